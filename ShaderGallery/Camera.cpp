@@ -1,4 +1,5 @@
 #include "Camera.h"
+#include <Windows.h>
 
 Camera::Camera(float x, float y, float z)
 {
@@ -108,6 +109,32 @@ void Camera::UpdateProjectionMatrix(float width, float height)
 	XMStoreFloat4x4(&projMatrix, XMMatrixTranspose(XMMatrixOrthographicOffCenterLH(0.0f, width, 0.0f, height, 0.0f, 100.0f)));
 }
 
+// Pulls the frustum planes out of view * projection (Gribb & Hartmann)
+void Camera::GetFrustumPlanes(XMFLOAT4 planes[6])
+{
+	GetFrustumPlanes(viewMatrix, projMatrix, planes);
+}
+
+void Camera::GetFrustumPlanes(XMFLOAT4X4 view, XMFLOAT4X4 projection, XMFLOAT4 planes[6])
+{
+	// Both matrices are stored transposed for HLSL, so this product is
+	// (view * projection) transposed and its rows are the clip space axes
+	XMFLOAT4X4 m;
+	XMStoreFloat4x4(&m, XMMatrixMultiply(XMLoadFloat4x4(&projection), XMLoadFloat4x4(&view)));
+
+	XMVECTOR x = XMVectorSet(m._11, m._12, m._13, m._14);
+	XMVECTOR y = XMVectorSet(m._21, m._22, m._23, m._24);
+	XMVECTOR z = XMVectorSet(m._31, m._32, m._33, m._34);
+	XMVECTOR w = XMVectorSet(m._41, m._42, m._43, m._44);
+
+	XMStoreFloat4(&planes[0], XMPlaneNormalize(w + x));	// Left
+	XMStoreFloat4(&planes[1], XMPlaneNormalize(w - x));	// Right
+	XMStoreFloat4(&planes[2], XMPlaneNormalize(w + y));	// Bottom
+	XMStoreFloat4(&planes[3], XMPlaneNormalize(w - y));	// Top
+	XMStoreFloat4(&planes[4], XMPlaneNormalize(z));		// Near (D3D clip z starts at 0)
+	XMStoreFloat4(&planes[5], XMPlaneNormalize(w - z));	// Far
+}
+
 void Camera::MakeGUI()
 {
 	// Set up the view
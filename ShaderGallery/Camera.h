@@ -1,6 +1,6 @@
 #pragma once
 
-#include "Game.h"
+#include <DirectXMath.h>
 using namespace DirectX;
 
 class Camera
@@ -31,6 +31,13 @@ public:
 	XMFLOAT4X4 GetView() { return viewMatrix; }
 	XMFLOAT4X4 GetProjection() { return projMatrix; }
 
+	// World space planes of the view frustum (left, right, bottom, top, near, far),
+	// normals pointing inward
+	void GetFrustumPlanes(XMFLOAT4 planes[6]);
+
+	// The same for any view and projection (both stored transposed), like the shadow map's
+	static void GetFrustumPlanes(XMFLOAT4X4 view, XMFLOAT4X4 projection, XMFLOAT4 planes[6]);
+
 	void SetPosition(XMFLOAT3 pPosition);
 	void SetRotation(XMFLOAT4 pRotation);
 
@@ -0,0 +1,40 @@
+#pragma once
+#include <chrono>
+
+// --------------------------------------------------------
+// Where the game loop gets the time from.
+//
+// SteadyClock is the real one (the performance counter,
+// on Windows).  ManualClock only moves when it's told to,
+// so a run can be replayed frame for frame, or the loop
+// driven with made-up frame times without a window.
+// --------------------------------------------------------
+class Clock
+{
+public:
+	virtual ~Clock() {}
+
+	// Seconds since some fixed point; never goes backwards
+	virtual double GetSeconds() = 0;
+};
+
+class SteadyClock : public Clock
+{
+public:
+	double GetSeconds()
+	{
+		return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+};
+
+class ManualClock : public Clock
+{
+public:
+	ManualClock(double seconds = 0.0) { this->seconds = seconds; }
+
+	void Advance(double seconds) { this->seconds += seconds; }
+	double GetSeconds() { return seconds; }
+
+private:
+	double seconds;
+};
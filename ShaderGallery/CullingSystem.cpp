@@ -0,0 +1,289 @@
+#include "CullingSystem.h"
+
+#include <float.h>
+#include <math.h>
+
+#include "Parallel.h"
+
+// Fewer bounds than this aren't worth the threads
+#define PARALLEL_CULL_THRESHOLD 32768
+
+// Per plane, broadcast: normal, distance, then the normal's absolute value
+#define CULL_PLANE_VALUES 7
+
+// From this many bounds on, the tree culls faster than testing them all
+#define TREE_CULL_THRESHOLD 4096
+
+// Loosened tree leaves put back properly per UpdateWorldBounds().  Each
+// costs a few microseconds, so this caps the frame's share.
+#define TREE_REBALANCE_BUDGET 64
+
+using namespace DirectX;
+
+CullingSystem::CullingSystem(TransformSystem* transforms)
+{
+	this->transforms = transforms;
+	count = 0;
+	boundedCount = 0;
+	threadCount = GetHardwareThreadCount();
+	anyStale = false;
+}
+
+CullingSystem::~CullingSystem()
+{
+}
+
+void CullingSystem::SetThreadCount(unsigned int threads)
+{
+	threadCount = threads > 0 ? threads : 1;
+}
+
+void CullingSystem::Grow(unsigned int needed)
+{
+	if (needed <= count) return;
+
+	// Whole groups of 8, so the cull never runs off the end.  New slots
+	// have no bounds: infinitely big, so they always pass.
+	needed = (needed + 7) & ~7u;
+	localCenters.resize(needed, XMFLOAT3(0, 0, 0));
+	localExtents.resize(needed, XMFLOAT3(0, 0, 0));
+	localRadii.resize(needed, 0);
+	bounded.resize(needed, 0);
+	stale.resize(needed, 0);
+	centerX.resize(needed, 0);
+	centerY.resize(needed, 0);
+	centerZ.resize(needed, 0);
+	extentX.resize(needed, FLT_MAX);
+	extentY.resize(needed, FLT_MAX);
+	extentZ.resize(needed, FLT_MAX);
+	radius.resize(needed, FLT_MAX);
+	count = needed;
+}
+
+void CullingSystem::SetLocalBounds(unsigned int transform, XMFLOAT3 min, XMFLOAT3 max, float radius)
+{
+	Grow(transform + 1);
+	if (!bounded[transform]) boundedCount++;
+
+	localCenters[transform] = XMFLOAT3((min.x + max.x) / 2, (min.y + max.y) / 2, (min.z + max.z) / 2);
+	localExtents[transform] = XMFLOAT3((max.x - min.x) / 2, (max.y - min.y) / 2, (max.z - min.z) / 2);
+	localRadii[transform] = radius;
+	bounded[transform] = 1;
+	stale[transform] = 1;
+	anyStale = true;
+}
+
+void CullingSystem::ClearBounds(unsigned int transform)
+{
+	if (!HasBounds(transform)) return;
+
+	bounded[transform] = 0;
+	stale[transform] = 0;
+	boundedCount--;
+	clearedBounds.push_back(transform);
+	tree.Remove(transform);
+	centerX[transform] = centerY[transform] = centerZ[transform] = 0;
+	extentX[transform] = extentY[transform] = extentZ[transform] = FLT_MAX;
+	radius[transform] = FLT_MAX;
+}
+
+XMFLOAT3 CullingSystem::GetWorldCenter(unsigned int transform)
+{
+	return XMFLOAT3(centerX[transform], centerY[transform], centerZ[transform]);
+}
+
+XMFLOAT3 CullingSystem::GetWorldExtents(unsigned int transform)
+{
+	return XMFLOAT3(extentX[transform], extentY[transform], extentZ[transform]);
+}
+
+void CullingSystem::UpdateWorldBounds()
+{
+	changedBounds.swap(clearedBounds);
+	clearedBounds.clear();
+
+	bool moved = transforms->AnyWorldChanged();
+	if (moved || anyStale)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			if (!bounded[i]) continue;
+			if (stale[i] || (moved && transforms->WorldChanged(i)))
+			{
+				RefreshWorldBounds(i);
+				stale[i] = 0;
+				changedBounds.push_back(i);
+			}
+		}
+
+		anyStale = false;
+	}
+
+	// Whatever moved far enough to loosen the tree is put back a bit at a time
+	tree.Rebalance(TREE_REBALANCE_BUDGET);
+}
+
+void CullingSystem::RefreshWorldBounds(unsigned int transform)
+{
+	// Stored transposed, so row r of m gives world axis r in terms of
+	// the local axes (plus the translation in column 4)
+	XMFLOAT4X4 m = transforms->GetWorldMatrix(transform);
+	XMFLOAT3 c = localCenters[transform];
+	XMFLOAT3 e = localExtents[transform];
+
+	centerX[transform] = m._11 * c.x + m._12 * c.y + m._13 * c.z + m._14;
+	centerY[transform] = m._21 * c.x + m._22 * c.y + m._23 * c.z + m._24;
+	centerZ[transform] = m._31 * c.x + m._32 * c.y + m._33 * c.z + m._34;
+
+	// The box that holds the rotated box
+	extentX[transform] = fabsf(m._11) * e.x + fabsf(m._12) * e.y + fabsf(m._13) * e.z;
+	extentY[transform] = fabsf(m._21) * e.x + fabsf(m._22) * e.y + fabsf(m._23) * e.z;
+	extentZ[transform] = fabsf(m._31) * e.x + fabsf(m._32) * e.y + fabsf(m._33) * e.z;
+
+	// The sphere grows by the biggest scale on any axis
+	float scaleX = m._11 * m._11 + m._21 * m._21 + m._31 * m._31;
+	float scaleY = m._12 * m._12 + m._22 * m._22 + m._32 * m._32;
+	float scaleZ = m._13 * m._13 + m._23 * m._23 + m._33 * m._33;
+	float scale = scaleX > scaleY ? scaleX : scaleY;
+	scale = scale > scaleZ ? scale : scaleZ;
+	radius[transform] = localRadii[transform] * sqrtf(scale);
+
+	// Only touches the tree when it leaves its leaf's box
+	XMFLOAT3 center(centerX[transform], centerY[transform], centerZ[transform]);
+	XMFLOAT3 extents(extentX[transform], extentY[transform], extentZ[transform]);
+	tree.Move(transform,
+		XMFLOAT3(center.x - extents.x, center.y - extents.y, center.z - extents.z),
+		XMFLOAT3(center.x + extents.x, center.y + extents.y, center.z + extents.z));
+}
+
+unsigned int CullingSystem::Cull(const XMFLOAT4 planes[6], std::vector<unsigned char>& visible)
+{
+	visible.resize(count);
+	if (count == 0) return 0;
+	if (boundedCount >= TREE_CULL_THRESHOLD) return CullTree(planes, visible);
+
+	// Broadcast each plane once, outside the loop
+	__m128 planeData[6 * CULL_PLANE_VALUES];
+	for (int p = 0; p < 6; p++)
+	{
+		float values[CULL_PLANE_VALUES] = {
+			planes[p].x, planes[p].y, planes[p].z, planes[p].w,
+			fabsf(planes[p].x), fabsf(planes[p].y), fabsf(planes[p].z) };
+
+		for (int v = 0; v < CULL_PLANE_VALUES; v++)
+		{
+			planeData[p * CULL_PLANE_VALUES + v] = _mm_set1_ps(values[v]);
+		}
+	}
+
+	// Split into whole groups of 8 across the workers
+	unsigned int groups = count / 8;
+	unsigned int workers = count >= PARALLEL_CULL_THRESHOLD ? threadCount : 1;
+	if (workers > groups) workers = groups;
+	unsigned int chunk = (groups + workers - 1) / workers;
+
+	std::vector<unsigned int> visibleCounts(workers, 0);
+	RunParallel(workers, [&](unsigned int t)
+	{
+		unsigned int first = t * chunk * 8;
+		unsigned int last = (t + 1) * chunk * 8 < count ? (t + 1) * chunk * 8 : count;
+		if (first < last) visibleCounts[t] = CullRange(planeData, first, last, &visible[0]);
+	});
+
+	unsigned int total = 0;
+	for (unsigned int t = 0; t < workers; t++)
+	{
+		total += visibleCounts[t];
+	}
+	return total;
+}
+
+unsigned int CullingSystem::CullRange(const __m128* planeData, unsigned int first, unsigned int last, unsigned char* visible)
+{
+	const __m128 zero = _mm_setzero_ps();
+	unsigned int visibleCount = 0;
+
+	for (unsigned int i = first; i < last; i += 8)
+	{
+		__m128 cxA = _mm_loadu_ps(&centerX[i]), cxB = _mm_loadu_ps(&centerX[i + 4]);
+		__m128 cyA = _mm_loadu_ps(&centerY[i]), cyB = _mm_loadu_ps(&centerY[i + 4]);
+		__m128 czA = _mm_loadu_ps(&centerZ[i]), czB = _mm_loadu_ps(&centerZ[i + 4]);
+		__m128 exA = _mm_loadu_ps(&extentX[i]), exB = _mm_loadu_ps(&extentX[i + 4]);
+		__m128 eyA = _mm_loadu_ps(&extentY[i]), eyB = _mm_loadu_ps(&extentY[i + 4]);
+		__m128 ezA = _mm_loadu_ps(&extentZ[i]), ezB = _mm_loadu_ps(&extentZ[i + 4]);
+		__m128 rA = _mm_loadu_ps(&radius[i]), rB = _mm_loadu_ps(&radius[i + 4]);
+
+		__m128 outsideA = zero;
+		__m128 outsideB = zero;
+		for (int p = 0; p < 6; p++)
+		{
+			const __m128* plane = &planeData[p * CULL_PLANE_VALUES];
+			__m128 nx = plane[0], ny = plane[1], nz = plane[2], w = plane[3];
+			__m128 ax = plane[4], ay = plane[5], az = plane[6];
+
+			// Signed distance of the center, and how far each shape reaches toward the plane
+			__m128 distanceA = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cxA), _mm_mul_ps(ny, cyA)), _mm_add_ps(_mm_mul_ps(nz, czA), w));
+			__m128 distanceB = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cxB), _mm_mul_ps(ny, cyB)), _mm_add_ps(_mm_mul_ps(nz, czB), w));
+			__m128 reachA = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, exA), _mm_mul_ps(ay, eyA)), _mm_mul_ps(az, ezA));
+			__m128 reachB = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax, exB), _mm_mul_ps(ay, eyB)), _mm_mul_ps(az, ezB));
+			reachA = _mm_min_ps(reachA, rA);
+			reachB = _mm_min_ps(reachB, rB);
+
+			outsideA = _mm_or_ps(outsideA, _mm_cmplt_ps(_mm_add_ps(distanceA, reachA), zero));
+			outsideB = _mm_or_ps(outsideB, _mm_cmplt_ps(_mm_add_ps(distanceB, reachB), zero));
+		}
+
+		int outside = _mm_movemask_ps(outsideA) | (_mm_movemask_ps(outsideB) << 4);
+		for (unsigned int k = 0; k < 8; k++)
+		{
+			unsigned char inside = (outside >> k & 1) ^ 1;
+			visible[i + k] = inside;
+			visibleCount += inside & bounded[i + k];
+		}
+	}
+
+	return visibleCount;
+}
+
+unsigned int CullingSystem::CullTree(const XMFLOAT4 planes[6], std::vector<unsigned char>& visible)
+{
+	// Transforms without bounds always pass; the tree says which bounded ones do
+	for (unsigned int i = 0; i < count; i++)
+	{
+		visible[i] = bounded[i] ^ 1;
+	}
+
+	treeInside.clear();
+	treeCrossing.clear();
+	tree.QueryFrustum(planes, treeInside, treeCrossing);
+
+	for (size_t i = 0; i < treeInside.size(); i++)
+	{
+		visible[treeInside[i]] = 1;
+	}
+	unsigned int visibleCount = (unsigned int)treeInside.size();
+
+	// Boxes crossing a plane get the same box-or-sphere test as CullRange(),
+	// in the same order, so the two always agree
+	for (size_t i = 0; i < treeCrossing.size(); i++)
+	{
+		unsigned int t = treeCrossing[i];
+		bool outside = false;
+		for (int p = 0; p < 6 && !outside; p++)
+		{
+			const XMFLOAT4& plane = planes[p];
+			float distance = (plane.x * centerX[t] + plane.y * centerY[t]) + (plane.z * centerZ[t] + plane.w);
+			float reach = (fabsf(plane.x) * extentX[t] + fabsf(plane.y) * extentY[t]) + fabsf(plane.z) * extentZ[t];
+			reach = reach < radius[t] ? reach : radius[t];
+			outside = distance + reach < 0;
+		}
+
+		if (!outside)
+		{
+			visible[t] = 1;
+			visibleCount++;
+		}
+	}
+
+	return visibleCount;
+}
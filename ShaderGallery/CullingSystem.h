@@ -0,0 +1,106 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <xmmintrin.h>
+
+#include "TransformSystem.h"
+#include "DynamicBVH.h"
+
+// --------------------------------------------------------
+// World space bounds for everything drawable, and view
+// frustum culling against them.
+//
+// Bounds are addressed by transform index, so an entity's
+// bounds live at its GetTransform().  Each has a local box
+// (usually its mesh's) and a sphere around the box's center;
+// world bounds are only recomputed for transforms the last
+// TransformSystem batch actually moved.
+//
+// World bounds are kept in structure-of-arrays form and a
+// cull tests 8 of them per loop iteration, as two 4-wide SSE
+// halves, against all six planes.  Something is culled when
+// it's entirely behind a plane by either its box or its
+// sphere, whichever reaches less far toward the plane.
+// Transforms without bounds (GUI, bare nodes) are never
+// culled and aren't counted.
+//
+// World boxes are also kept in a DynamicBVH, refit as they
+// move.  Big scenes are culled through it instead: whole
+// subtrees in view or out of it are settled at once, and
+// only what crosses a plane gets the test above.  It gives
+// the same answer, and it's there for sphere and ray
+// queries over everything drawable.
+// --------------------------------------------------------
+class CullingSystem
+{
+public:
+	CullingSystem(TransformSystem* transforms);
+	~CullingSystem();
+
+	void SetLocalBounds(unsigned int transform, DirectX::XMFLOAT3 min, DirectX::XMFLOAT3 max, float radius);
+	void ClearBounds(unsigned int transform);
+	bool HasBounds(unsigned int transform) { return transform < count && bounded[transform]; }
+
+	// Refreshes the world bounds of whatever moved in the last
+	// UpdateWorldMatrices(), so call it right after that
+	void UpdateWorldBounds();
+
+	// Transforms whose world bounds the last UpdateWorldBounds() refreshed,
+	// or whose bounds were cleared since the one before, for anything
+	// filed by them (like the portal graph's rooms) to follow
+	const std::vector<unsigned int>& GetChangedBounds() { return changedBounds; }
+
+	// Planes point inward (see Camera::GetFrustumPlanes).  Fills one flag
+	// per transform and returns how many bounded ones are visible.
+	unsigned int Cull(const DirectX::XMFLOAT4 planes[6], std::vector<unsigned char>& visible);
+
+	// Every bounded transform's world box, current as of UpdateWorldBounds()
+	DynamicBVH* GetTree() { return &tree; }
+
+	DirectX::XMFLOAT3 GetWorldCenter(unsigned int transform);
+	DirectX::XMFLOAT3 GetWorldExtents(unsigned int transform);
+	float GetWorldRadius(unsigned int transform) { return radius[transform]; }
+
+	unsigned int GetBoundedCount() { return boundedCount; }
+
+	// Transforms below this might have bounds
+	unsigned int GetSlotCount() { return count; }
+
+	void SetThreadCount(unsigned int threads);
+	unsigned int GetThreadCount() { return threadCount; }
+
+private:
+	void Grow(unsigned int needed);
+	void RefreshWorldBounds(unsigned int transform);
+	unsigned int CullRange(const __m128* planeData, unsigned int first, unsigned int last, unsigned char* visible);
+	unsigned int CullTree(const DirectX::XMFLOAT4 planes[6], std::vector<unsigned char>& visible);
+
+	TransformSystem* transforms;
+	unsigned int count;			// Slots in use, a multiple of 8
+	unsigned int boundedCount;
+	unsigned int threadCount;
+
+	// Local bounds
+	std::vector<DirectX::XMFLOAT3> localCenters;
+	std::vector<DirectX::XMFLOAT3> localExtents;
+	std::vector<float> localRadii;
+	std::vector<unsigned char> bounded;
+	std::vector<unsigned char> stale;		// New bounds not in world space yet
+	bool anyStale;
+	std::vector<unsigned int> changedBounds;
+	std::vector<unsigned int> clearedBounds;	// Since the last UpdateWorldBounds()
+
+	// World bounds, SoA; the sphere shares the box's center
+	std::vector<float> centerX;
+	std::vector<float> centerY;
+	std::vector<float> centerZ;
+	std::vector<float> extentX;
+	std::vector<float> extentY;
+	std::vector<float> extentZ;
+	std::vector<float> radius;
+
+	// The same boxes, as a tree, and what its last frustum query found
+	DynamicBVH tree;
+	std::vector<unsigned int> treeInside;
+	std::vector<unsigned int> treeCrossing;
+};
@@ -0,0 +1,60 @@
+#include "D3D11RenderBackend.h"
+#include "SimpleShader.h"
+
+namespace
+{
+	// Handles come in const, but binding through them isn't
+	ISimpleShader* ShaderOf(const void* shader)
+	{
+		return (ISimpleShader*)shader;
+	}
+}
+
+D3D11RenderBackend::D3D11RenderBackend(ID3D11DeviceContext* context)
+{
+	this->context = context;
+}
+
+D3D11RenderBackend::~D3D11RenderBackend()
+{
+}
+
+void D3D11RenderBackend::SetShader(const void* shader)
+{
+	ShaderOf(shader)->SetShader();
+}
+
+void D3D11RenderBackend::SetConstant(const void* shader, const char* name, const void* data, unsigned int size)
+{
+	ShaderOf(shader)->SetData(name, data, size);
+}
+
+void D3D11RenderBackend::UploadConstants(const void* shader, const char* buffer)
+{
+	if (buffer) ShaderOf(shader)->CopyBufferData(buffer);
+	else ShaderOf(shader)->CopyAllBufferData();
+}
+
+void D3D11RenderBackend::SetTexture(const void* shader, const char* name, const void* view)
+{
+	ShaderOf(shader)->SetShaderResourceView(name, (ID3D11ShaderResourceView*)view);
+}
+
+void D3D11RenderBackend::SetSampler(const void* shader, const char* name, const void* sampler)
+{
+	ShaderOf(shader)->SetSamplerState(name, (ID3D11SamplerState*)sampler);
+}
+
+void D3D11RenderBackend::SetGeometry(const void* vertices, const void* indices, unsigned int stride)
+{
+	ID3D11Buffer* vertexBuffer = (ID3D11Buffer*)vertices;
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	context->IASetIndexBuffer((ID3D11Buffer*)indices, DXGI_FORMAT_R32_UINT, 0);
+}
+
+void D3D11RenderBackend::Draw(unsigned int indexCount, unsigned int instanceCount, unsigned int firstInstance)
+{
+	if (instanceCount > 0) context->DrawIndexedInstanced(indexCount, instanceCount, 0, 0, firstInstance);
+	else context->DrawIndexed(indexCount, 0, 0);
+}
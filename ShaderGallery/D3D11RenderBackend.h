@@ -0,0 +1,30 @@
+#pragma once
+#include <d3d11.h>
+#include "RenderCommandList.h"
+
+// --------------------------------------------------------
+// Plays command lists onto a device context.
+//
+// Shader handles are ISimpleShader pointers (so variables
+// and buffers are looked up by name), views are shader
+// resource views, samplers are sampler states, and
+// geometry is a vertex and an index buffer.  Vertex
+// buffers go in slot 0; indices are 32-bit.
+// --------------------------------------------------------
+class D3D11RenderBackend : public RenderBackend
+{
+public:
+	D3D11RenderBackend(ID3D11DeviceContext* context);
+	~D3D11RenderBackend();
+
+	void SetShader(const void* shader);
+	void SetConstant(const void* shader, const char* name, const void* data, unsigned int size);
+	void UploadConstants(const void* shader, const char* buffer);
+	void SetTexture(const void* shader, const char* name, const void* view);
+	void SetSampler(const void* shader, const char* name, const void* sampler);
+	void SetGeometry(const void* vertices, const void* indices, unsigned int stride);
+	void Draw(unsigned int indexCount, unsigned int instanceCount, unsigned int firstInstance);
+
+private:
+	ID3D11DeviceContext* context;
+};
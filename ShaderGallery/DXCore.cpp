@@ -57,10 +57,12 @@ DXCore::DXCore(
 	backBufferRTV = 0;
 	depthStencilView = 0;
 
-	// Query performance counter for accurate timing information
-	__int64 perfFreq;
-	QueryPerformanceFrequency((LARGE_INTEGER*)&perfFreq);
-	perfCounterSeconds = 1.0 / (double)perfFreq;
+	// The steady clock is the performance counter underneath
+	clock = &steadyClock;
+	totalTime = 0.0f;
+	deltaTime = 0.0f;
+	startTime = 0.0;
+	previousTime = 0.0;
 }
 
 // --------------------------------------------------------
@@ -344,11 +346,10 @@ HRESULT DXCore::Run()
 {
 	// Grab the start time now that
 	// the game loop is running
-	__int64 now;
-	QueryPerformanceCounter((LARGE_INTEGER*)&now);
+	double now = clock->GetSeconds();
 	startTime = now;
-	currentTime = now;
 	previousTime = now;
+	timestep.Reset();
 
 	// Give subclass a chance to initialize
 	Init();
@@ -372,8 +373,11 @@ HRESULT DXCore::Run()
 			if(titleBarStats)
 				UpdateTitleBarStats();
 
-			// The game loop
-			Update(deltaTime, totalTime);
+			// The game loop: as many fixed ticks as this frame's time
+			// covers (maybe none), then one draw
+			timestep.Advance(deltaTime);
+			while (timestep.Tick())
+				Update(timestep.GetTickLength(), (float)timestep.GetTime());
 			Draw(deltaTime, totalTime);
 		}
 	}
@@ -395,26 +399,38 @@ void DXCore::Quit()
 
 
 // --------------------------------------------------------
-// Uses high resolution time stamps to get very accurate
-// timing information, and calculates useful time stats
+// Swaps the clock the loop reads (a ManualClock makes runs
+// repeatable).  Times carry on from the new clock's now.
+// --------------------------------------------------------
+void DXCore::SetClock(Clock* clock)
+{
+	double elapsed = previousTime - startTime;
+
+	this->clock = clock ? clock : &steadyClock;
+	previousTime = this->clock->GetSeconds();
+	startTime = previousTime - elapsed;
+}
+
+
+// --------------------------------------------------------
+// Reads the clock (high resolution time stamps, unless it's
+// been swapped) and calculates useful time stats
 // --------------------------------------------------------
 void DXCore::UpdateTimer()
 {
 	// Grab the current time
-	__int64 now;
-	QueryPerformanceCounter((LARGE_INTEGER*)&now);
-	currentTime = now;
+	double now = clock->GetSeconds();
 
 	// Calculate delta time and clamp to zero
 	//  - Could go negative if CPU goes into power save mode 
 	//    or the process itself gets moved to another core
-	deltaTime = max((float)((currentTime - previousTime) * perfCounterSeconds), 0.0f);
+	deltaTime = max((float)(now - previousTime), 0.0f);
 
 	// Calculate the total time from start to now
-	totalTime = (float)((currentTime - startTime) * perfCounterSeconds);
+	totalTime = (float)(now - startTime);
 
 	// Save current time for next frame
-	previousTime = currentTime;
+	previousTime = now;
 }
 
 
@@ -444,7 +460,8 @@ void DXCore::UpdateTitleBarStats()
 		"    Width: "		<< width <<
 		"    Height: "		<< height <<
 		"    FPS: "			<< fpsFrameCount <<
-		"    Frame Time: "	<< mspf << "ms";
+		"    Frame Time: "	<< mspf << "ms" <<
+		GetTitleBarStats();
 
 	// Append the version of DirectX the app is using
 	switch (dxFeatureLevel)
@@ -4,6 +4,9 @@
 #include <d3d11.h>
 #include <string>
 
+#include "Clock.h"
+#include "FixedTimestep.h"
+
 // We can include the correct library files here
 // instead of in Visual Studio settings if we want
 #pragma comment(lib, "d3d11.lib")
@@ -38,7 +41,13 @@ public:
 	void Quit();
 	virtual void OnResize();
 	
-	// Pure virtual methods for setup and game functionality
+	// Where the loop gets the time from; null goes back to the real clock.
+	// The caller keeps ownership.
+	void SetClock(Clock* clock);
+
+	// Pure virtual methods for setup and game functionality.  Update runs once
+	// per fixed tick (deltaTime is the tick length, totalTime the simulation
+	// time); Draw runs once per frame with real frame and total time.
 	virtual void Init()										= 0;
 	virtual void Update(float deltaTime, float totalTime)	= 0;
 	virtual void Draw(float deltaTime, float totalTime)		= 0;
@@ -49,6 +58,9 @@ public:
 	virtual void OnMouseUp	 (WPARAM buttonState, int x, int y) { }
 	virtual void OnMouseMove (WPARAM buttonState, int x, int y) { }
 	virtual void OnMouseWheel(float wheelDelta,   int x, int y) { }
+
+	// Extra text for the title bar stats (once a second, when they're on)
+	virtual std::string GetTitleBarStats() { return std::string(); }
 	
 protected:
 	HINSTANCE	hInstance;		// The handle to the application
@@ -69,17 +81,21 @@ protected:
 	ID3D11RenderTargetView* backBufferRTV;
 	ID3D11DepthStencilView* depthStencilView;
 
+	// Splits real time into simulation ticks; Draw can ask it
+	// how far between the last two ticks the frame is
+	FixedTimestep timestep;
+
 	// Helper function for allocating a console window
 	void CreateConsoleWindow(int bufferLines, int bufferColumns, int windowLines, int windowColumns);
 
 private:
 	// Timing related data
-	double perfCounterSeconds;
+	SteadyClock steadyClock;
+	Clock* clock;
 	float totalTime;
 	float deltaTime;
-	__int64 startTime;
-	__int64 currentTime;
-	__int64 previousTime;
+	double startTime;
+	double previousTime;
 
 	// FPS calculation
 	int fpsFrameCount;
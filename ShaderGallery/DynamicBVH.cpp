@@ -0,0 +1,607 @@
+#include "DynamicBVH.h"
+
+#include <float.h>
+#include <math.h>
+
+using namespace DirectX;
+
+namespace
+{
+	XMFLOAT3 Min3(XMFLOAT3 a, XMFLOAT3 b)
+	{
+		return XMFLOAT3(fminf(a.x, b.x), fminf(a.y, b.y), fminf(a.z, b.z));
+	}
+
+	XMFLOAT3 Max3(XMFLOAT3 a, XMFLOAT3 b)
+	{
+		return XMFLOAT3(fmaxf(a.x, b.x), fmaxf(a.y, b.y), fmaxf(a.z, b.z));
+	}
+
+	// Half the surface area; only ever compared, so the 2 doesn't matter
+	float Area(XMFLOAT3 min, XMFLOAT3 max)
+	{
+		float x = max.x - min.x;
+		float y = max.y - min.y;
+		float z = max.z - min.z;
+		return x * y + y * z + z * x;
+	}
+
+	float UnionArea(XMFLOAT3 minA, XMFLOAT3 maxA, XMFLOAT3 minB, XMFLOAT3 maxB)
+	{
+		return Area(Min3(minA, minB), Max3(maxA, maxB));
+	}
+
+	bool BoxContains(XMFLOAT3 outerMin, XMFLOAT3 outerMax, XMFLOAT3 min, XMFLOAT3 max)
+	{
+		return outerMin.x <= min.x && outerMin.y <= min.y && outerMin.z <= min.z &&
+			max.x <= outerMax.x && max.y <= outerMax.y && max.z <= outerMax.z;
+	}
+
+	bool SameBox(XMFLOAT3 minA, XMFLOAT3 maxA, XMFLOAT3 minB, XMFLOAT3 maxB)
+	{
+		return minA.x == minB.x && minA.y == minB.y && minA.z == minB.z &&
+			maxA.x == maxB.x && maxA.y == maxB.y && maxA.z == maxB.z;
+	}
+
+	// Where the ray enters the box (0 if it starts inside), or FLT_MAX if it misses
+	float RayEnter(XMFLOAT3 origin, XMFLOAT3 inverse, float maxDistance, XMFLOAT3 min, XMFLOAT3 max)
+	{
+		float t1 = (min.x - origin.x) * inverse.x, t2 = (max.x - origin.x) * inverse.x;
+		float enter = fminf(t1, t2), leave = fmaxf(t1, t2);
+		t1 = (min.y - origin.y) * inverse.y; t2 = (max.y - origin.y) * inverse.y;
+		enter = fmaxf(enter, fminf(t1, t2)); leave = fminf(leave, fmaxf(t1, t2));
+		t1 = (min.z - origin.z) * inverse.z; t2 = (max.z - origin.z) * inverse.z;
+		enter = fmaxf(enter, fminf(t1, t2)); leave = fminf(leave, fmaxf(t1, t2));
+
+		enter = fmaxf(enter, 0.0f);
+		return enter <= leave && enter <= maxDistance ? enter : FLT_MAX;
+	}
+}
+
+DynamicBVH::DynamicBVH()
+{
+	root = DYNAMIC_BVH_NONE;
+	freeList = DYNAMIC_BVH_NONE;
+	freeCount = 0;
+	itemCount = 0;
+	pendingHead = 0;
+}
+
+DynamicBVH::~DynamicBVH()
+{
+}
+
+unsigned int DynamicBVH::AllocateNode()
+{
+	unsigned int node;
+	if (freeList != DYNAMIC_BVH_NONE)
+	{
+		node = freeList;
+		freeList = nodes[node].parent;
+		freeCount--;
+	}
+	else
+	{
+		node = (unsigned int)nodes.size();
+		nodes.push_back(Node());
+	}
+
+	Node& n = nodes[node];
+	n.min = n.max = XMFLOAT3(0, 0, 0);
+	n.parent = n.left = n.right = DYNAMIC_BVH_NONE;
+	n.item = DYNAMIC_BVH_NONE;
+	n.height = 0;
+	return node;
+}
+
+void DynamicBVH::FreeNode(unsigned int node)
+{
+	nodes[node].parent = freeList;
+	nodes[node].height = -1;
+	freeList = node;
+	freeCount++;
+}
+
+void DynamicBVH::FattenLeaf(unsigned int leaf, unsigned int item, XMFLOAT3 motion)
+{
+	// Stretched ahead of where it's heading, so it stays inside for a few frames
+	XMVECTOR margin = XMVectorReplicate(DYNAMIC_BVH_MARGIN);
+	XMVECTOR ahead = XMVectorScale(XMLoadFloat3(&motion), DYNAMIC_BVH_MOTION_SCALE);
+	XMVECTOR zero = XMVectorZero();
+	XMVECTOR min = XMVectorSubtract(XMLoadFloat3(&itemMins[item]), margin);
+	XMVECTOR max = XMVectorAdd(XMLoadFloat3(&itemMaxes[item]), margin);
+	XMStoreFloat3(&nodes[leaf].min, XMVectorAdd(min, XMVectorMin(ahead, zero)));
+	XMStoreFloat3(&nodes[leaf].max, XMVectorAdd(max, XMVectorMax(ahead, zero)));
+}
+
+void DynamicBVH::Insert(unsigned int item, XMFLOAT3 min, XMFLOAT3 max)
+{
+	if (Contains(item))
+	{
+		Move(item, min, max);
+		return;
+	}
+
+	if (item >= itemLeaves.size())
+	{
+		itemLeaves.resize(item + 1, DYNAMIC_BVH_NONE);
+		itemMins.resize(item + 1, XMFLOAT3(0, 0, 0));
+		itemMaxes.resize(item + 1, XMFLOAT3(0, 0, 0));
+		itemPending.resize(item + 1, 0);
+	}
+
+	unsigned int leaf = AllocateNode();
+	nodes[leaf].item = item;
+	itemLeaves[item] = leaf;
+	itemMins[item] = min;
+	itemMaxes[item] = max;
+	FattenLeaf(leaf, item, XMFLOAT3(0, 0, 0));
+	InsertLeaf(leaf);
+	itemCount++;
+}
+
+bool DynamicBVH::Move(unsigned int item, XMFLOAT3 min, XMFLOAT3 max)
+{
+	if (!Contains(item))
+	{
+		Insert(item, min, max);
+		return true;
+	}
+
+	XMFLOAT3 motion(min.x - itemMins[item].x, min.y - itemMins[item].y, min.z - itemMins[item].z);
+	itemMins[item] = min;
+	itemMaxes[item] = max;
+
+	// Still inside its leaf: nothing in the tree changes
+	unsigned int leaf = itemLeaves[item];
+	if (BoxContains(nodes[leaf].min, nodes[leaf].max, min, max)) return false;
+
+	FattenLeaf(leaf, item, motion);
+	Refit(nodes[leaf].parent);
+
+	if (!itemPending[item])
+	{
+		itemPending[item] = 1;
+		pending.push_back(item);
+	}
+	return true;
+}
+
+void DynamicBVH::Remove(unsigned int item)
+{
+	if (!Contains(item)) return;
+
+	unsigned int leaf = itemLeaves[item];
+	RemoveLeaf(leaf);
+	FreeNode(leaf);
+	itemLeaves[item] = DYNAMIC_BVH_NONE;
+	itemCount--;
+}
+
+void DynamicBVH::Clear()
+{
+	nodes.clear();
+	root = DYNAMIC_BVH_NONE;
+	freeList = DYNAMIC_BVH_NONE;
+	freeCount = 0;
+	itemCount = 0;
+	itemLeaves.clear();
+	itemMins.clear();
+	itemMaxes.clear();
+	itemPending.clear();
+	pending.clear();
+	pendingHead = 0;
+}
+
+unsigned int DynamicBVH::Rebalance(unsigned int budget)
+{
+	// Oldest first, so nothing waits forever behind things that keep moving
+	while (budget > 0 && pendingHead < pending.size())
+	{
+		unsigned int item = pending[pendingHead++];
+		itemPending[item] = 0;
+		if (!Contains(item)) continue;
+
+		// Taken out and put back where it fits best now
+		unsigned int leaf = itemLeaves[item];
+		RemoveLeaf(leaf);
+		InsertLeaf(leaf);
+		budget--;
+	}
+
+	if (pendingHead == pending.size())
+	{
+		pending.clear();
+		pendingHead = 0;
+	}
+	else if (pendingHead > pending.size() / 2)
+	{
+		pending.erase(pending.begin(), pending.begin() + pendingHead);
+		pendingHead = 0;
+	}
+
+	return GetPendingCount();
+}
+
+void DynamicBVH::InsertLeaf(unsigned int leaf)
+{
+	if (root == DYNAMIC_BVH_NONE)
+	{
+		root = leaf;
+		nodes[leaf].parent = DYNAMIC_BVH_NONE;
+		return;
+	}
+
+	// Walk down toward the sibling that makes the tree's area grow least.
+	// Going further down always makes every node on the way grow too.
+	XMFLOAT3 leafMin = nodes[leaf].min;
+	XMFLOAT3 leafMax = nodes[leaf].max;
+	unsigned int index = root;
+	while (nodes[index].left != DYNAMIC_BVH_NONE)
+	{
+		const Node& n = nodes[index];
+		float area = Area(n.min, n.max);
+		float combined = UnionArea(n.min, n.max, leafMin, leafMax);
+
+		// Pairing with this node here, or pushing the leaf further down
+		float cost = 2 * combined;
+		float inherited = 2 * (combined - area);
+
+		float childCosts[2];
+		unsigned int children[2] = { n.left, n.right };
+		for (int c = 0; c < 2; c++)
+		{
+			const Node& child = nodes[children[c]];
+			childCosts[c] = UnionArea(child.min, child.max, leafMin, leafMax) + inherited;
+			if (child.left != DYNAMIC_BVH_NONE) childCosts[c] -= Area(child.min, child.max);
+		}
+
+		if (cost < childCosts[0] && cost < childCosts[1]) break;
+		index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+	}
+
+	// A new parent for the leaf and its sibling, in the sibling's place
+	unsigned int sibling = index;
+	unsigned int oldParent = nodes[sibling].parent;
+	unsigned int newParent = AllocateNode();
+	nodes[newParent].parent = oldParent;
+	nodes[newParent].min = Min3(leafMin, nodes[sibling].min);
+	nodes[newParent].max = Max3(leafMax, nodes[sibling].max);
+	nodes[newParent].height = nodes[sibling].height + 1;
+	nodes[newParent].left = sibling;
+	nodes[newParent].right = leaf;
+	nodes[sibling].parent = newParent;
+	nodes[leaf].parent = newParent;
+
+	if (oldParent == DYNAMIC_BVH_NONE) root = newParent;
+	else if (nodes[oldParent].left == sibling) nodes[oldParent].left = newParent;
+	else nodes[oldParent].right = newParent;
+
+	// Then everything above it is rebalanced and regrown
+	index = nodes[leaf].parent;
+	while (index != DYNAMIC_BVH_NONE)
+	{
+		index = Balance(index);
+		Node& n = nodes[index];
+		n.height = 1 + (nodes[n.left].height > nodes[n.right].height ? nodes[n.left].height : nodes[n.right].height);
+		n.min = Min3(nodes[n.left].min, nodes[n.right].min);
+		n.max = Max3(nodes[n.left].max, nodes[n.right].max);
+		index = n.parent;
+	}
+}
+
+void DynamicBVH::RemoveLeaf(unsigned int leaf)
+{
+	if (leaf == root)
+	{
+		root = DYNAMIC_BVH_NONE;
+		return;
+	}
+
+	// The sibling takes the parent's place
+	unsigned int parent = nodes[leaf].parent;
+	unsigned int grandParent = nodes[parent].parent;
+	unsigned int sibling = nodes[parent].left == leaf ? nodes[parent].right : nodes[parent].left;
+	FreeNode(parent);
+
+	if (grandParent == DYNAMIC_BVH_NONE)
+	{
+		root = sibling;
+		nodes[sibling].parent = DYNAMIC_BVH_NONE;
+		return;
+	}
+
+	if (nodes[grandParent].left == parent) nodes[grandParent].left = sibling;
+	else nodes[grandParent].right = sibling;
+	nodes[sibling].parent = grandParent;
+
+	unsigned int index = grandParent;
+	while (index != DYNAMIC_BVH_NONE)
+	{
+		index = Balance(index);
+		Node& n = nodes[index];
+		n.height = 1 + (nodes[n.left].height > nodes[n.right].height ? nodes[n.left].height : nodes[n.right].height);
+		n.min = Min3(nodes[n.left].min, nodes[n.right].min);
+		n.max = Max3(nodes[n.left].max, nodes[n.right].max);
+		index = n.parent;
+	}
+}
+
+void DynamicBVH::Refit(unsigned int node)
+{
+	// Stops as soon as a box comes out the same, since nothing above can change
+	while (node != DYNAMIC_BVH_NONE)
+	{
+		Node& n = nodes[node];
+		XMFLOAT3 min = Min3(nodes[n.left].min, nodes[n.right].min);
+		XMFLOAT3 max = Max3(nodes[n.left].max, nodes[n.right].max);
+		if (SameBox(min, max, n.min, n.max)) break;
+
+		n.min = min;
+		n.max = max;
+		node = n.parent;
+	}
+}
+
+// --------------------------------------------------------
+// Rotates the taller child of a up when the two sides differ
+// in height by more than one.  Returns the node now in a's
+// place.  Only heights and boxes of the two nodes that moved
+// change; callers fix the ones above.
+// --------------------------------------------------------
+unsigned int DynamicBVH::Balance(unsigned int a)
+{
+	Node& A = nodes[a];
+	if (A.left == DYNAMIC_BVH_NONE || A.height < 2) return a;
+
+	unsigned int b = A.left;
+	unsigned int c = A.right;
+	Node& B = nodes[b];
+	Node& C = nodes[c];
+	int balance = C.height - B.height;
+
+	if (balance > 1)
+	{
+		// C comes up; its taller child stays with it, the other goes to A
+		unsigned int f = C.left;
+		unsigned int g = C.right;
+		Node& F = nodes[f];
+		Node& G = nodes[g];
+
+		C.left = a;
+		C.parent = A.parent;
+		A.parent = c;
+		if (C.parent == DYNAMIC_BVH_NONE) root = c;
+		else if (nodes[C.parent].left == a) nodes[C.parent].left = c;
+		else nodes[C.parent].right = c;
+
+		unsigned int keep = F.height > G.height ? f : g;
+		unsigned int give = F.height > G.height ? g : f;
+		C.right = keep;
+		A.right = give;
+		nodes[give].parent = a;
+
+		A.min = Min3(B.min, nodes[give].min);
+		A.max = Max3(B.max, nodes[give].max);
+		A.height = 1 + (B.height > nodes[give].height ? B.height : nodes[give].height);
+		C.min = Min3(A.min, nodes[keep].min);
+		C.max = Max3(A.max, nodes[keep].max);
+		C.height = 1 + (A.height > nodes[keep].height ? A.height : nodes[keep].height);
+		return c;
+	}
+
+	if (balance < -1)
+	{
+		// The same with B
+		unsigned int d = B.left;
+		unsigned int e = B.right;
+		Node& D = nodes[d];
+		Node& E = nodes[e];
+
+		B.left = a;
+		B.parent = A.parent;
+		A.parent = b;
+		if (B.parent == DYNAMIC_BVH_NONE) root = b;
+		else if (nodes[B.parent].left == a) nodes[B.parent].left = b;
+		else nodes[B.parent].right = b;
+
+		unsigned int keep = D.height > E.height ? d : e;
+		unsigned int give = D.height > E.height ? e : d;
+		B.right = keep;
+		A.left = give;
+		nodes[give].parent = a;
+
+		A.min = Min3(C.min, nodes[give].min);
+		A.max = Max3(C.max, nodes[give].max);
+		A.height = 1 + (C.height > nodes[give].height ? C.height : nodes[give].height);
+		B.min = Min3(A.min, nodes[keep].min);
+		B.max = Max3(A.max, nodes[keep].max);
+		B.height = 1 + (A.height > nodes[keep].height ? A.height : nodes[keep].height);
+		return b;
+	}
+
+	return a;
+}
+
+void DynamicBVH::CollectLeaves(unsigned int node, std::vector<unsigned int>& found)
+{
+	const Node& n = nodes[node];
+	if (n.left == DYNAMIC_BVH_NONE)
+	{
+		found.push_back(n.item);
+		return;
+	}
+
+	CollectLeaves(n.left, found);
+	CollectLeaves(n.right, found);
+}
+
+void DynamicBVH::QueryFrustum(const XMFLOAT4 planes[6], std::vector<unsigned int>& inside, std::vector<unsigned int>& crossing)
+{
+	if (root == DYNAMIC_BVH_NONE) return;
+
+	// Each entry carries the planes its box still crosses; the ones a
+	// parent is wholly inside of aren't tested again below it
+	stack.clear();
+	stackMasks.clear();
+	stack.push_back(root);
+	stackMasks.push_back(0x3F);
+
+	while (!stack.empty())
+	{
+		unsigned int node = stack.back();
+		unsigned char mask = stackMasks.back();
+		stack.pop_back();
+		stackMasks.pop_back();
+
+		// Leaves too are tested with their (bigger) leaf box, so in and out
+		// are never down to rounding; what's close goes in crossing
+		const Node& n = nodes[node];
+		float cx = (n.min.x + n.max.x) * 0.5f, ex = (n.max.x - n.min.x) * 0.5f;
+		float cy = (n.min.y + n.max.y) * 0.5f, ey = (n.max.y - n.min.y) * 0.5f;
+		float cz = (n.min.z + n.max.z) * 0.5f, ez = (n.max.z - n.min.z) * 0.5f;
+
+		bool outside = false;
+		for (int p = 0; p < 6; p++)
+		{
+			if (!(mask >> p & 1)) continue;
+
+			const XMFLOAT4& plane = planes[p];
+			float distance = plane.x * cx + plane.y * cy + plane.z * cz + plane.w;
+			float reach = fabsf(plane.x) * ex + fabsf(plane.y) * ey + fabsf(plane.z) * ez;
+			if (distance + reach < 0)
+			{
+				outside = true;
+				break;
+			}
+			if (distance - reach >= 0) mask &= ~(1 << p);
+		}
+		if (outside) continue;
+
+		if (mask == 0) CollectLeaves(node, inside);
+		else if (n.left == DYNAMIC_BVH_NONE) crossing.push_back(n.item);
+		else
+		{
+			stack.push_back(n.left);
+			stackMasks.push_back(mask);
+			stack.push_back(n.right);
+			stackMasks.push_back(mask);
+		}
+	}
+}
+
+unsigned int DynamicBVH::QuerySphere(XMFLOAT3 center, float radius, std::vector<unsigned int>& found)
+{
+	size_t before = found.size();
+	if (root == DYNAMIC_BVH_NONE) return 0;
+
+	float radiusSquared = radius * radius;
+	stack.clear();
+	stack.push_back(root);
+	while (!stack.empty())
+	{
+		unsigned int node = stack.back();
+		stack.pop_back();
+
+		const Node& n = nodes[node];
+		bool leaf = n.left == DYNAMIC_BVH_NONE;
+		XMFLOAT3 min = leaf ? itemMins[n.item] : n.min;
+		XMFLOAT3 max = leaf ? itemMaxes[n.item] : n.max;
+
+		// Squared distance from the center to the nearest point of the box
+		float dx = fmaxf(fmaxf(min.x - center.x, center.x - max.x), 0.0f);
+		float dy = fmaxf(fmaxf(min.y - center.y, center.y - max.y), 0.0f);
+		float dz = fmaxf(fmaxf(min.z - center.z, center.z - max.z), 0.0f);
+		if (dx * dx + dy * dy + dz * dz > radiusSquared) continue;
+
+		if (leaf) found.push_back(n.item);
+		else
+		{
+			stack.push_back(n.left);
+			stack.push_back(n.right);
+		}
+	}
+
+	return (unsigned int)(found.size() - before);
+}
+
+unsigned int DynamicBVH::RayCast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, float* hitDistance)
+{
+	unsigned int hit = DYNAMIC_BVH_NONE;
+	float nearest = maxDistance;
+	if (root == DYNAMIC_BVH_NONE) return hit;
+
+	// Axes the ray runs along get a huge inverse instead of a division by zero
+	XMFLOAT3 inverse(
+		direction.x != 0 ? 1.0f / direction.x : FLT_MAX,
+		direction.y != 0 ? 1.0f / direction.y : FLT_MAX,
+		direction.z != 0 ? 1.0f / direction.z : FLT_MAX);
+
+	float rootEnter = RayEnter(origin, inverse, nearest, nodes[root].min, nodes[root].max);
+	if (rootEnter == FLT_MAX) return hit;
+
+	stack.clear();
+	stackDistances.clear();
+	stack.push_back(root);
+	stackDistances.push_back(rootEnter);
+
+	while (!stack.empty())
+	{
+		unsigned int node = stack.back();
+		float enter = stackDistances.back();
+		stack.pop_back();
+		stackDistances.pop_back();
+
+		// Something nearer was hit since this was pushed
+		if (enter > nearest) continue;
+
+		const Node& n = nodes[node];
+		if (n.left == DYNAMIC_BVH_NONE)
+		{
+			float t = RayEnter(origin, inverse, nearest, itemMins[n.item], itemMaxes[n.item]);
+			if (t != FLT_MAX && (t < nearest || (t == nearest && hit == DYNAMIC_BVH_NONE)))
+			{
+				nearest = t;
+				hit = n.item;
+			}
+			continue;
+		}
+
+		// The nearer child goes on top, so it's searched first
+		float leftEnter = RayEnter(origin, inverse, nearest, nodes[n.left].min, nodes[n.left].max);
+		float rightEnter = RayEnter(origin, inverse, nearest, nodes[n.right].min, nodes[n.right].max);
+		unsigned int nearChild = leftEnter <= rightEnter ? n.left : n.right;
+		unsigned int farChild = leftEnter <= rightEnter ? n.right : n.left;
+		float nearEnter = fminf(leftEnter, rightEnter);
+		float farEnter = fmaxf(leftEnter, rightEnter);
+
+		if (farEnter != FLT_MAX)
+		{
+			stack.push_back(farChild);
+			stackDistances.push_back(farEnter);
+		}
+		if (nearEnter != FLT_MAX)
+		{
+			stack.push_back(nearChild);
+			stackDistances.push_back(nearEnter);
+		}
+	}
+
+	if (hit != DYNAMIC_BVH_NONE && hitDistance) *hitDistance = nearest;
+	return hit;
+}
+
+float DynamicBVH::GetAreaRatio()
+{
+	if (root == DYNAMIC_BVH_NONE) return 0;
+
+	float rootArea = Area(nodes[root].min, nodes[root].max);
+	if (rootArea <= 0) return 0;
+
+	float total = 0;
+	for (size_t i = 0; i < nodes.size(); i++)
+	{
+		if (nodes[i].height > 0) total += Area(nodes[i].min, nodes[i].max);
+	}
+	return total / rootArea;
+}
@@ -0,0 +1,121 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+// No node, no item
+#define DYNAMIC_BVH_NONE 0xFFFFFFFF
+
+// How far each leaf's box reaches past its item's, so small moves
+// (jitter, spinning in place) don't touch the tree at all
+#define DYNAMIC_BVH_MARGIN 0.1f
+
+// Leaves that had to be regrown also reach this many of the
+// last move ahead, so steady movers don't regrow every frame
+#define DYNAMIC_BVH_MOTION_SCALE 4.0f
+
+// --------------------------------------------------------
+// Dynamic bounding volume hierarchy over world boxes that
+// can move every frame.
+//
+// Items are addressed by small ids (like transform indices)
+// and each gets a leaf whose box is a little bigger than the
+// item's.  New leaves go next to the sibling that grows the
+// tree's surface area least, and AVL-style rotations on the
+// way back up keep it balanced.
+//
+// Move() is a refit: while an item stays inside its leaf's
+// box nothing happens; otherwise the leaf is regrown around
+// it (reaching ahead the way it's going) and only its
+// ancestors' boxes are recomputed.  Refits are cheap but let
+// the tree loosen, so leaves that were refit are queued and
+// Rebalance() reinserts a budgeted number of them each call,
+// spreading the real fix over later frames.
+//
+// Queries:
+//  - frustum: everything in view, split into what's wholly
+//    inside (whole subtrees are taken without testing once
+//    they clear every plane) and what might cross a plane,
+//    judged by the leaf boxes, for the caller to test itself
+//  - sphere: every item box touching it
+//  - ray: the nearest item box it hits
+// --------------------------------------------------------
+class DynamicBVH
+{
+public:
+	DynamicBVH();
+	~DynamicBVH();
+
+	// Ids already in the tree are moved instead
+	void Insert(unsigned int item, DirectX::XMFLOAT3 min, DirectX::XMFLOAT3 max);
+
+	// Returns true if the tree had to change
+	bool Move(unsigned int item, DirectX::XMFLOAT3 min, DirectX::XMFLOAT3 max);
+	void Remove(unsigned int item);
+	void Clear();
+	bool Contains(unsigned int item) { return item < itemLeaves.size() && itemLeaves[item] != DYNAMIC_BVH_NONE; }
+
+	// Reinserts up to budget of the leaves loosened by Move().
+	// Returns how many are still waiting.
+	unsigned int Rebalance(unsigned int budget);
+
+	// Planes point inward (see Camera::GetFrustumPlanes).  Appends items
+	// wholly inside to inside, and items whose leaf box crosses a plane
+	// (so they may or may not be in view) to crossing.
+	void QueryFrustum(const DirectX::XMFLOAT4 planes[6], std::vector<unsigned int>& inside, std::vector<unsigned int>& crossing);
+
+	// Appends every item whose box touches the sphere; returns how many
+	unsigned int QuerySphere(DirectX::XMFLOAT3 center, float radius, std::vector<unsigned int>& found);
+
+	// Nearest item whose box the ray hits within maxDistance (direction
+	// needn't be normalized; distances are in its lengths), or DYNAMIC_BVH_NONE
+	unsigned int RayCast(DirectX::XMFLOAT3 origin, DirectX::XMFLOAT3 direction, float maxDistance, float* hitDistance);
+
+	unsigned int GetItemCount() { return itemCount; }
+	unsigned int GetNodeCount() { return (unsigned int)nodes.size() - (unsigned int)freeCount; }
+	unsigned int GetPendingCount() { return (unsigned int)(pending.size() - pendingHead); }
+	int GetHeight() { return root == DYNAMIC_BVH_NONE ? 0 : nodes[root].height; }
+
+	// Summed surface area of every internal node over the root's; lower
+	// is a better tree, and it's what Rebalance() brings back down
+	float GetAreaRatio();
+
+private:
+	struct Node
+	{
+		DirectX::XMFLOAT3 min;
+		DirectX::XMFLOAT3 max;
+		unsigned int parent;	// Next free node, while free
+		unsigned int left;		// DYNAMIC_BVH_NONE for leaves
+		unsigned int right;
+		unsigned int item;
+		int height;				// 0 for leaves, -1 while free
+	};
+
+	unsigned int AllocateNode();
+	void FreeNode(unsigned int node);
+	void InsertLeaf(unsigned int leaf);
+	void RemoveLeaf(unsigned int leaf);
+	void Refit(unsigned int node);
+	unsigned int Balance(unsigned int node);
+	void CollectLeaves(unsigned int node, std::vector<unsigned int>& found);
+	void FattenLeaf(unsigned int leaf, unsigned int item, DirectX::XMFLOAT3 motion);
+
+	std::vector<Node> nodes;
+	unsigned int root;
+	unsigned int freeList;
+	unsigned int freeCount;
+	unsigned int itemCount;
+
+	// Per item: its leaf, its own box, and whether it's queued for Rebalance()
+	std::vector<unsigned int> itemLeaves;
+	std::vector<DirectX::XMFLOAT3> itemMins;
+	std::vector<DirectX::XMFLOAT3> itemMaxes;
+	std::vector<unsigned char> itemPending;
+	std::vector<unsigned int> pending;
+	size_t pendingHead;
+
+	// Traversal scratch, kept so queries don't allocate
+	std::vector<unsigned int> stack;
+	std::vector<unsigned char> stackMasks;
+	std::vector<float> stackDistances;
+};
@@ -1,5 +1,8 @@
 #include "Emitter.h"
 
+// Frame length assumed for the bounds until the emitter has ticked
+#define NOMINAL_STEP_TIME (1.0f / 60.0f)
+
 Emitter::Emitter(
 	DirectX::XMFLOAT3 position,
 	DirectX::XMFLOAT3 startVelocity,
@@ -10,7 +13,7 @@ Emitter::Emitter(
 	unsigned int maxParticleCount,
 	float emissionRate,
 	float lifetime,
-	ID3D11Device* device,
+	ParticlePool* pool,
 	SimpleVertexShader* vs,
 	SimplePixelShader* ps,
 	ID3D11ShaderResourceView* texture
@@ -20,10 +23,6 @@ Emitter::Emitter(
 
 	// Initial values for particle
 	this->startVelocity = startVelocity;
-	this->startColor = startColor;
-	this->endColor = endColor;
-	this->startSize = startSize;
-	this->endSize = endSize;
 
 	this->maxParticleCount = maxParticleCount;
 
@@ -32,245 +31,631 @@ Emitter::Emitter(
 
 	this->lifetime = lifetime;
 
-	particleList = new Particle[maxParticleCount];
+	// Straight start to end lerps until given richer curves
+	curves = new ParticleCurves(lifetime);
+	ParticleColorKey colorKeys[] = { { 0.0f, startColor }, { 1.0f, endColor } };
+	ParticleCurveKey sizeKeys[] = { { 0.0f, startSize }, { 1.0f, endSize } };
+	curves->SetColorGradient(colorKeys, 2);
+	curves->SetSizeCurve(sizeKeys, 2);
 
-	localParticleVertices = new ParticleVertex[4 * maxParticleCount];
-	for (int i = 0; i < maxParticleCount * 4; i += 4)
-	{
-		localParticleVertices[i + 0].uv = XMFLOAT2(0, 0);
-		localParticleVertices[i + 1].uv = XMFLOAT2(1, 0);
-		localParticleVertices[i + 2].uv = XMFLOAT2(1, 1);
-		localParticleVertices[i + 3].uv = XMFLOAT2(0, 1);
-	}
+	motion = EMITTER_MOTION_LINEAR;
+	gravity = 0.0f;
+	spreadAngles = PARTICLE_SPREAD_ANGLES;
+	spreadCalmness = PARTICLE_SPREAD_CALMNESS;
 
-	this->firstAliveIndex = 0;
-	this->firstDeadIndex = 0;
+	// Storage is leased from the pool as particles spawn
+	this->pool = pool;
+	pool->Register(this);
+	headOffset = 0;
 
 	timeSinceEmit = 0;
 	livingParticleCount = 0;
 
+	lod = EMITTER_LOD_FULL;
+	pendingTime = 0.0f;
+	pendingSteps = 0;
+	lastSteps = 1;
+
+	stepTime = NOMINAL_STEP_TIME;
+	UpdateBounds();
+	SelectKernel();
+
 	this->texture = texture;
 	this->vs = vs;
 	this->ps = ps;
+}
+
+
+Emitter::~Emitter()
+{
+	// Hand everything back to the pool
+	livingParticleCount = 0;
+	ReleaseEmptyBlocks();
+	pool->Unregister(this);
+
+	SetDepthSorted(false);
+	DisableCollision();
+
+	delete curves;
+}
+
+void Emitter::Seed(unsigned int seed)
+{
+	random.Seed(seed);
+}
+
+void Emitter::SetColorGradient(const ParticleColorKey* keys, unsigned int count)
+{
+	curves->SetColorGradient(keys, count);
+	SelectKernel();
+}
+
+void Emitter::SetSizeCurve(const ParticleCurveKey* keys, unsigned int count)
+{
+	curves->SetSizeCurve(keys, count);
+	SelectKernel();
+	UpdateBounds();
+}
 
-	// Define the buffers
-	D3D11_BUFFER_DESC vbDesc = {};
-	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-	vbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	vbDesc.Usage = D3D11_USAGE_DYNAMIC;
-	vbDesc.ByteWidth = sizeof(ParticleVertex) * 4 * maxParticleCount;
-	device->CreateBuffer(&vbDesc, 0, &vertexBuffer);
-
-	// Index buffer data
-	unsigned int* indices = new unsigned int[maxParticleCount * 6];
-	int indexCount = 0;
-	for (int i = 0; i < maxParticleCount * 4; i += 4)
+void Emitter::SetSpeedCurve(const ParticleCurveKey* keys, unsigned int count)
+{
+	curves->SetSpeedCurve(keys, count);
+	SelectKernel();
+	UpdateBounds();
+}
+
+void Emitter::SetGravity(float gravity)
+{
+	this->gravity = gravity;
+	SelectKernel();
+	UpdateBounds();
+}
+
+void Emitter::SetSpread(int angles, float calmness)
+{
+	spreadAngles = angles;
+	spreadCalmness = calmness;
+	UpdateBounds();
+}
+
+void Emitter::SetCollision(
+	ParticleCollisionResponse response,
+	const std::vector<BoundingBox*>& rooms,
+	float floorHeight,
+	float restitution)
+{
+	DisableCollision();
+
+	collider = new ParticleCollider(response, rooms, floorHeight, restitution);
+	collider->Prefilter(boundsCenter, boundsHalfSize);
+	SelectKernel();
+}
+
+void Emitter::DisableCollision()
+{
+	delete collider;
+	collider = nullptr;
+	SelectKernel();
+}
+
+void Emitter::SetOrderIndependent(bool orderIndependent)
+{
+	this->orderIndependent = orderIndependent;
+
+	// The OIT pass doesn't care about draw order
+	if (orderIndependent) SetDepthSorted(false);
+}
+
+void Emitter::SetDepthSorted(bool sorted)
+{
+	if (sorted) orderIndependent = false;
+
+	if (sorted && !sorter)
 	{
-		indices[indexCount++] = i;
-		indices[indexCount++] = i + 1;
-		indices[indexCount++] = i + 2;
-		indices[indexCount++] = i;
-		indices[indexCount++] = i + 2;
-		indices[indexCount++] = i + 3;
+		sorter = new ParticleSorter(maxParticleCount);
+		livingIndices = new unsigned int[maxParticleCount];
+		particleDepths = new float[maxParticleCount];
 	}
-	D3D11_SUBRESOURCE_DATA indexData = {};
-	indexData.pSysMem = indices;
+	else if (!sorted && sorter)
+	{
+		delete sorter;
+		delete[] livingIndices;
+		delete[] particleDepths;
 
-	// Regular index buffer
-	D3D11_BUFFER_DESC ibDesc = {};
-	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-	ibDesc.CPUAccessFlags = 0;
-	ibDesc.Usage = D3D11_USAGE_DEFAULT;
-	ibDesc.ByteWidth = sizeof(unsigned int) * maxParticleCount * 6;
-	device->CreateBuffer(&ibDesc, &indexData, &indexBuffer);
+		sorter = nullptr;
+		livingIndices = nullptr;
+		particleDepths = nullptr;
+	}
+}
 
-	delete[] indices;
+// Converts an offset from the start of the first leased block into a pool index
+unsigned int Emitter::GetPoolIndex(unsigned int offset)
+{
+	return blocks[offset / PARTICLE_BLOCK_SIZE] * PARTICLE_BLOCK_SIZE + offset % PARTICLE_BLOCK_SIZE;
 }
 
+void Emitter::Update(float dt)
+{
+	pendingTime += dt;
+	pendingSteps++;
 
-Emitter::~Emitter()
+	// Asleep: nothing to do until it wakes up
+	if (lod == EMITTER_LOD_ASLEEP) return;
+
+	// Lower levels of detail only tick every 2nd or 4th frame
+	if (pendingSteps < (1u << lod)) return;
+
+	Simulate(pendingTime, pendingSteps);
+}
+
+void Emitter::UpdateLOD(const XMFLOAT4* frustumPlanes, XMFLOAT3 viewPosition, bool hidden)
 {
-	delete[] particleList;
-	delete[] localParticleVertices;
-	vertexBuffer->Release();
-	indexBuffer->Release();
+	EmitterLOD next = EMITTER_LOD_ASLEEP;
+	if (!hidden && InFrustum(frustumPlanes))
+	{
+		float dx = boundsCenter.x - viewPosition.x;
+		float dy = boundsCenter.y - viewPosition.y;
+		float dz = boundsCenter.z - viewPosition.z;
+		float distanceSq = dx * dx + dy * dy + dz * dz;
+
+		if (distanceSq < EMITTER_LOD_HALF_DISTANCE * EMITTER_LOD_HALF_DISTANCE)
+			next = EMITTER_LOD_FULL;
+		else if (distanceSq < EMITTER_LOD_QUARTER_DISTANCE * EMITTER_LOD_QUARTER_DISTANCE)
+			next = EMITTER_LOD_HALF;
+		else
+			next = EMITTER_LOD_QUARTER;
+	}
+
+	// Waking up: jump straight to where the emitter would be by now,
+	// rather than re-simulating every frame it slept through
+	if (lod == EMITTER_LOD_ASLEEP && next != EMITTER_LOD_ASLEEP && pendingSteps > 0)
+	{
+		Simulate(pendingTime, pendingSteps);
+
+		// Nobody saw the jump, so don't draw it
+		SettlePreviousPositions();
+	}
+
+	lod = next;
 }
 
-void Emitter::Update(float dt)
+bool Emitter::InFrustum(const XMFLOAT4* frustumPlanes)
 {
-	// Are the living particles continuous?
-	if (firstAliveIndex <= firstDeadIndex)
+	for (int i = 0; i < 6; i++)
 	{
-		for (int i = firstAliveIndex; i < firstDeadIndex; i++)
-		{
-			UpdateParticle(dt, i);
-		}
+		XMFLOAT4 plane = frustumPlanes[i];
+
+		// Distance from the plane to the box corner furthest along its normal
+		float distance =
+			plane.x * boundsCenter.x + plane.y * boundsCenter.y + plane.z * boundsCenter.z + plane.w
+			+ fabsf(plane.x) * boundsHalfSize.x
+			+ fabsf(plane.y) * boundsHalfSize.y
+			+ fabsf(plane.z) * boundsHalfSize.z;
+
+		if (distance < 0.0f) return false;
 	}
 
-	// They hop the border between 0 and max; handle accordingly
-	else
+	return true;
+}
+
+void Emitter::UpdateBounds()
+{
+	// How far a particle can get in its lifetime at the current frame rate
+	float steps = curves->GetMaxDistance() / stepTime;
+	float rise = startVelocity.y * steps;
+	float lowest = rise < 0.0f ? rise : 0.0f;
+	float highest = rise > 0.0f ? rise : 0.0f;
+
+	// Under gravity the height peaks (or bottoms out) part way through
+	if (motion == EMITTER_MOTION_GRAVITY)
 	{
-		for (int i = firstAliveIndex; i < maxParticleCount; i++)
-		{
-			UpdateParticle(dt, i);
-		}
+		steps = lifetime / stepTime;
+		float end = startVelocity.y * steps - 0.5f * gravity * steps * steps;
+		lowest = end < 0.0f ? end : 0.0f;
+		highest = end > 0.0f ? end : 0.0f;
 
-		for (int i = 0; i < firstDeadIndex; i++)
+		float turn = startVelocity.y / gravity;
+		if (turn > 0.0f && turn < steps)
 		{
-			UpdateParticle(dt, i);
+			float apex = 0.5f * startVelocity.y * turn;
+			if (apex < lowest) lowest = apex;
+			if (apex > highest) highest = apex;
 		}
 	}
 
-	timeSinceEmit += dt;
+	float spread = spreadAngles > 1
+		? (float)(spreadAngles / 2) / (spreadCalmness * spreadAngles) * steps
+		: 0.0f;
+
+	// Quads are offset in clip space, so the size is a (generous) world pad
+	float pad = curves->GetMaxSize();
+
+	boundsCenter = XMFLOAT3(position.x, position.y + (lowest + highest) / 2.0f, position.z);
+	boundsHalfSize = XMFLOAT3(spread + pad, (highest - lowest) / 2.0f + pad, spread + pad);
+
+	// Only the rooms this emitter can reach are worth testing
+	if (collider)
+	{
+		collider->Prefilter(boundsCenter, boundsHalfSize);
+	}
+}
+
+void Emitter::Simulate(float dt, unsigned int steps)
+{
+	pendingTime = 0.0f;
+	pendingSteps = 0;
+	lastSteps = steps;
+
+	stepTime = dt / steps;
+	UpdateBounds();
+
+	(this->*updateKernel)(dt, (float)steps);
+
+	ReleaseEmptyBlocks();
+
+	SpawnMissedParticles(dt);
+
+	if (collider)
+	{
+		CollideParticles();
+	}
+}
+
+void Emitter::CollideParticles()
+{
+	// Particles are contiguous within a block, so collide block by block
+	unsigned int end = headOffset + livingParticleCount;
+	for (unsigned int i = 0; i * PARTICLE_BLOCK_SIZE < end; i++)
+	{
+		unsigned int from = (i == 0) ? headOffset : 0;
+		unsigned int to = end - i * PARTICLE_BLOCK_SIZE;
+		if (to > PARTICLE_BLOCK_SIZE) to = PARTICLE_BLOCK_SIZE;
+
+		collider->Collide(pool->GetParticle(blocks[i] * PARTICLE_BLOCK_SIZE + from), to - from);
+	}
+}
 
-	// Do we need to create a new particle?
-	if (timeSinceEmit >= secondsPerParticle)
+void Emitter::SpawnMissedParticles(float dt)
+{
+	// Every spawn that fell inside dt, the k-th one k * secondsPerParticle
+	// after the last spawn.  Each is placed where it would be by now, so a
+	// tick of any length (or waking from sleep) gives the same steady state.
+	float elapsed = timeSinceEmit + dt;
+	unsigned int missed = (unsigned int)(elapsed / secondsPerParticle);
+	timeSinceEmit = elapsed - missed * secondsPerParticle;
+
+	// Only the newest few can still be alive, or fit under the cap
+	unsigned int keep = missed;
+	unsigned int alive = (unsigned int)(lifetime / secondsPerParticle) + 1;
+	unsigned int room = maxParticleCount - livingParticleCount;
+	if (keep > alive) keep = alive;
+	if (keep > room) keep = room;
+
+	// Two spread randoms per spawn, generated as one batch
+	spawnRandoms.resize(keep * 2);
+	if (keep > 0) random.FillFloats(random.Reserve(keep * 2), spawnRandoms.data(), keep * 2);
+
+	// Oldest first, so the living range stays in spawn order
+	for (unsigned int k = missed - keep + 1, n = 0; k <= missed; k++, n++)
 	{
-		SpawnParticle();
+		float age = elapsed - k * secondsPerParticle;
+		if (age >= lifetime) continue;
+
+		Particle* particle = SpawnParticle(&spawnRandoms[n * 2]);
+		if (!particle) return;
+
+		// Where it was when this tick started (the spawn point if it wasn't
+		// born yet), then where it is by now
+		float before = age - dt;
+		if (before > 0.0f) MoveSpawned(particle, 0.0f, before);
+		particle->previousPosition = particle->position;
+		MoveSpawned(particle, before > 0.0f ? before : 0.0f, age);
+
+		particle->age = age;
+		ApplyAge(particle);
 	}
 }
 
-void Emitter::UpdateParticle(float dt, int index)
+void Emitter::MoveSpawned(Particle* particle, float fromAge, float toAge)
 {
-	// Failsafe: Make sure the particle's even alive first
-	if (particleList[index].age >= lifetime)
+	// Frames' worth of travel between the two ages
+	float steps = (toAge - fromAge) / stepTime;
+
+	switch (motion)
 	{
-		return;
+	case EMITTER_MOTION_SPEED_CURVE:
+		steps = (curves->GetDistance(curves->GetIndex(toAge)) - curves->GetDistance(curves->GetIndex(fromAge))) / stepTime;
+		LinearMotion::Move(particle, steps, gravity, curves, 0);
+		break;
+
+	case EMITTER_MOTION_GRAVITY:
+		GravityMotion::Move(particle, steps, gravity, curves, 0);
+		break;
+
+	default:
+		LinearMotion::Move(particle, steps, gravity, curves, 0);
+		break;
 	}
+}
 
-	particleList[index].age += dt;
+void Emitter::SettlePreviousPositions()
+{
+	for (unsigned int i = 0; i < livingParticleCount; i++)
+	{
+		Particle* particle = pool->GetParticle(GetPoolIndex(headOffset + i));
+		particle->previousPosition = particle->position;
+	}
+}
 
-	// If the particle has reached its end, update the list accordingly!
-	if (particleList[index].age >= lifetime)
+template<typename Color, typename Size, typename Motion, typename Collision>
+void Emitter::UpdateParticles(float dt, float steps)
+{
+	// Every particle shares a lifetime and they're stored oldest first,
+	// so everyone who dies this tick is at the front of the range
+	while (livingParticleCount > 0)
 	{
-		firstAliveIndex++;
-		firstAliveIndex %= maxParticleCount;
+		Particle* particle = pool->GetParticle(GetPoolIndex(headOffset));
+		if (particle->age + dt < lifetime) break;
 
+		headOffset++;
 		livingParticleCount--;
+	}
+
+	const bool usesCurves = Color::UsesCurve || Size::UsesCurve || Motion::UsesCurve;
+
+	// The survivors, a block at a time since each block is contiguous.
+	// The deaths above can have moved the head past the first block.
+	unsigned int end = headOffset + livingParticleCount;
+	for (unsigned int b = headOffset / PARTICLE_BLOCK_SIZE; b * PARTICLE_BLOCK_SIZE < end; b++)
+	{
+		unsigned int start = b * PARTICLE_BLOCK_SIZE;
+		unsigned int from = headOffset > start ? headOffset - start : 0;
+		unsigned int to = end - start;
+		if (to > PARTICLE_BLOCK_SIZE) to = PARTICLE_BLOCK_SIZE;
+
+		Particle* particles = pool->GetParticle(blocks[b] * PARTICLE_BLOCK_SIZE + from);
+		for (unsigned int i = 0; i < to - from; i++)
+		{
+			Particle* particle = &particles[i];
+			particle->previousPosition = particle->position;
+			particle->age += dt;
+
+			// Killed by a collision; just waiting for its turn to die
+			if (Collision::CanKill && particle->killed) continue;
 
-		// No need to continue updating since the particle just died
-		return;
+			unsigned int index = usesCurves ? curves->GetIndex(particle->age) : 0;
+			Motion::Move(particle, steps, gravity, curves, index);
+			Color::Apply(particle, curves, index);
+			Size::Apply(particle, curves, index);
+		}
 	}
+}
+
+// The runtime factory: walks the settings one policy at a time
+// down to the matching instantiation of UpdateParticles
+template<typename Color, typename Size, typename Motion>
+Emitter::UpdateKernel Emitter::SelectCollisionKernel()
+{
+	if (collider) return &Emitter::UpdateParticles<Color, Size, Motion, WithCollision>;
+	return &Emitter::UpdateParticles<Color, Size, Motion, NoCollision>;
+}
 
-	// Update position based on velocity;
-	particleList[index].position.x += particleList[index].velocity.x;
-	particleList[index].position.y += particleList[index].velocity.y;
-	particleList[index].position.z += particleList[index].velocity.z;
+template<typename Color, typename Size>
+Emitter::UpdateKernel Emitter::SelectMotionKernel()
+{
+	switch (motion)
+	{
+	case EMITTER_MOTION_SPEED_CURVE: return SelectCollisionKernel<Color, Size, SpeedCurveMotion>();
+	case EMITTER_MOTION_GRAVITY: return SelectCollisionKernel<Color, Size, GravityMotion>();
+	default: return SelectCollisionKernel<Color, Size, LinearMotion>();
+	}
+}
 
-	// LERP!
-	float agePercent = particleList[index].age / lifetime;
+template<typename Color>
+Emitter::UpdateKernel Emitter::SelectSizeKernel()
+{
+	if (curves->IsSizeConstant()) return SelectMotionKernel<Color, ConstantSize>();
+	return SelectMotionKernel<Color, CurveSize>();
+}
 
-	// Lerp size
-	particleList[index].size = (startSize * (1.0f - agePercent)) + (endSize * agePercent);
+void Emitter::SelectKernel()
+{
+	// Gravity takes the place of a speed curve
+	if (gravity != 0.0f) motion = EMITTER_MOTION_GRAVITY;
+	else if (curves->HasSpeedCurve()) motion = EMITTER_MOTION_SPEED_CURVE;
+	else motion = EMITTER_MOTION_LINEAR;
 
-	// Lerp color
-	XMStoreFloat4(
-		&particleList[index].color,
-		XMVectorLerp(
-			XMLoadFloat4(&startColor),
-			XMLoadFloat4(&endColor),
-			agePercent));
+	if (curves->IsColorConstant()) updateKernel = SelectSizeKernel<ConstantColor>();
+	else updateKernel = SelectSizeKernel<CurveColor>();
 }
 
-void Emitter::SpawnParticle()
+void Emitter::ApplyAge(Particle* particle)
+{
+	// One multiply-add to find the table entry, however many keys the curves have
+	unsigned int index = curves->GetIndex(particle->age);
+
+	particle->size = curves->GetSize(index);
+	particle->color = curves->GetColor(index);
+}
+
+void Emitter::ReleaseEmptyBlocks()
+{
+	// Hand back any leading blocks whose particles have all died
+	while (!blocks.empty() && headOffset >= PARTICLE_BLOCK_SIZE)
+	{
+		pool->ReleaseBlock(blocks[0]);
+		blocks.pop_front();
+		headOffset -= PARTICLE_BLOCK_SIZE;
+	}
+
+	// Nobody left at all
+	if (livingParticleCount == 0)
+	{
+		for (unsigned int i = 0; i < blocks.size(); i++)
+		{
+			pool->ReleaseBlock(blocks[i]);
+		}
+
+		blocks.clear();
+		headOffset = 0;
+	}
+}
+
+void Emitter::ReleaseOldestBlock()
+{
+	if (blocks.empty()) return;
+
+	// Everything still living in the first block goes with it
+	unsigned int lost = PARTICLE_BLOCK_SIZE - headOffset;
+	livingParticleCount -= lost < livingParticleCount ? lost : livingParticleCount;
+
+	pool->ReleaseBlock(blocks[0]);
+	blocks.pop_front();
+	headOffset = 0;
+}
+
+Particle* Emitter::SpawnParticle(const float* spread)
 {
 	// If too many particles already exist, we can't spawn one
 	if (livingParticleCount == maxParticleCount)
 	{
-		return;
+		return nullptr;
 	}
 
-	// Reset new particle's data
-	particleList[firstDeadIndex].position = position;
-	particleList[firstDeadIndex].color = startColor;
-	particleList[firstDeadIndex].size = startSize;
-	particleList[firstDeadIndex].age = 0.0f;
+	// Grow into a new block if the last one is full
+	unsigned int tail = headOffset + livingParticleCount;
+	if (tail == blocks.size() * PARTICLE_BLOCK_SIZE)
+	{
+		int block = pool->LeaseBlock(this);
 
-	// Randomize the particle's velocity, because FIRE
+		// The pool is out of room and its overflow policy says drop the spawn
+		if (block < 0)
+		{
+			return nullptr;
+		}
 
-	int angles = 91;					// Should always be odd and > 0; the number of angles the fire can fly at
-	float calmness = 10000.0f;		// The higher this number, the calmer the fire
+		blocks.push_back(block);
+	}
 
-	particleList[firstDeadIndex].velocity = startVelocity;
-	particleList[firstDeadIndex].velocity.x = ((rand() % angles) - (angles / 2)) / (calmness * angles);
-	particleList[firstDeadIndex].velocity.z = ((rand() % angles) - (angles / 2)) / (calmness * angles);
+	Particle* particle = pool->GetParticle(GetPoolIndex(tail));
 
-	firstDeadIndex++;
-	firstDeadIndex %= maxParticleCount;
+	// Reset new particle's data
+	particle->position = position;
+	particle->previousPosition = position;
+	particle->color = curves->GetColor(0);
+	particle->size = curves->GetSize(0);
+	particle->age = 0.0f;
+	particle->killed = false;
+
+	// Randomize the particle's velocity, because FIRE
+	particle->velocity = startVelocity;
+	particle->velocity.x = 0.0f;
+	particle->velocity.z = 0.0f;
+	if (spreadAngles > 1)
+	{
+		particle->velocity.x = (SpreadAngle(spread[0]) - (spreadAngles / 2)) / (spreadCalmness * spreadAngles);
+		particle->velocity.z = (SpreadAngle(spread[1]) - (spreadAngles / 2)) / (spreadCalmness * spreadAngles);
+	}
 
 	livingParticleCount++;
 
-	// We spawned a new particle, it has now been 0 seconds since last spawn
-	timeSinceEmit = 0.0f;
+	return particle;
+}
+
+int Emitter::SpreadAngle(float random)
+{
+	// A [0, 1) random to one of the angles; the product can round up to spreadAngles
+	int angle = (int)(random * spreadAngles);
+	return angle < spreadAngles ? angle : spreadAngles - 1;
 }
 
-void Emitter::CopyParticlesToGPU(ID3D11DeviceContext* context)
+void Emitter::CopyParticlesToPool(Camera* camera, float alpha)
 {
-	// Update local buffer (living particles only as a speed up)
+	// How far across the last simulation to draw.  At full detail that's
+	// alpha; lower levels spread their few simulations over the ticks in
+	// between, so they run a little further behind instead of jumping.
+	float t = (pendingSteps + alpha) / lastSteps;
+	if (t > 1.0f) t = 1.0f;
 
-	// Are the living particles continuous?
-	if (firstAliveIndex < firstDeadIndex)
+	if (sorter)
 	{
-		for (int i = firstAliveIndex; i < firstDeadIndex; i++)
+		SortParticles(camera);
+
+		// Fill this emitter's slots back-to-front
+		const unsigned int* order = sorter->GetOrder();
+		for (unsigned int i = 0; i < livingParticleCount; i++)
 		{
-			CopyParticle(i);
+			CopyParticle(order[i], GetPoolIndex(headOffset + i), t);
 		}
 	}
-
-	// They hop the border between 0 and max; handle accordingly
 	else
 	{
-		for (int i = firstAliveIndex; i < maxParticleCount; i++)
-		{
-			CopyParticle(i);
-		}
-
-		for (int i = 0; i < firstDeadIndex; i++)
+		// Update local buffer (living particles only as a speed up)
+		for (unsigned int i = 0; i < livingParticleCount; i++)
 		{
-			CopyParticle(i);
+			unsigned int index = GetPoolIndex(headOffset + i);
+			CopyParticle(index, index, t);
 		}
 	}
+}
 
-	// All particles copied locally - send whole buffer to GPU
-	D3D11_MAPPED_SUBRESOURCE mapped = {};
-	context->Map(vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
-
-	memcpy(mapped.pData, localParticleVertices, sizeof(ParticleVertex) * 4 * maxParticleCount);
-
-	context->Unmap(vertexBuffer, 0);
+void Emitter::CopyParticle(unsigned int index, unsigned int slot, float t)
+{
+	Particle* particle = pool->GetParticle(index);
+	ParticleVertex* vertices = pool->GetVertices(slot);
+
+	XMFLOAT3 from = particle->previousPosition;
+	XMFLOAT3 position = XMFLOAT3(
+		from.x + (particle->position.x - from.x) * t,
+		from.y + (particle->position.y - from.y) * t,
+		from.z + (particle->position.z - from.z) * t);
+
+	vertices[0].position = position;
+	vertices[1].position = position;
+	vertices[2].position = position;
+	vertices[3].position = position;
+
+	vertices[0].size = particle->size;
+	vertices[1].size = particle->size;
+	vertices[2].size = particle->size;
+	vertices[3].size = particle->size;
+
+	vertices[0].color = particle->color;
+	vertices[1].color = particle->color;
+	vertices[2].color = particle->color;
+	vertices[3].color = particle->color;
 }
 
-void Emitter::CopyParticle(int index)
+void Emitter::SortParticles(Camera* camera)
 {
-	// Convert index to ensure we get the correct vertex
-	int i = index * 4;
+	// The view matrix is stored transposed, so its third row gives view space z
+	XMFLOAT4X4 view = camera->GetView();
 
-	localParticleVertices[i + 0].position = particleList[index].position;
-	localParticleVertices[i + 1].position = particleList[index].position;
-	localParticleVertices[i + 2].position = particleList[index].position;
-	localParticleVertices[i + 3].position = particleList[index].position;
+	for (unsigned int i = 0; i < livingParticleCount; i++)
+	{
+		unsigned int index = GetPoolIndex(headOffset + i);
+		XMFLOAT3 p = pool->GetParticle(index)->position;
 
-	localParticleVertices[i + 0].size = particleList[index].size;
-	localParticleVertices[i + 1].size = particleList[index].size;
-	localParticleVertices[i + 2].size = particleList[index].size;
-	localParticleVertices[i + 3].size = particleList[index].size;
+		livingIndices[i] = index;
+		particleDepths[i] = view._31 * p.x + view._32 * p.y + view._33 * p.z + view._34;
+	}
 
-	localParticleVertices[i + 0].color = particleList[index].color;
-	localParticleVertices[i + 1].color = particleList[index].color;
-	localParticleVertices[i + 2].color = particleList[index].color;
-	localParticleVertices[i + 3].color = particleList[index].color;
+	sorter->Sort(livingIndices, particleDepths, livingParticleCount);
 }
 
-void Emitter::Draw(ID3D11DeviceContext* context, Camera* camera)
+void Emitter::Draw(ID3D11DeviceContext* context, Camera* camera, SimplePixelShader* pixelShader)
 {
-	// Copy to dynamic buffer
-	CopyParticlesToGPU(context);
+	// The OIT pass swaps in its own pixel shader
+	SimplePixelShader* ps = pixelShader ? pixelShader : this->ps;
+
+	if (livingParticleCount == 0) return;
 
 	// Set up buffers
 	UINT stride = sizeof(ParticleVertex);
 	UINT offset = 0;
+	ID3D11Buffer* vertexBuffer = pool->GetVertexBuffer();
 	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(pool->GetIndexBuffer(), DXGI_FORMAT_R32_UINT, 0);
 
 	vs->SetMatrix4x4("view", camera->GetView());
 	vs->SetMatrix4x4("projection", camera->GetProjection());
@@ -281,18 +666,32 @@ void Emitter::Draw(ID3D11DeviceContext* context, Camera* camera)
 	ps->SetShader();
 	ps->CopyAllBufferData();
 
-	// Draw the correct parts of the buffer
-	if (firstAliveIndex < firstDeadIndex)
-	{
-		context->DrawIndexed(livingParticleCount * 6, firstAliveIndex * 6, 0);
-	}
-	else
+	// Draw the living range block by block, merging blocks that sit
+	// next to each other in the pool into a single call
+	unsigned int end = headOffset + livingParticleCount;
+	unsigned int runStart = 0;
+	unsigned int runCount = 0;
+	for (unsigned int i = 0; i * PARTICLE_BLOCK_SIZE < end; i++)
 	{
-		// Draw first half (0 -> dead)
-		context->DrawIndexed(firstDeadIndex * 6, 0, 0);
+		unsigned int from = (i == 0) ? headOffset : 0;
+		unsigned int to = end - i * PARTICLE_BLOCK_SIZE;
+		if (to > PARTICLE_BLOCK_SIZE) to = PARTICLE_BLOCK_SIZE;
 
-		// Draw second half (alive -> max)
-		context->DrawIndexed((maxParticleCount - firstAliveIndex) * 6, firstAliveIndex * 6, 0);
+		unsigned int start = blocks[i] * PARTICLE_BLOCK_SIZE + from;
+		if (runCount > 0 && runStart + runCount == start)
+		{
+			runCount += to - from;
+			continue;
+		}
+
+		if (runCount > 0)
+		{
+			context->DrawIndexed(runCount * 6, runStart * 6, 0);
+		}
+
+		runStart = start;
+		runCount = to - from;
 	}
 
-}
\ No newline at end of file
+	context->DrawIndexed(runCount * 6, runStart * 6, 0);
+}
@@ -1,28 +1,33 @@
 #pragma once
 #include <d3d11.h>
 #include <DirectXMath.h>
+#include <deque>
+#include <vector>
 
 #include "Camera.h"
+#include "EmitterPolicies.h"
 #include "SimpleShader.h"
+#include "Particle.h"
+#include "ParticleCollider.h"
+#include "ParticleCurves.h"
+#include "ParticlePool.h"
+#include "ParticleSorter.h"
+#include "Random.h"
 
 class Camera;
 
-struct Particle
+// How often an emitter simulates, picked each frame from visibility and distance
+enum EmitterLOD
 {
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT4 color;
-	DirectX::XMFLOAT3 velocity;
-	float size;
-	float age;
+	EMITTER_LOD_FULL,		// Every frame
+	EMITTER_LOD_HALF,		// Every 2nd frame
+	EMITTER_LOD_QUARTER,	// Every 4th frame
+	EMITTER_LOD_ASLEEP		// Out of view; caught up in one step when it wakes
 };
 
-struct ParticleVertex
-{
-	DirectX::XMFLOAT3 position;
-	DirectX::XMFLOAT2 uv;
-	DirectX::XMFLOAT4 color;
-	float size;
-};
+// Camera distances where emitters drop to the next level of detail
+#define EMITTER_LOD_HALF_DISTANCE 10.0f
+#define EMITTER_LOD_QUARTER_DISTANCE 20.0f
 
 class Emitter
 {
@@ -37,7 +42,7 @@ public:
 		unsigned int maxParticleCount,
 		float emissionRate,
 		float lifetime,
-		ID3D11Device* device,
+		ParticlePool* pool,
 		SimpleVertexShader* vs,
 		SimplePixelShader* ps,
 		ID3D11ShaderResourceView* texture
@@ -46,39 +51,154 @@ public:
 
 	void Update(float dt);
 
-	void SpawnParticle();
-	void UpdateParticle(float dt, int index);
+	// Picks this frame's level of detail; waking from sleep fast-forwards
+	// the emitter over the time it missed.  Hidden emitters (known to be
+	// out of sight some other way, like behind walls) sleep too.
+	void UpdateLOD(const DirectX::XMFLOAT4* frustumPlanes, DirectX::XMFLOAT3 viewPosition, bool hidden = false);
+	EmitterLOD GetLOD() { return lod; }
+	bool IsVisible() { return lod != EMITTER_LOD_ASLEEP; }
+	bool InFrustum(const DirectX::XMFLOAT4* frustumPlanes);
+
+	// Spread is this spawn's two [0, 1) randoms, for the x and z angles
+	Particle* SpawnParticle(const float* spread);
+
+	// Writes this emitter's quads into the pool's vertex staging;
+	// the pool uploads them for everyone before any emitter draws.
+	// Alpha is how far between the last two ticks to draw them.
+	void CopyParticlesToPool(Camera* camera, float alpha = 1.0f);
+	void CopyParticle(unsigned int index, unsigned int slot, float t = 1.0f);
+	void SortParticles(Camera* camera);
+	void Draw(ID3D11DeviceContext* context, Camera* camera, SimplePixelShader* pixelShader = nullptr);
+
+	// Pool block management
+	unsigned int GetLeasedBlockCount() { return (unsigned int)blocks.size(); }
+	void ReleaseOldestBlock();
+
+	DirectX::XMFLOAT3 GetPosition() { return position; }
+
+	// Living particles, oldest first
+	unsigned int GetParticleCount() { return livingParticleCount; }
+	Particle* GetParticle(unsigned int index) { return pool->GetParticle(GetPoolIndex(headOffset + index)); }
+
+	// Box around wherever its particles can get to
+	DirectX::XMFLOAT3 GetBoundsCenter() { return boundsCenter; }
+	DirectX::XMFLOAT3 GetBoundsHalfSize() { return boundsHalfSize; }
+
+	// Attribute-over-lifetime curves; these replace the start/end lerp
+	void SetColorGradient(const ParticleColorKey* keys, unsigned int count);
+	void SetSizeCurve(const ParticleCurveKey* keys, unsigned int count);
+	void SetSpeedCurve(const ParticleCurveKey* keys, unsigned int count);
+
+	// Gravity, in the same per-frame units as velocity (takes the place of a speed curve)
+	void SetGravity(float gravity);
+
+	// Random x/z spread at spawn: the number of angles particles can fly at
+	// (odd; 1 means straight) and how calm they are (higher is calmer)
+	void SetSpread(int angles, float calmness);
+
+	// Optional collision against the room boxes and a floor
+	void SetCollision(
+		ParticleCollisionResponse response,
+		const std::vector<BoundingBox*>& rooms,
+		float floorHeight,
+		float restitution = 0.5f);
+	void DisableCollision();
+
+	// Reseeds this emitter's random stream so runs can be reproduced
+	void Seed(unsigned int seed);
 
-	void CopyParticlesToGPU(ID3D11DeviceContext* context);
-	void CopyParticle(int index);
-	void Draw(ID3D11DeviceContext* context, Camera* camera);
+	// Depth sorting (back-to-front) for alpha blended emitters
+	void SetDepthSorted(bool sorted);
+	bool IsDepthSorted() { return sorter != nullptr; }
+
+	// Alpha blended through the OIT pass instead, so no sorting needed
+	void SetOrderIndependent(bool orderIndependent);
+	bool IsOrderIndependent() { return orderIndependent; }
 
 private:
+	unsigned int GetPoolIndex(unsigned int offset);
+	void ReleaseEmptyBlocks();
+
+	// Advances the whole emitter by dt, which spans the given number of frames
+	void Simulate(float dt, unsigned int steps);
+
+	// The particle update loop, specialized per combination of features.
+	// SelectKernel picks the instantiation that matches the current settings.
+	typedef void (Emitter::*UpdateKernel)(float dt, float steps);
+	template<typename Color, typename Size, typename Motion, typename Collision>
+	void UpdateParticles(float dt, float steps);
+	template<typename Color, typename Size, typename Motion>
+	UpdateKernel SelectCollisionKernel();
+	template<typename Color, typename Size>
+	UpdateKernel SelectMotionKernel();
+	template<typename Color>
+	UpdateKernel SelectSizeKernel();
+	void SelectKernel();
+
+	void SpawnMissedParticles(float dt);
+	void MoveSpawned(Particle* particle, float fromAge, float toAge);
+	void SettlePreviousPositions();
+	int SpreadAngle(float random);
+	void ApplyAge(Particle* particle);
+	void UpdateBounds();
+	void CollideParticles();
+
 	DirectX::XMFLOAT3 position;
-	Particle* particleList;
 	float timeSinceEmit;
 	unsigned int livingParticleCount;
 
 	DirectX::XMFLOAT3 startVelocity;
-	DirectX::XMFLOAT4 startColor;
-	DirectX::XMFLOAT4 endColor;
-	float startSize;
-	float endSize;
+
+	// Baked color, size and speed over lifetime
+	ParticleCurves* curves;
+
+	EmitterMotion motion;
+	float gravity;
+	int spreadAngles;
+	float spreadCalmness;
+	UpdateKernel updateKernel;
 
 	unsigned int maxParticleCount;
-	unsigned int firstAliveIndex;
-	unsigned int firstDeadIndex;
 	float emissionRate;
 	float secondsPerParticle;
 	float lifetime;
 
-	// Rendering vars
-	ParticleVertex* localParticleVertices;
-	ID3D11Buffer* vertexBuffer;
-	ID3D11Buffer* indexBuffer;
+	Random random;
+	std::vector<float> spawnRandoms;
 
+	// Level of detail.  Frames that haven't been simulated yet pile up
+	// here until the next tick (or wake up) handles them all at once.
+	EmitterLOD lod;
+	float pendingTime;
+	unsigned int pendingSteps;
+	unsigned int lastSteps;			// Ticks the last simulation covered; frames draw across them
+
+	// Particles move a fixed amount per frame, so the bounds depend
+	// on how long a frame has been lately
+	float stepTime;
+	DirectX::XMFLOAT3 boundsCenter;
+	DirectX::XMFLOAT3 boundsHalfSize;
+
+	// Blocks leased from the shared pool, oldest first (deaths and steals
+	// pop the front).  The living particles run from headOffset in the
+	// first block, in spawn order.
+	ParticlePool* pool;
+	std::deque<int> blocks;
+	unsigned int headOffset;
+
+	// Rendering vars
 	ID3D11ShaderResourceView* texture;
 	SimpleVertexShader* vs;
 	SimplePixelShader* ps;
+
+	// Collision (only allocated for colliding emitters)
+	ParticleCollider* collider = nullptr;
+
+	bool orderIndependent = false;
+
+	// Sorting vars (only allocated for depth sorted emitters)
+	ParticleSorter* sorter = nullptr;
+	unsigned int* livingIndices = nullptr;
+	float* particleDepths = nullptr;
 };
 
@@ -0,0 +1,100 @@
+#pragma once
+#include <DirectXMath.h>
+
+#include "Particle.h"
+#include "ParticleCurves.h"
+
+// --------------------------------------------------------
+// Compile-time building blocks for the emitter update loop.
+//
+// Emitter::UpdateParticles is instantiated once for every
+// combination of these, so a particle only pays for the
+// features its emitter actually uses: a constant color
+// never touches the gradient table, an emitter without
+// gravity never does the extra math, and so on.
+// --------------------------------------------------------
+
+// How an emitter's particles move
+enum EmitterMotion
+{
+	EMITTER_MOTION_LINEAR,			// Constant velocity
+	EMITTER_MOTION_SPEED_CURVE,		// Velocity scaled by the speed curve
+	EMITTER_MOTION_GRAVITY			// Velocity pulled down by gravity each frame
+};
+
+// Color ---------------------------------------------------
+struct ConstantColor
+{
+	static const bool UsesCurve = false;
+	static void Apply(Particle*, ParticleCurves*, unsigned int) { }
+};
+
+struct CurveColor
+{
+	static const bool UsesCurve = true;
+	static void Apply(Particle* particle, ParticleCurves* curves, unsigned int index)
+	{
+		particle->color = curves->GetColor(index);
+	}
+};
+
+// Size ----------------------------------------------------
+struct ConstantSize
+{
+	static const bool UsesCurve = false;
+	static void Apply(Particle*, ParticleCurves*, unsigned int) { }
+};
+
+struct CurveSize
+{
+	static const bool UsesCurve = true;
+	static void Apply(Particle* particle, ParticleCurves* curves, unsigned int index)
+	{
+		particle->size = curves->GetSize(index);
+	}
+};
+
+// Motion (velocity is per frame, so everything is in frames) ----
+struct LinearMotion
+{
+	static const bool UsesCurve = false;
+	static void Move(Particle* particle, float steps, float, ParticleCurves*, unsigned int)
+	{
+		particle->position.x += particle->velocity.x * steps;
+		particle->position.y += particle->velocity.y * steps;
+		particle->position.z += particle->velocity.z * steps;
+	}
+};
+
+struct SpeedCurveMotion
+{
+	static const bool UsesCurve = true;
+	static void Move(Particle* particle, float steps, float gravity, ParticleCurves* curves, unsigned int index)
+	{
+		LinearMotion::Move(particle, steps * curves->GetSpeed(index), gravity, curves, index);
+	}
+};
+
+struct GravityMotion
+{
+	static const bool UsesCurve = false;
+	static void Move(Particle* particle, float steps, float gravity, ParticleCurves*, unsigned int)
+	{
+		// Closed form over the whole tick, so skipped frames land in the same place
+		particle->position.x += particle->velocity.x * steps;
+		particle->position.y += particle->velocity.y * steps - 0.5f * gravity * steps * steps;
+		particle->position.z += particle->velocity.z * steps;
+		particle->velocity.y -= gravity * steps;
+	}
+};
+
+// Collision -----------------------------------------------
+struct NoCollision
+{
+	static const bool CanKill = false;
+};
+
+struct WithCollision
+{
+	static const bool CanKill = true;
+};
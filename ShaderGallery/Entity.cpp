@@ -2,38 +2,15 @@
 
 XMFLOAT4X4 Entity::GetWorldMatrix()
 {
-	if (dirty) UpdateWorldMatrix();
-	
-	return world;
-}
-
-void Entity::UpdateWorldMatrix() {
-	// If the world matrix has changed, update it.
-	if (dirty) {
-		// Construct the new world matrix
-		XMMATRIX w = XMMatrixScaling(scale.x, scale.y, scale.z) * // Scale matrix
-			(XMMatrixRotationX(rotation.x) * XMMatrixRotationY(rotation.y) * XMMatrixRotationZ(rotation.z)) * // rotation matrix is composed of 3 rotation matrices
-			XMMatrixTranslation(position.x, position.y, position.z); // Position matrix
-
-		// Store the new world matrix
-		XMStoreFloat4x4(&world, XMMatrixTranspose(w));
-
-		// Reset whether the world matrix has changed.
-		dirty = false;
-	}
+	return transforms->GetWorldMatrix(transform);
 }
 
 // Entity contructor sets default values
-Entity::Entity(Mesh* pMesh, Material* pMaterial, ID3D11DeviceContext* pDeviceContext)
+Entity::Entity(Mesh* pMesh, Material* pMaterial, ID3D11DeviceContext* pDeviceContext, TransformSystem* pTransforms)
 {
-	// Initialize the world matrix
-	XMMATRIX identity = XMMatrixIdentity();
-	XMStoreFloat4x4(&world, identity);
-
-	// Initialize transformation vectors
-	position = XMFLOAT3(0, 0, 0);
-	rotation = XMFLOAT3(0, 0, 0);
-	scale = XMFLOAT3(1, 1, 1);
+	// Take an identity transform from the system
+	transforms = pTransforms;
+	transform = transforms->Create();
 
 	// Set this entity's mesh
 	mesh = pMesh;
@@ -45,9 +22,12 @@ Entity::Entity(Mesh* pMesh, Material* pMaterial, ID3D11DeviceContext* pDeviceCon
 	deviceContext = pDeviceContext;
 }
 
-// Entity destructor doesn't need to do anything --
+// Entity destructor only hands back its transform --
 // Mesh cleans up DX objects.
-Entity::~Entity() { }
+Entity::~Entity()
+{
+	transforms->Release(transform);
+}
 
 void Entity::SetRating(int pRating)
 {
@@ -61,14 +41,13 @@ int Entity::GetRating()
 
 // Set this entity's position
 void Entity::SetPosition(XMFLOAT3 pNewPosition) { 
-	position = pNewPosition; 
-	dirty = true; 
+	transforms->SetPosition(transform, pNewPosition);
 }
 
 // Add to this entity's position
 void Entity::OffsetPosition(XMFLOAT3 pOffset) { 
-	position = XMFLOAT3(position.x + pOffset.x, position.y + pOffset.y, position.z + pOffset.z); 
-	dirty = true;
+	XMFLOAT3 position = transforms->GetPosition(transform);
+	transforms->SetPosition(transform, XMFLOAT3(position.x + pOffset.x, position.y + pOffset.y, position.z + pOffset.z));
 }
 
 void Entity::SetActive(bool pActive)
@@ -78,29 +57,42 @@ void Entity::SetActive(bool pActive)
 
 XMFLOAT3 Entity::GetPosition()
 {
-	return position;
+	return transforms->GetPosition(transform);
 }
 
 XMFLOAT3 Entity::GetScale()
 {
-	return scale;
+	return transforms->GetScale(transform);
 }
 
 XMFLOAT3 Entity::GetRotation()
 {
-	return rotation;
+	return transforms->GetRotation(transform);
+}
+
+XMFLOAT3 Entity::GetWorldPosition()
+{
+	return transforms->GetWorldPosition(transform);
+}
+
+void Entity::SetParent(unsigned int pParentTransform)
+{
+	transforms->SetParent(transform, pParentTransform);
+}
+
+unsigned int Entity::GetTransform()
+{
+	return transform;
 }
 
 // Set this entity's rotation (Euler)
 void Entity::SetRotation(XMFLOAT3 pNewRotation) { 
-	rotation = pNewRotation;
-	dirty = true;
+	transforms->SetRotation(transform, pNewRotation);
 }
 
 // Set this entity's scale
 void Entity::SetScale(XMFLOAT3 pNewScale) {
-	scale = pNewScale;
-	dirty = true;
+	transforms->SetScale(transform, pNewScale);
 }
 
 // Set the mesh this entity will render
@@ -158,10 +150,6 @@ void Entity::Render(XMFLOAT4X4 pView, XMFLOAT4X4 pProjection) {
 	// Prepare the pixel/vertex shaders for rendering
 	PrepMaterial(pView, pProjection);
 
-	// If the entity's transform was changed since last render, 
-	// Update it.
-	if (dirty) UpdateWorldMatrix();
-
 	// Render the mesh using the world matrix.
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
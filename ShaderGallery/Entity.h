@@ -3,6 +3,7 @@
 #include <DirectXMath.h>
 #include "Mesh.h"
 #include "Material.h"
+#include "TransformSystem.h"
 
 // For the DirectX Math library
 using namespace DirectX;
@@ -14,9 +15,8 @@ class Entity
 {
 public:
 	XMFLOAT4X4 GetWorldMatrix(); // Returns the world matrix of this entity
-	void UpdateWorldMatrix(); // Update the world matrix of this entity
 
-	Entity(Mesh* pMesh, Material* pMaterial, ID3D11DeviceContext* pDeviceContext);
+	Entity(Mesh* pMesh, Material* pMaterial, ID3D11DeviceContext* pDeviceContext, TransformSystem* pTransforms);
 	~Entity();
 
 	void SetRating(int pRating);
@@ -26,9 +26,15 @@ public:
 	void OffsetPosition(XMFLOAT3 pOffset); // Add to current position
 	void SetActive(bool pActive); // Should this be updated/rendered?
 
-	XMFLOAT3 GetPosition();
+	XMFLOAT3 GetPosition(); // Relative to the parent, if there is one
 	XMFLOAT3 GetScale();
 	XMFLOAT3 GetRotation();
+	XMFLOAT3 GetWorldPosition();
+
+	// Hang this entity under another transform (another entity's GetTransform(),
+	// or a bare one from the TransformSystem); TRANSFORM_NO_PARENT detaches it
+	void SetParent(unsigned int pParentTransform);
+	unsigned int GetTransform();
 
 	void SetRotation(XMFLOAT3 pNewRotation); // Set rotation (Euler)
 	void SetScale(XMFLOAT3 pNewScale); // Set scale
@@ -47,16 +53,12 @@ public:
 private:
 	int rating = -1;
 
-	bool dirty; // Does this entity's world matrix need to be updated?
 	bool active = true; // Is this a GUI element? 
 
 	ID3D11DeviceContext* deviceContext; // Rendering context
 
-	XMFLOAT4X4 world; // This entity's world matrix
-
-	XMFLOAT3 position; // This entity's position vector
-	XMFLOAT3 rotation; // This entity's rotation vector
-	XMFLOAT3 scale;    // This entity's scale vector
+	TransformSystem* transforms; // Owns this entity's position, rotation, scale and world matrix
+	unsigned int transform; // This entity's slot in the transform system
 
 	Mesh* mesh; // The mesh that this entity renders
 	Material* material; // The material that the mesh is rendered with
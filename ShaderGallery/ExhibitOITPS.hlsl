@@ -0,0 +1,62 @@
+#include "OIT.hlsli"
+
+// Translucent (glass) exhibits.  Same inputs and lighting as PixelShader,
+// minus the shadow map, but written into the OIT targets.
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+	float3 worldPos		: POSITION;
+	float2 uv			: TEXCOORD;
+	float4 posForShadow : POSITION1;
+};
+
+struct DirectionalLight {
+	float4 AmbientColor;
+	float4 DiffuseColor;
+	float3 Direction;
+};
+
+cbuffer Light : register(b1) {
+	DirectionalLight light;
+};
+
+cbuffer Camera : register(b2) {
+	float3 cameraPosition;
+}
+
+Texture2D diffuseTexture : register(t0);
+Texture2D specularMap : register(t1);
+Texture2D normalMap : register(t2);
+SamplerState basicSampler : register(s0);
+
+OITOutput main(VertexToPixel input)
+{
+	input.normal = normalize(input.normal);
+	input.tangent = normalize(input.tangent);
+
+	float4 surfaceColor = diffuseTexture.Sample(basicSampler, input.uv);
+
+	// Normal map
+	float3 normalFromMap = normalMap.Sample(basicSampler, input.uv).rgb * 2 - 1;
+	float3 N = input.normal;
+	float3 T = normalize(input.tangent - N * dot(input.tangent, N));
+	float3 B = cross(T, N);
+	input.normal = normalize(mul(normalFromMap, float3x3(T, B, N)));
+
+	float3 lightDir = normalize(-light.Direction);
+	float NdotL = saturate(dot(input.normal, lightDir));
+
+	// Specular
+	float3 reflection = reflect(-lightDir, input.normal);
+	float3 dirToCamera = normalize(cameraPosition - input.worldPos);
+	float specAmt = pow(saturate(dot(reflection, dirToCamera)), 64.0f);
+	float4 specColor = specularMap.Sample(basicSampler, input.uv) * specAmt;
+
+	float4 color = surfaceColor * (light.AmbientColor + light.DiffuseColor * NdotL + specColor);
+	color.a = surfaceColor.a;
+
+	// In the pixel shader, SV_POSITION.w is the view depth
+	return OITPack(color, input.position.w);
+}
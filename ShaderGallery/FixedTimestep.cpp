@@ -0,0 +1,68 @@
+#include "FixedTimestep.h"
+
+FixedTimestep::FixedTimestep(unsigned int tickRate, unsigned int maxSubsteps)
+{
+	this->tickRate = tickRate > 0 ? tickRate : 1;
+	this->maxSubsteps = maxSubsteps > 0 ? maxSubsteps : 1;
+	tickLength = 1.0 / this->tickRate;
+	Reset();
+}
+
+FixedTimestep::~FixedTimestep()
+{
+}
+
+void FixedTimestep::SetTickRate(unsigned int tickRate)
+{
+	if (tickRate == 0) tickRate = 1;
+
+	// The bank is kept in ticks, so rescale it to the same seconds
+	banked = banked * tickRate / this->tickRate;
+	this->tickRate = tickRate;
+	tickLength = 1.0 / tickRate;
+}
+
+void FixedTimestep::SetMaxSubsteps(unsigned int maxSubsteps)
+{
+	this->maxSubsteps = maxSubsteps > 0 ? maxSubsteps : 1;
+}
+
+void FixedTimestep::Reset()
+{
+	banked = 0.0;
+	droppedTime = 0.0;
+	time = 0.0;
+	tickCount = 0;
+}
+
+void FixedTimestep::Advance(double frameSeconds)
+{
+	if (frameSeconds > 0.0) banked += frameSeconds * tickRate;
+
+	// Never more than the max substeps in the bank at once
+	if (banked > maxSubsteps)
+	{
+		droppedTime += (banked - maxSubsteps) * tickLength;
+		banked = maxSubsteps;
+	}
+}
+
+bool FixedTimestep::Tick()
+{
+	if (banked < 1.0 - FIXED_TIMESTEP_EPSILON) return false;
+
+	// A tick a hair short still counts; it just can't leave the bank negative
+	banked -= 1.0;
+	if (banked < 0.0) banked = 0.0;
+
+	time += tickLength;
+	tickCount++;
+	return true;
+}
+
+float FixedTimestep::GetAlpha()
+{
+	// Between ticks the bank is always under one, but not
+	// while a frame's ticks are still being run
+	return banked < 1.0 ? (float)banked : 1.0f;
+}
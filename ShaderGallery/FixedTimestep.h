@@ -0,0 +1,73 @@
+#pragma once
+
+// Simulation ticks per second, and the most ticks one frame
+// will run to catch up before the rest of its time is dropped
+#define FIXED_TIMESTEP_RATE 60
+#define FIXED_TIMESTEP_MAX_SUBSTEPS 8
+
+// How close (in ticks) counts as a whole tick, so frames of
+// exactly the tick length don't alternate between 0 and 2
+#define FIXED_TIMESTEP_EPSILON 1e-4
+
+// --------------------------------------------------------
+// Runs the simulation in ticks of a fixed length, however
+// long frames take.
+//
+// Each frame Advance() banks the real time that passed, then
+// Tick() says yes once per whole tick in the bank:
+//
+//     timestep.Advance(frameSeconds);
+//     while (timestep.Tick()) Update(timestep.GetTickLength(), ...);
+//
+// What's left over (GetAlpha(), 0 to 1) is how far between
+// the last two ticks the frame is, for drawing in between.
+//
+// A frame that would need more than the max substeps (a hitch,
+// or the window being dragged) runs that many and drops the
+// rest, so the simulation falls behind real time rather than
+// spending ever longer catching up.
+// --------------------------------------------------------
+class FixedTimestep
+{
+public:
+	FixedTimestep(unsigned int tickRate = FIXED_TIMESTEP_RATE, unsigned int maxSubsteps = FIXED_TIMESTEP_MAX_SUBSTEPS);
+	~FixedTimestep();
+
+	// Both keep the time banked so far, and the simulation time
+	void SetTickRate(unsigned int tickRate);
+	void SetMaxSubsteps(unsigned int maxSubsteps);
+
+	// Back to tick 0 with nothing banked
+	void Reset();
+
+	// Banks a frame's worth of real time (negative counts as 0)
+	void Advance(double frameSeconds);
+
+	// True (and one tick spent) while a whole tick is banked
+	bool Tick();
+
+	unsigned int GetTickRate() { return tickRate; }
+	unsigned int GetMaxSubsteps() { return maxSubsteps; }
+	float GetTickLength() { return (float)tickLength; }
+
+	// Simulation time and ticks run so far (since the last Reset)
+	double GetTime() { return time; }
+	unsigned long long GetTickCount() { return tickCount; }
+
+	// How far past the last tick real time is, as a fraction of a tick
+	float GetAlpha();
+
+	// Real time thrown away by the substep limit
+	double GetDroppedTime() { return droppedTime; }
+
+private:
+	unsigned int tickRate;
+	unsigned int maxSubsteps;
+	double tickLength;
+
+	// In ticks rather than seconds, so a frame of exactly one tick adds exactly 1
+	double banked;
+	double droppedTime;
+	double time;
+	unsigned long long tickCount;
+};
@@ -0,0 +1,605 @@
+#include "FluidSimulation.h"
+
+#include <algorithm>
+#include <math.h>
+#include <xmmintrin.h>
+
+#include "Parallel.h"
+
+// Below this many particles the threads cost more than they save
+#define PARALLEL_FLUID_THRESHOLD 16384
+
+#define FLUID_PI 3.14159265f
+
+FluidSimulation::FluidSimulation(unsigned int particleCount, FluidSettings settings, unsigned int seed)
+{
+	this->particleCount = particleCount;
+	this->settings = settings;
+	threadCount = GetHardwareThreadCount();
+
+	// Particles start half a smoothing radius apart, at rest density
+	float h = settings.smoothingRadius;
+	float spacing = h * 0.5f;
+	radiusSq = h * h;
+	particleMass = settings.restDensity * spacing * spacing * spacing;
+	poly6Scale = 315.0f / (64.0f * FLUID_PI * powf(h, 9.0f));
+	spikyScale = 45.0f / (FLUID_PI * powf(h, 6.0f));
+
+	timeSinceStep = 0.0f;
+	jetAccumulator = 0.0f;
+	jetCursor = 0;
+	random.Seed(seed);
+
+	positionX = new float[particleCount];
+	positionY = new float[particleCount];
+	positionZ = new float[particleCount];
+	velocityX = new float[particleCount];
+	velocityY = new float[particleCount];
+	velocityZ = new float[particleCount];
+	previousX = new float[particleCount];
+	previousY = new float[particleCount];
+	previousZ = new float[particleCount];
+	density = new float[particleCount];
+	inverseDensity = new float[particleCount];
+	pressure = new float[particleCount];
+	accelerationX = new float[particleCount];
+	accelerationY = new float[particleCount];
+	accelerationZ = new float[particleCount];
+	for (int i = 0; i < 9; i++)
+	{
+		scratch[i] = new float[particleCount];
+	}
+
+	// Cells are one smoothing radius wide, so neighbors are always
+	// within the surrounding 3x3x3 cells
+	cellScale = 1.0f / h;
+	gridX = (int)ceilf(settings.basinRadius * 2.0f * cellScale);
+	gridY = (int)ceilf((settings.ceiling - settings.basinFloor) * cellScale);
+	gridZ = gridX;
+	if (gridY < 1) gridY = 1;
+	cellCount = gridX * gridY * gridZ;
+
+	cellStart.resize(cellCount + 1);
+	particleCell.resize(particleCount);
+	sortedCell.resize(particleCount);
+	destination.resize(particleCount);
+
+	Fill();
+}
+
+FluidSimulation::~FluidSimulation()
+{
+	delete[] positionX;
+	delete[] positionY;
+	delete[] positionZ;
+	delete[] velocityX;
+	delete[] velocityY;
+	delete[] velocityZ;
+	delete[] previousX;
+	delete[] previousY;
+	delete[] previousZ;
+	delete[] density;
+	delete[] inverseDensity;
+	delete[] pressure;
+	delete[] accelerationX;
+	delete[] accelerationY;
+	delete[] accelerationZ;
+	for (int i = 0; i < 9; i++)
+	{
+		delete[] scratch[i];
+	}
+}
+
+void FluidSimulation::SetThreadCount(unsigned int threads)
+{
+	threadCount = threads > 0 ? threads : 1;
+}
+
+void FluidSimulation::Fill()
+{
+	// Stack layers of a lattice into the ring between the spout and the
+	// basin wall until everyone is placed, with a little jitter so the
+	// lattice doesn't hold its shape
+	float spacing = settings.smoothingRadius * 0.5f;
+	float inner = settings.spoutRadius + spacing * 0.5f;
+	float outer = settings.basinRadius - spacing * 0.5f;
+	int across = (int)(outer * 2.0f / spacing);
+
+	unsigned int placed = 0;
+	for (int layer = 0; placed < particleCount; layer++)
+	{
+		float y = settings.basinFloor + spacing * (layer + 0.5f);
+		for (int row = 0; row <= across && placed < particleCount; row++)
+		{
+			float z = -outer + row * spacing;
+			for (int column = 0; column <= across && placed < particleCount; column++)
+			{
+				float x = -outer + column * spacing;
+				float radius = sqrtf(x * x + z * z);
+				if (radius < inner || radius > outer) continue;
+
+				positionX[placed] = x + spacing * random.NextFloat(-0.05f, 0.05f);
+				positionY[placed] = y;
+				positionZ[placed] = z + spacing * random.NextFloat(-0.05f, 0.05f);
+				velocityX[placed] = 0.0f;
+				velocityY[placed] = 0.0f;
+				velocityZ[placed] = 0.0f;
+				previousX[placed] = positionX[placed];
+				previousY[placed] = positionY[placed];
+				previousZ[placed] = positionZ[placed];
+				placed++;
+			}
+		}
+	}
+}
+
+void FluidSimulation::Update(float dt)
+{
+	timeSinceStep += dt;
+
+	std::copy(positionX, positionX + particleCount, previousX);
+	std::copy(positionY, positionY + particleCount, previousY);
+	std::copy(positionZ, positionZ + particleCount, previousZ);
+
+	unsigned int steps = 0;
+	while (timeSinceStep >= settings.substepTime && steps < settings.maxSubsteps)
+	{
+		Step();
+		timeSinceStep -= settings.substepTime;
+		steps++;
+	}
+
+	// Over budget; drop the time we couldn't afford
+	if (steps == settings.maxSubsteps && timeSinceStep > settings.substepTime)
+	{
+		timeSinceStep = 0.0f;
+	}
+}
+
+void FluidSimulation::Step()
+{
+	unsigned int workers = particleCount >= PARALLEL_FLUID_THRESHOLD ? threadCount : 1;
+	unsigned int chunk = (particleCount + workers - 1) / workers;
+
+	BuildGrid(workers);
+
+	// Every pass only writes its own slice, so slices never wait on each other
+	RunParallel(workers, [&](unsigned int t)
+	{
+		unsigned int end = (t + 1) * chunk < particleCount ? (t + 1) * chunk : particleCount;
+		if (t * chunk < end) ComputeDensity(t * chunk, end);
+	});
+
+	RunParallel(workers, [&](unsigned int t)
+	{
+		unsigned int end = (t + 1) * chunk < particleCount ? (t + 1) * chunk : particleCount;
+		if (t * chunk < end) ComputeForces(t * chunk, end);
+	});
+
+	RunParallel(workers, [&](unsigned int t)
+	{
+		unsigned int end = (t + 1) * chunk < particleCount ? (t + 1) * chunk : particleCount;
+		if (t * chunk < end) Integrate(t * chunk, end);
+	});
+
+	EmitJet();
+}
+
+unsigned int FluidSimulation::GetCell(float x, float y, float z)
+{
+	// Anything outside the grid (spray above the ceiling) clamps to the edge cells
+	int cx = (int)((x + settings.basinRadius) * cellScale);
+	int cy = (int)((y - settings.basinFloor) * cellScale);
+	int cz = (int)((z + settings.basinRadius) * cellScale);
+	cx = cx < 0 ? 0 : (cx >= gridX ? gridX - 1 : cx);
+	cy = cy < 0 ? 0 : (cy >= gridY ? gridY - 1 : cy);
+	cz = cz < 0 ? 0 : (cz >= gridZ ? gridZ - 1 : cz);
+
+	return (cz * gridY + cy) * gridX + cx;
+}
+
+void FluidSimulation::BuildGrid(unsigned int workers)
+{
+	unsigned int chunk = (particleCount + workers - 1) / workers;
+	unsigned int cellChunk = (cellCount + workers - 1) / workers;
+
+	// Count cells, one slice of the particles per worker
+	histograms.assign(workers * cellCount, 0);
+	RunParallel(workers, [&](unsigned int t)
+	{
+		unsigned int* histogram = &histograms[t * cellCount];
+		unsigned int end = (t + 1) * chunk < particleCount ? (t + 1) * chunk : particleCount;
+		for (unsigned int i = t * chunk; i < end; i++)
+		{
+			unsigned int cell = GetCell(positionX[i], positionY[i], positionZ[i]);
+			particleCell[i] = cell;
+			histogram[cell]++;
+		}
+	});
+
+	// The scan runs cell-major, worker-minor.  Each worker first totals
+	// a range of cells...
+	rangeTotals.assign(workers, 0);
+	RunParallel(workers, [&](unsigned int t)
+	{
+		unsigned int end = (t + 1) * cellChunk < cellCount ? (t + 1) * cellChunk : cellCount;
+		unsigned int total = 0;
+		for (unsigned int cell = t * cellChunk; cell < end; cell++)
+		{
+			for (unsigned int w = 0; w < workers; w++)
+			{
+				total += histograms[w * cellCount + cell];
+			}
+		}
+		rangeTotals[t] = total;
+	});
+
+	unsigned int offset = 0;
+	for (unsigned int t = 0; t < workers; t++)
+	{
+		unsigned int total = rangeTotals[t];
+		rangeTotals[t] = offset;
+		offset += total;
+	}
+
+	// ...then turns its range's counts into write offsets
+	RunParallel(workers, [&](unsigned int t)
+	{
+		unsigned int end = (t + 1) * cellChunk < cellCount ? (t + 1) * cellChunk : cellCount;
+		unsigned int offset = rangeTotals[t];
+		for (unsigned int cell = t * cellChunk; cell < end; cell++)
+		{
+			cellStart[cell] = offset;
+			for (unsigned int w = 0; w < workers; w++)
+			{
+				unsigned int n = histograms[w * cellCount + cell];
+				histograms[w * cellCount + cell] = offset;
+				offset += n;
+			}
+		}
+	});
+	cellStart[cellCount] = particleCount;
+
+	// Scatter; each worker owns its own run in every cell so this stays stable
+	RunParallel(workers, [&](unsigned int t)
+	{
+		unsigned int* offsets = &histograms[t * cellCount];
+		unsigned int end = (t + 1) * chunk < particleCount ? (t + 1) * chunk : particleCount;
+		for (unsigned int i = t * chunk; i < end; i++)
+		{
+			unsigned int dst = offsets[particleCell[i]]++;
+			destination[i] = dst;
+			sortedCell[dst] = particleCell[i];
+		}
+
+		// Move the state that carries over between steps
+		for (unsigned int i = t * chunk; i < end; i++)
+		{
+			unsigned int dst = destination[i];
+			scratch[0][dst] = positionX[i];
+			scratch[1][dst] = positionY[i];
+			scratch[2][dst] = positionZ[i];
+			scratch[3][dst] = velocityX[i];
+			scratch[4][dst] = velocityY[i];
+			scratch[5][dst] = velocityZ[i];
+			scratch[6][dst] = previousX[i];
+			scratch[7][dst] = previousY[i];
+			scratch[8][dst] = previousZ[i];
+		}
+	});
+
+	std::swap(particleCell, sortedCell);
+	std::swap(positionX, scratch[0]);
+	std::swap(positionY, scratch[1]);
+	std::swap(positionZ, scratch[2]);
+	std::swap(velocityX, scratch[3]);
+	std::swap(velocityY, scratch[4]);
+	std::swap(velocityZ, scratch[5]);
+	std::swap(previousX, scratch[6]);
+	std::swap(previousY, scratch[7]);
+	std::swap(previousZ, scratch[8]);
+}
+
+void FluidSimulation::ComputeDensity(unsigned int first, unsigned int last)
+{
+	const __m128 h2 = _mm_set1_ps(radiusSq);
+
+	for (unsigned int i = first; i < last; i++)
+	{
+		float xi = positionX[i];
+		float yi = positionY[i];
+		float zi = positionZ[i];
+		__m128 px = _mm_set1_ps(xi);
+		__m128 py = _mm_set1_ps(yi);
+		__m128 pz = _mm_set1_ps(zi);
+		__m128 sum4 = _mm_setzero_ps();
+		float sum = 0.0f;
+
+		unsigned int cell = particleCell[i];
+		int cx = cell % gridX;
+		int cy = (cell / gridX) % gridY;
+		int cz = cell / (gridX * gridY);
+		int x0 = cx > 0 ? cx - 1 : 0;
+		int x1 = cx < gridX - 1 ? cx + 1 : gridX - 1;
+
+		// A row of three cells is one contiguous range of particles
+		for (int z = cz - 1; z <= cz + 1; z++)
+		{
+			if (z < 0 || z >= gridZ) continue;
+			for (int y = cy - 1; y <= cy + 1; y++)
+			{
+				if (y < 0 || y >= gridY) continue;
+
+				unsigned int row = (z * gridY + y) * gridX;
+				unsigned int j = cellStart[row + x0];
+				unsigned int end = cellStart[row + x1 + 1];
+
+				// Poly6: (h^2 - r^2)^3 inside the radius
+				for (; j + 4 <= end; j += 4)
+				{
+					__m128 dx = _mm_sub_ps(px, _mm_loadu_ps(positionX + j));
+					__m128 dy = _mm_sub_ps(py, _mm_loadu_ps(positionY + j));
+					__m128 dz = _mm_sub_ps(pz, _mm_loadu_ps(positionZ + j));
+					__m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+					__m128 d = _mm_sub_ps(h2, r2);
+					__m128 w = _mm_mul_ps(_mm_mul_ps(d, d), d);
+					sum4 = _mm_add_ps(sum4, _mm_and_ps(_mm_cmplt_ps(r2, h2), w));
+				}
+
+				for (; j < end; j++)
+				{
+					float dx = xi - positionX[j];
+					float dy = yi - positionY[j];
+					float dz = zi - positionZ[j];
+					float r2 = dx * dx + dy * dy + dz * dz;
+					if (r2 < radiusSq)
+					{
+						float d = radiusSq - r2;
+						sum += d * d * d;
+					}
+				}
+			}
+		}
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, sum4);
+		sum += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+		// Includes the particle itself, so density is never zero.  Pressure
+		// only pushes; pulling would clump the free surface.
+		density[i] = particleMass * poly6Scale * sum;
+		inverseDensity[i] = 1.0f / density[i];
+		float p = settings.stiffness * (density[i] - settings.restDensity);
+		pressure[i] = p > 0.0f ? p : 0.0f;
+	}
+}
+
+void FluidSimulation::ComputeForces(unsigned int first, unsigned int last)
+{
+	const __m128 h = _mm_set1_ps(settings.smoothingRadius);
+	const __m128 h2 = _mm_set1_ps(radiusSq);
+	const __m128 tiny = _mm_set1_ps(1e-12f);
+
+	for (unsigned int i = first; i < last; i++)
+	{
+		float xi = positionX[i];
+		float yi = positionY[i];
+		float zi = positionZ[i];
+		float vxi = velocityX[i];
+		float vyi = velocityY[i];
+		float vzi = velocityZ[i];
+		float pi = pressure[i];
+		__m128 px = _mm_set1_ps(xi);
+		__m128 py = _mm_set1_ps(yi);
+		__m128 pz = _mm_set1_ps(zi);
+		__m128 vx = _mm_set1_ps(vxi);
+		__m128 vy = _mm_set1_ps(vyi);
+		__m128 vz = _mm_set1_ps(vzi);
+		__m128 p = _mm_set1_ps(pi);
+
+		// Pressure pushes along the separation, viscosity pulls velocities together
+		__m128 pressureX4 = _mm_setzero_ps();
+		__m128 pressureY4 = _mm_setzero_ps();
+		__m128 pressureZ4 = _mm_setzero_ps();
+		__m128 viscosityX4 = _mm_setzero_ps();
+		__m128 viscosityY4 = _mm_setzero_ps();
+		__m128 viscosityZ4 = _mm_setzero_ps();
+		float pressureX = 0.0f, pressureY = 0.0f, pressureZ = 0.0f;
+		float viscosityX = 0.0f, viscosityY = 0.0f, viscosityZ = 0.0f;
+
+		unsigned int cell = particleCell[i];
+		int cx = cell % gridX;
+		int cy = (cell / gridX) % gridY;
+		int cz = cell / (gridX * gridY);
+		int x0 = cx > 0 ? cx - 1 : 0;
+		int x1 = cx < gridX - 1 ? cx + 1 : gridX - 1;
+
+		for (int z = cz - 1; z <= cz + 1; z++)
+		{
+			if (z < 0 || z >= gridZ) continue;
+			for (int y = cy - 1; y <= cy + 1; y++)
+			{
+				if (y < 0 || y >= gridY) continue;
+
+				unsigned int row = (z * gridY + y) * gridX;
+				unsigned int j = cellStart[row + x0];
+				unsigned int end = cellStart[row + x1 + 1];
+
+				for (; j + 4 <= end; j += 4)
+				{
+					__m128 dx = _mm_sub_ps(px, _mm_loadu_ps(positionX + j));
+					__m128 dy = _mm_sub_ps(py, _mm_loadu_ps(positionY + j));
+					__m128 dz = _mm_sub_ps(pz, _mm_loadu_ps(positionZ + j));
+					__m128 r2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+
+					// Inside the radius and not itself (or sitting right on top of it)
+					__m128 mask = _mm_and_ps(_mm_cmplt_ps(r2, h2), _mm_cmpgt_ps(r2, tiny));
+					__m128 invR = _mm_rsqrt_ps(_mm_max_ps(r2, tiny));
+					__m128 q = _mm_and_ps(mask, _mm_sub_ps(h, _mm_mul_ps(r2, invR)));
+					__m128 invRhoJ = _mm_loadu_ps(inverseDensity + j);
+
+					// Spiky gradient: (pi + pj) / rhoj * (h - r)^2 * rhat
+					__m128 push = _mm_mul_ps(_mm_mul_ps(_mm_add_ps(p, _mm_loadu_ps(pressure + j)), invRhoJ), _mm_mul_ps(_mm_mul_ps(q, q), invR));
+					pressureX4 = _mm_add_ps(pressureX4, _mm_mul_ps(push, dx));
+					pressureY4 = _mm_add_ps(pressureY4, _mm_mul_ps(push, dy));
+					pressureZ4 = _mm_add_ps(pressureZ4, _mm_mul_ps(push, dz));
+
+					// Viscosity laplacian: (vj - vi) / rhoj * (h - r)
+					__m128 drag = _mm_mul_ps(invRhoJ, q);
+					viscosityX4 = _mm_add_ps(viscosityX4, _mm_mul_ps(drag, _mm_sub_ps(_mm_loadu_ps(velocityX + j), vx)));
+					viscosityY4 = _mm_add_ps(viscosityY4, _mm_mul_ps(drag, _mm_sub_ps(_mm_loadu_ps(velocityY + j), vy)));
+					viscosityZ4 = _mm_add_ps(viscosityZ4, _mm_mul_ps(drag, _mm_sub_ps(_mm_loadu_ps(velocityZ + j), vz)));
+				}
+
+				for (; j < end; j++)
+				{
+					float dx = xi - positionX[j];
+					float dy = yi - positionY[j];
+					float dz = zi - positionZ[j];
+					float r2 = dx * dx + dy * dy + dz * dz;
+					if (r2 >= radiusSq || r2 <= 1e-12f) continue;
+
+					float r = sqrtf(r2);
+					float q = settings.smoothingRadius - r;
+					float push = (pi + pressure[j]) * inverseDensity[j] * q * q / r;
+					pressureX += push * dx;
+					pressureY += push * dy;
+					pressureZ += push * dz;
+
+					float drag = inverseDensity[j] * q;
+					viscosityX += drag * (velocityX[j] - vxi);
+					viscosityY += drag * (velocityY[j] - vyi);
+					viscosityZ += drag * (velocityZ[j] - vzi);
+				}
+			}
+		}
+
+		float lanes[4];
+		_mm_storeu_ps(lanes, pressureX4); pressureX += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		_mm_storeu_ps(lanes, pressureY4); pressureY += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		_mm_storeu_ps(lanes, pressureZ4); pressureZ += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		_mm_storeu_ps(lanes, viscosityX4); viscosityX += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		_mm_storeu_ps(lanes, viscosityY4); viscosityY += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+		_mm_storeu_ps(lanes, viscosityZ4); viscosityZ += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+
+		// Both kernels share the 45 / (pi h^6) scale
+		float scale = particleMass * spikyScale * inverseDensity[i];
+		accelerationX[i] = scale * (0.5f * pressureX + settings.viscosity * viscosityX);
+		accelerationY[i] = scale * (0.5f * pressureY + settings.viscosity * viscosityY) - settings.gravity;
+		accelerationZ[i] = scale * (0.5f * pressureZ + settings.viscosity * viscosityZ);
+	}
+}
+
+void FluidSimulation::Integrate(unsigned int first, unsigned int last)
+{
+	float dt = settings.substepTime;
+	float bounce = -settings.restitution;
+
+	// Nothing should cross more than half a cell in one substep
+	float maxSpeed = settings.smoothingRadius * 0.5f / dt;
+	float maxSpeedSq = maxSpeed * maxSpeed;
+
+	for (unsigned int i = first; i < last; i++)
+	{
+		float vx = velocityX[i] + accelerationX[i] * dt;
+		float vy = velocityY[i] + accelerationY[i] * dt;
+		float vz = velocityZ[i] + accelerationZ[i] * dt;
+
+		float speedSq = vx * vx + vy * vy + vz * vz;
+		if (speedSq > maxSpeedSq)
+		{
+			float scale = maxSpeed / sqrtf(speedSq);
+			vx *= scale;
+			vy *= scale;
+			vz *= scale;
+		}
+
+		float x = positionX[i] + vx * dt;
+		float y = positionY[i] + vy * dt;
+		float z = positionZ[i] + vz * dt;
+
+		// Basin floor
+		if (y < settings.basinFloor)
+		{
+			y = settings.basinFloor;
+			if (vy < 0.0f) vy *= bounce;
+		}
+
+		// Basin wall, and the spout's column
+		float distanceSq = x * x + z * z;
+		float wall = 0.0f;
+		if (distanceSq > settings.basinRadius * settings.basinRadius)
+		{
+			wall = settings.basinRadius;
+		}
+		else if (distanceSq < settings.spoutRadius * settings.spoutRadius && y < settings.spoutTop)
+		{
+			wall = settings.spoutRadius;
+		}
+
+		if (wall > 0.0f)
+		{
+			// Push back onto the wall and reflect the velocity's radial part
+			float radius = sqrtf(distanceSq);
+			float nx = radius > 1e-6f ? x / radius : 1.0f;
+			float nz = radius > 1e-6f ? z / radius : 0.0f;
+			x = nx * wall;
+			z = nz * wall;
+
+			float radial = vx * nx + vz * nz;
+			bool outward = wall == settings.basinRadius ? radial > 0.0f : radial < 0.0f;
+			if (outward)
+			{
+				vx -= (1.0f - bounce) * radial * nx;
+				vz -= (1.0f - bounce) * radial * nz;
+			}
+		}
+
+		positionX[i] = x;
+		positionY[i] = y;
+		positionZ[i] = z;
+		velocityX[i] = vx;
+		velocityY[i] = vy;
+		velocityZ[i] = vz;
+	}
+}
+
+void FluidSimulation::EmitJet()
+{
+	jetAccumulator += settings.jetRate * settings.substepTime;
+
+	// Take water from the basin and send it back up out of the spout.
+	// The cursor keeps walking so every particle gets its turn.
+	unsigned int searched = 0;
+	while (jetAccumulator >= 1.0f && searched < particleCount)
+	{
+		unsigned int i = jetCursor;
+		jetCursor = (jetCursor + 1) % particleCount;
+		searched++;
+
+		if (positionY[i] >= settings.basinRim) continue;
+
+		float angle = random.NextFloat(0.0f, 2.0f * FLUID_PI);
+		float radius = settings.spoutRadius * 0.5f * sqrtf(random.NextFloat());
+		float spread = settings.jetSpread * random.NextFloat(0.5f, 1.0f);
+		float c = cosf(angle);
+		float s = sinf(angle);
+
+		positionX[i] = c * radius;
+		positionY[i] = settings.spoutTop + settings.smoothingRadius * 0.25f;
+		positionZ[i] = s * radius;
+		velocityX[i] = c * spread;
+		velocityY[i] = settings.jetSpeed;
+		velocityZ[i] = s * spread;
+
+		// Out of the spout, not flown up from the basin
+		previousX[i] = positionX[i];
+		previousY[i] = positionY[i];
+		previousZ[i] = positionZ[i];
+
+		jetAccumulator -= 1.0f;
+	}
+
+	// The basin ran dry; try again next step
+	if (jetAccumulator > 1.0f) jetAccumulator = 1.0f;
+}
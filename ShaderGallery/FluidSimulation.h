@@ -0,0 +1,139 @@
+#pragma once
+#include <vector>
+
+#include "Random.h"
+
+// --------------------------------------------------------
+// Tuning for a fluid simulation.  The defaults fill the
+// gallery's fountain basin; everything is in the basin's
+// local space (the spout stands on the y axis).
+// --------------------------------------------------------
+struct FluidSettings
+{
+	// SPH
+	float smoothingRadius = 0.12f;
+	float restDensity = 1000.0f;
+	float stiffness = 200.0f;			// Pressure per unit of density above rest
+	float viscosity = 0.25f;
+	float gravity = 9.8f;
+
+	// Fixed substeps; an Update() never runs more than the budget,
+	// so a slow frame makes the water slow down instead of snowballing
+	float substepTime = 1.0f / 300.0f;
+	unsigned int maxSubsteps = 5;
+
+	// Basin: a cylinder around the spout
+	float basinRadius = 1.45f;
+	float basinFloor = 0.2f;
+	float basinRim = 0.5f;
+	float spoutRadius = 0.3f;
+	float spoutTop = 1.5f;
+	float ceiling = 3.0f;				// Top of the neighbor grid (not a wall)
+	float restitution = 0.3f;
+
+	// Water is recycled from the basin back out of the spout.  Keep the
+	// rate below what fills the nozzle at rest density, or the jet bursts.
+	float jetRate = 400.0f;				// Particles per second
+	float jetSpeed = 3.0f;
+	float jetSpread = 0.35f;
+};
+
+// --------------------------------------------------------
+// Smoothed-particle hydrodynamics on the CPU.
+//
+// Particles live in SoA arrays that are re-sorted by grid
+// cell every substep with a parallel counting sort, so a
+// cell's particles are contiguous and a row of three
+// neighboring cells is one contiguous range.  Density and
+// force kernels then walk those ranges four neighbors at a
+// time in SSE.
+//
+// Nothing here touches D3D, so it can be stepped headless;
+// see Fountain for the exhibit that draws it.
+// --------------------------------------------------------
+class FluidSimulation
+{
+public:
+	FluidSimulation(unsigned int particleCount, FluidSettings settings, unsigned int seed = 1);
+	~FluidSimulation();
+
+	// Runs as many fixed substeps as dt covers, up to the budget.
+	// Where everyone was before it is kept, to draw in between.
+	void Update(float dt);
+
+	// One fixed substep
+	void Step();
+
+	void SetThreadCount(unsigned int threads);
+	unsigned int GetThreadCount() { return threadCount; }
+
+	unsigned int GetParticleCount() { return particleCount; }
+	const float* GetPositionsX() { return positionX; }
+	const float* GetPositionsY() { return positionY; }
+	const float* GetPositionsZ() { return positionZ; }
+	const float* GetPreviousPositionsX() { return previousX; }
+	const float* GetPreviousPositionsY() { return previousY; }
+	const float* GetPreviousPositionsZ() { return previousZ; }
+	const float* GetDensities() { return density; }
+	FluidSettings GetSettings() { return settings; }
+
+private:
+	void Fill();
+	void BuildGrid(unsigned int workers);
+	void ComputeDensity(unsigned int first, unsigned int last);
+	void ComputeForces(unsigned int first, unsigned int last);
+	void Integrate(unsigned int first, unsigned int last);
+	void EmitJet();
+
+	unsigned int GetCell(float x, float y, float z);
+
+	FluidSettings settings;
+	unsigned int particleCount;
+	unsigned int threadCount;
+
+	// Derived kernel constants
+	float radiusSq;
+	float particleMass;
+	float poly6Scale;
+	float spikyScale;
+
+	float timeSinceStep;
+	float jetAccumulator;
+	unsigned int jetCursor;
+	Random random;
+
+	// Particle SoA, in cell order after every BuildGrid()
+	float* positionX;
+	float* positionY;
+	float* positionZ;
+	float* velocityX;
+	float* velocityY;
+	float* velocityZ;
+	float* previousX;
+	float* previousY;
+	float* previousZ;
+	float* density;
+	float* inverseDensity;
+	float* pressure;
+	float* accelerationX;
+	float* accelerationY;
+	float* accelerationZ;
+
+	// Scratch for reordering positions (current and previous) and velocities
+	float* scratch[9];
+
+	// Uniform grid over the basin, from the floor up to the ceiling
+	float cellScale;
+	int gridX;
+	int gridY;
+	int gridZ;
+	unsigned int cellCount;
+	std::vector<unsigned int> cellStart;		// cellCount + 1 entries
+	std::vector<unsigned int> particleCell;		// Parallel to the SoA
+	std::vector<unsigned int> sortedCell;
+	std::vector<unsigned int> destination;		// Where each particle lands in the sort
+
+	// Per worker histograms (workers * cellCount) and range totals
+	std::vector<unsigned int> histograms;
+	std::vector<unsigned int> rangeTotals;
+};
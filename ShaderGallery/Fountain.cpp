@@ -0,0 +1,153 @@
+#include "Fountain.h"
+
+using namespace DirectX;
+
+Fountain::Fountain(
+	DirectX::XMFLOAT3 position,
+	unsigned int particleCount,
+	FluidSettings settings,
+	float particleSize,
+	DirectX::XMFLOAT4 waterColor,
+	DirectX::XMFLOAT4 foamColor,
+	ID3D11Device* device,
+	SimpleVertexShader* vs,
+	SimplePixelShader* ps,
+	ID3D11ShaderResourceView* texture
+)
+{
+	simulation = new FluidSimulation(particleCount, settings);
+
+	this->position = position;
+	this->particleSize = particleSize;
+	this->waterColor = waterColor;
+	this->foamColor = foamColor;
+	this->texture = texture;
+	this->vs = vs;
+	this->ps = ps;
+
+	// UVs and sizes never change, so only fill them once
+	localVertices = new ParticleVertex[particleCount * 4];
+	for (unsigned int i = 0; i < particleCount * 4; i += 4)
+	{
+		localVertices[i + 0].uv = XMFLOAT2(0, 0);
+		localVertices[i + 1].uv = XMFLOAT2(1, 0);
+		localVertices[i + 2].uv = XMFLOAT2(1, 1);
+		localVertices[i + 3].uv = XMFLOAT2(0, 1);
+
+		localVertices[i + 0].size = particleSize;
+		localVertices[i + 1].size = particleSize;
+		localVertices[i + 2].size = particleSize;
+		localVertices[i + 3].size = particleSize;
+	}
+
+	// DYNAMIC vertex buffer (no initial data necessary)
+	D3D11_BUFFER_DESC vbDesc = {};
+	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	vbDesc.Usage = D3D11_USAGE_DYNAMIC;
+	vbDesc.ByteWidth = sizeof(ParticleVertex) * 4 * particleCount;
+	device->CreateBuffer(&vbDesc, 0, &vertexBuffer);
+
+	// Index buffer data
+	unsigned int* indices = new unsigned int[particleCount * 6];
+	int indexCount = 0;
+	for (unsigned int i = 0; i < particleCount * 4; i += 4)
+	{
+		indices[indexCount++] = i;
+		indices[indexCount++] = i + 1;
+		indices[indexCount++] = i + 2;
+		indices[indexCount++] = i;
+		indices[indexCount++] = i + 2;
+		indices[indexCount++] = i + 3;
+	}
+	D3D11_SUBRESOURCE_DATA indexData = {};
+	indexData.pSysMem = indices;
+
+	// Regular index buffer
+	D3D11_BUFFER_DESC ibDesc = {};
+	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibDesc.CPUAccessFlags = 0;
+	ibDesc.Usage = D3D11_USAGE_DEFAULT;
+	ibDesc.ByteWidth = sizeof(unsigned int) * particleCount * 6;
+	device->CreateBuffer(&ibDesc, &indexData, &indexBuffer);
+
+	delete[] indices;
+}
+
+Fountain::~Fountain()
+{
+	delete simulation;
+	delete[] localVertices;
+
+	vertexBuffer->Release();
+	indexBuffer->Release();
+}
+
+void Fountain::Update(float dt)
+{
+	simulation->Update(dt);
+}
+
+void Fountain::Draw(ID3D11DeviceContext* context, Camera* camera, float alpha)
+{
+	unsigned int count = simulation->GetParticleCount();
+	const float* x = simulation->GetPositionsX();
+	const float* y = simulation->GetPositionsY();
+	const float* z = simulation->GetPositionsZ();
+	const float* previousX = simulation->GetPreviousPositionsX();
+	const float* previousY = simulation->GetPreviousPositionsY();
+	const float* previousZ = simulation->GetPreviousPositionsZ();
+	const float* density = simulation->GetDensities();
+	float inverseRestDensity = 1.0f / simulation->GetSettings().restDensity;
+
+	XMVECTOR water = XMLoadFloat4(&waterColor);
+	XMVECTOR foam = XMLoadFloat4(&foamColor);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		XMFLOAT3 p(
+			position.x + previousX[i] + (x[i] - previousX[i]) * alpha,
+			position.y + previousY[i] + (y[i] - previousY[i]) * alpha,
+			position.z + previousZ[i] + (z[i] - previousZ[i]) * alpha);
+
+		// Foamier the further under rest density
+		float foamAmount = 1.0f - density[i] * inverseRestDensity;
+		foamAmount = foamAmount < 0.0f ? 0.0f : (foamAmount > 1.0f ? 1.0f : foamAmount);
+		XMFLOAT4 color;
+		XMStoreFloat4(&color, XMVectorLerp(water, foam, foamAmount));
+
+		ParticleVertex* vertices = &localVertices[i * 4];
+		vertices[0].position = p;
+		vertices[1].position = p;
+		vertices[2].position = p;
+		vertices[3].position = p;
+
+		vertices[0].color = color;
+		vertices[1].color = color;
+		vertices[2].color = color;
+		vertices[3].color = color;
+	}
+
+	// All particles copied locally - send whole buffer to GPU
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	memcpy(mapped.pData, localVertices, sizeof(ParticleVertex) * 4 * count);
+	context->Unmap(vertexBuffer, 0);
+
+	// Set up buffers
+	UINT stride = sizeof(ParticleVertex);
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+	vs->SetMatrix4x4("view", camera->GetView());
+	vs->SetMatrix4x4("projection", camera->GetProjection());
+	vs->SetShader();
+	vs->CopyAllBufferData();
+
+	ps->SetShaderResourceView("particle", texture);
+	ps->SetShader();
+	ps->CopyAllBufferData();
+
+	context->DrawIndexed(count * 6, 0, 0);
+}
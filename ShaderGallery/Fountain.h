@@ -0,0 +1,55 @@
+#pragma once
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+#include "Camera.h"
+#include "SimpleShader.h"
+#include "Particle.h"
+#include "FluidSimulation.h"
+
+// --------------------------------------------------------
+// The water in the fountain exhibit: a FluidSimulation in
+// the basin's local space, drawn as camera-facing quads
+// through the regular particle shaders.  Foam (particles
+// well under rest density, like spray) fades toward white.
+// --------------------------------------------------------
+class Fountain
+{
+public:
+	Fountain(
+		DirectX::XMFLOAT3 position,
+		unsigned int particleCount,
+		FluidSettings settings,
+		float particleSize,
+		DirectX::XMFLOAT4 waterColor,
+		DirectX::XMFLOAT4 foamColor,
+		ID3D11Device* device,
+		SimpleVertexShader* vs,
+		SimplePixelShader* ps,
+		ID3D11ShaderResourceView* texture
+	);
+	~Fountain();
+
+	void Update(float dt);
+
+	// Alpha is how far between the last two updates to draw the water
+	void Draw(ID3D11DeviceContext* context, Camera* camera, float alpha = 1.0f);
+
+	FluidSimulation* GetSimulation() { return simulation; }
+
+private:
+	FluidSimulation* simulation;
+
+	DirectX::XMFLOAT3 position;
+	float particleSize;
+	DirectX::XMFLOAT4 waterColor;
+	DirectX::XMFLOAT4 foamColor;
+
+	// Rendering vars
+	ID3D11Buffer* vertexBuffer;
+	ID3D11Buffer* indexBuffer;
+	ParticleVertex* localVertices;
+	ID3D11ShaderResourceView* texture;
+	SimpleVertexShader* vs;
+	SimplePixelShader* ps;
+};
@@ -0,0 +1,254 @@
+#include "GPUEmitter.h"
+
+GPUEmitter::GPUEmitter(
+	DirectX::XMFLOAT3 position,
+	DirectX::XMFLOAT3 startVelocity,
+	DirectX::XMFLOAT4 startColor,
+	DirectX::XMFLOAT4 endColor,
+	float startSize,
+	float endSize,
+	unsigned int maxParticleCount,
+	float emissionRate,
+	float lifetime,
+	ID3D11Device* device,
+	ID3D11DeviceContext* context,
+	SimpleComputeShader* deadListInitCS,
+	SimpleComputeShader* emitCS,
+	SimpleComputeShader* updateCS,
+	SimpleVertexShader* vs,
+	SimplePixelShader* ps,
+	ID3D11ShaderResourceView* texture
+)
+{
+	this->position = position;
+
+	// Initial values for particle
+	this->startVelocity = startVelocity;
+	this->startColor = startColor;
+	this->endColor = endColor;
+	this->startSize = startSize;
+	this->endSize = endSize;
+
+	this->maxParticleCount = maxParticleCount;
+
+	this->emissionRate = emissionRate;
+	secondsPerParticle = 1.0f / emissionRate;
+
+	this->lifetime = lifetime;
+
+	spreadAngles = PARTICLE_SPREAD_ANGLES;
+	spreadCalmness = PARTICLE_SPREAD_CALMNESS;
+
+	timeSinceEmit = 0;
+	spawnCount = 0;
+
+	this->context = context;
+	this->emitCS = emitCS;
+	this->updateCS = updateCS;
+	this->texture = texture;
+	this->vs = vs;
+	this->ps = ps;
+
+	// Particle buffer (read/write in the kernels, read in the vertex shader)
+	D3D11_BUFFER_DESC particleDesc = {};
+	particleDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+	particleDesc.Usage = D3D11_USAGE_DEFAULT;
+	particleDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	particleDesc.StructureByteStride = sizeof(GPUParticle);
+	particleDesc.ByteWidth = sizeof(GPUParticle) * maxParticleCount;
+	device->CreateBuffer(&particleDesc, 0, &particleBuffer);
+
+	D3D11_UNORDERED_ACCESS_VIEW_DESC uavDesc = {};
+	uavDesc.Format = DXGI_FORMAT_UNKNOWN;
+	uavDesc.ViewDimension = D3D11_UAV_DIMENSION_BUFFER;
+	uavDesc.Buffer.FirstElement = 0;
+	uavDesc.Buffer.NumElements = maxParticleCount;
+	uavDesc.Buffer.Flags = 0;
+	device->CreateUnorderedAccessView(particleBuffer, &uavDesc, &particleUAV);
+
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+	srvDesc.Format = DXGI_FORMAT_UNKNOWN;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_BUFFER;
+	srvDesc.Buffer.FirstElement = 0;
+	srvDesc.Buffer.NumElements = maxParticleCount;
+	device->CreateShaderResourceView(particleBuffer, &srvDesc, &particleSRV);
+
+	// Dead and draw lists are append/consume buffers of particle indices
+	D3D11_BUFFER_DESC listDesc = {};
+	listDesc.BindFlags = D3D11_BIND_UNORDERED_ACCESS | D3D11_BIND_SHADER_RESOURCE;
+	listDesc.Usage = D3D11_USAGE_DEFAULT;
+	listDesc.MiscFlags = D3D11_RESOURCE_MISC_BUFFER_STRUCTURED;
+	listDesc.StructureByteStride = sizeof(unsigned int);
+	listDesc.ByteWidth = sizeof(unsigned int) * maxParticleCount;
+	device->CreateBuffer(&listDesc, 0, &deadListBuffer);
+	device->CreateBuffer(&listDesc, 0, &drawListBuffer);
+
+	uavDesc.Buffer.Flags = D3D11_BUFFER_UAV_FLAG_APPEND;
+	device->CreateUnorderedAccessView(deadListBuffer, &uavDesc, &deadListUAV);
+	device->CreateUnorderedAccessView(drawListBuffer, &uavDesc, &drawListUAV);
+	device->CreateShaderResourceView(drawListBuffer, &srvDesc, &drawListSRV);
+
+	// Constant buffer the dead list count gets copied into (must be 16 bytes)
+	D3D11_BUFFER_DESC counterDesc = {};
+	counterDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	counterDesc.Usage = D3D11_USAGE_DEFAULT;
+	counterDesc.ByteWidth = 16;
+	device->CreateBuffer(&counterDesc, 0, &deadListCounterBuffer);
+
+	// Indirect args: 6 vertices per particle, one instance per living particle.
+	// The instance count gets overwritten with the draw list count every frame.
+	D3D11_BUFFER_DESC argsDesc = {};
+	argsDesc.BindFlags = 0;
+	argsDesc.Usage = D3D11_USAGE_DEFAULT;
+	argsDesc.MiscFlags = D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS;
+	argsDesc.ByteWidth = sizeof(unsigned int) * 4;
+
+	unsigned int args[4] = { 6, 0, 0, 0 };
+	D3D11_SUBRESOURCE_DATA argsData = {};
+	argsData.pSysMem = args;
+	device->CreateBuffer(&argsDesc, &argsData, &drawArgsBuffer);
+
+	// Every particle starts dead
+	deadListInitCS->SetInt("maxParticles", maxParticleCount);
+	deadListInitCS->SetShader();
+	deadListInitCS->CopyAllBufferData();
+	deadListInitCS->SetUnorderedAccessView("Particles", particleUAV);
+	deadListInitCS->SetUnorderedAccessView("DeadList", deadListUAV, 0);
+	deadListInitCS->DispatchByThreads(maxParticleCount, 1, 1);
+	deadListInitCS->SetUnorderedAccessView("Particles", 0);
+	deadListInitCS->SetUnorderedAccessView("DeadList", 0);
+}
+
+GPUEmitter::~GPUEmitter()
+{
+	particleBuffer->Release();
+	particleUAV->Release();
+	particleSRV->Release();
+
+	deadListBuffer->Release();
+	deadListUAV->Release();
+	deadListCounterBuffer->Release();
+
+	drawListBuffer->Release();
+	drawListUAV->Release();
+	drawListSRV->Release();
+
+	drawArgsBuffer->Release();
+}
+
+void GPUEmitter::Seed(unsigned int seed)
+{
+	random.Seed(seed);
+}
+
+void GPUEmitter::SetSpread(int angles, float calmness)
+{
+	spreadAngles = angles;
+	spreadCalmness = calmness;
+}
+
+GPUParticleParams GPUEmitter::GetParams(float dt, unsigned int emitCount)
+{
+	GPUParticleParams params = {};
+	params.emitterPosition = position;
+	params.startVelocity = startVelocity;
+	params.startColor = startColor;
+	params.endColor = endColor;
+	params.startSize = startSize;
+	params.endSize = endSize;
+	params.lifetime = lifetime;
+	params.invLifetime = 1.0f / lifetime;
+	params.spread = spreadAngles > 1 ? (spreadAngles / 2) / (spreadCalmness * spreadAngles) : 0.0f;
+	params.dt = dt;
+	params.emitCount = emitCount;
+	params.spawnBase = spawnCount;
+	params.randomKey = random.GetKey();
+	params.maxParticles = maxParticleCount;
+	return params;
+}
+
+void GPUEmitter::Update(float dt)
+{
+	// How many particles are due this frame?
+	timeSinceEmit += dt;
+	unsigned int emitCount = (unsigned int)(timeSinceEmit / secondsPerParticle);
+	timeSinceEmit -= emitCount * secondsPerParticle;
+
+	GPUParticleParams params = GetParams(dt, emitCount);
+
+	// Update pass: age everyone, compact survivors into a fresh draw list
+	updateCS->SetFloat4("startColor", params.startColor);
+	updateCS->SetFloat4("endColor", params.endColor);
+	updateCS->SetFloat("startSize", params.startSize);
+	updateCS->SetFloat("endSize", params.endSize);
+	updateCS->SetFloat("lifetime", params.lifetime);
+	updateCS->SetFloat("invLifetime", params.invLifetime);
+	updateCS->SetFloat("dt", params.dt);
+	updateCS->SetInt("maxParticles", params.maxParticles);
+	updateCS->SetShader();
+	updateCS->CopyAllBufferData();
+	updateCS->SetUnorderedAccessView("Particles", particleUAV);
+	updateCS->SetUnorderedAccessView("DeadList", deadListUAV);
+	updateCS->SetUnorderedAccessView("DrawList", drawListUAV, 0);
+	updateCS->DispatchByThreads(maxParticleCount, 1, 1);
+
+	// Spawn pass: pull new particles off the dead list
+	if (emitCount > 0)
+	{
+		// The emit kernel guards against consuming more than the dead list holds
+		context->CopyStructureCount(deadListCounterBuffer, 0, deadListUAV);
+
+		emitCS->SetFloat3("emitterPosition", params.emitterPosition);
+		emitCS->SetFloat3("startVelocity", params.startVelocity);
+		emitCS->SetFloat4("startColor", params.startColor);
+		emitCS->SetFloat("startSize", params.startSize);
+		emitCS->SetFloat("spread", params.spread);
+		emitCS->SetInt("emitCount", params.emitCount);
+		emitCS->SetInt("spawnBase", params.spawnBase);
+		emitCS->SetInt("randomKey", params.randomKey);
+		emitCS->SetShader();
+		emitCS->CopyAllBufferData();
+		context->CSSetConstantBuffers(1, 1, &deadListCounterBuffer);
+		emitCS->SetUnorderedAccessView("Particles", particleUAV);
+		emitCS->SetUnorderedAccessView("DeadList", deadListUAV);
+		emitCS->SetUnorderedAccessView("DrawList", drawListUAV);
+		emitCS->DispatchByThreads(emitCount, 1, 1);
+
+		spawnCount += emitCount;
+	}
+
+	// Unbind so the buffers can be read by the vertex shader
+	ID3D11UnorderedAccessView* none[3] = {};
+	context->CSSetUnorderedAccessViews(0, 3, none, 0);
+
+	// The survivors are the instance count for the indirect draw
+	context->CopyStructureCount(drawArgsBuffer, sizeof(unsigned int), drawListUAV);
+}
+
+void GPUEmitter::Draw(ID3D11DeviceContext* context, Camera* camera, float alpha)
+{
+	// No vertex or index buffers; the vertex shader reads the particles directly
+	ID3D11Buffer* nothing = 0;
+	UINT stride = 0;
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
+	context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
+
+	vs->SetMatrix4x4("view", camera->GetView());
+	vs->SetMatrix4x4("projection", camera->GetProjection());
+	vs->SetFloat("alpha", alpha);
+	vs->SetShader();
+	vs->CopyAllBufferData();
+	vs->SetShaderResourceView("ParticleData", particleSRV);
+	vs->SetShaderResourceView("DrawList", drawListSRV);
+
+	ps->SetShaderResourceView("particle", texture);
+	ps->SetShader();
+	ps->CopyAllBufferData();
+
+	context->DrawInstancedIndirect(drawArgsBuffer, 0);
+
+	// Unbind so the kernels can write to them next frame
+	vs->SetShaderResourceView("ParticleData", 0);
+	vs->SetShaderResourceView("DrawList", 0);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+#include "Camera.h"
+#include "SimpleShader.h"
+#include "GPUParticle.h"
+#include "Particle.h"
+#include "Random.h"
+
+class Camera;
+
+// --------------------------------------------------------
+// Emitter whose particles live entirely on the GPU.
+//
+// Particle state is kept in a structured buffer alongside a
+// dead list (free slots) and a draw list (this frame's
+// survivors).  Each frame an update pass ages particles and
+// compacts the living ones into the draw list, and a spawn
+// pass pulls new particles off the dead list.  The draw list
+// count is copied straight into the indirect draw args, so
+// the CPU never needs to know how many particles are alive.
+//
+// GPUParticleReference runs the same kernels on the CPU.
+// --------------------------------------------------------
+class GPUEmitter
+{
+public:
+	GPUEmitter(
+		DirectX::XMFLOAT3 position,
+		DirectX::XMFLOAT3 startVelocity,
+		DirectX::XMFLOAT4 startColor,
+		DirectX::XMFLOAT4 endColor,
+		float startSize,
+		float endSize,
+		unsigned int maxParticleCount,
+		float emissionRate,
+		float lifetime,
+		ID3D11Device* device,
+		ID3D11DeviceContext* context,
+		SimpleComputeShader* deadListInitCS,
+		SimpleComputeShader* emitCS,
+		SimpleComputeShader* updateCS,
+		SimpleVertexShader* vs,
+		SimplePixelShader* ps,
+		ID3D11ShaderResourceView* texture
+	);
+	~GPUEmitter();
+
+	void Update(float dt);
+
+	// Alpha is how far between the last two updates to draw the particles
+	void Draw(ID3D11DeviceContext* context, Camera* camera, float alpha = 1.0f);
+
+	// Reseeds this emitter's random stream so runs can be reproduced
+	void Seed(unsigned int seed);
+
+	// Random x/z spread at spawn, as for the CPU emitter
+	void SetSpread(int angles, float calmness);
+
+	// The kernel inputs for the coming frame, as the CPU reference wants them
+	GPUParticleParams GetParams(float dt, unsigned int emitCount);
+
+private:
+	DirectX::XMFLOAT3 position;
+	float timeSinceEmit;
+	unsigned int spawnCount;
+
+	DirectX::XMFLOAT3 startVelocity;
+	DirectX::XMFLOAT4 startColor;
+	DirectX::XMFLOAT4 endColor;
+	float startSize;
+	float endSize;
+
+	unsigned int maxParticleCount;
+	float emissionRate;
+	float secondsPerParticle;
+	float lifetime;
+
+	int spreadAngles;
+	float spreadCalmness;
+
+	Random random;
+
+	ID3D11DeviceContext* context;
+
+	// Particle state, free slots and this frame's survivors
+	ID3D11Buffer* particleBuffer;
+	ID3D11UnorderedAccessView* particleUAV;
+	ID3D11ShaderResourceView* particleSRV;
+
+	ID3D11Buffer* deadListBuffer;
+	ID3D11UnorderedAccessView* deadListUAV;
+	ID3D11Buffer* deadListCounterBuffer;	// Constant buffer the dead list count is copied into
+
+	ID3D11Buffer* drawListBuffer;
+	ID3D11UnorderedAccessView* drawListUAV;
+	ID3D11ShaderResourceView* drawListSRV;
+
+	ID3D11Buffer* drawArgsBuffer;			// Indirect args for DrawInstancedIndirect
+
+	// Shaders
+	SimpleComputeShader* emitCS;
+	SimpleComputeShader* updateCS;
+	ID3D11ShaderResourceView* texture;
+	SimpleVertexShader* vs;
+	SimplePixelShader* ps;
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// Age given to dead particles so they never pass the lifetime test
+#define GPU_DEAD_PARTICLE_AGE 3.402823466e+38f
+
+// --------------------------------------------------------
+// A particle as stored in the GPU emitter's structured buffer.
+// Must match Particle in ParticleGPUCommon.hlsli (64 bytes).
+// --------------------------------------------------------
+struct GPUParticle
+{
+	DirectX::XMFLOAT3 position;
+	float age;
+	DirectX::XMFLOAT3 velocity;
+	float size;
+	DirectX::XMFLOAT4 color;
+	unsigned int spawnId;
+	DirectX::XMFLOAT3 previousPosition;		// Before the last update; frames draw in between
+};
+
+// --------------------------------------------------------
+// Everything the spawn and update kernels read from their
+// constant buffers for one frame
+// --------------------------------------------------------
+struct GPUParticleParams
+{
+	DirectX::XMFLOAT3 emitterPosition;
+	DirectX::XMFLOAT3 startVelocity;
+	DirectX::XMFLOAT4 startColor;
+	DirectX::XMFLOAT4 endColor;
+	float startSize;
+	float endSize;
+	float lifetime;
+	float invLifetime;
+	float spread;				// Max x/z velocity jitter either way
+	float dt;
+	unsigned int emitCount;		// Particles to spawn this frame
+	unsigned int spawnBase;		// Spawn id of the first of them
+	unsigned int randomKey;		// Random::GetKey() of the emitter's stream
+	unsigned int maxParticles;
+};
@@ -0,0 +1,149 @@
+#include "GPUParticleReference.h"
+
+GPUParticleReference::GPUParticleReference(unsigned int maxParticles)
+{
+	this->maxParticles = maxParticles;
+	particles.resize(maxParticles);
+	deadList.reserve(maxParticles);
+	drawList.reserve(maxParticles);
+}
+
+GPUParticleReference::~GPUParticleReference()
+{
+}
+
+void GPUParticleReference::DeadListInit()
+{
+	deadList.clear();
+	drawList.clear();
+
+	for (unsigned int id = 0; id < maxParticles; id++)
+	{
+		DeadListInitThread(id);
+	}
+}
+
+void GPUParticleReference::Update(const GPUParticleParams& params)
+{
+	// The draw list's counter is reset at the start of every frame
+	drawList.clear();
+
+	for (unsigned int id = 0; id < params.maxParticles; id++)
+	{
+		UpdateThread(params, id);
+	}
+}
+
+void GPUParticleReference::Emit(const GPUParticleParams& params)
+{
+	// The GPU reads this from a constant buffer filled by CopyStructureCount
+	unsigned int deadListCount = (unsigned int)deadList.size();
+
+	for (unsigned int id = 0; id < params.emitCount; id++)
+	{
+		EmitThread(params, id, deadListCount);
+	}
+}
+
+void GPUParticleReference::Step(const GPUParticleParams& params)
+{
+	Update(params);
+	Emit(params);
+}
+
+void GPUParticleReference::DeadListInitThread(unsigned int id)
+{
+	if (id >= maxParticles) return;
+
+	GPUParticle p = {};
+	p.age = GPU_DEAD_PARTICLE_AGE;
+	particles[id] = p;
+
+	deadList.push_back(id);
+}
+
+void GPUParticleReference::EmitThread(const GPUParticleParams& params, unsigned int id, unsigned int deadListCount)
+{
+	// Never consume more than the dead list holds
+	if (id >= params.emitCount || id >= deadListCount) return;
+
+	unsigned int index = deadList.back();
+	deadList.pop_back();
+	unsigned int spawnId = params.spawnBase + id;
+
+	GPUParticle p = {};
+	p.position = params.emitterPosition;
+	p.previousPosition = params.emitterPosition;
+	p.age = 0.0f;
+	p.size = params.startSize;
+	p.color = params.startColor;
+	p.spawnId = spawnId;
+
+	// Randomize the x/z velocity, because FIRE
+	float rx = RandomToFloat(RandomAt(params.randomKey, spawnId * 2)) * 2.0f - 1.0f;
+	float rz = RandomToFloat(RandomAt(params.randomKey, spawnId * 2 + 1)) * 2.0f - 1.0f;
+	p.velocity = params.startVelocity;
+	p.velocity.x = rx * params.spread;
+	p.velocity.z = rz * params.spread;
+
+	particles[index] = p;
+	drawList.push_back(index);
+}
+
+void GPUParticleReference::UpdateThread(const GPUParticleParams& params, unsigned int id)
+{
+	if (id >= params.maxParticles) return;
+
+	GPUParticle p = particles[id];
+
+	// Already dead
+	if (p.age >= params.lifetime) return;
+
+	p.age += params.dt;
+
+	if (p.age >= params.lifetime)
+	{
+		p.age = GPU_DEAD_PARTICLE_AGE;
+		particles[id] = p;
+		deadList.push_back(id);
+		return;
+	}
+
+	// Velocity is per frame, like the CPU emitter
+	p.previousPosition = p.position;
+	p.position.x += p.velocity.x;
+	p.position.y += p.velocity.y;
+	p.position.z += p.velocity.z;
+
+	// Same operations, same order as the HLSL (no fused multiply-adds)
+	float t = p.age * params.invLifetime;
+	p.size = params.startSize + (params.endSize - params.startSize) * t;
+	p.color.x = params.startColor.x + (params.endColor.x - params.startColor.x) * t;
+	p.color.y = params.startColor.y + (params.endColor.y - params.startColor.y) * t;
+	p.color.z = params.startColor.z + (params.endColor.z - params.startColor.z) * t;
+	p.color.w = params.startColor.w + (params.endColor.w - params.startColor.w) * t;
+
+	particles[id] = p;
+	drawList.push_back(id);
+}
+
+// Same integer mix as Random::At() and ParticleGPUCommon.hlsli
+unsigned int GPUParticleReference::RandomMix(unsigned int x)
+{
+	x ^= x >> 16;
+	x *= 0x7FEB352Du;
+	x ^= x >> 15;
+	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+	return x;
+}
+
+unsigned int GPUParticleReference::RandomAt(unsigned int key, unsigned int counter)
+{
+	return RandomMix(RandomMix(counter ^ key) + key);
+}
+
+float GPUParticleReference::RandomToFloat(unsigned int bits)
+{
+	return (float)(bits >> 8) * (1.0f / 16777216.0f);
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <vector>
+
+#include "GPUParticle.h"
+
+// --------------------------------------------------------
+// CPU reference of the GPU emitter's compute kernels
+// (ParticleDeadListInitCS, ParticleEmitCS, ParticleUpdateCS).
+//
+// Each kernel is written per thread with the same operations
+// in the same order as the HLSL, so given the same params it
+// produces the same particle bits.  It has no D3D dependency
+// and runs headless, which makes it usable for checking
+// kernel changes against golden outputs on any platform.
+//
+// Append/consume order is not defined on the GPU, so compare
+// particle contents keyed by spawnId and the draw list as a
+// set, not by position.
+// --------------------------------------------------------
+class GPUParticleReference
+{
+public:
+	GPUParticleReference(unsigned int maxParticles);
+	~GPUParticleReference();
+
+	// Run a whole dispatch of each kernel
+	void DeadListInit();
+	void Update(const GPUParticleParams& params);
+	void Emit(const GPUParticleParams& params);
+
+	// Update then emit, the same order the GPU emitter uses each frame
+	void Step(const GPUParticleParams& params);
+
+	const std::vector<GPUParticle>& GetParticles() { return particles; }
+	const std::vector<unsigned int>& GetDrawList() { return drawList; }
+	unsigned int GetDeadCount() { return (unsigned int)deadList.size(); }
+
+private:
+	// Per thread bodies, mirroring each kernel's main()
+	void DeadListInitThread(unsigned int id);
+	void EmitThread(const GPUParticleParams& params, unsigned int id, unsigned int deadListCount);
+	void UpdateThread(const GPUParticleParams& params, unsigned int id);
+
+	static unsigned int RandomMix(unsigned int x);
+	static unsigned int RandomAt(unsigned int key, unsigned int counter);
+	static float RandomToFloat(unsigned int bits);
+
+	unsigned int maxParticles;
+	std::vector<GPUParticle> particles;
+	std::vector<unsigned int> deadList;
+	std::vector<unsigned int> drawList;
+};
@@ -23,6 +23,8 @@ Game::Game(HINSTANCE hInstance)
 	// Initialize fields
 	GameCamera = new Camera(0, 0, -5);
 	GameCamera->UpdateProjectionMatrix((float)width / height);
+	cameraLastPosition = GameCamera->GetPosition();
+	cameraNextPosition = cameraLastPosition;
 
 	GUICamera = new Camera(0, 0, -5);
 	GUICamera->MakeGUI();
@@ -57,6 +59,32 @@ Game::Game(HINSTANCE hInstance)
 	
 }
 
+// --------------------------------------------------------
+// Reads the options WinMain was given.  Unknown words are
+// ignored, so a stray option never stops the gallery.
+// --------------------------------------------------------
+void Game::ParseCommandLine(const char* commandLine)
+{
+	// strtok writes into what it splits, so work on a copy
+	std::vector<char> buffer;
+	if (commandLine) buffer.assign(commandLine, commandLine + strlen(commandLine));
+	buffer.push_back('\0');
+
+	char* context = nullptr;
+	for (char* word = strtok_s(&buffer[0], " \t", &context); word; word = strtok_s(nullptr, " \t", &context))
+	{
+		if (strcmp(word, "-stress") == 0)
+		{
+			char* rooms = strtok_s(nullptr, " \t", &context);
+			if (rooms) stressSceneRooms = (unsigned int)strtoul(rooms, nullptr, 10);
+		}
+		else if (strcmp(word, "-gpuparticles") == 0)
+		{
+			useGPUParticles = true;
+		}
+	}
+}
+
 // --------------------------------------------------------
 // Destructor - Clean up anything our game has created:
 //  - Release all DirectX objects created here
@@ -66,17 +94,31 @@ Game::~Game()
 {
 	delete pixelShader;
 	delete vertexShader;
-
-	// Delete each added resource
-	for (auto& m : meshes) delete m;
-	for (auto& m : materials) delete m;
-	for (auto& m : starMaterials) delete m;
-	for (auto& e : entities) delete e;
-	for (auto& e : exhibits) delete e;
-	for (auto& e : emitters) delete e;
+	delete instancedVS;
+	if (instanceBuffer) instanceBuffer->Release();
+
+	// Delete each added resource (entities before the meshes and
+	// materials they use, emitters before the particle pool)
+	entityPool.Clear();
+	meshPool.Clear();
+	materialPool.Clear();
+	emitterPool.Clear();
+	gpuEmitterPool.Clear();
+	trailEmitterPool.Clear();
+	delete fountain;
 	for (auto& w : worldBounds) delete w;
 	for (auto& e : exhibitBounds) delete e;
-	for (auto& g : GUIElements) delete g;
+
+	// Entities hand their transforms back on delete, so this goes after them
+	delete occlusion;
+	delete portals;
+	delete exhibitGrid;
+	delete opaqueQueue;
+	for (auto& l : opaqueLists) delete l;
+	delete renderBackend;
+	delete culling;
+	delete transforms;
+	delete scene;
 
 	blend->Release();
 	rast->Release();
@@ -102,11 +144,19 @@ Game::~Game()
 
 	blur2SRV->Release();
 	blur2RTV->Release();
+
+	oitAccumulationSRV->Release();
+	oitAccumulationRTV->Release();
+	oitRevealageSRV->Release();
+	oitRevealageRTV->Release();
+	oitBlendState->Release();
+	delete oitCompositePS;
+	delete particleOITPS;
+	delete exhibitOITPS;
 	
 	skySRV->Release();
 	skyRasterizerState->Release();
 	skyDepthState->Release();
-	delete skyMesh;
 
 	delete skyPixelShader;
 	delete skyVertexShader;
@@ -117,7 +167,17 @@ Game::~Game()
 	delete particlePS;
 	delete particleVS;
 	particleBlendState->Release();
+	particleAlphaBlendState->Release();
 	particleDepthState->Release();
+
+	// Emitters hand their blocks back on delete, so the pool goes last
+	delete particlePool;
+
+	delete particleDeadListInitCS;
+	delete particleEmitCS;
+	delete particleUpdateCS;
+	delete particleGPUDrawVS;
+	delete trailVS;
 }
 
 // --------------------------------------------------------
@@ -132,6 +192,9 @@ void Game::Init()
 	vertexShader = new SimpleVertexShader(device, context);
 	vertexShader->LoadShaderFile(L"VertexShader.cso");
 
+	instancedVS = new SimpleVertexShader(device, context);
+	instancedVS->LoadShaderFile(L"InstancedVS.cso");
+
 	sampleDescription = new D3D11_SAMPLER_DESC();
 	sampleDescription->AddressU = D3D11_TEXTURE_ADDRESS_CLAMP;
 	sampleDescription->AddressV = D3D11_TEXTURE_ADDRESS_CLAMP;
@@ -158,6 +221,14 @@ void Game::Init()
 	ppVS = new SimpleVertexShader(device, context);
 	ppVS->LoadShaderFile(L"PostProcessVS.cso");
 
+	// Order-independent transparency shaders
+	oitCompositePS = new SimplePixelShader(device, context);
+	oitCompositePS->LoadShaderFile(L"OITCompositePS.cso");
+	particleOITPS = new SimplePixelShader(device, context);
+	particleOITPS->LoadShaderFile(L"ParticleOITPS.cso");
+	exhibitOITPS = new SimplePixelShader(device, context);
+	exhibitOITPS->LoadShaderFile(L"ExhibitOITPS.cso");
+
 	// Load shadow map shader
 	shadowVS = new SimpleVertexShader(device, context);
 	shadowVS->LoadShaderFile(L"ShadowMapVS.cso");
@@ -168,6 +239,20 @@ void Game::Init()
 	particleVS = new SimpleVertexShader(device, context);
 	particleVS->LoadShaderFile(L"ParticleVS.cso");
 
+	// Load GPU particle shaders
+	particleDeadListInitCS = new SimpleComputeShader(device, context);
+	particleDeadListInitCS->LoadShaderFile(L"ParticleDeadListInitCS.cso");
+	particleEmitCS = new SimpleComputeShader(device, context);
+	particleEmitCS->LoadShaderFile(L"ParticleEmitCS.cso");
+	particleUpdateCS = new SimpleComputeShader(device, context);
+	particleUpdateCS->LoadShaderFile(L"ParticleUpdateCS.cso");
+	particleGPUDrawVS = new SimpleVertexShader(device, context);
+	particleGPUDrawVS->LoadShaderFile(L"ParticleGPUDrawVS.cso");
+
+	// Load trail shader
+	trailVS = new SimpleVertexShader(device, context);
+	trailVS->LoadShaderFile(L"TrailVS.cso");
+
 	// Create post process resources -----------------------------------------
 	D3D11_TEXTURE2D_DESC textureDesc = {};
 	textureDesc.Width = width;
@@ -216,153 +301,103 @@ void Game::Init()
 	ppTexture2->Release();
 	ppTexture3->Release();
 
+	// Create OIT targets -----------------------------------------------------
+	// Accumulation needs range and precision (weights go up to 3000),
+	// revealage is a single product of (1 - alpha)
+	ID3D11Texture2D* oitTexture;
+
+	textureDesc.Format = DXGI_FORMAT_R16G16B16A16_FLOAT;
+	rtvDesc.Format = textureDesc.Format;
+	srvDesc.Format = textureDesc.Format;
+	device->CreateTexture2D(&textureDesc, 0, &oitTexture);
+	device->CreateRenderTargetView(oitTexture, &rtvDesc, &oitAccumulationRTV);
+	device->CreateShaderResourceView(oitTexture, &srvDesc, &oitAccumulationSRV);
+	oitTexture->Release();
+
+	textureDesc.Format = DXGI_FORMAT_R16_FLOAT;
+	rtvDesc.Format = textureDesc.Format;
+	srvDesc.Format = textureDesc.Format;
+	device->CreateTexture2D(&textureDesc, 0, &oitTexture);
+	device->CreateRenderTargetView(oitTexture, &rtvDesc, &oitRevealageRTV);
+	device->CreateShaderResourceView(oitTexture, &srvDesc, &oitRevealageSRV);
+	oitTexture->Release();
+
+	// Accumulation adds everything up, revealage multiplies by (1 - alpha)
+	D3D11_BLEND_DESC oitBlend = {};
+	oitBlend.AlphaToCoverageEnable = false;
+	oitBlend.IndependentBlendEnable = true;
+	oitBlend.RenderTarget[0].BlendEnable = true;
+	oitBlend.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+	oitBlend.RenderTarget[0].SrcBlend = D3D11_BLEND_ONE;
+	oitBlend.RenderTarget[0].DestBlend = D3D11_BLEND_ONE;
+	oitBlend.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	oitBlend.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ONE;
+	oitBlend.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ONE;
+	oitBlend.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
+	oitBlend.RenderTarget[1].BlendEnable = true;
+	oitBlend.RenderTarget[1].BlendOp = D3D11_BLEND_OP_ADD;
+	oitBlend.RenderTarget[1].SrcBlend = D3D11_BLEND_ZERO;
+	oitBlend.RenderTarget[1].DestBlend = D3D11_BLEND_INV_SRC_COLOR;
+	oitBlend.RenderTarget[1].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+	oitBlend.RenderTarget[1].SrcBlendAlpha = D3D11_BLEND_ZERO;
+	oitBlend.RenderTarget[1].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	oitBlend.RenderTarget[1].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_RED;
+	device->CreateBlendState(&oitBlend, &oitBlendState);
 
-	// Helper methods for loading shaders, creating some basic
-	// geometry to draw and some simple camera matrices.
-	//  - You'll be expanding and/or replacing these later
-	LoadMaterials();
-	
 
 	// Game Objects
-	meshes.push_back(new Mesh(device, "../../Assets/Models/sphere.obj"));
-	meshes.push_back(new Mesh(device, "../../Assets/Models/cube_inverted.obj"));
-	meshes.push_back(new Mesh(device, "../../Assets/Models/helix.obj"));
-
-	//GUI Mesh
-	meshes.push_back(new Mesh(device, "../../Assets/Models/plane.obj"));
-
-	// Gallery base
-	meshes.push_back(new Mesh(device, "../../Assets/Models/gallery.obj"));
-
-	// Exhibits
-	meshes.push_back(new Mesh(device, "../../Assets/Models/painting_large.obj"));
-	meshes.push_back(new Mesh(device, "../../Assets/Models/painting_small.obj"));
-	meshes.push_back(new Mesh(device, "../../Assets/Models/wackybigsculpture.obj"));
-	meshes.push_back(new Mesh(device, "../../Assets/Models/bench.obj"));
-	meshes.push_back(new Mesh(device, "../../Assets/Models/painting_small_h.obj"));
-	meshes.push_back(new Mesh(device, "../../Assets/Models/wackysculpture1.obj"));
-	meshes.push_back(new Mesh(device, "../../Assets/Models/wackysculpture2.obj"));
-	meshes.push_back(new Mesh(device, "../../Assets/Models/wackysculpture3.obj"));
-	meshes.push_back(new Mesh(device, "../../Assets/Models/cube.obj"));
-
-	exhibits.push_back(new Entity(meshes[0], materials[5], context)); // tiles
-	exhibits.push_back(new Entity(meshes[0], materials[0], context)); // lava
-	exhibits.push_back(new Entity(meshes[5], materials[7], context)); // big painting
-	exhibits.push_back(new Entity(meshes[7], materials[8], context)); // big sculpture
-
-	exhibits.push_back(new Entity(meshes[9], materials[10], context)); // painting 1
-	exhibits.push_back(new Entity(meshes[9], materials[11], context)); // painting 2
-	exhibits.push_back(new Entity(meshes[5], materials[13], context)); // painting 3
-	exhibits.push_back(new Entity(meshes[10], materials[14], context)); // weird donut
-	exhibits.push_back(new Entity(meshes[11], materials[15], context)); // gold thingy
-
-	exhibits.push_back(new Entity(meshes[13], materials[16], context)); // swatches
-	exhibits.push_back(new Entity(meshes[13], materials[17], context));
-	exhibits.push_back(new Entity(meshes[13], materials[18], context));
-	exhibits.push_back(new Entity(meshes[13], materials[19], context));
-	exhibits.push_back(new Entity(meshes[13], materials[20], context));
-	exhibits.push_back(new Entity(meshes[13], materials[21], context));
-	exhibits.push_back(new Entity(meshes[13], materials[22], context));
-	exhibits.push_back(new Entity(meshes[13], materials[23], context));
-
-	exhibits.push_back(new Entity(meshes[12], materials[24], context));
-
-	exhibits.push_back(new Entity(meshes[9], materials[25], context));
-
-	exhibits[1]->SetPosition(XMFLOAT3(1, 0.75f, 5));
-	exhibits[0]->SetPosition(XMFLOAT3(-8, 0.9f, 5));
-	exhibits[1]->SetScale(XMFLOAT3(2, 2, 2));
-	exhibits[0]->SetScale(XMFLOAT3(2, 2, 2));
-
-	exhibits[2]->SetPosition(XMFLOAT3(-4, 2, 16));
-
-	exhibits[3]->SetScale(XMFLOAT3(2, 2, 2));
-	exhibits[3]->SetPosition(XMFLOAT3(-4, -1, -15));
-
-	exhibits[4]->SetPosition(XMFLOAT3(-10.5f, 1.5f, -6)); // paintings
-	exhibits[5]->SetRotation(XMFLOAT3(0, 3.14f, 0));
-	exhibits[5]->SetPosition(XMFLOAT3(3, 1.5, -6));
-	exhibits[6]->SetPosition(XMFLOAT3(10.5f, 2.5, -18));
-	exhibits[6]->SetRotation(XMFLOAT3(0, 3.14f, 0));
-	exhibits[7]->SetPosition(XMFLOAT3(-18.5f, 1, 2.5f));
-	exhibits[7]->SetRotation(XMFLOAT3(0, 3.14f / 2, 0));
-	exhibits[8]->SetPosition(XMFLOAT3(15, -0.5f, 6));
-	exhibits[8]->SetRotation(XMFLOAT3(0, 0.35f, 0));
-	exhibits[18]->SetPosition(XMFLOAT3(-11.5f, 1, -2));
-	exhibits[18]->SetRotation(XMFLOAT3(0, 3.14f, 0));
-
-	// swatches
-	for (int i = 0; i < 8; i++) {
-		exhibits[9 + i]->SetScale(XMFLOAT3(1, 5, 0.1f));
-		exhibits[9 + i]->SetPosition(XMFLOAT3(16, 0, -8 - i));
-		exhibits[9 + i]->SetRotation(XMFLOAT3(0, 1.8f, 0));
+	transforms = new TransformSystem();
+	culling = new CullingSystem(transforms);
+	portals = new PortalGraph(culling);
+	occlusion = new OcclusionCuller(transforms, culling);
+	exhibitGrid = new SpatialHash(EXHIBIT_RATING_DISTANCE);
+	opaqueQueue = new RenderQueue();
+	renderBackend = new D3D11RenderBackend(context);
+	visibleCount = 0;
+	shadowCasterCount = 0;
+	behindWallsCount = 0;
+	occludedCount = 0;
+	stateChanges = 0;
+	unsortedStateChanges = 0;
+	drawCalls = 0;
+
+	LoadScene("../../Assets/Scenes/gallery.scene");
+	LoadMaterials();
+
+	// Room for every opaque draw to be an instance, the most a frame can have
+	instanceBuffer = 0;
+	if (!opaqueDraws.empty())
+	{
+		D3D11_BUFFER_DESC instanceDesc = {};
+		instanceDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		instanceDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		instanceDesc.Usage = D3D11_USAGE_DYNAMIC;
+		instanceDesc.ByteWidth = sizeof(XMFLOAT4X4) * (UINT)opaqueDraws.size();
+		device->CreateBuffer(&instanceDesc, 0, &instanceBuffer);
 	}
 
-	exhibits[17]->SetPosition(XMFLOAT3(6, 0.5f, -2));
-	exhibits[17]->SetScale(XMFLOAT3(1, 0.5f, 1));
-
-	// Gallery base
-	entities.push_back(new Entity(meshes[4], materials[6], context));
-	entities[0]->SetPosition(XMFLOAT3(0.0f, -0.5f, 0.0f));
-	entities[0]->SetScale(XMFLOAT3(2.5f, 2.5f, 2.5f));
-
-	entities.push_back(new Entity(meshes[8], materials[9], context));
-	entities.push_back(new Entity(meshes[8], materials[9], context));
-	entities.push_back(new Entity(meshes[8], materials[9], context));
-	entities.push_back(new Entity(meshes[8], materials[9], context));
-	entities[1]->SetPosition(XMFLOAT3(-1.5f, -0.65f, 5)); // Benches
-	entities[1]->SetScale(XMFLOAT3(0.5f, 0.5f, 0.5f));
-	entities[2]->SetPosition(XMFLOAT3(-6, -0.65f, 5));
-	entities[2]->SetScale(XMFLOAT3(0.5f, 0.5f, 0.5f));
-	entities[3]->SetPosition(XMFLOAT3(-4, -0.65f, 11));
-	entities[3]->SetScale(XMFLOAT3(0.5f, 0.5f, 0.5f));
-	entities[3]->SetRotation(XMFLOAT3(0, 3.14f / 2, 0));
-	entities[4]->SetPosition(XMFLOAT3(10.5f, -0.65f, -13.5f));
-	entities[4]->SetScale(XMFLOAT3(0.5f, 0.5f, 0.5f));
-	entities[4]->SetRotation(XMFLOAT3(0, 3.14f / 2, 0));
+	// Bounds testing block
+	// entities.push_back(new Entity(meshes[1], materials[3], context, transforms));
+	// entities[1]->SetScale(XMFLOAT3(worldBounds[6]->GetHalfSize().x, 1.0f, worldBounds[6]->GetHalfSize().z));
+	// entities[1]->SetPosition(XMFLOAT3(worldBounds[6]->GetCenter().x, 1.0f, worldBounds[6]->GetCenter().z));
 
 	//UI Elements
+	Mesh* guiMesh = meshPool.Get(meshes[scene->FindMesh("plane")]);
+
 	//Start Holder
-	GUIElements.push_back(new Entity(meshes[3], starMaterials[0], context));
-	GUIElements[0]->SetRotation(XMFLOAT3(-(3.141592654f / 2), 0, 0));
-	GUIElements[0]->SetScale(XMFLOAT3(2.56f, .5f, 0.5f));
+	GUIElements.push_back(entityPool.Create(guiMesh, materialPool.Get(starMaterials[0]), context, transforms));
+	entityPool.Get(GUIElements[0])->SetRotation(XMFLOAT3(-(3.141592654f / 2), 0, 0));
+	entityPool.Get(GUIElements[0])->SetScale(XMFLOAT3(2.56f, .5f, 0.5f));
 
 	//E to rate
-	GUIElements.push_back(new Entity(meshes[3], materials[2], context));
-	GUIElements[1]->SetRotation(XMFLOAT3(-(3.141592654f / 2), 0, 0));
-	GUIElements[1]->SetScale(XMFLOAT3(389.0f / 300, 125.0f / 300, 125.0f / 300));
+	GUIElements.push_back(entityPool.Create(guiMesh, materialPool.Get(materials[scene->FindMaterial("rate")]), context, transforms));
+	entityPool.Get(GUIElements[1])->SetRotation(XMFLOAT3(-(3.141592654f / 2), 0, 0));
+	entityPool.Get(GUIElements[1])->SetScale(XMFLOAT3(389.0f / 300, 125.0f / 300, 125.0f / 300));
 
 	//R to restart
-	GUIElements.push_back(new Entity(meshes[3], materials[4], context));
-	GUIElements[2]->SetRotation(XMFLOAT3(-(3.141592654f / 2), 0, 0));
-	GUIElements[2]->SetScale(XMFLOAT3(449.0f / 400, 93.0f / 400, 93.0f / 400));
-
-
-	// Define the world boundaries
-
-	// Starting Room
-	worldBounds.push_back(new BoundingBox(XMFLOAT3(-10, 0.0f, -18.3875f), XMFLOAT3(2.50f, 0.0f, 15.5f))); // Room
-	worldBounds.push_back(new BoundingBox(XMFLOAT3(-12, 0.0f, 1), XMFLOAT3(-9.5f, 0.0f, 4))); // West Doorway
-	worldBounds.push_back(new BoundingBox(XMFLOAT3(2, 0.0f, 1), XMFLOAT3(5, 0.0f, 4))); // East Doorway
-
-	//// West Room
-	worldBounds.push_back(new BoundingBox(XMFLOAT3(-24, 0.0f, -4.0f), XMFLOAT3(-12, 0.0f, 8))); // Room
-
-	//// East Room
-	worldBounds.push_back(new BoundingBox(XMFLOAT3(5, 0.0f, -3), XMFLOAT3(17, 0.0f, 9)));
-	worldBounds.push_back(new BoundingBox(XMFLOAT3(10, 0.0f, -6), XMFLOAT3(11, 0.0f, -2))); // South door
-
-	//// Southeast Room
-	worldBounds.push_back(new BoundingBox(XMFLOAT3(5, 0.0f, -17), XMFLOAT3(17, 0.0f, -6))); // Room
-
-	// Bounds testing block
-	// entities.push_back(new Entity(meshes[1], materials[3], context));
-	// entities[1]->SetScale(XMFLOAT3(worldBounds[6]->GetHalfSize().x, 1.0f, worldBounds[6]->GetHalfSize().z));
-	// entities[1]->SetPosition(XMFLOAT3(worldBounds[6]->GetCenter().x, 1.0f, worldBounds[6]->GetCenter().z));
-
-	// Define the exhibit bounds
-	// exhibitBounds.push_back(new BoundingBox(XMFLOAT3(-4.0f, 0.0f, -4.0f), XMFLOAT3(-2.0f, 0.0f, -2.0f)));	// Checker Sphere
-	// exhibitBounds.push_back(new BoundingBox(XMFLOAT3(2.0f, 0.0f, -4.0f), XMFLOAT3(4.0f, 0.0f, -2.0f)));		// Lava Sphere
+	GUIElements.push_back(entityPool.Create(guiMesh, materialPool.Get(materials[scene->FindMaterial("restart")]), context, transforms));
+	entityPool.Get(GUIElements[2])->SetRotation(XMFLOAT3(-(3.141592654f / 2), 0, 0));
+	entityPool.Get(GUIElements[2])->SetScale(XMFLOAT3(449.0f / 400, 93.0f / 400, 93.0f / 400));
 
 	// Particle Emitters
 	// A depth state for the particles
@@ -387,23 +422,122 @@ void Game::Init()
 	particleBlend.RenderTarget[0].RenderTargetWriteMask = D3D11_COLOR_WRITE_ENABLE_ALL;
 	device->CreateBlendState(&particleBlend, &particleBlendState);
 
+	// Blend for depth sorted particles (premultiplied alpha, since the PS scales by alpha)
+	particleBlend.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+	particleBlend.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_INV_SRC_ALPHA;
+	device->CreateBlendState(&particleBlend, &particleAlphaBlendState);
+
+	// One fixed particle budget for the whole gallery; when it runs out,
+	// emitters far from the camera give up their oldest particles
+	particlePool = new ParticlePool(device, 16384, PARTICLE_OVERFLOW_STEAL);
+
 	// Create Emitters
-	emitters.push_back(new Emitter(
-		XMFLOAT3(-18.5f, 2.75f, 2.75f),				// Position
-		XMFLOAT3(0.1f, 0.003125f, 0.1f),			// Initial Particle Velocity
-		XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f),		// Initial Particle Color
-		XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f),		// Final Particle Color
-		1.25f,									// Initial Particle Size
-		0.45f,									// Final Particle Size
-		1000,									// Max Number of Particles
-		20.0f,									// Particles per Second
-		2.0f,									// Particle Lifetime
+	const std::vector<SceneEmitter>& sceneEmitters = scene->GetEmitters();
+	for (size_t i = 0; i < sceneEmitters.size(); i++)
+	{
+		const SceneEmitter& e = sceneEmitters[i];
+		Material* material = materialPool.Get(materials[e.material]);
+
+		if (useGPUParticles)
+		{
+			gpuEmitters.push_back(gpuEmitterPool.Create(
+				e.position,
+				e.velocity,
+				e.startColor,
+				e.endColor,
+				e.startSize,
+				e.endSize,
+				e.maxParticles,
+				e.emissionRate,
+				e.lifetime,
+				device,
+				context,
+				particleDeadListInitCS,
+				particleEmitCS,
+				particleUpdateCS,
+				particleGPUDrawVS,
+				material->GetPixelShader(),
+				material->GetTexture()
+				));
+			gpuEmitterPool.Get(gpuEmitters.back())->SetSpread(e.spreadAngles, e.spreadCalmness);
+			continue;
+		}
+
+		emitters.push_back(emitterPool.Create(
+			e.position,
+			e.velocity,
+			e.startColor,
+			e.endColor,
+			e.startSize,
+			e.endSize,
+			e.maxParticles,
+			e.emissionRate,
+			e.lifetime,
+			particlePool,
+			material->GetVertexShader(),
+			material->GetPixelShader(),
+			material->GetTexture()
+			));
+
+		Emitter* emitter = emitterPool.Get(emitters.back());
+		emitter->SetSpread(e.spreadAngles, e.spreadCalmness);
+		if (e.colorKeyCount > 0)
+			emitter->SetColorGradient(scene->GetColorKeys(e.firstColorKey), e.colorKeyCount);
+		if (e.collide)
+			emitter->SetCollision(PARTICLE_COLLISION_BOUNCE, worldBounds, -1.0f);
+	}
+
+	Material* particleMaterial = materialPool.Get(materials[scene->FindMaterial("particle")]);
+
+	// Sparks thrown up out of the fire, streaking as they fall
+	trailEmitters.push_back(trailEmitterPool.Create(
+		XMFLOAT3(-18.5f, 3.25f, 2.75f),				// Position
+		XMFLOAT3(0.0f, 3.0f, 0.0f),				// Initial Trail Velocity (per second)
+		XMFLOAT3(1.5f, 1.0f, 1.5f),				// Velocity Spread
+		XMFLOAT4(1.0f, 0.9f, 0.5f, 1.0f),		// Initial Trail Color
+		XMFLOAT4(0.9f, 0.2f, 0.0f, 0.0f),		// Final Trail Color
+		0.05f,									// Ribbon Width
+		4.0f,									// Gravity
+		64,										// Max Number of Trails
+		16,										// Points per Trail
+		0.02f,									// Seconds between Points
+		24.0f,									// Trails per Second
+		1.5f,									// Trail Lifetime
 		device,
-		materials[12]->GetVertexShader(),
-		materials[12]->GetPixelShader(),
-		materials[12]->GetTexture()
+		trailVS,
+		particleMaterial->GetPixelShader(),
+		particleMaterial->GetTexture()
 		));
 
+	// Give every emitter its own reproducible stream
+	for (int i = 0; i < emitters.size(); i++)
+	{
+		emitterPool.Get(emitters[i])->Seed(i + 1);
+	}
+	for (int i = 0; i < gpuEmitters.size(); i++)
+	{
+		gpuEmitterPool.Get(gpuEmitters[i])->Seed(emitters.size() + i + 1);
+	}
+	for (int i = 0; i < trailEmitters.size(); i++)
+	{
+		trailEmitterPool.Get(trailEmitters[i])->Seed(emitters.size() + gpuEmitters.size() + i + 1);
+	}
+
+	// Water for the fountain exhibit, in the basin's space (generated scenes have none)
+	unsigned int fountainEntity = scene->FindEntity("fountain");
+	fountain = fountainEntity == SCENE_NONE ? nullptr : new Fountain(
+		transforms->GetWorldPosition(sceneTransforms[fountainEntity]),	// Position
+		4096,									// Number of Particles
+		FluidSettings(),
+		0.06f,									// Particle Size
+		XMFLOAT4(0.1f, 0.35f, 0.8f, 0.5f),		// Water Color
+		XMFLOAT4(0.8f, 0.9f, 1.0f, 0.5f),		// Foam Color
+		device,
+		particleVS,
+		particlePS,
+		particleMaterial->GetTexture()
+		);
+
 	light.AmbientColor = XMFLOAT4(0.3f, 0.3f, 0.3f, 1.0f);
 	light.DiffuseColor = XMFLOAT4(1, 1, 1, 1);
 	light.Direction = XMFLOAT3(1, -1, 0);
@@ -466,7 +600,7 @@ void Game::Init()
 	skyPixelShader = new SimplePixelShader(device, context);
 	skyPixelShader->LoadShaderFile(L"SkyBoxPS.cso");
 
-	skyMesh = new Mesh(device, "../../Assets/Models/cube.obj");
+	skyMesh = meshPool.Create(device, "../../Assets/Models/cube.obj");
 	
 	// Tell the input assembler stage of the pipeline what kind of
 	// geometric primitives (points, lines or triangles) we want to draw.  
@@ -539,166 +673,186 @@ void Game::SetUpShadowMap()
 }
 
 // --------------------------------------------------------
-// Loads shaders from compiled shader object (.cso) files using
-// my SimpleShader wrapper for DirectX shader manipulation.
-// - SimpleShader provides helpful methods for sending
-//   data to individual variables on the GPU
+// Builds the gallery from a scene file (text or binary, see
+// Scene.h): meshes, materials, exhibits, static entities and
+// the world bounds.  Meshes and materials are created in the
+// scene's order, so its indices can be used on them directly.
 // --------------------------------------------------------
-void Game::LoadMaterials() {
-	//IT IS NECESSARY FOR ALL MATERIALS TO CALL THE SetSpecularMap(); METHOD
-	//IF NO SPECULAR MAP EXISTS FOR A MATERIAL, SET IT USING THE NO_SPEC.png FILE WITHIN THE TEXTURES FOLDER
-
-	// Lava Texture
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[0]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/Lava_005_COLOR.jpg");
-	materials[0]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[0]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/Lava_005_NORM.jpg");
-
-	// Panel Texture
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[1]->SetTexture(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[1]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[1]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/panel_normal.png");
-
-	//Rate Texture
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[2]->SetTexture(device, context, L"../../Assets/Textures/UI/rate.png");
-	materials[2]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[2]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	//White material
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[3]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/white.png");
-	materials[3]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[3]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	//Restart Texture
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[4]->SetTexture(device, context, L"../../Assets/Textures/UI/restart.png");
-	materials[4]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[4]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-	
-	//Tiles Texture
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[5]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/tiles_diffuse.png");
-	materials[5]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/tiles_spec.png");
-	materials[5]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/tiles_normal.png");
-
-	//Gallery Texture
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[6]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/galleryTexture.png");
-	materials[6]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[6]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[7]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/painting_0.png");
-	materials[7]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[7]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/painting_0_normal.png");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[8]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/marble.png");
-	materials[8]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/marbleSpecular.png");
-	materials[8]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/marbleNormal.png");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[9]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/bench.png");
-	materials[9]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[9]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[10]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/painting_1.png");
-	materials[10]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[10]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[11]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/painting_2.png");
-	materials[11]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[11]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	// Particle Texture
-	materials.push_back(new Material(particleVS, particlePS));
-	materials[12]->SetTexture(device, context, L"../../Assets/Textures/Particles/fireParticle.jpg");
-	materials[12]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/NO_SPEC.png");
-	materials[12]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[13]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/painting_3.png");
-	materials[13]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/painting_3_specular.png");
-	materials[13]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[14]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/volcanic.png");
-	materials[14]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[14]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/volcanic_normal.png");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[15]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/gold.png");
-	materials[15]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/gold_specular.png");
-	materials[15]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[16]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/red.png");
-	materials[16]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/gold_specular.png");
-	materials[16]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[17]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/orange.png");
-	materials[17]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/gold_specular.png");
-	materials[17]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[18]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/yellow.png");
-	materials[18]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/gold_specular.png");
-	materials[18]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[19]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/green.png");
-	materials[19]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/gold_specular.png");
-	materials[19]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[20]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/blue.png");
-	materials[20]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/gold_specular.png");
-	materials[20]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[21]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/bluer.png");
-	materials[21]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/gold_specular.png");
-	materials[21]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[22]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/indigo.png");
-	materials[22]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/gold_specular.png");
-	materials[22]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[23]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/violet.png");
-	materials[23]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/gold_specular.png");
-	materials[23]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[24]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/cheese.png");
-	materials[24]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/gold_specular.png");
-	materials[24]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/cheese_normal.png");
-
-	materials.push_back(new Material(vertexShader, pixelShader));
-	materials[25]->SetTexture(device, context, L"../../Assets/Textures/Diffuse/painting_4.png");
-	materials[25]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/ALL_SPEC.png");
-	materials[25]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
+void Game::LoadScene(const char* path)
+{
+	scene = new Scene();
+	if (!scene->Load(path))
+	{
+		// Nothing to show without a gallery
+		MessageBoxA(hWnd, scene->GetError().c_str(), path, MB_OK | MB_ICONERROR);
+		exit(-1);
+	}
+
+	// Keeps the gallery's meshes and materials, lays out new rooms with them
+	if (stressSceneRooms > 0)
+	{
+		SceneGeneratorSettings settings;
+		settings.roomCount = stressSceneRooms;
+
+		SceneGenerator generator(settings);
+		if (!generator.Generate(scene))
+		{
+			MessageBoxA(hWnd, generator.GetError().c_str(), path, MB_OK | MB_ICONERROR);
+			exit(-1);
+		}
+	}
+
+	const std::vector<SceneMesh>& sceneMeshes = scene->GetMeshes();
+	meshes.reserve(sceneMeshes.size());
+	for (size_t i = 0; i < sceneMeshes.size(); i++)
+	{
+		std::string file = scene->GetString(sceneMeshes[i].path);
+		meshes.push_back(meshPool.Create(device, &file[0]));
+	}
 
+	const std::vector<SceneMaterial>& sceneMaterials = scene->GetMaterials();
+	materials.reserve(sceneMaterials.size());
+	for (size_t i = 0; i < sceneMaterials.size(); i++)
+	{
+		const SceneMaterial& m = sceneMaterials[i];
+		unsigned int handle = m.shader == SCENE_SHADER_PARTICLE ?
+			materialPool.Create(particleVS, particlePS) :
+			materialPool.Create(vertexShader, pixelShader);
+		Material* material = materialPool.Get(handle);
+
+		// Paths are plain ASCII, so widening is a straight copy
+		std::string texture = scene->GetString(m.texture);
+		std::string specularMap = scene->GetString(m.specularMap);
+		std::string normalMap = scene->GetString(m.normalMap);
+		std::wstring w_texture(texture.begin(), texture.end());
+		std::wstring w_specularMap(specularMap.begin(), specularMap.end());
+		std::wstring w_normalMap(normalMap.begin(), normalMap.end());
+
+		//IT IS NECESSARY FOR ALL MATERIALS TO CALL THE SetSpecularMap(); METHOD
+		material->SetTexture(device, context, &w_texture[0]);
+		material->SetSpecularMap(device, context, &w_specularMap[0]);
+		material->SetNormalMap(device, context, &w_normalMap[0]);
+		material->SetTranslucent(m.translucent != 0);
+
+		// Translucent surfaces only ever draw into the OIT targets
+		if (m.translucent && m.shader != SCENE_SHADER_PARTICLE) material->SetPixelShader(exhibitOITPS);
+		materials.push_back(handle);
+	}
 
+	// Parents always come earlier in the file, so their transforms exist
+	const std::vector<SceneEntity>& sceneEntities = scene->GetEntities();
+	sceneTransforms.resize(sceneEntities.size());
+	std::vector<unsigned char> animated(sceneEntities.size(), 0);
+	for (size_t i = 0; i < sceneEntities.size(); i++)
+	{
+		const SceneEntity& e = sceneEntities[i];
+		unsigned int parent = e.parent == SCENE_NONE ? TRANSFORM_NO_PARENT : sceneTransforms[e.parent];
+
+		// Moves if it animates, or anything it hangs from does
+		animated[i] = e.spin != 0 || e.jitter != 0 || (e.parent != SCENE_NONE && animated[e.parent]);
+
+		if (e.group == SCENE_GROUP_NODE)
+		{
+			unsigned int node = transforms->Create();
+			transforms->SetParent(node, parent);
+			transforms->SetPosition(node, e.position);
+			transforms->SetRotation(node, e.rotation);
+			transforms->SetScale(node, e.scale);
+			sceneTransforms[i] = node;
+			continue;
+		}
+
+		Mesh* mesh = meshPool.Get(meshes[e.mesh]);
+		unsigned int handle = entityPool.Create(mesh, materialPool.Get(materials[e.material]), context, transforms);
+		Entity* entity = entityPool.Get(handle);
+		if (parent != TRANSFORM_NO_PARENT) entity->SetParent(parent);
+		entity->SetPosition(e.position);
+		entity->SetRotation(e.rotation);
+		entity->SetScale(e.scale);
+		sceneTransforms[i] = entity->GetTransform();
+		culling->SetLocalBounds(entity->GetTransform(), mesh->GetBoundsMin(), mesh->GetBoundsMax(), mesh->GetBoundingRadius());
+
+		// Walls, shells and big paintings hide what's behind them
+		float scale = fmaxf(fabsf(e.scale.x), fmaxf(fabsf(e.scale.y), fabsf(e.scale.z)));
+		const SceneMaterial& sceneMaterial = scene->GetMaterials()[e.material];
+		if (!sceneMaterial.translucent && sceneMaterial.shader != SCENE_SHADER_PARTICLE &&
+			mesh->GetBoundingRadius() * scale >= OCCLUDER_MIN_RADIUS &&
+			mesh->GetTriangleCount() <= OCCLUDER_MAX_TRIANGLES)
+		{
+			occlusion->AddOccluder(entity->GetTransform(), mesh->GetTrianglePositions(), mesh->GetTriangleCount());
+		}
+
+		if (e.group == SCENE_GROUP_EXHIBIT)
+		{
+			if (animated[i]) movingExhibits.push_back((unsigned int)exhibits.size());
+			exhibits.push_back(handle);
+		}
+		else entities.push_back(handle);
+
+		// Anything translucent, exhibit or not, is left for the OIT pass
+		if (sceneMaterial.translucent) translucentEntities.push_back(handle);
+		else
+		{
+			OpaqueDraw draw = { handle,
+				e.group == SCENE_GROUP_EXHIBIT ? (unsigned int)OPAQUE_PASS_UNSHADOWED : (unsigned int)OPAQUE_PASS_SHADOWED,
+				sceneMaterial.shader, e.material, e.mesh };
+			opaqueDraws.push_back(draw);
+		}
+
+		if (e.spin != 0 || e.jitter != 0)
+		{
+			SceneAnimation animation = { handle, e.position, e.rotation, e.spin, e.jitter,
+				e.position, e.rotation, e.position, e.rotation };
+			animations.push_back(animation);
+		}
+	}
+
+	const std::vector<SceneBounds>& sceneBounds = scene->GetBounds();
+	for (size_t i = 0; i < sceneBounds.size(); i++)
+	{
+		const SceneBounds& b = sceneBounds[i];
+		BoundingBox* box = new BoundingBox(b.min, b.max);
+		if (b.type == SCENE_BOUNDS_EXHIBIT)
+		{
+			exhibitBounds.push_back(box);
+			continue;
+		}
+
+		// Doorways are walkable too
+		worldBounds.push_back(box);
+		if (b.type == SCENE_BOUNDS_DOORWAY) portals->AddDoorway(b.min, b.max);
+		else portals->AddRoom(b.min, b.max);
+	}
+
+	// Entities are filed under rooms by their world bounds, and
+	// exhibits into the grid by their world positions
+	transforms->UpdateWorldMatrices();
+	culling->UpdateWorldBounds();
+	portals->Build();
+	for (unsigned int i = 0; i < exhibits.size(); i++)
+	{
+		exhibitGrid->Insert(i, entityPool.Get(exhibits[i])->GetWorldPosition());
+	}
+}
+
+// --------------------------------------------------------
+// Creates the materials that aren't part of the scene (the
+// UI's star trays).
+// --------------------------------------------------------
+void Game::LoadMaterials() {
 	//loop through all the ui star materials
 	for (int i = 0; i < 6; i++) {
-		starMaterials.push_back(new Material(vertexShader, pixelShader));
+		starMaterials.push_back(materialPool.Create(vertexShader, pixelShader));
+		Material* starMaterial = materialPool.Get(starMaterials[i]);
 
 		//concatenate a wstring then reference its first index to get a wchar_t* object
 		std::wstring w_file = L"../../Assets/Textures/UI/ui_starTray_";
 		w_file += std::to_wstring(i);
 		w_file += L".png";
 
-		starMaterials[i]->SetTexture(device, context, &w_file[0]);
-		starMaterials[i]->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/NO_SPEC.png");
-		starMaterials[i]->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
+		starMaterial->SetTexture(device, context, &w_file[0]);
+		starMaterial->SetSpecularMap(device, context, L"../../Assets/Textures/Specular/NO_SPEC.png");
+		starMaterial->SetNormalMap(device, context, L"../../Assets/Textures/Normal/NO_NORMAL.jpg");
 	}
 	
 }
@@ -739,17 +893,30 @@ void Game::Update(float deltaTime, float totalTime)
 
 	//if(prevMousePos.y > (float))
 
-	//rotate the helix that exists in entities
-	exhibits[0]->SetRotation(XMFLOAT3(0, totalTime * 0.5f, 0));
-	exhibits[1]->SetRotation(XMFLOAT3(0, totalTime * 0.5f, 0));
-
-	exhibits[8]->SetPosition(XMFLOAT3(15 + (rand() % 10 * 0.0015f), -0.5f + (rand() % 10 * 0.0015f), 6 + (rand() % 10 * 0.0015f)));
+	// Spin and shake whatever the scene asks for.  Only the poses are
+	// worked out here; frames put the entities in between (InterpolateTicks).
+	for (size_t i = 0; i < animations.size(); i++)
+	{
+		SceneAnimation& a = animations[i];
+		a.lastPosition = a.nextPosition;
+		a.lastRotation = a.nextRotation;
+		if (a.spin != 0)
+			a.nextRotation = XMFLOAT3(a.rotation.x, a.rotation.y + totalTime * a.spin, a.rotation.z);
+		if (a.jitter != 0)
+		{
+			float x = a.position.x + random.NextInt(0, 9) * a.jitter;
+			float y = a.position.y + random.NextInt(0, 9) * a.jitter;
+			float z = a.position.z + random.NextInt(0, 9) * a.jitter;
+			a.nextPosition = XMFLOAT3(x, y, z);
+		}
+	}
 
-	GUIElements[0]->SetPosition(XMFLOAT3((float)width / (2 * 100), 0.73f, 2));
-	GUIElements[1]->SetPosition(XMFLOAT3((float)width / (2 * 100), (float)height / (2 * 100), 2));
-	GUIElements[2]->SetPosition(XMFLOAT3(1.5f, 0.5f, 2));
+	entityPool.Get(GUIElements[0])->SetPosition(XMFLOAT3((float)width / (2 * 100), 0.73f, 2));
+	entityPool.Get(GUIElements[1])->SetPosition(XMFLOAT3((float)width / (2 * 100), (float)height / (2 * 100), 2));
+	entityPool.Get(GUIElements[2])->SetPosition(XMFLOAT3(1.5f, 0.5f, 2));
 
-	// Movement
+	// Movement, from where the last tick left the camera (not where the last frame drew it)
+	GameCamera->SetPosition(cameraNextPosition);
 	XMFLOAT3 prevPosition = GameCamera->GetPosition();	// Position before the move
 	GameCamera->Update(deltaTime);
 
@@ -805,18 +972,49 @@ void Game::Update(float deltaTime, float totalTime)
 	XMStoreFloat3(&newestPosition, DirectX::XMVectorLerp(XMLoadFloat3(&prevPosition), XMLoadFloat3(&GameCamera->GetPosition()), .5f));
 
 	GameCamera->SetPosition(newestPosition);
-	
+
 	DoExhibits();
 
 	DoEmitters(deltaTime);
 
 	if (GetAsyncKeyState('R') & 0x8000) {
 		for (int i = 0; i < exhibits.size(); i++) {
-			exhibits[i]->SetRating(-1);
+			entityPool.Get(exhibits[i])->SetRating(-1);
 		}
 		GameCamera->SetPosition(XMFLOAT3(0, 0, -5));
 		GameCamera->SetRotation(GameCamera->GetInitRotation());
+
+		// A jump, not a move; don't draw the trip there
+		cameraNextPosition = GameCamera->GetPosition();
 	}
+
+	cameraLastPosition = cameraNextPosition;
+	cameraNextPosition = GameCamera->GetPosition();
+}
+
+void Game::InterpolateTicks(float alpha)
+{
+	for (size_t i = 0; i < animations.size(); i++)
+	{
+		SceneAnimation& a = animations[i];
+		Entity* entity = entityPool.Get(a.entity);
+		XMFLOAT3 blended;
+		if (a.spin != 0)
+		{
+			XMStoreFloat3(&blended, XMVectorLerp(XMLoadFloat3(&a.lastRotation), XMLoadFloat3(&a.nextRotation), alpha));
+			entity->SetRotation(blended);
+		}
+		if (a.jitter != 0)
+		{
+			XMStoreFloat3(&blended, XMVectorLerp(XMLoadFloat3(&a.lastPosition), XMLoadFloat3(&a.nextPosition), alpha));
+			entity->SetPosition(blended);
+		}
+	}
+
+	XMFLOAT3 camera;
+	XMStoreFloat3(&camera, XMVectorLerp(XMLoadFloat3(&cameraLastPosition), XMLoadFloat3(&cameraNextPosition), alpha));
+	GameCamera->SetPosition(camera);
+	GameCamera->UpdateViewMatrix();
 }
 
 //calculate stars for game rating system
@@ -824,12 +1022,12 @@ void Game::DoStars()
 {
 	if (!isRating) return;
 	starRating = -1;
-	if (exhibits[currentExhibit]->GetRating() != -1) {
+	if (entityPool.Get(exhibits[currentExhibit])->GetRating() != -1) {
 		return;
 	}
 	//if mouse too high then get out of there.
 	if (prevMousePos.y < (float)height * (2.0f / 3)) {
-		GUIElements[0]->SetMaterial(starMaterials[0]);
+		entityPool.Get(GUIElements[0])->SetMaterial(materialPool.Get(starMaterials[0]));
 		return;
 	}
 	
@@ -838,52 +1036,69 @@ void Game::DoStars()
 	int increment = 512 / 5;
 
 	if (prevMousePos.x < left_start) {
-		GUIElements[0]->SetMaterial(starMaterials[0]);
+		entityPool.Get(GUIElements[0])->SetMaterial(materialPool.Get(starMaterials[0]));
 	}else if (prevMousePos.x >= right_end - 3) {
-		GUIElements[0]->SetMaterial(starMaterials[5]);
+		entityPool.Get(GUIElements[0])->SetMaterial(materialPool.Get(starMaterials[5]));
 	}else {
 		starRating = (int)((prevMousePos.x - left_start) / increment) + 1;
-		GUIElements[0]->SetMaterial(starMaterials[starRating]);
+		entityPool.Get(GUIElements[0])->SetMaterial(materialPool.Get(starMaterials[starRating]));
 	}
 }
 
 void Game::DoExhibits()
 {
 	canRate = false;
-	bool isNear = false;
-
-	//cycle through exhibits and see if we're close to one
-	for (int i = 0; i < exhibits.size(); i++) {
-		float distance = sqrt(
-			pow((GameCamera->GetPosition().x - exhibits[i]->GetPosition().x), 2)
-			+ pow((GameCamera->GetPosition().z - exhibits[i]->GetPosition().z), 2));
-		if (distance < 2.5f) {
-			canRate = true;
-			isNear = true;
-			currentExhibit = i;
-			if (!isRating) {
-				int myRating = exhibits[i]->GetRating();
-				if (myRating == -1) myRating = 0;
-				GUIElements[0]->SetMaterial(starMaterials[myRating]);
-			}
-			DoStars();
+
+	// Only exhibits in the grid cells around the camera are checked; if
+	// two are close enough, the nearer one gets rated
+	unsigned int nearest = exhibitGrid->FindNearest(GameCamera->GetPosition(), EXHIBIT_RATING_DISTANCE);
+	if (nearest != SPATIAL_HASH_NONE) {
+		canRate = true;
+		currentExhibit = nearest;
+		if (!isRating) {
+			int myRating = entityPool.Get(exhibits[nearest])->GetRating();
+			if (myRating == -1) myRating = 0;
+			entityPool.Get(GUIElements[0])->SetMaterial(materialPool.Get(starMaterials[myRating]));
 		}
+		DoStars();
 	}
 	//if not near any exhibits we cannot rate by default
-	if (!isNear) isRating = false;
+	if (!canRate) isRating = false;
 	
 	if (GetAsyncKeyState('E') & 0x8000 && canRate) {
 		isRating = true;
-		exhibits[currentExhibit]->SetRating(-1);
+		entityPool.Get(exhibits[currentExhibit])->SetRating(-1);
 	}
 }
 
 void Game::DoEmitters(float deltaTime)
 {
+	particlePool->SetViewPosition(GameCamera->GetPosition());
+
+	// Emitters out of view (or in rooms that couldn't be seen into last
+	// frame) sleep, and far ones tick less often
+	XMFLOAT4 frustumPlanes[6];
+	GameCamera->GetFrustumPlanes(frustumPlanes);
+
 	for (int i = 0; i < emitters.size(); i++)
 	{
-		emitters[i]->Update(deltaTime);
+		Emitter* emitter = emitterPool.Get(emitters[i]);
+		bool hidden = !portals->IsBoxVisible(emitter->GetBoundsCenter(), emitter->GetBoundsHalfSize());
+		emitter->UpdateLOD(frustumPlanes, GameCamera->GetPosition(), hidden);
+		emitter->Update(deltaTime);
 	}
+
+	for (int i = 0; i < gpuEmitters.size(); i++)
+	{
+		gpuEmitterPool.Get(gpuEmitters[i])->Update(deltaTime);
+	}
+
+	for (int i = 0; i < trailEmitters.size(); i++)
+	{
+		trailEmitterPool.Get(trailEmitters[i])->Update(deltaTime);
+	}
+
+	if (fountain) fountain->Update(deltaTime);
 }
 
 // --------------------------------------------------------
@@ -891,6 +1106,42 @@ void Game::DoEmitters(float deltaTime)
 // --------------------------------------------------------
 void Game::Draw(float deltaTime, float totalTime)
 {
+	// Ticks don't line up with frames, so draw from between the last two
+	InterpolateTicks(timestep.GetAlpha());
+
+	// Which rooms can be seen into from where the camera is drawn (the
+	// emitters' next ticks go by this too)
+	portals->FindVisibleRooms(GameCamera->GetPosition(), GameCamera->GetView(), GameCamera->GetProjection());
+
+	// Everything that moved this frame gets its world matrix rebuilt at once
+	transforms->UpdateWorldMatrices();
+
+	// Exhibits that moved are refiled in the grid (usually in the same cell)
+	for (size_t i = 0; i < movingExhibits.size(); i++)
+	{
+		Entity* exhibit = entityPool.Get(exhibits[movingExhibits[i]]);
+		if (transforms->WorldChanged(exhibit->GetTransform()))
+			exhibitGrid->Move(movingExhibits[i], exhibit->GetWorldPosition());
+	}
+
+	// Then only what's in view (of the camera, and of the shadow map) is drawn
+	XMFLOAT4 frustumPlanes[6];
+	culling->UpdateWorldBounds();
+	portals->UpdateMembers();
+	GameCamera->GetFrustumPlanes(frustumPlanes);
+	visibleCount = culling->Cull(frustumPlanes, cameraVisible);
+
+	// and of that, only what's in rooms seen through the doorways
+	behindWallsCount = portals->Cull(cameraVisible);
+	visibleCount -= behindWallsCount;
+
+	// and what the occluders in view don't hide
+	occlusion->Render(GameCamera->GetView(), GameCamera->GetProjection(), cameraVisible);
+	occludedCount = occlusion->Cull(cameraVisible);
+	visibleCount -= occludedCount;
+	Camera::GetFrustumPlanes(shadowViewMatrix, shadowProjectionMatrix, frustumPlanes);
+	shadowCasterCount = culling->Cull(frustumPlanes, shadowVisible);
+
 	DrawShadowMap();
 
 	// Background color (Black in this case) for clearing
@@ -910,30 +1161,8 @@ void Game::Draw(float deltaTime, float totalTime)
 	UINT stride = sizeof(Vertex);
 	UINT offset = 0;
 
-	
-	// Set buffers in the input assembler
-	//  - Do this ONCE PER OBJECT you're drawing, since each object might
-	//    have different geometry.
-
-	for (int i = 0; i < entities.size(); i++) {
-		entities[i]->GetMaterial()->GetPixelShader()->SetInt("ReceiveShadows", 1);
-		entities[i]->GetMaterial()->GetPixelShader()->SetData("light", &light, sizeof(DirectionalLight));
-		entities[i]->GetMaterial()->GetPixelShader()->SetFloat3("cameraPosition", GameCamera->GetPosition());
-		entities[i]->GetMaterial()->GetVertexShader()->SetMatrix4x4("lightView", shadowViewMatrix);
-		entities[i]->GetMaterial()->GetVertexShader()->SetMatrix4x4("lightProj", shadowProjectionMatrix);
-		entities[i]->GetMaterial()->GetPixelShader()->SetShaderResourceView("ShadowMap", shadowSRV);
-		entities[i]->GetMaterial()->GetPixelShader()->SetSamplerState("ShadowSampler", shadowSampler);
-
-		entities[i]->Render(GameCamera->GetView(), GameCamera->GetProjection());
-	}
+	DrawOpaque();
 
-	for (int i = 0; i < exhibits.size(); i++) {
-		exhibits[i]->GetMaterial()->GetPixelShader()->SetInt("ReceiveShadows", 0);
-		exhibits[i]->GetMaterial()->GetPixelShader()->SetData("light", &light, sizeof(DirectionalLight));
-		exhibits[i]->GetMaterial()->GetPixelShader()->SetFloat3("cameraPosition", GameCamera->GetPosition());
-		exhibits[i]->Render(GameCamera->GetView(), GameCamera->GetProjection());
-	}
-	
 	//----------------------------------------------------------------------------------
 //----------------------------------------------------------------------------------
 	//SKYYYYYYYYBOXXXXXX
@@ -941,8 +1170,9 @@ void Game::Draw(float deltaTime, float totalTime)
 	context->OMSetDepthStencilState(skyDepthState, 0);
 
 	// After drawing all of our regular (solid) objects, draw the sky!
-	ID3D11Buffer* skyVB = skyMesh->GetVertexBuffer();
-	ID3D11Buffer* skyIB = skyMesh->GetIndexBuffer();
+	Mesh* sky = meshPool.Get(skyMesh);
+	ID3D11Buffer* skyVB = sky->GetVertexBuffer();
+	ID3D11Buffer* skyIB = sky->GetIndexBuffer();
 
 	// Set the buffers
 	context->IASetVertexBuffers(0, 1, &skyVB, &stride, &offset);
@@ -962,7 +1192,7 @@ void Game::Draw(float deltaTime, float totalTime)
 	skyPixelShader->SetShader();
 
 	// Finally do the actual drawing
-	context->DrawIndexed(skyMesh->GetIndexCount(), 0, 0);
+	context->DrawIndexed(sky->GetIndexCount(), 0, 0);
 
 	//Reset changed states
 	context->RSSetState(0);
@@ -975,14 +1205,52 @@ void Game::Draw(float deltaTime, float totalTime)
 	context->OMSetBlendState(particleBlendState, particleBlend, 0xffffffff);  // Additive blending
 	context->OMSetDepthStencilState(particleDepthState, 0);			// No depth WRITING
 
+	// Every emitter shares the pool's vertex buffer, so fill it once up front
 	for (int i = 0; i < emitters.size(); i++)
 	{
-		emitters[i]->Draw(context, GameCamera);
+		Emitter* emitter = emitterPool.Get(emitters[i]);
+		if (emitter->IsVisible())
+			emitter->CopyParticlesToPool(GameCamera, timestep.GetAlpha());
+	}
+	particlePool->CopyToGPU(context);
+
+	for (int i = 0; i < emitters.size(); i++)
+	{
+		Emitter* emitter = emitterPool.Get(emitters[i]);
+		if (emitter->IsVisible() && !emitter->IsDepthSorted() && !emitter->IsOrderIndependent())
+			emitter->Draw(context, GameCamera);
+	}
+
+	for (int i = 0; i < gpuEmitters.size(); i++)
+	{
+		gpuEmitterPool.Get(gpuEmitters[i])->Draw(context, GameCamera, timestep.GetAlpha());
+	}
+
+	// Ribbons are rebuilt every frame, so only for the emitters in view
+	GameCamera->GetFrustumPlanes(frustumPlanes);
+	for (int i = 0; i < trailEmitters.size(); i++)
+	{
+		TrailEmitter* trails = trailEmitterPool.Get(trailEmitters[i]);
+		if (trails->InFrustum(frustumPlanes) && portals->IsBoxVisible(trails->GetBoundsCenter(), trails->GetBoundsHalfSize()))
+			trails->Draw(context, GameCamera, timestep.GetAlpha());
+	}
+
+	if (fountain) fountain->Draw(context, GameCamera, timestep.GetAlpha());
+
+	// Sorted emitters blend over what's behind them, so they go last
+	context->OMSetBlendState(particleAlphaBlendState, particleBlend, 0xffffffff);
+	for (int i = 0; i < emitters.size(); i++)
+	{
+		Emitter* emitter = emitterPool.Get(emitters[i]);
+		if (emitter->IsVisible() && emitter->IsDepthSorted())
+			emitter->Draw(context, GameCamera);
 	}
 
 	// Reset to default states
 	context->OMSetBlendState(blend, particleBlend, 0xFFFFFFFF);
 
+	DrawOIT();
+
 	DrawBloom();
 
 	DrawUI();
@@ -1037,7 +1305,8 @@ void Game::DrawShadowMap()
 	for (unsigned int i = 0; i < exhibits.size(); i++)
 	{
 		// Grab the data from the first entity's mesh
-		Entity* ge = exhibits[i];
+		Entity* ge = entityPool.Get(exhibits[i]);
+		if (!shadowVisible[ge->GetTransform()]) continue;
 		ID3D11Buffer* vb = ge->GetMesh()->GetVertexBuffer();
 		ID3D11Buffer* ib = ge->GetMesh()->GetIndexBuffer();
 
@@ -1062,6 +1331,310 @@ void Game::DrawShadowMap()
 	context->RSSetState(0); // Default rasterizer options
 }
 
+// --------------------------------------------------------
+// Draws every opaque entity and exhibit in view through the
+// render queue.  Sorted by pass, shader, material and mesh,
+// each draw only binds what differs from the one before it
+// (the rest is left bound), and runs of draws that share
+// all of it are drawn instanced, as one call.  Big queues
+// are recorded on several threads, then played back here.
+// --------------------------------------------------------
+void Game::DrawOpaque()
+{
+	XMFLOAT4X4 view = GameCamera->GetView();
+
+	// The view matrix is stored transposed, so its third row gives view space z
+	opaqueQueue->Clear();
+	opaqueEntities.resize(opaqueDraws.size());
+	for (unsigned int i = 0; i < opaqueDraws.size(); i++)
+	{
+		const OpaqueDraw& draw = opaqueDraws[i];
+		Entity* entity = entityPool.Get(draw.entity);
+		if (!entity) continue;		// Destroyed since load
+		opaqueEntities[i] = entity;
+
+		unsigned int transform = entity->GetTransform();
+		if (!cameraVisible[transform]) continue;
+
+		XMFLOAT3 center = culling->GetWorldCenter(transform);
+		float depth = view._31 * center.x + view._32 * center.y + view._33 * center.z + view._34;
+		opaqueQueue->Add(draw.pass, draw.shader, draw.material, draw.mesh, depth / OPAQUE_DEPTH_RANGE, i);
+	}
+	opaqueQueue->Sort();
+
+	unsigned int count = opaqueQueue->GetCount();
+	queuedOpaques.resize(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned int item = opaqueQueue->GetItem(i);
+		Entity* entity = opaqueEntities[item];
+		QueuedOpaque& queued = queuedOpaques[i];
+		queued.entity = entity;
+		queued.material = entity->GetMaterial();
+		queued.mesh = entity->GetMesh();
+		queued.pass = opaqueDraws[item].pass;
+		queued.instanceable = queued.material->GetVertexShader() == vertexShader;
+	}
+
+	// Each worker records a slice of the queue into its own list; slices
+	// start at the start of a run, so no run is split between two lists
+	bool instancing = instanceBuffer && instancedVS->GetPerInstanceCompatible();
+	unsigned int workers = count / OPAQUE_DRAWS_PER_WORKER;
+	if (workers > GetHardwareThreadCount()) workers = GetHardwareThreadCount();
+	if (workers < 1) workers = 1;
+	while (opaqueLists.size() < workers) opaqueLists.push_back(new RenderCommandList());
+	std::vector<unsigned int> sliceStarts(workers + 1, count);
+	for (unsigned int w = 0; w < workers; w++)
+	{
+		unsigned int start = (unsigned int)((unsigned long long)count * w / workers);
+		while (start > 0 && start < count && ContinuesRun(start, instancing)) start++;
+		sliceStarts[w] = start;
+	}
+
+	// Every draw's world matrix goes up at once, in queue order, so each
+	// run's instances are contiguous; workers fill in their own slices
+	XMFLOAT4X4* worlds = 0;
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	if (instancing && count > 0)
+	{
+		context->Map(instanceBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+		worlds = (XMFLOAT4X4*)mapped.pData;
+	}
+
+	std::vector<unsigned int> sliceStateChanges(workers, 0);
+	RunParallel(workers, [&](unsigned int w)
+	{
+		sliceStateChanges[w] = RecordOpaque(sliceStarts[w], sliceStarts[w + 1], worlds, opaqueLists[w]);
+	});
+
+	if (worlds)
+	{
+		context->Unmap(instanceBuffer, 0);
+
+		UINT instanceStride = sizeof(XMFLOAT4X4);
+		UINT instanceOffset = 0;
+		context->IASetVertexBuffers(1, 1, &instanceBuffer, &instanceStride, &instanceOffset);
+	}
+
+	// Then they're played back in order
+	stateChanges = 0;
+	drawCalls = 0;
+	for (unsigned int w = 0; w < workers; w++)
+	{
+		opaqueLists[w]->Execute(renderBackend);
+		stateChanges += sliceStateChanges[w];
+		drawCalls += opaqueLists[w]->GetDrawCount();
+	}
+
+	// Drawing them one by one (Entity::Render) binds all four every time
+	unsortedStateChanges = count * 4;
+}
+
+// --------------------------------------------------------
+// Whether the queued draw at index can be drawn as another
+// instance of the one before it: same pass, material and
+// mesh, on the standard shader (the one with an instanced
+// twin).
+// --------------------------------------------------------
+bool Game::ContinuesRun(unsigned int index, bool instancing)
+{
+	if (!instancing || index == 0) return false;
+
+	const QueuedOpaque& draw = queuedOpaques[index];
+	const QueuedOpaque& previous = queuedOpaques[index - 1];
+	return draw.instanceable &&
+		draw.pass == previous.pass &&
+		draw.material == previous.material &&
+		draw.mesh == previous.mesh;
+}
+
+// --------------------------------------------------------
+// Records the queued draws in [begin, end) into list, each
+// binding only what differs from the draw before it (so the
+// first binds everything), and writes their world matrices
+// into worlds (null when not instancing).  Only reads the
+// scene, so slices can be recorded on several threads at
+// once.  Returns how many binds it took.
+// --------------------------------------------------------
+unsigned int Game::RecordOpaque(unsigned int begin, unsigned int end, XMFLOAT4X4* worlds, RenderCommandList* list)
+{
+	XMFLOAT4X4 view = GameCamera->GetView();
+	XMFLOAT4X4 projection = GameCamera->GetProjection();
+	XMFLOAT3 cameraPosition = GameCamera->GetPosition();
+
+	ISimpleShader* boundVS = 0;
+	ISimpleShader* boundPS = 0;
+	unsigned int boundPass = 0;
+	Material* boundMaterial = 0;
+	Mesh* boundMesh = 0;
+	unsigned int binds = 0;
+
+	list->Clear();
+	for (unsigned int i = begin; i < end; )
+	{
+		const QueuedOpaque& draw = queuedOpaques[i];
+		Material* material = draw.material;
+		Mesh* mesh = draw.mesh;
+		ISimpleShader* ps = material->GetPixelShader();
+
+		// The draws after it that can share the call go with it
+		unsigned int run = 1;
+		while (i + run < end && ContinuesRun(i + run, worlds != 0)) run++;
+		bool instanced = worlds && draw.instanceable;
+		ISimpleShader* vs = instanced ? instancedVS : material->GetVertexShader();
+		if (instanced)
+		{
+			for (unsigned int r = 0; r < run; r++)
+			{
+				worlds[i + r] = queuedOpaques[i + r].entity->GetWorldMatrix();
+			}
+		}
+
+		// Camera and light matrices only change between frames
+		if (vs != boundVS)
+		{
+			list->SetConstant(vs, "view", &view, sizeof(XMFLOAT4X4));
+			list->SetConstant(vs, "projection", &projection, sizeof(XMFLOAT4X4));
+			list->SetConstant(vs, "lightView", &shadowViewMatrix, sizeof(XMFLOAT4X4));
+			list->SetConstant(vs, "lightProj", &shadowProjectionMatrix, sizeof(XMFLOAT4X4));
+			list->UploadConstants(vs, 0);
+			list->SetShader(vs);
+			boundVS = vs;
+			binds++;
+		}
+
+		// Lighting, and whether the shadow map is read, change per pass
+		if (ps != boundPS || draw.pass != boundPass)
+		{
+			int receiveShadows = draw.pass == OPAQUE_PASS_SHADOWED;
+			list->SetConstant(ps, "ReceiveShadows", &receiveShadows, sizeof(int));
+			list->SetConstant(ps, "light", &light, sizeof(DirectionalLight));
+			list->SetConstant(ps, "cameraPosition", &cameraPosition, sizeof(XMFLOAT3));
+			list->UploadConstants(ps, 0);
+			list->SetShader(ps);
+			if (receiveShadows)
+			{
+				list->SetTexture(ps, "ShadowMap", shadowSRV);
+				list->SetSampler(ps, "ShadowSampler", shadowSampler);
+			}
+			boundPS = ps;
+			boundPass = draw.pass;
+			binds++;
+		}
+
+		if (material != boundMaterial)
+		{
+			list->SetSampler(ps, "basicSampler", material->GetSampleState());
+			list->SetTexture(ps, "diffuseTexture", material->GetTexture());
+			list->SetTexture(ps, "specularMap", material->GetSpecularMap());
+			list->SetTexture(ps, "normalMap", material->GetNormalMap());
+			boundMaterial = material;
+			binds++;
+		}
+
+		if (mesh != boundMesh)
+		{
+			list->SetGeometry(mesh->vertexBuffer, mesh->indexBuffer, sizeof(Vertex));
+			boundMesh = mesh;
+			binds++;
+		}
+
+		// Instances start at the run's place in the queue
+		if (instanced)
+		{
+			list->Draw(mesh->numVertices, run, i);
+		}
+		else
+		{
+			XMFLOAT4X4 world = draw.entity->GetWorldMatrix();
+			list->SetConstant(vs, "world", &world, sizeof(XMFLOAT4X4));
+			list->UploadConstants(vs, "perObject");
+			list->Draw(mesh->numVertices, 0, 0);
+		}
+		i += run;
+	}
+
+	return binds;
+}
+
+// --------------------------------------------------------
+// Weighted blended order-independent transparency: every
+// translucent entity and OIT particle emitter goes into the
+// accumulation and revealage targets in whatever order, then
+// one full screen pass composites them over the scene.
+// --------------------------------------------------------
+void Game::DrawOIT()
+{
+	// Skip the whole thing when there's nothing translucent in view
+	bool anyTranslucent = false;
+	for (size_t i = 0; i < translucentEntities.size() && !anyTranslucent; i++)
+	{
+		anyTranslucent = cameraVisible[entityPool.Get(translucentEntities[i])->GetTransform()];
+	}
+	for (int i = 0; i < emitters.size() && !anyTranslucent; i++)
+	{
+		Emitter* emitter = emitterPool.Get(emitters[i]);
+		anyTranslucent = emitter->IsVisible() && emitter->IsOrderIndependent();
+	}
+	if (!anyTranslucent) return;
+
+	// No color yet, and everything behind fully revealed
+	const float clearAccumulation[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	const float clearRevealage[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	context->ClearRenderTargetView(oitAccumulationRTV, clearAccumulation);
+	context->ClearRenderTargetView(oitRevealageRTV, clearRevealage);
+
+	// Test against the opaque depth, but don't write it
+	ID3D11RenderTargetView* targets[2] = { oitAccumulationRTV, oitRevealageRTV };
+	context->OMSetRenderTargets(2, targets, depthStencilView);
+	float factors[4] = { 1,1,1,1 };
+	context->OMSetBlendState(oitBlendState, factors, 0xFFFFFFFF);
+	context->OMSetDepthStencilState(particleDepthState, 0);
+
+	// Their materials carry the OIT pixel shader, which writes both targets
+	for (size_t i = 0; i < translucentEntities.size(); i++)
+	{
+		Entity* entity = entityPool.Get(translucentEntities[i]);
+		if (!cameraVisible[entity->GetTransform()]) continue;
+
+		entity->GetMaterial()->GetPixelShader()->SetData("light", &light, sizeof(DirectionalLight));
+		entity->GetMaterial()->GetPixelShader()->SetFloat3("cameraPosition", GameCamera->GetPosition());
+		entity->Render(GameCamera->GetView(), GameCamera->GetProjection());
+	}
+
+	for (int i = 0; i < emitters.size(); i++)
+	{
+		Emitter* emitter = emitterPool.Get(emitters[i]);
+		if (emitter->IsVisible() && emitter->IsOrderIndependent())
+			emitter->Draw(context, GameCamera, particleOITPS);
+	}
+
+	// Composite over the scene (straight alpha, with alpha = 1 - revealage)
+	context->OMSetRenderTargets(1, &blurRTV, 0);
+	context->OMSetBlendState(blend, factors, 0xFFFFFFFF);
+	context->OMSetDepthStencilState(0, 0);
+
+	ppVS->SetShader();
+	oitCompositePS->SetShaderResourceView("Accumulation", oitAccumulationSRV);
+	oitCompositePS->SetShaderResourceView("Revealage", oitRevealageSRV);
+	oitCompositePS->CopyAllBufferData();
+	oitCompositePS->SetShader();
+
+	// Unbind vertex and index buffers!
+	UINT stride = sizeof(Vertex);
+	UINT offset = 0;
+	ID3D11Buffer* nothing = 0;
+	context->IASetVertexBuffers(0, 1, &nothing, &stride, &offset);
+	context->IASetIndexBuffer(0, DXGI_FORMAT_R32_UINT, 0);
+
+	// Draw exactly 3 vertices
+	context->Draw(3, 0);
+
+	// The targets get drawn into again next frame
+	oitCompositePS->SetShaderResourceView("Accumulation", 0);
+	oitCompositePS->SetShaderResourceView("Revealage", 0);
+}
+
 void Game::DrawBloom()
 {
 	// Set buffers in the input assembler
@@ -1153,24 +1726,43 @@ void Game::DrawUI()
 		0);
 
 
+	Entity* stars = entityPool.Get(GUIElements[0]);
+	Entity* rate = entityPool.Get(GUIElements[1]);
+	Entity* restart = entityPool.Get(GUIElements[2]);
+
 	if (canRate) {
 		//for (int i = 0; i < GUIElements.size(); i++) {
-		GUIElements[0]->GetMaterial()->GetPixelShader()->SetData("light", &fullBright, sizeof(DirectionalLight));
-		GUIElements[0]->GetMaterial()->GetPixelShader()->SetFloat3("cameraPosition", GUICamera->GetPosition());
-		GUIElements[0]->Render(GUICamera->GetView(), GUICamera->GetProjection());
+		stars->GetMaterial()->GetPixelShader()->SetData("light", &fullBright, sizeof(DirectionalLight));
+		stars->GetMaterial()->GetPixelShader()->SetFloat3("cameraPosition", GUICamera->GetPosition());
+		stars->Render(GUICamera->GetView(), GUICamera->GetProjection());
 		//}
 	}
 	if (!isRating && canRate) {
-		GUIElements[1]->GetMaterial()->GetPixelShader()->SetData("light", &fullBright, sizeof(DirectionalLight));
-		GUIElements[1]->GetMaterial()->GetPixelShader()->SetFloat3("cameraPosition", GUICamera->GetPosition());
-		GUIElements[1]->Render(GUICamera->GetView(), GUICamera->GetProjection());
+		rate->GetMaterial()->GetPixelShader()->SetData("light", &fullBright, sizeof(DirectionalLight));
+		rate->GetMaterial()->GetPixelShader()->SetFloat3("cameraPosition", GUICamera->GetPosition());
+		rate->Render(GUICamera->GetView(), GUICamera->GetProjection());
 	}
-	GUIElements[2]->GetMaterial()->GetPixelShader()->SetData("light", &fullBright, sizeof(DirectionalLight));
-	GUIElements[2]->GetMaterial()->GetPixelShader()->SetFloat3("cameraPosition", GUICamera->GetPosition());
-	GUIElements[2]->Render(GUICamera->GetView(), GUICamera->GetProjection());
+	restart->GetMaterial()->GetPixelShader()->SetData("light", &fullBright, sizeof(DirectionalLight));
+	restart->GetMaterial()->GetPixelShader()->SetFloat3("cameraPosition", GUICamera->GetPosition());
+	restart->Render(GUICamera->GetView(), GUICamera->GetProjection());
 }
 
 
+// --------------------------------------------------------
+// How much of the scene the culls let through, for the title bar
+// --------------------------------------------------------
+std::string Game::GetTitleBarStats()
+{
+	unsigned int bounded = culling->GetBoundedCount();
+	return "    Visible: " + std::to_string(visibleCount) + "/" + std::to_string(bounded) +
+		"    Rooms: " + std::to_string(portals->GetVisibleRoomCount()) + "/" + std::to_string(portals->GetRoomCount()) +
+		"    Behind Walls: " + std::to_string(behindWallsCount) +
+		"    Occluded: " + std::to_string(occludedCount) +
+		"    Shadow Casters: " + std::to_string(shadowCasterCount) + "/" + std::to_string(bounded) +
+		"    State Changes: " + std::to_string(stateChanges) + "/" + std::to_string(unsortedStateChanges) +
+		"    Draw Calls: " + std::to_string(drawCalls) + "/" + std::to_string(opaqueQueue->GetCount());
+}
+
 #pragma region Mouse Input
 
 // --------------------------------------------------------
@@ -1181,8 +1773,8 @@ void Game::DrawUI()
 void Game::OnMouseDown(WPARAM buttonState, int x, int y)
 {
 	if (canRate && starRating != -1 && isRating) {
-		exhibits[currentExhibit]->SetRating(starRating);
-		GUIElements[0]->SetMaterial(starMaterials[starRating]);
+		entityPool.Get(exhibits[currentExhibit])->SetRating(starRating);
+		entityPool.Get(GUIElements[0])->SetMaterial(materialPool.Get(starMaterials[starRating]));
 	}
 	// Add any custom code here...
 
@@ -8,10 +8,26 @@
 #include <d3d11sdklayers.h>
 #include "Lights.h"
 #include "Entity.h"
+#include "TransformSystem.h"
+#include "CullingSystem.h"
+#include "OcclusionCuller.h"
+#include "PortalGraph.h"
+#include "SpatialHash.h"
+#include "RenderQueue.h"
+#include "RenderCommandList.h"
+#include "D3D11RenderBackend.h"
+#include "Parallel.h"
+#include "Pool.h"
 #include "Camera.h"
 #include <vector>
 #include "BoundingBox.h"
 #include "Emitter.h"
+#include "GPUEmitter.h"
+#include "TrailEmitter.h"
+#include "Fountain.h"
+#include "Scene.h"
+#include "SceneGenerator.h"
+#include "Random.h"
 #include "DDSTextureLoader.h"
 
 class Mesh;
@@ -19,15 +35,40 @@ class Entity;
 class Camera;
 class Material;
 class Emitter;
+class GPUEmitter;
+class TrailEmitter;
 
 using namespace DirectX;
 
+// Entities worth rasterizing as occluders: big, opaque and cheap
+#define OCCLUDER_MIN_RADIUS 1.9f
+#define OCCLUDER_MAX_TRIANGLES 300
+
+// How close (on the floor) the camera has to be to rate an exhibit;
+// also the exhibit grid's cell size
+#define EXHIBIT_RATING_DISTANCE 2.5f
+
+// Passes of the opaque queue: the building takes the shadow map, exhibits don't
+#define OPAQUE_PASS_SHADOWED 0
+#define OPAQUE_PASS_UNSHADOWED 1
+
+// View depth that maps to the far end of a sort key (the camera's far plane)
+#define OPAQUE_DEPTH_RANGE 100.0f
+
+// Opaque draws each recording thread should have, at least, to be worth starting
+#define OPAQUE_DRAWS_PER_WORKER 512
+
 class Game : public DXCore {
 
 public:
 	Game(HINSTANCE hInstance);
 	~Game();
 
+	// Options given to the exe, before Init():
+	//   -stress <rooms>   generate a gallery this many rooms big instead
+	//   -gpuparticles     simulate the fire on the GPU
+	void ParseCommandLine(const char* commandLine);
+
 	// Overridden setup and game loop methods, which
 	// will be called automatically
 	void Init();
@@ -41,6 +82,8 @@ public:
 	void OnMouseMove (WPARAM buttonState, int x, int y);
 	void OnMouseWheel(float wheelDelta,   int x, int y);
 
+	std::string GetTitleBarStats();
+
 private:
 
 	ID3D11RasterizerState * rast;
@@ -56,6 +99,16 @@ private:
 	ID3D11RenderTargetView* blur2RTV;		// Allows us to render to a texture
 	ID3D11ShaderResourceView* blur2SRV;		// Allows us to sample from the same texture
 
+	// Weighted blended OIT stuff ---------------
+	ID3D11RenderTargetView* oitAccumulationRTV;
+	ID3D11ShaderResourceView* oitAccumulationSRV;
+	ID3D11RenderTargetView* oitRevealageRTV;
+	ID3D11ShaderResourceView* oitRevealageSRV;
+	ID3D11BlendState* oitBlendState;
+	SimplePixelShader* oitCompositePS;
+	SimplePixelShader* particleOITPS;
+	SimplePixelShader* exhibitOITPS;
+
 	// Shadow stuff ---------------------------
 	int shadowMapSize;
 	ID3D11DepthStencilView* shadowDSV;
@@ -73,50 +126,183 @@ private:
 	SimplePixelShader* pixelShader;
 	SimpleVertexShader* vertexShader;
 
+	// vertexShader, taking world matrices per instance from instanceBuffer
+	// (one per opaque draw, filled in queue order each frame)
+	SimpleVertexShader* instancedVS;
+	ID3D11Buffer* instanceBuffer;
+
 	// Particle Emitter Shaders
 	SimplePixelShader* particlePS;
 	SimpleVertexShader* particleVS;
 	ID3D11DepthStencilState* particleDepthState;
 	ID3D11BlendState* particleBlendState;
+	ID3D11BlendState* particleAlphaBlendState;
+
+	// GPU particle shaders
+	SimpleComputeShader* particleDeadListInitCS;
+	SimpleComputeShader* particleEmitCS;
+	SimpleComputeShader* particleUpdateCS;
+	SimpleVertexShader* particleGPUDrawVS;
+
+	// Ribbon trail shader (shares particlePS)
+	SimpleVertexShader* trailVS;
 
 	//Sky
 	ID3D11ShaderResourceView* skySRV;
 	ID3D11DepthStencilState* skyDepthState;
 	ID3D11RasterizerState* skyRasterizerState;
 
-	Mesh* skyMesh;
+	unsigned int skyMesh;
 
 	SimpleVertexShader* skyVertexShader;
 	SimplePixelShader* skyPixelShader;
 
-	// Vector of active meshes
-	std::vector<Mesh*> meshes;
+	// The gallery's layout; meshes and materials are created in its order
+	Scene* scene;
+
+	// Transform of each of the scene's entity records
+	std::vector<unsigned int> sceneTransforms;
+
+	// Meshes (the sky's too), materials, entities (exhibits and UI too)
+	// and every kind of emitter all live in pools; everything else refers
+	// to them by handle.  The fountain is the only one of its kind, so
+	// it's owned directly.
+	Pool<Mesh> meshPool;
+	Pool<Material> materialPool;
+	Pool<Entity> entityPool;
+	Pool<Emitter> emitterPool;
+	Pool<GPUEmitter> gpuEmitterPool;
+	Pool<TrailEmitter> trailEmitterPool;
+
+	// Handles of the scene's meshes, in its order
+	std::vector<unsigned int> meshes;
+
+	// Transforms for every entity, updated in one batch each frame
+	TransformSystem* transforms;
+
+	// World bounds of everything drawable, and what passed this frame's culls
+	CullingSystem* culling;
+	std::vector<unsigned char> cameraVisible;
+	std::vector<unsigned char> shadowVisible;
+	unsigned int visibleCount;
+	unsigned int shadowCasterCount;
+
+	// Rooms and doorways from the scene's bounds, flooded from the camera each frame
+	PortalGraph* portals;
+	unsigned int behindWallsCount;
 
-	// Vector of active entities
-	std::vector<Entity*> entities;
-	std::vector<Entity*> exhibits;
-	std::vector<Entity*> GUIElements;
+	// Big, simple entities rasterized on the CPU to hide what's behind them
+	OcclusionCuller* occlusion;
+	unsigned int occludedCount;
 
-	// Vector of materials
-	std::vector<Material*> materials;
-	std::vector<Material*> starMaterials;
+	// Handles of the active entities
+	std::vector<unsigned int> entities;
+	std::vector<unsigned int> exhibits;
+
+	// Statics and exhibits with translucent materials, drawn only in the OIT pass
+	std::vector<unsigned int> translucentEntities;
+
+	// Exhibits by floor position, for finding the one the camera is at,
+	// and the ones that can move (they or something above them animate)
+	SpatialHash* exhibitGrid;
+	std::vector<unsigned int> movingExhibits;
+
+	// Every opaque entity and exhibit with the scene ids its sort key
+	// is made of, the queue they're sorted through each frame, and
+	// how many binds drawing them took (and would have, one by one)
+	struct OpaqueDraw
+	{
+		unsigned int entity;
+		unsigned int pass;
+		unsigned int shader;
+		unsigned int material;
+		unsigned int mesh;
+	};
+	std::vector<OpaqueDraw> opaqueDraws;
+	RenderQueue* opaqueQueue;
+
+	// This frame's queue, in sorted order, with the handles resolved once
+	// so the recording threads only follow plain pointers
+	struct QueuedOpaque
+	{
+		Entity* entity;
+		Material* material;
+		Mesh* mesh;
+		unsigned int pass;
+		bool instanceable;		// On the standard shader, which has an instanced twin
+	};
+	std::vector<QueuedOpaque> queuedOpaques;
+	std::vector<Entity*> opaqueEntities;		// Per opaque draw, while the queue is built
+	unsigned int stateChanges;
+	unsigned int unsortedStateChanges;
+	unsigned int drawCalls;
+
+	// One command list per recording thread, played back onto the context
+	std::vector<RenderCommandList*> opaqueLists;
+	RenderBackend* renderBackend;
+	std::vector<unsigned int> GUIElements;
+
+	// Handles of the scene's materials (in its order) and the UI's
+	std::vector<unsigned int> materials;
+	std::vector<unsigned int> starMaterials;
 
 	// Vector to hold the world boundary boxes
 	std::vector<BoundingBox*> worldBounds;
 	std::vector<BoundingBox*> exhibitBounds;
 
-	// Vector to hold all emitterrs
-	std::vector<Emitter*> emitters;
+	// Handles of all the CPU emitters
+	std::vector<unsigned int> emitters;
+
+	// Shared particle storage that every emitter leases from
+	ParticlePool* particlePool;
+
+	// Handles of the emitters simulated entirely on the GPU
+	std::vector<unsigned int> gpuEmitters;
+
+	// Handles of the emitters whose particles leave ribbons behind them
+	std::vector<unsigned int> trailEmitters;
+
+	// Water in the fountain exhibit
+	Fountain* fountain;
 
 	// Cameras
 	Camera* GameCamera;
 	Camera* GUICamera;
 
+	// Where the game camera was after the last two ticks; frames
+	// draw from in between, and each tick carries on from the last
+	XMFLOAT3 cameraLastPosition;
+	XMFLOAT3 cameraNextPosition;
+
+	// Entities the scene spins or shakes, where they started, and
+	// their pose after the last two ticks (drawn in between)
+	struct SceneAnimation
+	{
+		unsigned int entity;
+		XMFLOAT3 position;
+		XMFLOAT3 rotation;
+		float spin;
+		float jitter;
+		XMFLOAT3 lastPosition;
+		XMFLOAT3 lastRotation;
+		XMFLOAT3 nextPosition;
+		XMFLOAT3 nextRotation;
+	};
+	std::vector<SceneAnimation> animations;
+
+	// Puts the animated entities and the camera where they'd be
+	// the given fraction of the way from the last tick to the next
+	void InterpolateTicks(float alpha);
+
+	// Random stream for exhibit animation (emitters have their own)
+	Random random;
+
 	// Light
 	DirectionalLight light;
 	DirectionalLight fullBright;
 
 	// Initialization helper methods - feel free to customize, combine, etc.
+	void LoadScene(const char* path);
 	void LoadMaterials();
 	void CreateBasicGeometry();
 	void DoStars();
@@ -124,6 +310,10 @@ private:
 	void DoEmitters(float deltaTime);
 	void SetUpShadowMap();
 
+	void DrawOpaque();
+	bool ContinuesRun(unsigned int index, bool instancing);
+	unsigned int RecordOpaque(unsigned int begin, unsigned int end, XMFLOAT4X4* worlds, RenderCommandList* list);
+	void DrawOIT();
 	void DrawBloom();
 	void DrawUI();
 	void DrawShadowMap();
@@ -134,6 +324,15 @@ private:
 	bool canRate = false;
 	bool isRating = false;
 
+	// Simulate the fire with compute shaders instead of on the CPU
+	// (-gpuparticles on the command line)
+	bool useGPUParticles = false;
+
+	// When nonzero, swap the gallery's layout for a generated one this
+	// many rooms big (the hand-made one has 4) to see how things scale.
+	// Set with -stress on the command line.
+	unsigned int stressSceneRooms = 0;
+
 	// Keeps track of the old mouse position.  Useful for 
 	// determining how far the mouse moved in a single frame.
 	POINT prevMousePos;
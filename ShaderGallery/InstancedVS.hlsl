@@ -0,0 +1,55 @@
+
+// VertexShader, for runs of entities sharing a mesh and material: the
+// world matrix comes from a per-instance vertex buffer instead of a cbuffer
+cbuffer perFrame : register(b0)
+{
+	matrix view;
+	matrix projection;
+	matrix lightView;
+	matrix lightProj;
+};
+
+// "_PER_INSTANCE" semantics are read from input slot 1, once per instance
+// (see SimpleVertexShader).  The world matrix arrives as stored on the CPU
+// (transposed, like everything sent to cbuffers), one row per element.
+struct VertexShaderInput
+{
+	float3 position		: POSITION;
+	float2 uv			: TEXCOORD;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+	float4 world0		: WORLD_PER_INSTANCE0;
+	float4 world1		: WORLD_PER_INSTANCE1;
+	float4 world2		: WORLD_PER_INSTANCE2;
+	float4 world3		: WORLD_PER_INSTANCE3;
+};
+
+// Matches PixelShader, same as VertexShader's
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float3 normal		: NORMAL;
+	float3 tangent		: TANGENT;
+	float3 worldPos		: POSITION;
+	float2 uv			: TEXCOORD;
+	float4 posForShadow : POSITION1;
+};
+
+VertexToPixel main(VertexShaderInput input)
+{
+	VertexToPixel output;
+
+	matrix world = transpose(float4x4(input.world0, input.world1, input.world2, input.world3));
+
+	matrix worldViewProj = mul(mul(world, view), projection);
+	matrix shadowWVP = mul(mul(world, lightView), lightProj);
+	output.posForShadow = mul(float4(input.position, 1.0f), shadowWVP);
+	output.position = mul(float4(input.position, 1.0f), worldViewProj);
+	output.worldPos = mul(float4(input.position, 1.0f), world).xyz;
+
+	output.normal = mul(input.normal, (float3x3)world);
+	output.tangent = mul(input.tangent, (float3x3)world);
+	output.uv = input.uv;
+
+	return output;
+}
@@ -47,6 +47,7 @@ int WINAPI WinMain(
 	// Create the Game object using
 	// the app handle we got from WinMain
 	Game dxGame(hInstance);
+	dxGame.ParseCommandLine(lpCmdLine);
 
 	// Result variable for function calls below
 	HRESULT hr = S_OK;
@@ -35,6 +35,10 @@ void Material::SetVertexShader(SimpleVertexShader* pVertexShader) { vertexShader
 
 void Material::SetPixelShader(SimplePixelShader* pPixelShader) { pixelShader = pPixelShader; }
 
+void Material::SetTranslucent(bool pTranslucent) { translucent = pTranslucent; }
+
+bool Material::IsTranslucent() { return translucent; }
+
 void Material::SetTexture(ID3D11Device * device, ID3D11DeviceContext * context, wchar_t * fileName)
 {
 	sampleDescription = new D3D11_SAMPLER_DESC();
@@ -21,6 +21,11 @@ public:
 	void SetSpecularMap(ID3D11Device* device, ID3D11DeviceContext* context, wchar_t* fileName);
 	void SetNormalMap(ID3D11Device* device, ID3D11DeviceContext* context, wchar_t* fileName);
 
+	// Translucent materials are drawn in the OIT pass, so their pixel
+	// shader has to write the OIT targets (see ExhibitOITPS)
+	void SetTranslucent(bool pTranslucent);
+	bool IsTranslucent();
+
 private:
 	SimpleVertexShader* vertexShader;
 	SimplePixelShader* pixelShader;
@@ -29,5 +34,6 @@ private:
 	ID3D11ShaderResourceView* normalMap = nullptr;
 	ID3D11SamplerState* sampleState;
 	D3D11_SAMPLER_DESC * sampleDescription;
+	bool translucent = false;
 };
 
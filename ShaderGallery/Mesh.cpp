@@ -2,6 +2,10 @@
 
 Mesh::Mesh(ID3D11Device * pDevice, char * fileName)
 {
+	boundsMin = XMFLOAT3(0, 0, 0);
+	boundsMax = XMFLOAT3(0, 0, 0);
+	boundingRadius = 0;
+
 	// File input object
 	std::ifstream obj(fileName);
 
@@ -183,6 +187,13 @@ Mesh::~Mesh() {
 
 void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArray, int numIndices, ID3D11Device* device)
 {
+	CalculateBounds(vertArray, numVerts);
+
+	trianglePositions.resize(numIndices);
+	for (int i = 0; i < numIndices; i++)
+	{
+		trianglePositions[i] = vertArray[indexArray[i]].Position;
+	}
 
 	// Create the vertex buffer
 	D3D11_BUFFER_DESC vbd;
@@ -212,6 +223,33 @@ void Mesh::CreateBuffers(Vertex* vertArray, int numVerts, unsigned int* indexArr
 	this->numIndices = numIndices;
 }
 
+// Box around every vertex, then the smallest sphere around
+// the box's center that still holds them all
+void Mesh::CalculateBounds(Vertex* verts, int numVerts)
+{
+	if (numVerts == 0) return;
+
+	XMVECTOR min = XMLoadFloat3(&verts[0].Position);
+	XMVECTOR max = min;
+	for (int i = 1; i < numVerts; i++)
+	{
+		XMVECTOR position = XMLoadFloat3(&verts[i].Position);
+		min = XMVectorMin(min, position);
+		max = XMVectorMax(max, position);
+	}
+	XMStoreFloat3(&boundsMin, min);
+	XMStoreFloat3(&boundsMax, max);
+
+	XMVECTOR center = XMVectorScale(XMVectorAdd(min, max), 0.5f);
+	XMVECTOR farthest = XMVectorZero();
+	for (int i = 0; i < numVerts; i++)
+	{
+		XMVECTOR offset = XMVectorSubtract(XMLoadFloat3(&verts[i].Position), center);
+		farthest = XMVectorMax(farthest, XMVector3LengthSq(offset));
+	}
+	boundingRadius = sqrtf(XMVectorGetX(farthest));
+}
+
 // Calculates the tangents of the vertices in a mesh
 // Code adapted from: http://www.terathon.com/code/tangent.html
 void Mesh::CalculateTangents(Vertex * verts, int numVerts, int * indices, int numIndices)
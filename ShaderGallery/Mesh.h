@@ -23,6 +23,15 @@ public:
 	ID3D11Buffer* GetIndexBuffer() { return indexBuffer; }
 	int GetIndexCount() { return numIndices; }
 
+	// Local space bounds, found at load.  The sphere is centered on the box.
+	XMFLOAT3 GetBoundsMin() { return boundsMin; }
+	XMFLOAT3 GetBoundsMax() { return boundsMax; }
+	float GetBoundingRadius() { return boundingRadius; }
+
+	// A CPU copy of the positions, three per triangle, for software occlusion
+	const XMFLOAT3* GetTrianglePositions() { return trianglePositions.empty() ? 0 : &trianglePositions[0]; }
+	int GetTriangleCount() { return (int)trianglePositions.size() / 3; }
+
 	// Number of vertices in this mesh.
 	// Used to calculate buffer byte width.
 	int numVertices;
@@ -30,6 +39,13 @@ public:
 
 private:
 	void CalculateTangents(Vertex * verts, int numVerts, int * indices, int numIndices);
+	void CalculateBounds(Vertex* verts, int numVerts);
+
+	XMFLOAT3 boundsMin;
+	XMFLOAT3 boundsMax;
+	float boundingRadius;
+	std::vector<XMFLOAT3> trianglePositions;
+
 	// DX Device
 	ID3D11Device* device;
 };
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "NullRenderBackend.h"
+
+#include <string.h>
+
+// 64-bit FNV-1a
+#define NULL_BACKEND_HASH_BASIS 0xCBF29CE484222325ull
+#define NULL_BACKEND_HASH_PRIME 0x100000001B3ull
+
+NullRenderBackend::NullRenderBackend()
+{
+	Reset();
+}
+
+NullRenderBackend::~NullRenderBackend()
+{
+}
+
+void NullRenderBackend::Reset()
+{
+	hash = NULL_BACKEND_HASH_BASIS;
+	commandCount = 0;
+	drawCount = 0;
+	instanceCount = 0;
+	constantBytes = 0;
+}
+
+void NullRenderBackend::Hash(const void* data, unsigned int size)
+{
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (unsigned int i = 0; i < size; i++)
+	{
+		hash = (hash ^ bytes[i]) * NULL_BACKEND_HASH_PRIME;
+	}
+}
+
+void NullRenderBackend::HashName(const char* name)
+{
+	// By contents, since two lists can hold different copies of the same literal
+	// (no name hashes as a lone 0xFF, which no name's terminator can be)
+	if (name) Hash(name, (unsigned int)strlen(name) + 1);
+	else
+	{
+		unsigned char none = 0xFF;
+		Hash(&none, 1);
+	}
+}
+
+void NullRenderBackend::SetShader(const void* shader)
+{
+	RenderCommandType type = RENDER_COMMAND_SET_SHADER;
+	Hash(&type, sizeof(type));
+	Hash(&shader, sizeof(shader));
+	commandCount++;
+}
+
+void NullRenderBackend::SetConstant(const void* shader, const char* name, const void* data, unsigned int size)
+{
+	RenderCommandType type = RENDER_COMMAND_SET_CONSTANT;
+	Hash(&type, sizeof(type));
+	Hash(&shader, sizeof(shader));
+	HashName(name);
+	Hash(data, size);
+	constantBytes += size;
+	commandCount++;
+}
+
+void NullRenderBackend::UploadConstants(const void* shader, const char* buffer)
+{
+	RenderCommandType type = RENDER_COMMAND_UPLOAD_CONSTANTS;
+	Hash(&type, sizeof(type));
+	Hash(&shader, sizeof(shader));
+	HashName(buffer);
+	commandCount++;
+}
+
+void NullRenderBackend::SetTexture(const void* shader, const char* name, const void* view)
+{
+	RenderCommandType type = RENDER_COMMAND_SET_TEXTURE;
+	Hash(&type, sizeof(type));
+	Hash(&shader, sizeof(shader));
+	HashName(name);
+	Hash(&view, sizeof(view));
+	commandCount++;
+}
+
+void NullRenderBackend::SetSampler(const void* shader, const char* name, const void* sampler)
+{
+	RenderCommandType type = RENDER_COMMAND_SET_SAMPLER;
+	Hash(&type, sizeof(type));
+	Hash(&shader, sizeof(shader));
+	HashName(name);
+	Hash(&sampler, sizeof(sampler));
+	commandCount++;
+}
+
+void NullRenderBackend::SetGeometry(const void* vertices, const void* indices, unsigned int stride)
+{
+	RenderCommandType type = RENDER_COMMAND_SET_GEOMETRY;
+	Hash(&type, sizeof(type));
+	Hash(&vertices, sizeof(vertices));
+	Hash(&indices, sizeof(indices));
+	Hash(&stride, sizeof(stride));
+	commandCount++;
+}
+
+void NullRenderBackend::Draw(unsigned int indexCount, unsigned int instanceCount, unsigned int firstInstance)
+{
+	RenderCommandType type = RENDER_COMMAND_DRAW;
+	Hash(&type, sizeof(type));
+	Hash(&indexCount, sizeof(indexCount));
+	Hash(&instanceCount, sizeof(instanceCount));
+	Hash(&firstInstance, sizeof(firstInstance));
+	this->instanceCount += instanceCount > 0 ? instanceCount : 1;
+	drawCount++;
+	commandCount++;
+}
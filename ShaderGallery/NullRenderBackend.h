@@ -0,0 +1,42 @@
+#pragma once
+#include "RenderCommandList.h"
+
+// --------------------------------------------------------
+// A backend that draws nothing.  It counts what's played
+// onto it and folds every command, with its arguments and
+// constant data, into a hash, so two ways of recording the
+// same frame (one thread or several) can be compared, and
+// recording can be timed, without a GPU.
+// --------------------------------------------------------
+class NullRenderBackend : public RenderBackend
+{
+public:
+	NullRenderBackend();
+	~NullRenderBackend();
+
+	void Reset();
+
+	void SetShader(const void* shader);
+	void SetConstant(const void* shader, const char* name, const void* data, unsigned int size);
+	void UploadConstants(const void* shader, const char* buffer);
+	void SetTexture(const void* shader, const char* name, const void* view);
+	void SetSampler(const void* shader, const char* name, const void* sampler);
+	void SetGeometry(const void* vertices, const void* indices, unsigned int stride);
+	void Draw(unsigned int indexCount, unsigned int instanceCount, unsigned int firstInstance);
+
+	unsigned long long GetHash() { return hash; }
+	unsigned int GetCommandCount() { return commandCount; }
+	unsigned int GetDrawCount() { return drawCount; }
+	unsigned int GetInstanceCount() { return instanceCount; }
+	unsigned int GetConstantBytes() { return constantBytes; }
+
+private:
+	void Hash(const void* data, unsigned int size);
+	void HashName(const char* name);
+
+	unsigned long long hash;
+	unsigned int commandCount;
+	unsigned int drawCount;
+	unsigned int instanceCount;
+	unsigned int constantBytes;
+};
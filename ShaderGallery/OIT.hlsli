@@ -0,0 +1,35 @@
+// --------------------------------------------------------
+// Weighted blended order-independent transparency
+// (McGuire & Bavoil 2013).
+//
+// Translucent surfaces write a depth-weighted, premultiplied
+// color sum to the accumulation target and multiply the
+// revealage target by (1 - alpha).  OITCompositePS turns the
+// two back into one color later, so draw order doesn't matter.
+// OITReference.cpp mirrors this math on the CPU.
+// --------------------------------------------------------
+
+struct OITOutput
+{
+	float4 accumulation	: SV_TARGET0;	// Blended ONE, ONE
+	float revealage		: SV_TARGET1;	// Blended ZERO, INV_SRC_COLOR
+};
+
+// Weight from view depth; nearer surfaces count for more (equation 9 in the paper)
+float OITWeight(float viewDepth, float alpha)
+{
+	float d = viewDepth / 5.0f;
+	float f = viewDepth / 200.0f;
+	return alpha * clamp(10.0f / (1e-5f + d * d + f * f * f * f * f * f), 1e-2f, 3e3f);
+}
+
+// color is straight (not premultiplied) alpha
+OITOutput OITPack(float4 color, float viewDepth)
+{
+	float weight = OITWeight(viewDepth, color.a);
+
+	OITOutput output;
+	output.accumulation = float4(color.rgb * color.a, color.a) * weight;
+	output.revealage = color.a;
+	return output;
+}
@@ -0,0 +1,24 @@
+// Resolves the weighted blended OIT targets over the opaque scene.
+// Drawn as a full screen triangle with straight alpha blending.
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : TEXCOORD0;
+};
+
+Texture2D Accumulation	: register(t0);
+Texture2D Revealage		: register(t1);
+
+float4 main(VertexToPixel input) : SV_TARGET
+{
+	int3 pixel = int3(input.position.xy, 0);
+	float4 accumulation = Accumulation.Load(pixel);
+	float revealage = Revealage.Load(pixel).r;
+
+	// Nothing translucent here
+	if (revealage >= 1.0f) discard;
+
+	// Weighted average color, covering (1 - revealage) of what's behind
+	float3 average = accumulation.rgb / clamp(accumulation.a, 1e-4f, 5e4f);
+	return float4(average, 1.0f - revealage);
+}
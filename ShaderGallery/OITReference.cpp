@@ -0,0 +1,54 @@
+#include "OITReference.h"
+
+using namespace DirectX;
+
+OITPixel OITReference::Clear()
+{
+	OITPixel pixel;
+	pixel.accumulation = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+	pixel.revealage = 1.0f;
+	return pixel;
+}
+
+float OITReference::Weight(float viewDepth, float alpha)
+{
+	float d = viewDepth / 5.0f;
+	float f = viewDepth / 200.0f;
+	float w = 10.0f / (1e-5f + d * d + f * f * f * f * f * f);
+
+	if (w < 1e-2f) w = 1e-2f;
+	if (w > 3e3f) w = 3e3f;
+
+	return alpha * w;
+}
+
+void OITReference::Accumulate(OITPixel& pixel, XMFLOAT4 color, float viewDepth)
+{
+	float weight = Weight(viewDepth, color.w);
+
+	// Accumulation target: ONE, ONE
+	pixel.accumulation.x += color.x * color.w * weight;
+	pixel.accumulation.y += color.y * color.w * weight;
+	pixel.accumulation.z += color.z * color.w * weight;
+	pixel.accumulation.w += color.w * weight;
+
+	// Revealage target: ZERO, INV_SRC_COLOR
+	pixel.revealage *= 1.0f - color.w;
+}
+
+XMFLOAT3 OITReference::Composite(const OITPixel& pixel, XMFLOAT3 background)
+{
+	// The composite shader discards untouched pixels
+	if (pixel.revealage >= 1.0f) return background;
+
+	float a = pixel.accumulation.w;
+	if (a < 1e-4f) a = 1e-4f;
+	if (a > 5e4f) a = 5e4f;
+
+	// Straight alpha blend (SRC_ALPHA, INV_SRC_ALPHA) with alpha = 1 - revealage
+	float coverage = 1.0f - pixel.revealage;
+	return XMFLOAT3(
+		pixel.accumulation.x / a * coverage + background.x * pixel.revealage,
+		pixel.accumulation.y / a * coverage + background.y * pixel.revealage,
+		pixel.accumulation.z / a * coverage + background.z * pixel.revealage);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <DirectXMath.h>
+
+// One pixel's worth of the two OIT targets
+struct OITPixel
+{
+	DirectX::XMFLOAT4 accumulation;
+	float revealage;
+};
+
+// --------------------------------------------------------
+// CPU reference of the weighted blended OIT math in
+// OIT.hlsli and OITCompositePS.hlsl, including the blend
+// states the GPU applies between them.
+//
+// It has no D3D dependency and runs headless, so the weight
+// and composite can be checked against a sorted "over"
+// blend, or against known values, on any platform.
+// --------------------------------------------------------
+class OITReference
+{
+public:
+	// Cleared targets: no color, everything behind fully revealed
+	static OITPixel Clear();
+
+	// Depth weight for a surface (OITWeight)
+	static float Weight(float viewDepth, float alpha);
+
+	// Blends one surface into the pixel (OITPack plus the target blend states)
+	// - color: straight alpha
+	static void Accumulate(OITPixel& pixel, DirectX::XMFLOAT4 color, float viewDepth);
+
+	// Final color over the opaque background (OITCompositePS plus its blend state)
+	static DirectX::XMFLOAT3 Composite(const OITPixel& pixel, DirectX::XMFLOAT3 background);
+};
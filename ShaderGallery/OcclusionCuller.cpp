@@ -0,0 +1,420 @@
+#include "OcclusionCuller.h"
+
+#include <float.h>
+#include <math.h>
+
+#include "Parallel.h"
+
+// Fewer triangles (or tests) than this aren't worth the threads
+#define PARALLEL_OCCLUSION_TRIANGLES 2048
+#define PARALLEL_OCCLUSION_TESTS 4096
+
+using namespace DirectX;
+
+OcclusionCuller::OcclusionCuller(TransformSystem* transforms, CullingSystem* culling)
+{
+	this->transforms = transforms;
+	this->culling = culling;
+	threadCount = GetHardwareThreadCount();
+	triangleCount = 0;
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+
+	bins.resize((OCCLUSION_WIDTH / OCCLUSION_TILE_WIDTH) * (OCCLUSION_HEIGHT / OCCLUSION_TILE_HEIGHT));
+
+	// Halve down to a single texel; everything starts out far away
+	unsigned int width = OCCLUSION_WIDTH;
+	unsigned int height = OCCLUSION_HEIGHT;
+	while (true)
+	{
+		PyramidLevel level;
+		level.width = width;
+		level.height = height;
+		level.depth.resize(width * height, 1.0f);
+		levels.push_back(level);
+
+		if (width == 1 && height == 1) break;
+		width = (width + 1) / 2;
+		height = (height + 1) / 2;
+	}
+}
+
+OcclusionCuller::~OcclusionCuller()
+{
+}
+
+void OcclusionCuller::SetThreadCount(unsigned int threads)
+{
+	threadCount = threads > 0 ? threads : 1;
+}
+
+void OcclusionCuller::AddOccluder(unsigned int transform, const XMFLOAT3* positions, unsigned int triangleCount)
+{
+	Occluder occluder = { transform, positions, triangleCount };
+	occluders.push_back(occluder);
+}
+
+void OcclusionCuller::ClearOccluders()
+{
+	occluders.clear();
+}
+
+float OcclusionCuller::GetDepth(unsigned int level, unsigned int x, unsigned int y)
+{
+	return levels[level].depth[y * levels[level].width + x];
+}
+
+void OcclusionCuller::Render(XMFLOAT4X4 view, XMFLOAT4X4 projection, const std::vector<unsigned char>& visible)
+{
+	// Both are stored transposed for HLSL
+	XMMATRIX viewProj = XMMatrixMultiply(
+		XMMatrixTranspose(XMLoadFloat4x4(&view)),
+		XMMatrixTranspose(XMLoadFloat4x4(&projection)));
+	XMStoreFloat4x4(&viewProjection, viewProj);
+
+	// Set up every triangle of the occluders in view
+	triangles.clear();
+	for (size_t i = 0; i < occluders.size(); i++)
+	{
+		const Occluder& occluder = occluders[i];
+		if (occluder.transform >= visible.size() || !visible[occluder.transform]) continue;
+
+		XMFLOAT4X4 world = transforms->GetWorldMatrix(occluder.transform);
+		XMMATRIX toClip = XMMatrixMultiply(XMMatrixTranspose(XMLoadFloat4x4(&world)), viewProj);
+
+		for (unsigned int t = 0; t < occluder.triangleCount; t++)
+		{
+			XMFLOAT4 clip[3];
+			for (int v = 0; v < 3; v++)
+			{
+				XMStoreFloat4(&clip[v], XMVector3Transform(XMLoadFloat3(&occluder.positions[t * 3 + v]), toClip));
+			}
+			AddClipTriangle(clip);
+		}
+	}
+	triangleCount = (unsigned int)triangles.size();
+
+	// Bin them by the tiles their pixel bounds touch
+	const int tilesX = OCCLUSION_WIDTH / OCCLUSION_TILE_WIDTH;
+	for (size_t b = 0; b < bins.size(); b++)
+	{
+		bins[b].clear();
+	}
+	for (unsigned int i = 0; i < triangleCount; i++)
+	{
+		const ScreenTriangle& triangle = triangles[i];
+		for (int ty = triangle.minY / OCCLUSION_TILE_HEIGHT; ty <= triangle.maxY / OCCLUSION_TILE_HEIGHT; ty++)
+		{
+			for (int tx = triangle.minX / OCCLUSION_TILE_WIDTH; tx <= triangle.maxX / OCCLUSION_TILE_WIDTH; tx++)
+			{
+				bins[ty * tilesX + tx].push_back(i);
+			}
+		}
+	}
+
+	// Tiles never share pixels, so workers can each take every Nth one
+	unsigned int tileCount = (unsigned int)bins.size();
+	unsigned int workers = triangleCount >= PARALLEL_OCCLUSION_TRIANGLES ? threadCount : 1;
+	if (workers > tileCount) workers = tileCount;
+	RunParallel(workers, [&](unsigned int t)
+	{
+		for (unsigned int tile = t; tile < tileCount; tile += workers)
+		{
+			RasterizeTile(tile);
+		}
+	});
+
+	BuildPyramid();
+}
+
+void OcclusionCuller::AddClipTriangle(const XMFLOAT4 clip[3])
+{
+	// Entirely outside one of the side or far planes?
+	int outside[5] = { 0, 0, 0, 0, 0 };
+	for (int v = 0; v < 3; v++)
+	{
+		outside[0] += clip[v].x < -clip[v].w;
+		outside[1] += clip[v].x > clip[v].w;
+		outside[2] += clip[v].y < -clip[v].w;
+		outside[3] += clip[v].y > clip[v].w;
+		outside[4] += clip[v].z > clip[v].w;
+	}
+	for (int p = 0; p < 5; p++)
+	{
+		if (outside[p] == 3) return;
+	}
+
+	// Clip at the near plane (z = 0 in D3D), leaving up to a quad
+	XMFLOAT4 polygon[4];
+	int count = 0;
+	for (int v = 0; v < 3; v++)
+	{
+		const XMFLOAT4& a = clip[v];
+		const XMFLOAT4& b = clip[(v + 1) % 3];
+		if (a.z >= 0) polygon[count++] = a;
+		if ((a.z >= 0) != (b.z >= 0))
+		{
+			float t = a.z / (a.z - b.z);
+			polygon[count++] = XMFLOAT4(
+				a.x + (b.x - a.x) * t,
+				a.y + (b.y - a.y) * t,
+				0,
+				a.w + (b.w - a.w) * t);
+		}
+	}
+
+	// Fan it back out, keeping the winding
+	for (int v = 2; v < count; v++)
+	{
+		XMFLOAT4 fan[3] = { polygon[0], polygon[v - 1], polygon[v] };
+		AddScreenTriangle(fan);
+	}
+}
+
+void OcclusionCuller::AddScreenTriangle(const XMFLOAT4 clip[3])
+{
+	ScreenTriangle triangle;
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	for (int v = 0; v < 3; v++)
+	{
+		float w = clip[v].w;
+		triangle.x[v] = (clip[v].x / w * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+		triangle.y[v] = (0.5f - clip[v].y / w * 0.5f) * OCCLUSION_HEIGHT;
+		triangle.z[v] = clip[v].z / w;
+
+		minX = fminf(minX, triangle.x[v]);
+		minY = fminf(minY, triangle.y[v]);
+		maxX = fmaxf(maxX, triangle.x[v]);
+		maxY = fmaxf(maxY, triangle.y[v]);
+	}
+
+	// Front faces are clockwise on screen, which is a positive area with y down
+	float area = (triangle.x[1] - triangle.x[0]) * (triangle.y[2] - triangle.y[0]) -
+		(triangle.x[2] - triangle.x[0]) * (triangle.y[1] - triangle.y[0]);
+	if (!(area > 0)) return;
+
+	// Pixels whose centers it could cover
+	minX = fmaxf(ceilf(minX - 0.5f), 0);
+	minY = fmaxf(ceilf(minY - 0.5f), 0);
+	maxX = fminf(floorf(maxX - 0.5f), OCCLUSION_WIDTH - 1);
+	maxY = fminf(floorf(maxY - 0.5f), OCCLUSION_HEIGHT - 1);
+	if (minX > maxX || minY > maxY) return;
+
+	triangle.minX = (int)minX;
+	triangle.minY = (int)minY;
+	triangle.maxX = (int)maxX;
+	triangle.maxY = (int)maxY;
+	triangles.push_back(triangle);
+}
+
+void OcclusionCuller::RasterizeTile(unsigned int tile)
+{
+	const unsigned int tilesX = OCCLUSION_WIDTH / OCCLUSION_TILE_WIDTH;
+	int tileX = (tile % tilesX) * OCCLUSION_TILE_WIDTH;
+	int tileY = (tile / tilesX) * OCCLUSION_TILE_HEIGHT;
+
+	// Start from far away, so a tile nothing touches is already done
+	std::vector<float>& depth = levels[0].depth;
+	for (int y = tileY; y < tileY + OCCLUSION_TILE_HEIGHT; y++)
+	{
+		for (int x = tileX; x < tileX + OCCLUSION_TILE_WIDTH; x += 4)
+		{
+			_mm_storeu_ps(&depth[y * OCCLUSION_WIDTH + x], _mm_set1_ps(1.0f));
+		}
+	}
+
+	const std::vector<unsigned int>& bin = bins[tile];
+	for (size_t i = 0; i < bin.size(); i++)
+	{
+		RasterizeTriangle(triangles[bin[i]], tileX, tileY);
+	}
+}
+
+void OcclusionCuller::RasterizeTriangle(const ScreenTriangle& triangle, int tileX, int tileY)
+{
+	const float* x = triangle.x;
+	const float* y = triangle.y;
+	const float* z = triangle.z;
+
+	// Edge functions a*px + b*py + c, positive on the inside
+	float a[3], b[3], c[3];
+	for (int e = 0; e < 3; e++)
+	{
+		int n = (e + 1) % 3;
+		a[e] = y[e] - y[n];
+		b[e] = x[n] - x[e];
+		c[e] = -(a[e] * x[e] + b[e] * y[e]);
+	}
+
+	// Depth is a plane in screen space.  Each pixel takes the farthest the
+	// plane gets anywhere inside it (but never past the farthest corner),
+	// so the buffer never claims the triangle is nearer than it is.
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	float dzdx = ((z[1] - z[0]) * (y[2] - y[0]) - (z[2] - z[0]) * (y[1] - y[0])) / area;
+	float dzdy = ((z[2] - z[0]) * (x[1] - x[0]) - (z[1] - z[0]) * (x[2] - x[0])) / area;
+	float zSlack = 0.5f * (fabsf(dzdx) + fabsf(dzdy));
+	float zOrigin = z[0] - dzdx * x[0] - dzdy * y[0] + zSlack;
+	float zFarthest = fmaxf(z[0], fmaxf(z[1], z[2]));
+
+	// Tiles start on a multiple of 4, so aligning down stays inside this one
+	int firstX = (triangle.minX > tileX ? triangle.minX : tileX) & ~3;
+	int lastX = triangle.maxX < tileX + OCCLUSION_TILE_WIDTH - 1 ? triangle.maxX : tileX + OCCLUSION_TILE_WIDTH - 1;
+	int firstY = triangle.minY > tileY ? triangle.minY : tileY;
+	int lastY = triangle.maxY < tileY + OCCLUSION_TILE_HEIGHT - 1 ? triangle.maxY : tileY + OCCLUSION_TILE_HEIGHT - 1;
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 a0 = _mm_set1_ps(a[0]), a1 = _mm_set1_ps(a[1]), a2 = _mm_set1_ps(a[2]);
+	const __m128 zStep = _mm_set1_ps(dzdx);
+	const __m128 zMax = _mm_set1_ps(zFarthest);
+
+	float* depth = &levels[0].depth[0];
+	for (int py = firstY; py <= lastY; py++)
+	{
+		// Everything that only changes per row
+		float centerY = py + 0.5f;
+		__m128 row0 = _mm_set1_ps(b[0] * centerY + c[0]);
+		__m128 row1 = _mm_set1_ps(b[1] * centerY + c[1]);
+		__m128 row2 = _mm_set1_ps(b[2] * centerY + c[2]);
+		__m128 rowZ = _mm_set1_ps(dzdy * centerY + zOrigin);
+
+		float* pixels = &depth[py * OCCLUSION_WIDTH];
+		for (int px = firstX; px <= lastX; px += 4)
+		{
+			__m128 centerX = _mm_add_ps(_mm_set1_ps((float)px), laneOffsets);
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(a0, centerX), row0);
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(a1, centerX), row1);
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(a2, centerX), row2);
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+			if (_mm_movemask_ps(inside) == 0) continue;
+
+			__m128 triangleZ = _mm_min_ps(_mm_add_ps(_mm_mul_ps(zStep, centerX), rowZ), zMax);
+			__m128 old = _mm_loadu_ps(&pixels[px]);
+			__m128 nearer = _mm_min_ps(old, triangleZ);
+			_mm_storeu_ps(&pixels[px], _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, old)));
+		}
+	}
+}
+
+void OcclusionCuller::BuildPyramid()
+{
+	for (size_t l = 1; l < levels.size(); l++)
+	{
+		const PyramidLevel& source = levels[l - 1];
+		PyramidLevel& level = levels[l];
+
+		for (unsigned int y = 0; y < level.height; y++)
+		{
+			// An odd last row or column just repeats itself
+			unsigned int y0 = y * 2;
+			unsigned int y1 = y0 + 1 < source.height ? y0 + 1 : y0;
+			const float* top = &source.depth[y0 * source.width];
+			const float* bottom = &source.depth[y1 * source.width];
+			float* out = &level.depth[y * level.width];
+
+			// Four texels out of each 8 wide pair of rows
+			unsigned int x = 0;
+			for (; x + 4 <= level.width && x * 2 + 8 <= source.width; x += 4)
+			{
+				__m128 left = _mm_max_ps(_mm_loadu_ps(&top[x * 2]), _mm_loadu_ps(&bottom[x * 2]));
+				__m128 right = _mm_max_ps(_mm_loadu_ps(&top[x * 2 + 4]), _mm_loadu_ps(&bottom[x * 2 + 4]));
+				__m128 even = _mm_shuffle_ps(left, right, _MM_SHUFFLE(2, 0, 2, 0));
+				__m128 odd = _mm_shuffle_ps(left, right, _MM_SHUFFLE(3, 1, 3, 1));
+				_mm_storeu_ps(&out[x], _mm_max_ps(even, odd));
+			}
+			for (; x < level.width; x++)
+			{
+				unsigned int x0 = x * 2;
+				unsigned int x1 = x0 + 1 < source.width ? x0 + 1 : x0;
+				out[x] = fmaxf(fmaxf(top[x0], top[x1]), fmaxf(bottom[x0], bottom[x1]));
+			}
+		}
+	}
+}
+
+bool OcclusionCuller::IsOccluded(XMFLOAT3 center, XMFLOAT3 extents)
+{
+	XMMATRIX m = XMLoadFloat4x4(&viewProjection);
+	XMVECTOR clipCenter = XMVector3Transform(XMLoadFloat3(&center), m);
+	XMVECTOR axisX = XMVectorScale(m.r[0], extents.x);
+	XMVECTOR axisY = XMVectorScale(m.r[1], extents.y);
+	XMVECTOR axisZ = XMVectorScale(m.r[2], extents.z);
+
+	// Screen rect and nearest depth of the box's corners
+	float minX = FLT_MAX, minY = FLT_MAX, maxX = -FLT_MAX, maxY = -FLT_MAX;
+	float nearest = FLT_MAX;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		XMVECTOR clip = clipCenter;
+		clip = (corner & 1) ? XMVectorAdd(clip, axisX) : XMVectorSubtract(clip, axisX);
+		clip = (corner & 2) ? XMVectorAdd(clip, axisY) : XMVectorSubtract(clip, axisY);
+		clip = (corner & 4) ? XMVectorAdd(clip, axisZ) : XMVectorSubtract(clip, axisZ);
+
+		XMFLOAT4 c;
+		XMStoreFloat4(&c, clip);
+		if (c.z < 0) return false;
+
+		float x = (c.x / c.w * 0.5f + 0.5f) * OCCLUSION_WIDTH;
+		float y = (0.5f - c.y / c.w * 0.5f) * OCCLUSION_HEIGHT;
+		minX = fminf(minX, x);
+		minY = fminf(minY, y);
+		maxX = fmaxf(maxX, x);
+		maxY = fmaxf(maxY, y);
+		nearest = fminf(nearest, c.z / c.w);
+	}
+
+	// Every pixel the rect overlaps at all
+	int x0 = (int)fmaxf(floorf(minX), 0);
+	int y0 = (int)fmaxf(floorf(minY), 0);
+	int x1 = (int)fminf(ceilf(maxX) - 1, OCCLUSION_WIDTH - 1);
+	int y1 = (int)fminf(ceilf(maxY) - 1, OCCLUSION_HEIGHT - 1);
+	if (x0 > x1 || y0 > y1) return false;
+
+	// Go up until the rect is at most 2 texels across
+	unsigned int level = 0;
+	while (level + 1 < levels.size() && ((x1 >> level) - (x0 >> level) > 1 || (y1 >> level) - (y0 >> level) > 1))
+	{
+		level++;
+	}
+
+	const PyramidLevel& hiZ = levels[level];
+	for (int y = y0 >> level; y <= y1 >> level; y++)
+	{
+		for (int x = x0 >> level; x <= x1 >> level; x++)
+		{
+			if (hiZ.depth[y * hiZ.width + x] >= nearest) return false;
+		}
+	}
+	return true;
+}
+
+unsigned int OcclusionCuller::Cull(std::vector<unsigned char>& visible)
+{
+	unsigned int count = (unsigned int)visible.size();
+	if (count == 0 || triangleCount == 0) return 0;
+
+	unsigned int workers = count >= PARALLEL_OCCLUSION_TESTS ? threadCount : 1;
+	unsigned int chunk = (count + workers - 1) / workers;
+
+	std::vector<unsigned int> occludedCounts(workers, 0);
+	RunParallel(workers, [&](unsigned int t)
+	{
+		unsigned int first = t * chunk;
+		unsigned int last = first + chunk < count ? first + chunk : count;
+		for (unsigned int i = first; i < last; i++)
+		{
+			if (!visible[i] || !culling->HasBounds(i)) continue;
+			if (IsOccluded(culling->GetWorldCenter(i), culling->GetWorldExtents(i)))
+			{
+				visible[i] = 0;
+				occludedCounts[t]++;
+			}
+		}
+	});
+
+	unsigned int total = 0;
+	for (unsigned int t = 0; t < workers; t++)
+	{
+		total += occludedCounts[t];
+	}
+	return total;
+}
@@ -0,0 +1,116 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <xmmintrin.h>
+
+#include "TransformSystem.h"
+#include "CullingSystem.h"
+
+// Size of the software depth buffer, and of the tiles it's rasterized in.
+// Rows of a tile are a multiple of 4 wide, so they fill whole SSE registers.
+#define OCCLUSION_WIDTH 256
+#define OCCLUSION_HEIGHT 128
+#define OCCLUSION_TILE_WIDTH 32
+#define OCCLUSION_TILE_HEIGHT 16
+
+// --------------------------------------------------------
+// Software occlusion culling against a few big occluders
+// (gallery walls, room shells, large paintings).
+//
+// Each frame the occluders in view are transformed, clipped
+// at the near plane, back face culled like the real draw
+// and binned into screen tiles.  Tiles are rasterized in
+// parallel, 4 pixels at a time with SSE, into a small depth
+// buffer that keeps the farthest depth each triangle could
+// have anywhere in a pixel.  A pyramid of max depths is then
+// built over it.
+//
+// An object is occluded when the nearest corner of its world
+// box is farther than every pyramid texel its screen rect
+// touches, at the level where that rect is only a couple of
+// texels wide.  Boxes that reach behind the camera always
+// pass.
+//
+// Bounds come from the CullingSystem, so it only works on
+// transforms with bounds and runs after the frustum cull.
+// No D3D in here, so it can run headless.
+// --------------------------------------------------------
+class OcclusionCuller
+{
+public:
+	OcclusionCuller(TransformSystem* transforms, CullingSystem* culling);
+	~OcclusionCuller();
+
+	// Triangle list positions in the transform's local space (three per
+	// triangle, front faces clockwise, like the meshes).  The positions
+	// must outlive the occluder.
+	void AddOccluder(unsigned int transform, const DirectX::XMFLOAT3* positions, unsigned int triangleCount);
+	void ClearOccluders();
+	unsigned int GetOccluderCount() { return (unsigned int)occluders.size(); }
+
+	// Rasterizes every occluder whose visible flag is set (the frustum
+	// cull's output) and builds the depth pyramid
+	void Render(DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 projection, const std::vector<unsigned char>& visible);
+
+	// Clears the flag of every visible, bounded transform hidden behind
+	// the last Render()'s occluders.  Returns how many that was.
+	unsigned int Cull(std::vector<unsigned char>& visible);
+
+	// Is this world box hidden by the last Render()?
+	bool IsOccluded(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents);
+
+	// Farthest occluder depth (0 near, 1 far) of a pixel at a pyramid level
+	float GetDepth(unsigned int level, unsigned int x, unsigned int y);
+	unsigned int GetLevelCount() { return (unsigned int)levels.size(); }
+	unsigned int GetRasterizedTriangleCount() { return triangleCount; }
+
+	void SetThreadCount(unsigned int threads);
+	unsigned int GetThreadCount() { return threadCount; }
+
+private:
+	struct Occluder
+	{
+		unsigned int transform;
+		const DirectX::XMFLOAT3* positions;
+		unsigned int triangleCount;
+	};
+
+	// Pixel space (y down), depth already divided through
+	struct ScreenTriangle
+	{
+		float x[3];
+		float y[3];
+		float z[3];
+		int minX, minY, maxX, maxY;
+	};
+
+	struct PyramidLevel
+	{
+		unsigned int width;
+		unsigned int height;
+		std::vector<float> depth;
+	};
+
+	void AddClipTriangle(const DirectX::XMFLOAT4 clip[3]);
+	void AddScreenTriangle(const DirectX::XMFLOAT4 clip[3]);
+	void RasterizeTile(unsigned int tile);
+	void RasterizeTriangle(const ScreenTriangle& triangle, int tileX, int tileY);
+	void BuildPyramid();
+
+	TransformSystem* transforms;
+	CullingSystem* culling;
+	unsigned int threadCount;
+
+	std::vector<Occluder> occluders;
+
+	// This frame's camera, rows of (world * view * projection) untransposed
+	DirectX::XMFLOAT4X4 viewProjection;
+
+	// Triangles after setup, and which of them touch each tile
+	std::vector<ScreenTriangle> triangles;
+	std::vector<std::vector<unsigned int> > bins;
+	unsigned int triangleCount;
+
+	// Level 0 is the depth buffer itself
+	std::vector<PyramidLevel> levels;
+};
@@ -0,0 +1,106 @@
+#include "Parallel.h"
+
+WorkerPool* WorkerPool::Get()
+{
+	// Started on first use, stopped at exit
+	static WorkerPool pool;
+	return &pool;
+}
+
+WorkerPool::WorkerPool()
+{
+	busy = false;
+	job = nullptr;
+	data = nullptr;
+	jobWorkers = 0;
+	pending = 0;
+	generation = 0;
+	stopping = false;
+}
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+
+	for (unsigned int t = 0; t < threads.size(); t++)
+	{
+		threads[t].join();
+	}
+}
+
+unsigned int WorkerPool::GetThreadCount()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return (unsigned int)threads.size();
+}
+
+void WorkerPool::Grow(unsigned int threadCount)
+{
+	// Thread t is worker t + 1; new threads skip the jobs before they started
+	std::lock_guard<std::mutex> lock(mutex);
+	while (threads.size() < threadCount)
+	{
+		threads.push_back(std::thread(&WorkerPool::WorkerLoop, this, (unsigned int)threads.size() + 1, generation));
+	}
+}
+
+void WorkerPool::Run(unsigned int workers, void (*job)(void*, unsigned int), void* data)
+{
+	// Already running a job (maybe this one); no one is free to help
+	if (workers <= 1 || busy.exchange(true))
+	{
+		for (unsigned int t = 0; t < workers; t++)
+		{
+			job(data, t);
+		}
+		return;
+	}
+
+	Grow(workers - 1);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		this->job = job;
+		this->data = data;
+		jobWorkers = workers;
+		pending = workers - 1;
+		generation++;
+	}
+	wake.notify_all();
+
+	job(data, 0);
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [&]() { return pending == 0; });
+	}
+	busy = false;
+}
+
+void WorkerPool::WorkerLoop(unsigned int worker, unsigned int generation)
+{
+	unsigned int seen = generation;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		wake.wait(lock, [&]() { return stopping || this->generation != seen; });
+		if (stopping) return;
+		seen = this->generation;
+
+		// Jobs smaller than the pool leave the higher workers asleep
+		if (worker >= jobWorkers) continue;
+
+		void (*job)(void*, unsigned int) = this->job;
+		void* data = this->data;
+		lock.unlock();
+		job(data, worker);
+		lock.lock();
+
+		if (--pending == 0) done.notify_one();
+	}
+}
@@ -0,0 +1,62 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// --------------------------------------------------------
+// Worker threads shared by every parallel loop.  They are
+// started the first time a job asks for them, grow to the
+// most workers any job has asked for, and sleep on a
+// condition variable between jobs.
+//
+// One job runs at a time.  A job started while another is
+// running (from inside a worker, or from another thread)
+// runs serially on the thread that started it.
+// --------------------------------------------------------
+class WorkerPool
+{
+public:
+	static WorkerPool* Get();
+	~WorkerPool();
+
+	// Runs job(data, worker) on [0, workers), using the calling thread as worker 0
+	void Run(unsigned int workers, void (*job)(void*, unsigned int), void* data);
+
+	// Threads started so far (not counting callers)
+	unsigned int GetThreadCount();
+
+private:
+	WorkerPool();
+	void Grow(unsigned int threadCount);
+	void WorkerLoop(unsigned int worker, unsigned int generation);
+
+	std::vector<std::thread> threads;
+	std::atomic<bool> busy;
+
+	// The current job, all guarded by mutex
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::condition_variable done;
+	void (*job)(void*, unsigned int);
+	void* data;
+	unsigned int jobWorkers;
+	unsigned int pending;
+	unsigned int generation;
+	bool stopping;
+};
+
+// Runs func(worker) on [0, workers), using the calling thread as worker 0
+template<typename Func>
+void RunParallel(unsigned int workers, Func func)
+{
+	WorkerPool::Get()->Run(workers, [](void* data, unsigned int worker) { (*(Func*)data)(worker); }, &func);
+}
+
+// Default worker count for RunParallel (never 0)
+inline unsigned int GetHardwareThreadCount()
+{
+	unsigned int threads = std::thread::hardware_concurrency();
+	return threads > 0 ? threads : 1;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <DirectXMath.h>
+
+// Default random x/z spread at spawn, for every kind of emitter: the
+// number of angles particles can fly at (odd and > 0), and how calm
+// they are (higher is calmer)
+#define PARTICLE_SPREAD_ANGLES 91
+#define PARTICLE_SPREAD_CALMNESS 10000.0f
+
+// --------------------------------------------------------
+// Simulation state of a single particle
+// --------------------------------------------------------
+struct Particle
+{
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT3 previousPosition;		// Before the last simulated tick; frames draw in between
+	DirectX::XMFLOAT4 color;
+	DirectX::XMFLOAT3 velocity;
+	float size;
+	float age;
+	bool killed;		// Removed by a collision, waiting for its lifetime to run out
+};
+
+// --------------------------------------------------------
+// One corner of a particle's camera-facing quad
+// --------------------------------------------------------
+struct ParticleVertex
+{
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT2 uv;
+	DirectX::XMFLOAT4 color;
+	float size;
+};
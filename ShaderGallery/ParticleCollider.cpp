@@ -0,0 +1,169 @@
+#include "ParticleCollider.h"
+
+#include <float.h>
+#include <math.h>
+#include <xmmintrin.h>
+
+ParticleCollider::ParticleCollider(
+	ParticleCollisionResponse response,
+	const std::vector<BoundingBox*>& rooms,
+	float floorHeight,
+	float restitution)
+{
+	this->response = response;
+	this->rooms = rooms;
+	this->floorHeight = floorHeight;
+	this->restitution = restitution;
+}
+
+ParticleCollider::~ParticleCollider()
+{
+}
+
+void ParticleCollider::Prefilter(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 halfSize)
+{
+	minX.clear();
+	maxX.clear();
+	minZ.clear();
+	maxZ.clear();
+
+	for (unsigned int i = 0; i < rooms.size(); i++)
+	{
+		XMFLOAT3 roomCenter = rooms[i]->GetCenter();
+		XMFLOAT3 roomHalfSize = rooms[i]->GetHalfSize();
+
+		// Rooms are flat boxes on the XZ plane
+		if (fabsf(roomCenter.x - center.x) > roomHalfSize.x + halfSize.x) continue;
+		if (fabsf(roomCenter.z - center.z) > roomHalfSize.z + halfSize.z) continue;
+
+		minX.push_back(roomCenter.x - roomHalfSize.x);
+		maxX.push_back(roomCenter.x + roomHalfSize.x);
+		minZ.push_back(roomCenter.z - roomHalfSize.z);
+		maxZ.push_back(roomCenter.z + roomHalfSize.z);
+	}
+}
+
+void ParticleCollider::Collide(Particle* particles, unsigned int count)
+{
+	const __m128 floor = _mm_set1_ps(floorHeight);
+	unsigned int roomCount = (unsigned int)minX.size();
+
+	unsigned int i = 0;
+	for (; i + 4 <= count; i += 4)
+	{
+		Particle* p = &particles[i];
+		__m128 x = _mm_setr_ps(p[0].position.x, p[1].position.x, p[2].position.x, p[3].position.x);
+		__m128 y = _mm_setr_ps(p[0].position.y, p[1].position.y, p[2].position.y, p[3].position.y);
+		__m128 z = _mm_setr_ps(p[0].position.z, p[1].position.z, p[2].position.z, p[3].position.z);
+
+		// Inside if above the floor and in any room (no rooms means no walls)
+		__m128 inRoom = roomCount > 0 ? _mm_setzero_ps() : _mm_cmpge_ps(x, x);
+		for (unsigned int r = 0; r < roomCount; r++)
+		{
+			__m128 inX = _mm_and_ps(_mm_cmpge_ps(x, _mm_set1_ps(minX[r])), _mm_cmple_ps(x, _mm_set1_ps(maxX[r])));
+			__m128 inZ = _mm_and_ps(_mm_cmpge_ps(z, _mm_set1_ps(minZ[r])), _mm_cmple_ps(z, _mm_set1_ps(maxZ[r])));
+			inRoom = _mm_or_ps(inRoom, _mm_and_ps(inX, inZ));
+		}
+
+		int inside = _mm_movemask_ps(_mm_and_ps(inRoom, _mm_cmpge_ps(y, floor)));
+
+		// Nearly every group is entirely inside
+		if (inside == 0xF) continue;
+
+		for (unsigned int j = 0; j < 4; j++)
+		{
+			if (!(inside & (1 << j))) Resolve(p[j]);
+		}
+	}
+
+	// Leftovers
+	for (; i < count; i++)
+	{
+		if (Outside(particles[i])) Resolve(particles[i]);
+	}
+}
+
+bool ParticleCollider::Outside(const Particle& particle)
+{
+	XMFLOAT3 p = particle.position;
+	if (p.y < floorHeight) return true;
+	if (minX.empty()) return false;
+
+	for (unsigned int r = 0; r < minX.size(); r++)
+	{
+		if (p.x >= minX[r] && p.x <= maxX[r] && p.z >= minZ[r] && p.z <= maxZ[r]) return false;
+	}
+
+	return true;
+}
+
+void ParticleCollider::Resolve(Particle& particle)
+{
+	// Already out of the picture
+	if (particle.killed) return;
+
+	if (response == PARTICLE_COLLISION_KILL)
+	{
+		// Particles die oldest first, so this one stays in its slot, invisible and
+		// frozen, until its lifetime runs out
+		particle.killed = true;
+		particle.velocity = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		particle.color = XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+		particle.size = 0.0f;
+		return;
+	}
+
+	// How far to move the particle to get it back inside
+	XMFLOAT3 push = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	XMFLOAT3 p = particle.position;
+
+	if (p.y < floorHeight)
+	{
+		push.y = floorHeight - p.y;
+	}
+
+	// Through a wall: head back into the closest room
+	bool inRoom = minX.empty();
+	for (unsigned int r = 0; r < minX.size() && !inRoom; r++)
+	{
+		inRoom = p.x >= minX[r] && p.x <= maxX[r] && p.z >= minZ[r] && p.z <= maxZ[r];
+	}
+
+	if (!inRoom)
+	{
+		float closest = FLT_MAX;
+		for (unsigned int r = 0; r < minX.size(); r++)
+		{
+			float dx = p.x < minX[r] ? minX[r] - p.x : (p.x > maxX[r] ? maxX[r] - p.x : 0.0f);
+			float dz = p.z < minZ[r] ? minZ[r] - p.z : (p.z > maxZ[r] ? maxZ[r] - p.z : 0.0f);
+
+			float distanceSq = dx * dx + dz * dz;
+			if (distanceSq < closest)
+			{
+				closest = distanceSq;
+				push.x = dx;
+				push.z = dz;
+			}
+		}
+	}
+
+	if (response == PARTICLE_COLLISION_STICK)
+	{
+		particle.position.x += push.x;
+		particle.position.y += push.y;
+		particle.position.z += push.z;
+		particle.velocity = XMFLOAT3(0.0f, 0.0f, 0.0f);
+		return;
+	}
+
+	// Bounce: mirror the overshoot back inside (damped) and reflect the
+	// velocity on every axis that crossed a surface
+	float scale = 1.0f + restitution;
+	particle.position.x += push.x * scale;
+	particle.position.y += push.y * scale;
+	particle.position.z += push.z * scale;
+
+	if (push.x != 0.0f) particle.velocity.x = -particle.velocity.x * restitution;
+	if (push.y != 0.0f) particle.velocity.y = -particle.velocity.y * restitution;
+	if (push.z != 0.0f) particle.velocity.z = -particle.velocity.z * restitution;
+}
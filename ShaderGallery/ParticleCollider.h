@@ -0,0 +1,60 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+#include "BoundingBox.h"
+#include "Particle.h"
+
+// What happens to a particle that leaves the rooms or goes through the floor
+enum ParticleCollisionResponse
+{
+	PARTICLE_COLLISION_BOUNCE,	// Pushed back inside with its velocity reflected
+	PARTICLE_COLLISION_STICK,	// Pushed back inside and stopped dead
+	PARTICLE_COLLISION_KILL		// Hidden until its lifetime runs out
+};
+
+// --------------------------------------------------------
+// Keeps an emitter's particles inside the gallery.
+//
+// The walkable area is the union of the worldBounds room
+// boxes (on the XZ plane, like the camera uses) above a
+// floor height. Only the boxes that overlap the emitter's
+// bounds are tested, and particles are tested 4 at a time:
+// each group's positions are gathered into SSE registers,
+// and only particles that turn out to be outside go through
+// the scalar response.
+// --------------------------------------------------------
+class ParticleCollider
+{
+public:
+	ParticleCollider(
+		ParticleCollisionResponse response,
+		const std::vector<BoundingBox*>& rooms,
+		float floorHeight,
+		float restitution);
+	~ParticleCollider();
+
+	// Keeps only the rooms that overlap the given (emitter) bounds
+	void Prefilter(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 halfSize);
+
+	// Tests and resolves a contiguous run of particles
+	void Collide(Particle* particles, unsigned int count);
+
+	unsigned int GetRoomCount() { return (unsigned int)minX.size(); }
+
+private:
+	bool Outside(const Particle& particle);
+	void Resolve(Particle& particle);
+
+	ParticleCollisionResponse response;
+	float floorHeight;
+	float restitution;
+
+	std::vector<BoundingBox*> rooms;
+
+	// Prefiltered rooms, one array per edge
+	std::vector<float> minX;
+	std::vector<float> maxX;
+	std::vector<float> minZ;
+	std::vector<float> maxZ;
+};
@@ -0,0 +1,117 @@
+#include "ParticleCurves.h"
+#include <math.h>
+
+using namespace DirectX;
+
+ParticleCurves::ParticleCurves(float lifetime)
+{
+	this->lifetime = lifetime;
+	indexScale = (PARTICLE_CURVE_RESOLUTION - 1) / lifetime;
+
+	// Flat curves until someone sets them
+	ParticleColorKey white = { 0.0f, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f) };
+	ParticleCurveKey one = { 0.0f, 1.0f };
+	SetColorGradient(&white, 1);
+	SetSizeCurve(&one, 1);
+	SetSpeedCurve(&one, 1);
+	hasSpeedCurve = false;
+}
+
+ParticleCurves::~ParticleCurves()
+{
+}
+
+// Piecewise linear interpolation between the keys
+float ParticleCurves::Evaluate(const ParticleCurveKey* keys, unsigned int count, float time)
+{
+	if (time <= keys[0].time) return keys[0].value;
+
+	for (unsigned int i = 1; i < count; i++)
+	{
+		if (time <= keys[i].time)
+		{
+			float span = keys[i].time - keys[i - 1].time;
+			float t = span > 0.0f ? (time - keys[i - 1].time) / span : 1.0f;
+			return keys[i - 1].value + (keys[i].value - keys[i - 1].value) * t;
+		}
+	}
+
+	return keys[count - 1].value;
+}
+
+void ParticleCurves::SetColorGradient(const ParticleColorKey* keys, unsigned int count)
+{
+	for (unsigned int i = 0; i < PARTICLE_CURVE_RESOLUTION; i++)
+	{
+		float time = (float)i / (PARTICLE_CURVE_RESOLUTION - 1);
+
+		// Find the keys either side and lerp between them
+		unsigned int next = 0;
+		while (next < count && keys[next].time < time) next++;
+
+		if (next == 0)
+		{
+			colors[i] = keys[0].color;
+		}
+		else if (next == count)
+		{
+			colors[i] = keys[count - 1].color;
+		}
+		else
+		{
+			float span = keys[next].time - keys[next - 1].time;
+			float t = span > 0.0f ? (time - keys[next - 1].time) / span : 1.0f;
+			XMStoreFloat4(
+				&colors[i],
+				XMVectorLerp(
+					XMLoadFloat4(&keys[next - 1].color),
+					XMLoadFloat4(&keys[next].color),
+					t));
+		}
+	}
+
+	colorConstant = true;
+	for (unsigned int i = 1; i < count; i++)
+	{
+		if (XMVector4NotEqual(XMLoadFloat4(&keys[i].color), XMLoadFloat4(&keys[0].color)))
+		{
+			colorConstant = false;
+		}
+	}
+}
+
+void ParticleCurves::SetSizeCurve(const ParticleCurveKey* keys, unsigned int count)
+{
+	maxSize = 0.0f;
+	for (unsigned int i = 0; i < PARTICLE_CURVE_RESOLUTION; i++)
+	{
+		sizes[i] = Evaluate(keys, count, (float)i / (PARTICLE_CURVE_RESOLUTION - 1));
+		if (fabsf(sizes[i]) > maxSize) maxSize = fabsf(sizes[i]);
+	}
+
+	sizeConstant = true;
+	for (unsigned int i = 1; i < count; i++)
+	{
+		if (keys[i].value != keys[0].value) sizeConstant = false;
+	}
+}
+
+void ParticleCurves::SetSpeedCurve(const ParticleCurveKey* keys, unsigned int count)
+{
+	for (unsigned int i = 0; i < PARTICLE_CURVE_RESOLUTION; i++)
+	{
+		speeds[i] = Evaluate(keys, count, (float)i / (PARTICLE_CURVE_RESOLUTION - 1));
+	}
+
+	// Trapezoid rule for the distance covered by each entry's age
+	float step = lifetime / (PARTICLE_CURVE_RESOLUTION - 1);
+	distances[0] = 0.0f;
+	maxDistance = 0.0f;
+	for (unsigned int i = 1; i < PARTICLE_CURVE_RESOLUTION; i++)
+	{
+		distances[i] = distances[i - 1] + (speeds[i - 1] + speeds[i]) * 0.5f * step;
+		if (fabsf(distances[i]) > maxDistance) maxDistance = fabsf(distances[i]);
+	}
+
+	hasSpeedCurve = true;
+}
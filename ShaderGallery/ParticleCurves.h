@@ -0,0 +1,84 @@
+#pragma once
+#include <DirectXMath.h>
+
+// Entries in each baked table, spread evenly over a particle's lifetime
+#define PARTICLE_CURVE_RESOLUTION 256
+
+// A gradient key; time is the fraction of the lifetime (0 to 1)
+struct ParticleColorKey
+{
+	float time;
+	DirectX::XMFLOAT4 color;
+};
+
+struct ParticleCurveKey
+{
+	float time;
+	float value;
+};
+
+// --------------------------------------------------------
+// Attribute-over-lifetime curves for an emitter.
+//
+// Multi-key color, size and speed curves are baked into
+// lookup tables once, so per particle an attribute costs a
+// multiply-add (age to table index) and a load, no matter
+// how many keys the curve has.
+//
+// The speed curve scales a particle's velocity over its
+// life; its running integral is baked alongside so the
+// distance travelled by any age can be looked up directly.
+// --------------------------------------------------------
+class ParticleCurves
+{
+public:
+	ParticleCurves(float lifetime);
+	~ParticleCurves();
+
+	// Keys must be sorted by time; anything before the first key or
+	// after the last holds that key's value
+	void SetColorGradient(const ParticleColorKey* keys, unsigned int count);
+	void SetSizeCurve(const ParticleCurveKey* keys, unsigned int count);
+	void SetSpeedCurve(const ParticleCurveKey* keys, unsigned int count);
+	bool HasSpeedCurve() { return hasSpeedCurve; }
+
+	// Table index for an age in seconds
+	unsigned int GetIndex(float age)
+	{
+		int index = (int)(age * indexScale + 0.5f);
+		if (index < 0) return 0;
+		if (index >= PARTICLE_CURVE_RESOLUTION) return PARTICLE_CURVE_RESOLUTION - 1;
+		return (unsigned int)index;
+	}
+
+	const DirectX::XMFLOAT4& GetColor(unsigned int index) { return colors[index]; }
+	float GetSize(unsigned int index) { return sizes[index]; }
+	float GetSpeed(unsigned int index) { return speeds[index]; }
+
+	// Seconds of full-speed travel covered by this table entry's age
+	float GetDistance(unsigned int index) { return distances[index]; }
+
+	// True when the curve has the same value all the way through
+	bool IsColorConstant() { return colorConstant; }
+	bool IsSizeConstant() { return sizeConstant; }
+
+	// Extremes over the whole lifetime, for bounds
+	float GetMaxSize() { return maxSize; }
+	float GetMaxDistance() { return maxDistance; }
+
+private:
+	float Evaluate(const ParticleCurveKey* keys, unsigned int count, float time);
+
+	float lifetime;
+	float indexScale;
+	bool hasSpeedCurve;
+	bool colorConstant;
+	bool sizeConstant;
+	float maxSize;
+	float maxDistance;
+
+	DirectX::XMFLOAT4 colors[PARTICLE_CURVE_RESOLUTION];
+	float sizes[PARTICLE_CURVE_RESOLUTION];
+	float speeds[PARTICLE_CURVE_RESOLUTION];
+	float distances[PARTICLE_CURVE_RESOLUTION];
+};
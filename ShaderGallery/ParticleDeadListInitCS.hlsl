@@ -0,0 +1,22 @@
+#include "ParticleGPUCommon.hlsli"
+
+cbuffer externalData : register(b0)
+{
+	uint maxParticles;
+};
+
+RWStructuredBuffer<Particle> Particles	: register(u0);
+AppendStructuredBuffer<uint> DeadList	: register(u1);
+
+// Marks every particle dead and puts it on the dead list
+[numthreads(32, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	if (id.x >= maxParticles) return;
+
+	Particle p = (Particle)0;
+	p.Age = DEAD_PARTICLE_AGE;
+	Particles[id.x] = p;
+
+	DeadList.Append(id.x);
+}
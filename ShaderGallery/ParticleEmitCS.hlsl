@@ -0,0 +1,52 @@
+#include "ParticleGPUCommon.hlsli"
+
+cbuffer externalData : register(b0)
+{
+	float3 emitterPosition;
+	float startSize;
+	float3 startVelocity;
+	float spread;
+	float4 startColor;
+	uint emitCount;
+	uint spawnBase;
+	uint randomKey;
+};
+
+// Filled by CopyStructureCount from the dead list
+cbuffer deadListCounter : register(b1)
+{
+	uint deadListCount;
+};
+
+RWStructuredBuffer<Particle> Particles	: register(u0);
+ConsumeStructuredBuffer<uint> DeadList	: register(u1);
+AppendStructuredBuffer<uint> DrawList	: register(u2);
+
+// One thread per new particle
+[numthreads(32, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	// Never consume more than the dead list holds
+	if (id.x >= emitCount || id.x >= deadListCount) return;
+
+	uint index = DeadList.Consume();
+	uint spawnId = spawnBase + id.x;
+
+	Particle p = (Particle)0;
+	p.Position = emitterPosition;
+	p.PreviousPosition = emitterPosition;
+	p.Age = 0.0f;
+	p.Size = startSize;
+	p.Color = startColor;
+	p.SpawnId = spawnId;
+
+	// Randomize the x/z velocity, because FIRE
+	precise float rx = RandomToFloat(RandomAt(randomKey, spawnId * 2)) * 2.0f - 1.0f;
+	precise float rz = RandomToFloat(RandomAt(randomKey, spawnId * 2 + 1)) * 2.0f - 1.0f;
+	p.Velocity = startVelocity;
+	p.Velocity.x = rx * spread;
+	p.Velocity.z = rz * spread;
+
+	Particles[index] = p;
+	DrawList.Append(index);
+}
@@ -0,0 +1,40 @@
+
+// Shared by the GPU particle kernels and the GPU particle vertex shader.
+// GPUParticleReference.cpp mirrors this file on the CPU; keep them in sync.
+
+// Must match GPUParticle in GPUParticle.h (64 bytes)
+struct Particle
+{
+	float3 Position;
+	float Age;
+	float3 Velocity;
+	float Size;
+	float4 Color;
+	uint SpawnId;
+	float3 PreviousPosition;		// Before the last update; frames draw in between
+};
+
+// Age given to dead particles so they never pass the lifetime test
+#define DEAD_PARTICLE_AGE 3.402823466e+38f
+
+// Same integer mix as Random::At() on the CPU
+uint RandomMix(uint x)
+{
+	x ^= x >> 16;
+	x *= 0x7FEB352Du;
+	x ^= x >> 15;
+	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+	return x;
+}
+
+uint RandomAt(uint key, uint counter)
+{
+	return RandomMix(RandomMix(counter ^ key) + key);
+}
+
+// Same as Random::ToFloat(); the top 24 bits convert exactly
+float RandomToFloat(uint bits)
+{
+	return (float)(bits >> 8) * (1.0f / 16777216.0f);
+}
@@ -0,0 +1,45 @@
+#include "ParticleGPUCommon.hlsli"
+
+cbuffer externalData : register(b0)
+{
+	matrix view;
+	matrix projection;
+	float alpha;		// How far between the last two updates to draw
+};
+
+StructuredBuffer<Particle> ParticleData	: register(t0);
+StructuredBuffer<uint> DrawList			: register(t1);
+
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : UV;
+	float4 color		: COLOR;
+};
+
+// No vertex buffer: each instance is one living particle,
+// and its six vertices build the quad's two triangles
+VertexToPixel main(uint vertexId : SV_VertexID, uint instanceId : SV_InstanceID)
+{
+	VertexToPixel output;
+
+	Particle p = ParticleData.Load(DrawList.Load(instanceId));
+
+	static const uint corners[6] = { 0, 1, 2, 0, 2, 3 };
+	static const float2 uvs[4] = { float2(0, 0), float2(1, 0), float2(1, 1), float2(0, 1) };
+	float2 uv = uvs[corners[vertexId]];
+
+	matrix viewProj = mul(view, projection);
+	float3 position = lerp(p.PreviousPosition, p.Position, alpha);
+	output.position = mul(float4(position, 1.0f), viewProj);
+
+	float2 offset = uv * 2 - 1;
+	offset *= p.Size;
+	offset.y *= -1;
+	output.position.xy += offset;
+
+	output.uv = uv;
+	output.color = p.Color;
+
+	return output;
+}
@@ -0,0 +1,19 @@
+#include "OIT.hlsli"
+
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : UV;
+	float4 color		: COLOR;
+};
+
+// Textures and such
+Texture2D particle		: register(t0);
+SamplerState trilinear	: register(s0);
+
+// Alpha blended particles, drawn in any order into the OIT targets
+OITOutput main(VertexToPixel input)
+{
+	// In the pixel shader, SV_POSITION.w is the view depth
+	return OITPack(particle.Sample(trilinear, input.uv) * input.color, input.position.w);
+}
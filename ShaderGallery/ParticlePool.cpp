@@ -0,0 +1,177 @@
+#include "ParticlePool.h"
+#include "Emitter.h"
+
+#include <string.h>
+
+using namespace DirectX;
+
+ParticlePool::ParticlePool(ID3D11Device* device, unsigned int particleBudget, ParticleOverflowPolicy policy)
+{
+	this->policy = policy;
+	viewPosition = XMFLOAT3(0, 0, 0);
+
+	// Round the budget up to whole blocks
+	blockCount = (particleBudget + PARTICLE_BLOCK_SIZE - 1) / PARTICLE_BLOCK_SIZE;
+	unsigned int particleCount = blockCount * PARTICLE_BLOCK_SIZE;
+
+	peakLeasedBlocks = 0;
+	blockOwners.resize(blockCount, nullptr);
+	for (unsigned int i = 0; i < blockCount; i++)
+	{
+		freeBlocks.push(i);
+	}
+
+	particles = new Particle[particleCount];
+
+	// UVs never change, so set them once for the whole pool
+	localParticleVertices = new ParticleVertex[4 * particleCount];
+	for (unsigned int i = 0; i < particleCount * 4; i += 4)
+	{
+		localParticleVertices[i + 0].uv = XMFLOAT2(0, 0);
+		localParticleVertices[i + 1].uv = XMFLOAT2(1, 0);
+		localParticleVertices[i + 2].uv = XMFLOAT2(1, 1);
+		localParticleVertices[i + 3].uv = XMFLOAT2(0, 1);
+	}
+
+	// Define the buffers
+	D3D11_BUFFER_DESC vbDesc = {};
+	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	vbDesc.Usage = D3D11_USAGE_DYNAMIC;
+	vbDesc.ByteWidth = sizeof(ParticleVertex) * 4 * particleCount;
+	device->CreateBuffer(&vbDesc, 0, &vertexBuffer);
+
+	// Index buffer data
+	unsigned int* indices = new unsigned int[particleCount * 6];
+	int indexCount = 0;
+	for (unsigned int i = 0; i < particleCount * 4; i += 4)
+	{
+		indices[indexCount++] = i;
+		indices[indexCount++] = i + 1;
+		indices[indexCount++] = i + 2;
+		indices[indexCount++] = i;
+		indices[indexCount++] = i + 2;
+		indices[indexCount++] = i + 3;
+	}
+	D3D11_SUBRESOURCE_DATA indexData = {};
+	indexData.pSysMem = indices;
+
+	// Regular index buffer
+	D3D11_BUFFER_DESC ibDesc = {};
+	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibDesc.CPUAccessFlags = 0;
+	ibDesc.Usage = D3D11_USAGE_DEFAULT;
+	ibDesc.ByteWidth = sizeof(unsigned int) * particleCount * 6;
+	device->CreateBuffer(&ibDesc, &indexData, &indexBuffer);
+
+	delete[] indices;
+}
+
+ParticlePool::~ParticlePool()
+{
+	delete[] particles;
+	delete[] localParticleVertices;
+	vertexBuffer->Release();
+	indexBuffer->Release();
+}
+
+void ParticlePool::Register(Emitter* emitter)
+{
+	emitters.push_back(emitter);
+}
+
+void ParticlePool::Unregister(Emitter* emitter)
+{
+	for (unsigned int i = 0; i < emitters.size(); i++)
+	{
+		if (emitters[i] == emitter)
+		{
+			emitters.erase(emitters.begin() + i);
+			return;
+		}
+	}
+}
+
+int ParticlePool::LeaseBlock(Emitter* requester)
+{
+	// Out of room?  Apply the overflow policy
+	if (freeBlocks.empty())
+	{
+		if (policy == PARTICLE_OVERFLOW_DROP || StealBlock(requester) < 0)
+		{
+			return -1;
+		}
+	}
+
+	int block = freeBlocks.top();
+	freeBlocks.pop();
+	blockOwners[block] = requester;
+
+	if (GetLeasedBlockCount() > peakLeasedBlocks)
+	{
+		peakLeasedBlocks = GetLeasedBlockCount();
+	}
+
+	return block;
+}
+
+void ParticlePool::ReleaseBlock(int block)
+{
+	blockOwners[block] = nullptr;
+	freeBlocks.push(block);
+}
+
+int ParticlePool::StealBlock(Emitter* requester)
+{
+	XMVECTOR view = XMLoadFloat3(&viewPosition);
+	XMFLOAT3 position = requester->GetPosition();
+	float requesterDistance = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&position) - view));
+
+	// Only steal from emitters farther away than the one asking
+	Emitter* victim = nullptr;
+	float victimDistance = requesterDistance;
+	for (unsigned int i = 0; i < emitters.size(); i++)
+	{
+		if (emitters[i] == requester || emitters[i]->GetLeasedBlockCount() == 0) continue;
+
+		position = emitters[i]->GetPosition();
+		float distance = XMVectorGetX(XMVector3LengthSq(XMLoadFloat3(&position) - view));
+		if (distance > victimDistance)
+		{
+			victim = emitters[i];
+			victimDistance = distance;
+		}
+	}
+
+	if (!victim) return -1;
+
+	// The victim loses its oldest particles, which are the closest to dying anyway
+	victim->ReleaseOldestBlock();
+	return 0;
+}
+
+void ParticlePool::CopyToGPU(ID3D11DeviceContext* context)
+{
+	// Only upload up to the highest leased block
+	int highest = (int)blockCount - 1;
+	while (highest >= 0 && !blockOwners[highest])
+	{
+		highest--;
+	}
+
+	if (highest < 0) return;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+
+	memcpy(mapped.pData, localParticleVertices, sizeof(ParticleVertex) * 4 * PARTICLE_BLOCK_SIZE * (highest + 1));
+
+	context->Unmap(vertexBuffer, 0);
+}
+
+size_t ParticlePool::GetMemoryUsage()
+{
+	// CPU side particles and staging vertices, plus the GPU vertex and index buffers
+	size_t particleCount = (size_t)blockCount * PARTICLE_BLOCK_SIZE;
+	return particleCount * (sizeof(Particle) + 2 * 4 * sizeof(ParticleVertex) + 6 * sizeof(unsigned int));
+}
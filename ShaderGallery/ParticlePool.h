@@ -0,0 +1,82 @@
+#pragma once
+#include <d3d11.h>
+#include <DirectXMath.h>
+#include <functional>
+#include <queue>
+#include <vector>
+
+#include "Particle.h"
+
+class Emitter;
+
+// Number of particles in each block an emitter leases
+#define PARTICLE_BLOCK_SIZE 64
+
+// What to do when an emitter needs a block and none are free
+enum ParticleOverflowPolicy
+{
+	PARTICLE_OVERFLOW_DROP,		// The new particle simply isn't spawned
+	PARTICLE_OVERFLOW_STEAL		// Take the oldest block from the emitter farthest from the camera
+};
+
+// --------------------------------------------------------
+// Fixed-budget particle arena shared by every emitter.
+//
+// The budget is split into blocks of PARTICLE_BLOCK_SIZE
+// particles. Emitters lease blocks as they grow and hand
+// them back as their particles die, so memory is sized to
+// the whole scene rather than to each emitter's maximum.
+// The pool also owns the one dynamic vertex buffer and
+// index buffer all emitters draw from.
+// --------------------------------------------------------
+class ParticlePool
+{
+public:
+	ParticlePool(ID3D11Device* device, unsigned int particleBudget, ParticleOverflowPolicy policy);
+	~ParticlePool();
+
+	// Emitters that can be stolen from
+	void Register(Emitter* emitter);
+	void Unregister(Emitter* emitter);
+
+	// Returns a free block index, or -1 if the budget is exhausted
+	int LeaseBlock(Emitter* requester);
+	void ReleaseBlock(int block);
+
+	Particle* GetParticle(unsigned int index) { return &particles[index]; }
+	ParticleVertex* GetVertices(unsigned int index) { return &localParticleVertices[index * 4]; }
+
+	// Used to pick who to steal from
+	void SetViewPosition(DirectX::XMFLOAT3 viewPosition) { this->viewPosition = viewPosition; }
+
+	// Sends the vertices of every leased block to the GPU in one map
+	void CopyToGPU(ID3D11DeviceContext* context);
+
+	ID3D11Buffer* GetVertexBuffer() { return vertexBuffer; }
+	ID3D11Buffer* GetIndexBuffer() { return indexBuffer; }
+
+	// Stats
+	unsigned int GetBlockCount() { return blockCount; }
+	unsigned int GetLeasedBlockCount() { return blockCount - (unsigned int)freeBlocks.size(); }
+	unsigned int GetPeakLeasedBlockCount() { return peakLeasedBlocks; }
+	size_t GetMemoryUsage();
+
+private:
+	int StealBlock(Emitter* requester);
+
+	unsigned int blockCount;
+	unsigned int peakLeasedBlocks;
+	ParticleOverflowPolicy policy;
+	DirectX::XMFLOAT3 viewPosition;
+
+	// Free blocks, lowest index on top so the used range stays compact
+	std::priority_queue<int, std::vector<int>, std::greater<int>> freeBlocks;
+	std::vector<Emitter*> blockOwners;
+	std::vector<Emitter*> emitters;
+
+	// Storage for the whole budget
+	Particle* particles;
+	ParticleVertex* localParticleVertices;
+	ID3D11Buffer* vertexBuffer;
+	ID3D11Buffer* indexBuffer;
+};
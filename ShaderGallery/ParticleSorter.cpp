@@ -0,0 +1,244 @@
+#include "ParticleSorter.h"
+
+#include <algorithm>
+
+#include "Parallel.h"
+
+// Below this many particles the threads cost more than they save
+#define PARALLEL_SORT_THRESHOLD 16384
+
+// If the carried-over order has at most 1 in this many keys out of
+// place, an insertion sort is tried before the radix passes
+#define NEARLY_SORTED_RATIO 64
+
+// ...but one key out of place can still have to travel the whole
+// array, so the insertion sort gives up (and the radix passes take
+// over) after this many shifts per particle
+#define INSERTION_SHIFTS_PER_PARTICLE 4
+
+ParticleSorter::ParticleSorter(unsigned int capacity)
+{
+	this->capacity = capacity;
+	count = 0;
+	frame = 0;
+
+	threadCount = GetHardwareThreadCount();
+
+	aliveStamp.resize(capacity, 0);
+	keptStamp.resize(capacity, 0);
+	depthByIndex.resize(capacity, 0.0f);
+
+	order.reserve(capacity);
+	orderScratch.resize(capacity);
+	keys.resize(capacity);
+	keysScratch.resize(capacity);
+}
+
+ParticleSorter::~ParticleSorter()
+{
+}
+
+void ParticleSorter::SetThreadCount(unsigned int threads)
+{
+	threadCount = threads > 0 ? threads : 1;
+}
+
+void ParticleSorter::Reserve(unsigned int maxIndex)
+{
+	// Particle indices can be anywhere in the shared pool, so grow as needed
+	if (maxIndex < capacity) return;
+
+	capacity = maxIndex + 1;
+	aliveStamp.resize(capacity, 0);
+	keptStamp.resize(capacity, 0);
+	depthByIndex.resize(capacity, 0.0f);
+}
+
+void ParticleSorter::Sort(const unsigned int* living, const float* depths, unsigned int count)
+{
+	frame++;
+
+	unsigned int maxIndex = 0;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (living[i] > maxIndex) maxIndex = living[i];
+	}
+	Reserve(maxIndex);
+
+	// Mark who is alive this frame
+	for (unsigned int i = 0; i < count; i++)
+	{
+		aliveStamp[living[i]] = frame;
+		depthByIndex[living[i]] = depths[i];
+	}
+
+	// Keep last frame's order for the survivors...
+	unsigned int kept = 0;
+	for (unsigned int i = 0; i < this->count; i++)
+	{
+		unsigned int index = order[i];
+		if (aliveStamp[index] == frame)
+		{
+			order[kept++] = index;
+			keptStamp[index] = frame;
+		}
+	}
+	order.resize(kept);
+
+	// ...and tack the newly spawned particles onto the end
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (keptStamp[living[i]] != frame)
+		{
+			order.push_back(living[i]);
+		}
+	}
+
+	this->count = count;
+	if (count < 2) return;
+
+	// The scratch arrays need to hold everyone
+	if (keys.size() < count)
+	{
+		keys.resize(count);
+		keysScratch.resize(count);
+		orderScratch.resize(count);
+	}
+
+	BuildKeys();
+
+	// How far from sorted is the carried-over order?
+	unsigned int outOfPlace = 0;
+	for (unsigned int i = 1; i < count; i++)
+	{
+		if (keys[i] < keys[i - 1]) outOfPlace++;
+	}
+
+	// Nothing moved enough to change the order
+	if (outOfPlace == 0) return;
+
+	// A give-up leaves a valid (partly sorted) order for the radix passes
+	if (outOfPlace > count / NEARLY_SORTED_RATIO ||
+		!InsertionSort(count * INSERTION_SHIFTS_PER_PARTICLE))
+	{
+		RadixSort();
+	}
+}
+
+void ParticleSorter::BuildKeys()
+{
+	// Quantize against this frame's depth range
+	float nearest = depthByIndex[order[0]];
+	float farthest = nearest;
+	for (unsigned int i = 1; i < count; i++)
+	{
+		float d = depthByIndex[order[i]];
+		if (d < nearest) nearest = d;
+		if (d > farthest) farthest = d;
+	}
+
+	// Farthest particle gets key 0, so ascending keys draw back-to-front
+	float range = farthest - nearest;
+	float scale = range > 0.0f ? 65535.0f / range : 0.0f;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		keys[i] = (unsigned short)((farthest - depthByIndex[order[i]]) * scale);
+	}
+}
+
+bool ParticleSorter::InsertionSort(unsigned int maxShifts)
+{
+	unsigned int shifts = 0;
+	for (unsigned int i = 1; i < count; i++)
+	{
+		unsigned short key = keys[i];
+		unsigned int index = order[i];
+
+		unsigned int j = i;
+		while (j > 0 && keys[j - 1] > key)
+		{
+			keys[j] = keys[j - 1];
+			order[j] = order[j - 1];
+			j--;
+		}
+
+		keys[j] = key;
+		order[j] = index;
+
+		shifts += i - j;
+		if (shifts > maxShifts) return false;
+	}
+
+	return true;
+}
+
+void ParticleSorter::RadixSort()
+{
+	unsigned int workers = count >= PARALLEL_SORT_THRESHOLD ? threadCount : 1;
+	unsigned int chunk = (count + workers - 1) / workers;
+
+	unsigned short* srcKeys = keys.data();
+	unsigned short* dstKeys = keysScratch.data();
+	unsigned int* srcOrder = order.data();
+	unsigned int* dstOrder = orderScratch.data();
+
+	for (unsigned int shift = 0; shift < 16; shift += 8)
+	{
+		histograms.assign(workers * 256, 0);
+
+		// Count digits, one slice of the array per worker
+		RunParallel(workers, [&](unsigned int t)
+		{
+			unsigned int* histogram = &histograms[t * 256];
+			unsigned int end = (t + 1) * chunk < count ? (t + 1) * chunk : count;
+			for (unsigned int i = t * chunk; i < end; i++)
+			{
+				histogram[(srcKeys[i] >> shift) & 0xFF]++;
+			}
+		});
+
+		// Every key shares this digit; the pass would be a plain copy
+		bool skip = false;
+		unsigned int offset = 0;
+		for (unsigned int digit = 0; digit < 256; digit++)
+		{
+			unsigned int total = 0;
+			for (unsigned int t = 0; t < workers; t++)
+			{
+				unsigned int n = histograms[t * 256 + digit];
+				histograms[t * 256 + digit] = offset;
+				offset += n;
+				total += n;
+			}
+
+			if (total == count) skip = true;
+		}
+		if (skip) continue;
+
+		// Scatter; each worker owns its own run in every bucket so this stays stable
+		RunParallel(workers, [&](unsigned int t)
+		{
+			unsigned int* offsets = &histograms[t * 256];
+			unsigned int end = (t + 1) * chunk < count ? (t + 1) * chunk : count;
+			for (unsigned int i = t * chunk; i < end; i++)
+			{
+				unsigned int dst = offsets[(srcKeys[i] >> shift) & 0xFF]++;
+				dstKeys[dst] = srcKeys[i];
+				dstOrder[dst] = srcOrder[i];
+			}
+		});
+
+		std::swap(srcKeys, dstKeys);
+		std::swap(srcOrder, dstOrder);
+	}
+
+	// Make sure the results end up in the main arrays
+	if (srcOrder != order.data())
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			order[i] = srcOrder[i];
+			keys[i] = srcKeys[i];
+		}
+	}
+}
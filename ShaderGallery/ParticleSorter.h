@@ -0,0 +1,60 @@
+#pragma once
+#include <vector>
+
+// --------------------------------------------------------
+// Orders particles back-to-front by view depth so alpha
+// blended emitters composite correctly.
+//
+// Depths are quantized to 16-bit keys and sorted with a
+// multithreaded LSD radix sort (two 8-bit passes). The order
+// from the previous frame is kept and used as the starting
+// point, so a frame where little has moved can be fixed up
+// with an insertion sort (with a cap on how much it shifts),
+// or skipped entirely.
+// --------------------------------------------------------
+class ParticleSorter
+{
+public:
+	ParticleSorter(unsigned int capacity);
+	~ParticleSorter();
+
+	// Sorts the living particles farthest-first
+	// - living: indices of the living particles (any order)
+	// - depths: view depth of each living particle (parallel to living)
+	// - count: number of living particles
+	void Sort(const unsigned int* living, const float* depths, unsigned int count);
+
+	// The sorted particle indices from the last call to Sort()
+	const unsigned int* GetOrder() { return order.data(); }
+	unsigned int GetCount() { return count; }
+
+	void SetThreadCount(unsigned int threads);
+	unsigned int GetThreadCount() { return threadCount; }
+
+private:
+	void Reserve(unsigned int maxIndex);
+	void BuildKeys();
+	void RadixSort();
+	// False if it gave up after maxShifts (the order is still whole)
+	bool InsertionSort(unsigned int maxShifts);
+
+	unsigned int capacity;
+	unsigned int count;
+	unsigned int threadCount;
+
+	// Per particle index: frame stamps used to carry the previous
+	// order forward, and this frame's depth
+	unsigned int frame;
+	std::vector<unsigned int> aliveStamp;
+	std::vector<unsigned int> keptStamp;
+	std::vector<float> depthByIndex;
+
+	// Current order and its keys, plus scratch for the radix passes
+	std::vector<unsigned int> order;
+	std::vector<unsigned int> orderScratch;
+	std::vector<unsigned short> keys;
+	std::vector<unsigned short> keysScratch;
+
+	// One 256-bucket histogram per worker
+	std::vector<unsigned int> histograms;
+};
@@ -0,0 +1,56 @@
+#include "ParticleGPUCommon.hlsli"
+
+cbuffer externalData : register(b0)
+{
+	float4 startColor;
+	float4 endColor;
+	float startSize;
+	float endSize;
+	float lifetime;
+	float invLifetime;
+	float dt;
+	uint maxParticles;
+};
+
+RWStructuredBuffer<Particle> Particles	: register(u0);
+AppendStructuredBuffer<uint> DeadList	: register(u1);
+AppendStructuredBuffer<uint> DrawList	: register(u2);
+
+// One thread per particle slot.  Survivors are compacted into the
+// draw list; particles that die this frame go back on the dead list.
+[numthreads(32, 1, 1)]
+void main(uint3 id : SV_DispatchThreadID)
+{
+	if (id.x >= maxParticles) return;
+
+	Particle p = Particles[id.x];
+
+	// Already dead
+	if (p.Age >= lifetime) return;
+
+	p.Age += dt;
+
+	if (p.Age >= lifetime)
+	{
+		p.Age = DEAD_PARTICLE_AGE;
+		Particles[id.x] = p;
+		DeadList.Append(id.x);
+		return;
+	}
+
+	// Velocity is per frame, like the CPU emitter
+	p.PreviousPosition = p.Position;
+	p.Position += p.Velocity;
+
+	// Multiply by the reciprocal instead of dividing (GPU division isn't
+	// correctly rounded) and keep the lerps unfused, so the CPU reference
+	// produces the same bits
+	precise float t = p.Age * invLifetime;
+	precise float size = startSize + (endSize - startSize) * t;
+	precise float4 color = startColor + (endColor - startColor) * t;
+	p.Size = size;
+	p.Color = color;
+
+	Particles[id.x] = p;
+	DrawList.Append(id.x);
+}
@@ -0,0 +1,166 @@
+#pragma once
+#include <cstddef>
+#include <new>
+#include <utility>
+#include <vector>
+
+// A handle's low bits are its slot, the rest the slot's generation
+// when it was handed out.  0 is never a live handle.
+#define POOL_INDEX_BITS 20
+#define POOL_INDEX_MASK ((1u << POOL_INDEX_BITS) - 1)
+#define POOL_GENERATION_MASK (0xFFFFFFFFu >> POOL_INDEX_BITS)
+#define POOL_NULL_HANDLE 0
+
+// Objects per block; a block is one allocation and never moves
+#define POOL_BLOCK_SIZE 256
+
+// Freed slots waiting before the oldest is reused
+#define POOL_MIN_FREE_SLOTS 64
+
+// --------------------------------------------------------
+// Objects of one type, kept in big contiguous blocks and
+// referred to by 32-bit generational handles.
+//
+// Create() builds an object in place in a free slot, and
+// Destroy() bumps the slot's generation, so handles to what
+// used to be there no longer check out.  Get() is O(1): one
+// compare of the handle's generation against the slot's.
+//
+// Generations are only 12 bits, so freed slots queue up and
+// are only reused, oldest first, once more than
+// POOL_MIN_FREE_SLOTS are waiting.  Each slot then sits out
+// at least that many creates between uses, so even one
+// object made and destroyed over and over takes a quarter
+// million creates (not 4096) before a stale handle to it
+// checks out again.
+//
+// Objects never move once made, so pointers from Get() stay
+// good until the object is destroyed (things like emitters
+// that hand "this" to others can live here too).
+// --------------------------------------------------------
+template<typename T>
+class Pool
+{
+public:
+	Pool()
+	{
+		slotCount = 0;
+		count = 0;
+		freeCount = 0;
+		freeHead = POOL_INDEX_MASK;
+		freeTail = POOL_INDEX_MASK;
+	}
+
+	~Pool()
+	{
+		Clear();
+		for (size_t b = 0; b < blocks.size(); b++)
+		{
+			::operator delete(blocks[b]);
+		}
+	}
+
+	// Returns POOL_NULL_HANDLE if every slot is taken
+	template<typename... Args>
+	unsigned int Create(Args&&... args)
+	{
+		// Blocks come from plain operator new
+		static_assert(alignof(T) <= alignof(std::max_align_t), "Pool can't align this type");
+
+		// The oldest freed slot, once enough are waiting (or there's no room left)
+		unsigned int slot;
+		if (freeCount > POOL_MIN_FREE_SLOTS || (freeCount > 0 && slotCount >= POOL_INDEX_MASK))
+		{
+			slot = freeHead;
+			freeHead = nextFree[slot];
+			if (freeHead == POOL_INDEX_MASK) freeTail = POOL_INDEX_MASK;
+			freeCount--;
+		}
+		else
+		{
+			// The last index is kept as "no slot"
+			if (slotCount >= POOL_INDEX_MASK) return POOL_NULL_HANDLE;
+			slot = slotCount++;
+			if (slot % POOL_BLOCK_SIZE == 0)
+			{
+				blocks.push_back((T*)::operator new(sizeof(T) * POOL_BLOCK_SIZE));
+			}
+			generations.push_back(1);
+			nextFree.push_back(POOL_INDEX_MASK);
+			alive.push_back(0);
+		}
+
+		new (At(slot)) T(std::forward<Args>(args)...);
+		alive[slot] = 1;
+		count++;
+		return (generations[slot] << POOL_INDEX_BITS) | slot;
+	}
+
+	// Stale and null handles are ignored
+	void Destroy(unsigned int handle)
+	{
+		if (!IsValid(handle)) return;
+		unsigned int slot = handle & POOL_INDEX_MASK;
+
+		At(slot)->~T();
+		alive[slot] = 0;
+		count--;
+
+		// Generation 0 is skipped when it wraps, so no handle is ever 0
+		generations[slot] = (generations[slot] + 1) & POOL_GENERATION_MASK;
+		if (generations[slot] == 0) generations[slot] = 1;
+
+		// Onto the back of the queue
+		nextFree[slot] = POOL_INDEX_MASK;
+		if (freeTail == POOL_INDEX_MASK) freeHead = slot;
+		else nextFree[freeTail] = slot;
+		freeTail = slot;
+		freeCount++;
+	}
+
+	// Destroys everything (in slot order); the blocks are kept
+	void Clear()
+	{
+		for (unsigned int slot = 0; slot < slotCount; slot++)
+		{
+			if (alive[slot]) Destroy((generations[slot] << POOL_INDEX_BITS) | slot);
+		}
+	}
+
+	bool IsValid(unsigned int handle)
+	{
+		unsigned int slot = handle & POOL_INDEX_MASK;
+		return slot < slotCount && alive[slot] && generations[slot] == handle >> POOL_INDEX_BITS;
+	}
+
+	// Null for stale handles
+	T* Get(unsigned int handle)
+	{
+		return IsValid(handle) ? At(handle & POOL_INDEX_MASK) : 0;
+	}
+
+	// Calls func(object) for every living object, block by block
+	template<typename Func>
+	void ForEach(Func func)
+	{
+		for (unsigned int slot = 0; slot < slotCount; slot++)
+		{
+			if (alive[slot]) func(*At(slot));
+		}
+	}
+
+	unsigned int GetCount() { return count; }
+
+private:
+	T* At(unsigned int slot) { return blocks[slot / POOL_BLOCK_SIZE] + slot % POOL_BLOCK_SIZE; }
+
+	std::vector<T*> blocks;
+	std::vector<unsigned int> generations;
+	std::vector<unsigned int> nextFree;
+	std::vector<unsigned char> alive;
+	unsigned int slotCount;
+	unsigned int count;
+	unsigned int freeHead;		// Free slots, oldest first
+	unsigned int freeTail;
+	unsigned int freeCount;
+};
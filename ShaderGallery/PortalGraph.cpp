@@ -0,0 +1,435 @@
+#include "PortalGraph.h"
+
+#include <float.h>
+#include <math.h>
+
+// Grid cells are about one room across; this keeps a stray huge box from
+// asking for a huge grid
+#define PORTAL_GRID_MAX_SIDE 1024
+
+using namespace DirectX;
+
+PortalGraph::PortalGraph(CullingSystem* culling)
+{
+	this->culling = culling;
+	doorwayFloor = -1.0f;
+	doorwayCeiling = 15.0f;
+
+	gridMin = XMFLOAT2(0, 0);
+	gridCellSize = 1.0f;
+	gridWidth = 0;
+	gridHeight = 0;
+	findCount = 0;
+
+	active = false;
+	frame = 0;
+	visibleRoomCount = 0;
+	XMStoreFloat4x4(&viewProjection, XMMatrixIdentity());
+}
+
+PortalGraph::~PortalGraph()
+{
+}
+
+void PortalGraph::AddRoom(XMFLOAT3 min, XMFLOAT3 max)
+{
+	Box room = { min, max };
+	rooms.push_back(room);
+}
+
+void PortalGraph::AddDoorway(XMFLOAT3 min, XMFLOAT3 max)
+{
+	Box doorway = { min, max };
+	doorways.push_back(doorway);
+}
+
+void PortalGraph::SetDoorwayHeight(float floor, float ceiling)
+{
+	doorwayFloor = floor;
+	doorwayCeiling = ceiling;
+}
+
+void PortalGraph::Build()
+{
+	BuildGrid();
+
+	// Rooms of each doorway
+	doorwayRoomStart.assign(1, 0);
+	doorwayRooms.clear();
+	std::vector<unsigned int> doorwayCounts(rooms.size(), 0);
+	for (size_t d = 0; d < doorways.size(); d++)
+	{
+		FindRooms(doorways[d].min, doorways[d].max, PORTAL_TOUCH_DISTANCE, found);
+		for (size_t i = 0; i < found.size(); i++)
+		{
+			doorwayRooms.push_back(found[i]);
+			doorwayCounts[found[i]]++;
+		}
+		doorwayRoomStart.push_back((unsigned int)doorwayRooms.size());
+	}
+
+	// Then turned around, doorways of each room
+	roomDoorwayStart.assign(rooms.size() + 1, 0);
+	for (size_t r = 0; r < rooms.size(); r++)
+	{
+		roomDoorwayStart[r + 1] = roomDoorwayStart[r] + doorwayCounts[r];
+	}
+	roomDoorways.resize(doorwayRooms.size());
+	std::vector<unsigned int> next(roomDoorwayStart.begin(), roomDoorwayStart.end() - 1);
+	for (size_t d = 0; d < doorways.size(); d++)
+	{
+		for (unsigned int i = doorwayRoomStart[d]; i < doorwayRoomStart[d + 1]; i++)
+		{
+			roomDoorways[next[doorwayRooms[i]]++] = (unsigned int)d;
+		}
+	}
+
+	// File everything with bounds under the rooms it reaches into
+	unsigned int slots = culling->GetSlotCount();
+	memberCounts.assign(slots, 0);
+	memberRooms.resize(slots * PORTAL_MEMBER_ROOMS);
+	for (unsigned int t = 0; t < slots; t++)
+	{
+		File(t);
+	}
+
+	reachedFrame.assign(rooms.size(), 0);
+	roomRects.resize(rooms.size());
+	doorwayFrame.assign(doorways.size(), 0);
+	doorwayRects.resize(doorways.size());
+	frame = 0;
+	active = false;
+}
+
+void PortalGraph::UpdateMembers()
+{
+	// Slots made since the last update start out unfiled
+	unsigned int slots = culling->GetSlotCount();
+	if (slots > memberCounts.size())
+	{
+		memberCounts.resize(slots, 0);
+		memberRooms.resize(slots * PORTAL_MEMBER_ROOMS);
+	}
+
+	const std::vector<unsigned int>& changed = culling->GetChangedBounds();
+	for (size_t i = 0; i < changed.size(); i++)
+	{
+		File(changed[i]);
+	}
+}
+
+void PortalGraph::File(unsigned int transform)
+{
+	memberCounts[transform] = 0;
+	if (!culling->HasBounds(transform)) return;
+
+	XMFLOAT3 center = culling->GetWorldCenter(transform);
+	XMFLOAT3 extents = culling->GetWorldExtents(transform);
+	FindRooms(
+		XMFLOAT3(center.x - extents.x, 0, center.z - extents.z),
+		XMFLOAT3(center.x + extents.x, 0, center.z + extents.z),
+		PORTAL_WALL_MARGIN, found);
+	if (found.size() > PORTAL_MEMBER_ROOMS) return;
+
+	for (size_t i = 0; i < found.size(); i++)
+	{
+		memberRooms[transform * PORTAL_MEMBER_ROOMS + i] = found[i];
+	}
+	memberCounts[transform] = (unsigned char)found.size();
+}
+
+void PortalGraph::BuildGrid()
+{
+	gridCells.clear();
+	foundFrame.assign(rooms.size(), 0);
+	findCount = 0;
+	if (rooms.empty())
+	{
+		gridWidth = gridHeight = 0;
+		return;
+	}
+
+	// Cells the size of an average room
+	XMFLOAT2 min(FLT_MAX, FLT_MAX);
+	XMFLOAT2 max(-FLT_MAX, -FLT_MAX);
+	float totalSize = 0;
+	for (size_t r = 0; r < rooms.size(); r++)
+	{
+		min.x = fminf(min.x, rooms[r].min.x);
+		min.y = fminf(min.y, rooms[r].min.z);
+		max.x = fmaxf(max.x, rooms[r].max.x);
+		max.y = fmaxf(max.y, rooms[r].max.z);
+		totalSize += fmaxf(rooms[r].max.x - rooms[r].min.x, rooms[r].max.z - rooms[r].min.z);
+	}
+	float side = fmaxf(max.x - min.x, max.y - min.y);
+	gridCellSize = fmaxf(totalSize / rooms.size(), side / PORTAL_GRID_MAX_SIDE);
+	gridCellSize = fmaxf(gridCellSize, 0.01f);
+	gridMin = min;
+	gridWidth = (unsigned int)((max.x - min.x) / gridCellSize) + 1;
+	gridHeight = (unsigned int)((max.y - min.y) / gridCellSize) + 1;
+	gridCells.resize(gridWidth * gridHeight);
+
+	for (size_t r = 0; r < rooms.size(); r++)
+	{
+		unsigned int x0 = (unsigned int)((rooms[r].min.x - gridMin.x) / gridCellSize);
+		unsigned int y0 = (unsigned int)((rooms[r].min.z - gridMin.y) / gridCellSize);
+		unsigned int x1 = (unsigned int)((rooms[r].max.x - gridMin.x) / gridCellSize);
+		unsigned int y1 = (unsigned int)((rooms[r].max.z - gridMin.y) / gridCellSize);
+		for (unsigned int y = y0; y <= y1 && y < gridHeight; y++)
+		{
+			for (unsigned int x = x0; x <= x1 && x < gridWidth; x++)
+			{
+				gridCells[y * gridWidth + x].push_back((unsigned int)r);
+			}
+		}
+	}
+}
+
+void PortalGraph::FindRooms(XMFLOAT3 min, XMFLOAT3 max, float margin, std::vector<unsigned int>& found)
+{
+	found.clear();
+	if (gridCells.empty()) return;
+
+	// Grown by the margin, clamped to the grid
+	float minX = (min.x - margin - gridMin.x) / gridCellSize;
+	float minY = (min.z - margin - gridMin.y) / gridCellSize;
+	float maxX = (max.x + margin - gridMin.x) / gridCellSize;
+	float maxY = (max.z + margin - gridMin.y) / gridCellSize;
+	if (maxX < 0 || maxY < 0 || minX >= gridWidth || minY >= gridHeight) return;
+
+	unsigned int x0 = minX > 0 ? (unsigned int)minX : 0;
+	unsigned int y0 = minY > 0 ? (unsigned int)minY : 0;
+	unsigned int x1 = maxX < gridWidth - 1 ? (unsigned int)maxX : gridWidth - 1;
+	unsigned int y1 = maxY < gridHeight - 1 ? (unsigned int)maxY : gridHeight - 1;
+
+	// Rooms span cells, so only take each once
+	findCount++;
+	for (unsigned int y = y0; y <= y1; y++)
+	{
+		for (unsigned int x = x0; x <= x1; x++)
+		{
+			const std::vector<unsigned int>& cell = gridCells[y * gridWidth + x];
+			for (size_t i = 0; i < cell.size(); i++)
+			{
+				unsigned int r = cell[i];
+				if (foundFrame[r] == findCount) continue;
+				foundFrame[r] = findCount;
+
+				const Box& room = rooms[r];
+				if (room.min.x - margin <= max.x && room.max.x + margin >= min.x &&
+					room.min.z - margin <= max.z && room.max.z + margin >= min.z)
+				{
+					found.push_back(r);
+				}
+			}
+		}
+	}
+}
+
+PortalGraph::ScreenRect PortalGraph::ProjectBox(XMFLOAT3 min, XMFLOAT3 max)
+{
+	ScreenRect nothing = { 1, 1, -1, -1 };
+	ScreenRect rect = { FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+	XMFLOAT4 clip[8];
+	int inFront = 0;
+	int beyondFar = 0;
+	XMMATRIX m = XMLoadFloat4x4(&viewProjection);
+	for (int corner = 0; corner < 8; corner++)
+	{
+		XMFLOAT3 p(
+			(corner & 1) ? max.x : min.x,
+			(corner & 2) ? max.y : min.y,
+			(corner & 4) ? max.z : min.z);
+		XMStoreFloat4(&clip[corner], XMVector3Transform(XMLoadFloat3(&p), m));
+		inFront += clip[corner].z >= 0;
+		beyondFar += clip[corner].z > clip[corner].w;
+	}
+	if (inFront == 0 || beyondFar == 8) return nothing;
+
+	for (int corner = 0; corner < 8; corner++)
+	{
+		const XMFLOAT4& a = clip[corner];
+		if (a.z >= 0)
+		{
+			rect.minX = fminf(rect.minX, a.x / a.w);
+			rect.minY = fminf(rect.minY, a.y / a.w);
+			rect.maxX = fmaxf(rect.maxX, a.x / a.w);
+			rect.maxY = fmaxf(rect.maxY, a.y / a.w);
+			continue;
+		}
+
+		// Corners behind the camera are swapped for where their edges
+		// cross the near plane
+		for (int axis = 1; axis < 8; axis <<= 1)
+		{
+			const XMFLOAT4& b = clip[corner ^ axis];
+			if (b.z < 0) continue;
+
+			float t = a.z / (a.z - b.z);
+			float x = a.x + (b.x - a.x) * t;
+			float y = a.y + (b.y - a.y) * t;
+			float w = a.w + (b.w - a.w) * t;
+			rect.minX = fminf(rect.minX, x / w);
+			rect.minY = fminf(rect.minY, y / w);
+			rect.maxX = fmaxf(rect.maxX, x / w);
+			rect.maxY = fmaxf(rect.maxY, y / w);
+		}
+	}
+
+	rect.minX = fmaxf(rect.minX, -1);
+	rect.minY = fmaxf(rect.minY, -1);
+	rect.maxX = fminf(rect.maxX, 1);
+	rect.maxY = fminf(rect.maxY, 1);
+	return rect;
+}
+
+void PortalGraph::FindVisibleRooms(XMFLOAT3 cameraPosition, XMFLOAT4X4 view, XMFLOAT4X4 projection)
+{
+	// Both are stored transposed for HLSL
+	XMStoreFloat4x4(&viewProjection, XMMatrixMultiply(
+		XMMatrixTranspose(XMLoadFloat4x4(&view)),
+		XMMatrixTranspose(XMLoadFloat4x4(&projection))));
+
+	frame++;
+	visibleRoomCount = 0;
+	stack.clear();
+
+	// Start from every room the camera is in (or that its doorway opens into)
+	ScreenRect everything = { -1, -1, 1, 1 };
+	FindRooms(cameraPosition, cameraPosition, 0, found);
+	for (size_t i = 0; i < found.size(); i++)
+	{
+		Visit start = { found[i], everything };
+		stack.push_back(start);
+	}
+	for (size_t d = 0; d < doorways.size(); d++)
+	{
+		const Box& doorway = doorways[d];
+		if (cameraPosition.x < doorway.min.x || cameraPosition.x > doorway.max.x ||
+			cameraPosition.z < doorway.min.z || cameraPosition.z > doorway.max.z) continue;
+
+		for (unsigned int i = doorwayRoomStart[d]; i < doorwayRoomStart[d + 1]; i++)
+		{
+			Visit start = { doorwayRooms[i], everything };
+			stack.push_back(start);
+		}
+	}
+
+	// Lost outside the floor plan, so there's nothing to go on
+	active = !stack.empty();
+
+	while (!stack.empty())
+	{
+		Visit visit = stack.back();
+		stack.pop_back();
+
+		unsigned int room = visit.room;
+		ScreenRect& seen = roomRects[room];
+		if (reachedFrame[room] == frame)
+		{
+			// Nothing new to see through this way
+			if (visit.rect.minX >= seen.minX && visit.rect.minY >= seen.minY &&
+				visit.rect.maxX <= seen.maxX && visit.rect.maxY <= seen.maxY) continue;
+
+			seen.minX = fminf(seen.minX, visit.rect.minX);
+			seen.minY = fminf(seen.minY, visit.rect.minY);
+			seen.maxX = fmaxf(seen.maxX, visit.rect.maxX);
+			seen.maxY = fmaxf(seen.maxY, visit.rect.maxY);
+		}
+		else
+		{
+			reachedFrame[room] = frame;
+			seen = visit.rect;
+			visibleRoomCount++;
+		}
+
+		for (unsigned int i = roomDoorwayStart[room]; i < roomDoorwayStart[room + 1]; i++)
+		{
+			unsigned int d = roomDoorways[i];
+			if (doorwayFrame[d] != frame)
+			{
+				XMFLOAT3 min(doorways[d].min.x, doorwayFloor, doorways[d].min.z);
+				XMFLOAT3 max(doorways[d].max.x, doorwayCeiling, doorways[d].max.z);
+				doorwayRects[d] = ProjectBox(min, max);
+				doorwayFrame[d] = frame;
+			}
+
+			// What's left of the view once it's squeezed through the doorway
+			ScreenRect through;
+			through.minX = fmaxf(visit.rect.minX, doorwayRects[d].minX);
+			through.minY = fmaxf(visit.rect.minY, doorwayRects[d].minY);
+			through.maxX = fminf(visit.rect.maxX, doorwayRects[d].maxX);
+			through.maxY = fminf(visit.rect.maxY, doorwayRects[d].maxY);
+			if (through.minX > through.maxX || through.minY > through.maxY) continue;
+
+			for (unsigned int j = doorwayRoomStart[d]; j < doorwayRoomStart[d + 1]; j++)
+			{
+				if (doorwayRooms[j] == room) continue;
+				Visit next = { doorwayRooms[j], through };
+				stack.push_back(next);
+			}
+		}
+	}
+}
+
+bool PortalGraph::CanSee(const unsigned int* roomList, unsigned int roomCount, XMFLOAT3 min, XMFLOAT3 max)
+{
+	bool projected = false;
+	ScreenRect rect;
+	for (unsigned int i = 0; i < roomCount; i++)
+	{
+		unsigned int room = roomList[i];
+		if (reachedFrame[room] != frame) continue;
+
+		// Only worth projecting once one of its rooms is in view
+		if (!projected)
+		{
+			rect = ProjectBox(min, max);
+			projected = true;
+		}
+
+		const ScreenRect& seen = roomRects[room];
+		if (rect.minX <= seen.maxX && rect.maxX >= seen.minX &&
+			rect.minY <= seen.maxY && rect.maxY >= seen.minY) return true;
+	}
+	return false;
+}
+
+unsigned int PortalGraph::Cull(std::vector<unsigned char>& visible)
+{
+	if (!active) return 0;
+
+	unsigned int count = (unsigned int)visible.size();
+	if (count > (unsigned int)memberCounts.size()) count = (unsigned int)memberCounts.size();
+
+	unsigned int hidden = 0;
+	for (unsigned int t = 0; t < count; t++)
+	{
+		unsigned int roomCount = memberCounts[t];
+		if (!visible[t] || roomCount == 0) continue;
+
+		XMFLOAT3 center = culling->GetWorldCenter(t);
+		XMFLOAT3 extents = culling->GetWorldExtents(t);
+		XMFLOAT3 min(center.x - extents.x, center.y - extents.y, center.z - extents.z);
+		XMFLOAT3 max(center.x + extents.x, center.y + extents.y, center.z + extents.z);
+		if (!CanSee(&memberRooms[t * PORTAL_MEMBER_ROOMS], roomCount, min, max))
+		{
+			visible[t] = 0;
+			hidden++;
+		}
+	}
+	return hidden;
+}
+
+bool PortalGraph::IsBoxVisible(XMFLOAT3 center, XMFLOAT3 extents)
+{
+	if (!active) return true;
+
+	XMFLOAT3 min(center.x - extents.x, center.y - extents.y, center.z - extents.z);
+	XMFLOAT3 max(center.x + extents.x, center.y + extents.y, center.z + extents.z);
+	FindRooms(min, max, PORTAL_WALL_MARGIN, found);
+	if (found.empty()) return true;
+
+	return CanSee(&found[0], (unsigned int)found.size(), min, max);
+}
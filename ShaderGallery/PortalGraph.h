@@ -0,0 +1,140 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+#include "CullingSystem.h"
+
+// Doorways this close to a room still open into it
+#define PORTAL_TOUCH_DISTANCE 0.05f
+
+// How far past a room's walkable floor its walls (and whatever
+// hangs on them) can be
+#define PORTAL_WALL_MARGIN 1.0f
+
+// Rooms one transform can be filed under.  Something reaching into
+// more than this (only huge things do) is left unfiled, never hidden.
+#define PORTAL_MEMBER_ROOMS 4
+
+// --------------------------------------------------------
+// Room-and-portal visibility over the gallery's floor plan.
+//
+// Rooms are the world bounds, doorways the doorway bounds;
+// a doorway joins every room it overlaps or touches.  Each
+// bounded transform is filed under the rooms its world box
+// overlaps (counting the walls) when the graph is built, and
+// again whenever its world bounds change or are cleared.
+//
+// Each frame visibility floods out of the camera's room.
+// Every room reached carries the part of the screen it can
+// be seen through: the camera's room gets all of it, and a
+// room behind a doorway gets what's left after clipping to
+// that doorway's screen rect.  A room is only revisited when
+// it's reached through a part of the screen it wasn't seen
+// through yet, so loops in the graph end.
+//
+// Something filed under rooms is only drawn when its screen
+// rect overlaps one of those rooms' visible parts.  Things
+// outside every room, and everything when the camera isn't
+// in a room, are left alone.  No D3D in here, so it can run
+// headless.
+// --------------------------------------------------------
+class PortalGraph
+{
+public:
+	PortalGraph(CullingSystem* culling);
+	~PortalGraph();
+
+	// Boxes on the XZ plane, like the scene's bounds
+	void AddRoom(DirectX::XMFLOAT3 min, DirectX::XMFLOAT3 max);
+	void AddDoorway(DirectX::XMFLOAT3 min, DirectX::XMFLOAT3 max);
+
+	// Height range doorways are seen through (default -1 to 15)
+	void SetDoorwayHeight(float floor, float ceiling);
+
+	// Joins doorways to rooms and files every bounded transform under
+	// its rooms.  Needs world bounds, so call it after they're updated.
+	void Build();
+
+	// Refiles whatever the culling system's last UpdateWorldBounds()
+	// changed or cleared, so call it right after that
+	void UpdateMembers();
+
+	// Floods out from the room holding the camera through the doorways in view
+	void FindVisibleRooms(DirectX::XMFLOAT3 cameraPosition, DirectX::XMFLOAT4X4 view, DirectX::XMFLOAT4X4 projection);
+
+	// Clears the flag of everything filed under rooms that can't be seen
+	// into where it is.  Returns how many that was.
+	unsigned int Cull(std::vector<unsigned char>& visible);
+
+	// For things without a transform, like emitters
+	bool IsBoxVisible(DirectX::XMFLOAT3 center, DirectX::XMFLOAT3 extents);
+
+	bool IsActive() { return active; }
+	bool IsRoomVisible(unsigned int room) { return active && reachedFrame[room] == frame; }
+	unsigned int GetRoomCount() { return (unsigned int)rooms.size(); }
+	unsigned int GetDoorwayCount() { return (unsigned int)doorways.size(); }
+	unsigned int GetVisibleRoomCount() { return visibleRoomCount; }
+
+private:
+	struct Box
+	{
+		DirectX::XMFLOAT3 min;
+		DirectX::XMFLOAT3 max;
+	};
+
+	// Normalized device coordinates, -1 to 1
+	struct ScreenRect
+	{
+		float minX, minY, maxX, maxY;
+	};
+
+	struct Visit
+	{
+		unsigned int room;
+		ScreenRect rect;
+	};
+
+	void BuildGrid();
+	void File(unsigned int transform);
+	void FindRooms(DirectX::XMFLOAT3 min, DirectX::XMFLOAT3 max, float margin, std::vector<unsigned int>& found);
+	ScreenRect ProjectBox(DirectX::XMFLOAT3 min, DirectX::XMFLOAT3 max);
+	bool CanSee(const unsigned int* roomList, unsigned int roomCount, DirectX::XMFLOAT3 min, DirectX::XMFLOAT3 max);
+
+	CullingSystem* culling;
+	float doorwayFloor;
+	float doorwayCeiling;
+
+	std::vector<Box> rooms;
+	std::vector<Box> doorways;
+
+	// Doorways of each room, and rooms of each doorway (start offsets into flat lists)
+	std::vector<unsigned int> roomDoorwayStart;
+	std::vector<unsigned int> roomDoorways;
+	std::vector<unsigned int> doorwayRoomStart;
+	std::vector<unsigned int> doorwayRooms;
+
+	// Rooms each transform slot is filed under, PORTAL_MEMBER_ROOMS apiece
+	std::vector<unsigned char> memberCounts;
+	std::vector<unsigned int> memberRooms;
+
+	// Uniform grid over the rooms, for finding them by position
+	DirectX::XMFLOAT2 gridMin;
+	float gridCellSize;
+	unsigned int gridWidth;
+	unsigned int gridHeight;
+	std::vector<std::vector<unsigned int> > gridCells;
+	std::vector<unsigned int> foundFrame;
+	unsigned int findCount;
+
+	// This frame's flood
+	bool active;
+	unsigned int frame;
+	unsigned int visibleRoomCount;
+	DirectX::XMFLOAT4X4 viewProjection;
+	std::vector<unsigned int> reachedFrame;
+	std::vector<ScreenRect> roomRects;
+	std::vector<unsigned int> doorwayFrame;
+	std::vector<ScreenRect> doorwayRects;
+	std::vector<Visit> stack;
+	std::vector<unsigned int> found;
+};
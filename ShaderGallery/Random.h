@@ -0,0 +1,123 @@
+#pragma once
+#include <emmintrin.h>
+
+// --------------------------------------------------------
+// Seedable counter-based random number generator.
+//
+// Each value is a hash of (seed, counter), so there is no
+// hidden state beyond the counter: a stream can be replayed
+// from its seed, jumped to any position, or split into
+// blocks that are filled in parallel.
+//
+// The hash is a two-round integer mix (lowbias32), which
+// only needs 32-bit multiplies and fixed shifts, so the
+// batch path runs 4-wide in SSE2 and gives the exact same
+// bits as the scalar path.
+// --------------------------------------------------------
+class Random
+{
+public:
+	Random(unsigned int seed = 0) { Seed(seed); }
+
+	void Seed(unsigned int seed)
+	{
+		this->seed = seed;
+		key = Mix(seed ^ 0x9E3779B9u);
+		counter = 0;
+	}
+
+	unsigned int GetSeed() { return seed; }
+	unsigned int GetKey() const { return key; }
+	unsigned int GetCounter() { return counter; }
+	void SetCounter(unsigned int pCounter) { counter = pCounter; }
+
+	// Reserves a block of count values and returns its first counter.
+	// The block can then be read with At() or FillFloats() from any thread.
+	unsigned int Reserve(unsigned int count)
+	{
+		unsigned int first = counter;
+		counter += count;
+		return first;
+	}
+
+	// Stateless lookup of the value at a given counter
+	unsigned int At(unsigned int pCounter) const { return Mix(Mix(pCounter ^ key) + key); }
+
+	// Next 32 random bits
+	unsigned int Next() { return At(counter++); }
+
+	// Uniform float in [0, 1)
+	float NextFloat() { return ToFloat(Next()); }
+
+	// Uniform float in [min, max)
+	float NextFloat(float min, float max) { return min + (max - min) * NextFloat(); }
+
+	// Uniform int in [min, max]
+	int NextInt(int min, int max)
+	{
+		unsigned int range = (unsigned int)(max - min) + 1;
+		return min + (int)(((unsigned long long)Next() * range) >> 32);
+	}
+
+	// Writes [0, 1) floats for counters [first, first + count), 4 at a time
+	void FillFloats(unsigned int first, float* out, unsigned int count) const
+	{
+		const __m128i keys = _mm_set1_epi32((int)key);
+		const __m128 scale = _mm_set1_ps(1.0f / 16777216.0f);
+
+		__m128i counters = _mm_add_epi32(_mm_set1_epi32((int)first), _mm_setr_epi32(0, 1, 2, 3));
+		const __m128i step = _mm_set1_epi32(4);
+
+		unsigned int i = 0;
+		for (; i + 4 <= count; i += 4)
+		{
+			__m128i bits = Mix4(_mm_add_epi32(Mix4(_mm_xor_si128(counters, keys)), keys));
+			_mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(bits, 8)), scale));
+			counters = _mm_add_epi32(counters, step);
+		}
+
+		// Leftovers
+		for (; i < count; i++)
+		{
+			out[i] = ToFloat(At(first + i));
+		}
+	}
+
+	// Top 24 bits as a [0, 1) float (exactly representable, so SIMD matches scalar)
+	static float ToFloat(unsigned int bits) { return (float)(bits >> 8) * (1.0f / 16777216.0f); }
+
+private:
+	static unsigned int Mix(unsigned int x)
+	{
+		x ^= x >> 16;
+		x *= 0x7FEB352Du;
+		x ^= x >> 15;
+		x *= 0x846CA68Bu;
+		x ^= x >> 16;
+		return x;
+	}
+
+	// SSE2 has no 32-bit lane multiply, so build one from the 32x32->64 multiply
+	static __m128i MulLo4(__m128i a, __m128i b)
+	{
+		__m128i even = _mm_mul_epu32(a, b);
+		__m128i odd = _mm_mul_epu32(_mm_srli_epi64(a, 32), _mm_srli_epi64(b, 32));
+		return _mm_unpacklo_epi32(
+			_mm_shuffle_epi32(even, _MM_SHUFFLE(0, 0, 2, 0)),
+			_mm_shuffle_epi32(odd, _MM_SHUFFLE(0, 0, 2, 0)));
+	}
+
+	static __m128i Mix4(__m128i x)
+	{
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+		x = MulLo4(x, _mm_set1_epi32(0x7FEB352D));
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 15));
+		x = MulLo4(x, _mm_set1_epi32((int)0x846CA68Bu));
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 16));
+		return x;
+	}
+
+	unsigned int seed;
+	unsigned int key;
+	unsigned int counter;
+};
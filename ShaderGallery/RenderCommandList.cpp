@@ -0,0 +1,104 @@
+#include "RenderCommandList.h"
+
+#include <string.h>
+
+RenderCommandList::RenderCommandList()
+{
+	drawCount = 0;
+}
+
+RenderCommandList::~RenderCommandList()
+{
+}
+
+void RenderCommandList::Clear()
+{
+	commands.clear();
+	constants.clear();
+	drawCount = 0;
+}
+
+void RenderCommandList::Add(RenderCommandType type, const void* target, const void* resource, const char* name, unsigned int a, unsigned int b, unsigned int c)
+{
+	Command command;
+	command.type = type;
+	command.target = target;
+	command.resource = resource;
+	command.name = name;
+	command.a = a;
+	command.b = b;
+	command.c = c;
+	commands.push_back(command);
+}
+
+void RenderCommandList::SetShader(const void* shader)
+{
+	Add(RENDER_COMMAND_SET_SHADER, shader, 0, 0, 0, 0, 0);
+}
+
+void RenderCommandList::SetConstant(const void* shader, const char* name, const void* data, unsigned int size)
+{
+	// The data goes in with the list, so the caller's copy can change right away
+	unsigned int offset = (unsigned int)constants.size();
+	constants.resize(offset + size);
+	memcpy(&constants[offset], data, size);
+	Add(RENDER_COMMAND_SET_CONSTANT, shader, 0, name, offset, size, 0);
+}
+
+void RenderCommandList::UploadConstants(const void* shader, const char* buffer)
+{
+	Add(RENDER_COMMAND_UPLOAD_CONSTANTS, shader, 0, buffer, 0, 0, 0);
+}
+
+void RenderCommandList::SetTexture(const void* shader, const char* name, const void* view)
+{
+	Add(RENDER_COMMAND_SET_TEXTURE, shader, view, name, 0, 0, 0);
+}
+
+void RenderCommandList::SetSampler(const void* shader, const char* name, const void* sampler)
+{
+	Add(RENDER_COMMAND_SET_SAMPLER, shader, sampler, name, 0, 0, 0);
+}
+
+void RenderCommandList::SetGeometry(const void* vertices, const void* indices, unsigned int stride)
+{
+	Add(RENDER_COMMAND_SET_GEOMETRY, vertices, indices, 0, stride, 0, 0);
+}
+
+void RenderCommandList::Draw(unsigned int indexCount, unsigned int instanceCount, unsigned int firstInstance)
+{
+	Add(RENDER_COMMAND_DRAW, 0, 0, 0, indexCount, instanceCount, firstInstance);
+	drawCount++;
+}
+
+void RenderCommandList::Execute(RenderBackend* backend)
+{
+	for (size_t i = 0; i < commands.size(); i++)
+	{
+		const Command& command = commands[i];
+		switch (command.type)
+		{
+		case RENDER_COMMAND_SET_SHADER:
+			backend->SetShader(command.target);
+			break;
+		case RENDER_COMMAND_SET_CONSTANT:
+			backend->SetConstant(command.target, command.name, &constants[command.a], command.b);
+			break;
+		case RENDER_COMMAND_UPLOAD_CONSTANTS:
+			backend->UploadConstants(command.target, command.name);
+			break;
+		case RENDER_COMMAND_SET_TEXTURE:
+			backend->SetTexture(command.target, command.name, command.resource);
+			break;
+		case RENDER_COMMAND_SET_SAMPLER:
+			backend->SetSampler(command.target, command.name, command.resource);
+			break;
+		case RENDER_COMMAND_SET_GEOMETRY:
+			backend->SetGeometry(command.target, command.resource, command.a);
+			break;
+		case RENDER_COMMAND_DRAW:
+			backend->Draw(command.a, command.b, command.c);
+			break;
+		}
+	}
+}
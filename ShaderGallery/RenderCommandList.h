@@ -0,0 +1,89 @@
+#pragma once
+#include <vector>
+
+enum RenderCommandType
+{
+	RENDER_COMMAND_SET_SHADER,
+	RENDER_COMMAND_SET_CONSTANT,
+	RENDER_COMMAND_UPLOAD_CONSTANTS,
+	RENDER_COMMAND_SET_TEXTURE,
+	RENDER_COMMAND_SET_SAMPLER,
+	RENDER_COMMAND_SET_GEOMETRY,
+	RENDER_COMMAND_DRAW
+};
+
+// --------------------------------------------------------
+// Whatever a command list is played back onto: a device
+// context, or something that just counts (NullRenderBackend).
+//
+// Shaders, views, samplers and buffers are opaque handles
+// that only the backend knows how to use.  Variables and
+// constant buffers are named the way the shaders name them.
+// --------------------------------------------------------
+class RenderBackend
+{
+public:
+	virtual ~RenderBackend() {}
+
+	virtual void SetShader(const void* shader) = 0;
+	virtual void SetConstant(const void* shader, const char* name, const void* data, unsigned int size) = 0;
+
+	// Sends the shader's named constant buffer (all of them, if name is null) to the GPU
+	virtual void UploadConstants(const void* shader, const char* buffer) = 0;
+	virtual void SetTexture(const void* shader, const char* name, const void* view) = 0;
+	virtual void SetSampler(const void* shader, const char* name, const void* sampler) = 0;
+	virtual void SetGeometry(const void* vertices, const void* indices, unsigned int stride) = 0;
+
+	// Indexed; instanceCount 0 is a plain (not instanced) draw
+	virtual void Draw(unsigned int indexCount, unsigned int instanceCount, unsigned int firstInstance) = 0;
+};
+
+// --------------------------------------------------------
+// Draw submission recorded for playing back later.
+//
+// Recording only touches the list (constant data is copied
+// in), never the shaders or the device, so several threads
+// can each record their own list at once and one thread
+// plays them back in order.  Names are kept as pointers, so
+// they have to outlive the list (string literals do).
+// --------------------------------------------------------
+class RenderCommandList
+{
+public:
+	RenderCommandList();
+	~RenderCommandList();
+
+	// Keeps the memory for the next recording
+	void Clear();
+
+	void SetShader(const void* shader);
+	void SetConstant(const void* shader, const char* name, const void* data, unsigned int size);
+	void UploadConstants(const void* shader, const char* buffer);
+	void SetTexture(const void* shader, const char* name, const void* view);
+	void SetSampler(const void* shader, const char* name, const void* sampler);
+	void SetGeometry(const void* vertices, const void* indices, unsigned int stride);
+	void Draw(unsigned int indexCount, unsigned int instanceCount, unsigned int firstInstance);
+
+	void Execute(RenderBackend* backend);
+
+	unsigned int GetCommandCount() { return (unsigned int)commands.size(); }
+	unsigned int GetDrawCount() { return drawCount; }
+
+private:
+	struct Command
+	{
+		RenderCommandType type;
+		const void* target;		// Shader, or vertex buffer
+		const void* resource;	// View, sampler, or index buffer
+		const char* name;		// Variable or constant buffer
+		unsigned int a;			// Constant data offset, stride or index count
+		unsigned int b;			// Constant data size, or instance count
+		unsigned int c;			// First instance
+	};
+
+	void Add(RenderCommandType type, const void* target, const void* resource, const char* name, unsigned int a, unsigned int b, unsigned int c);
+
+	std::vector<Command> commands;
+	std::vector<unsigned char> constants;
+	unsigned int drawCount;
+};
@@ -0,0 +1,124 @@
+#include "RenderQueue.h"
+
+#include <string.h>
+
+#define RENDER_KEY_DEPTH_SHIFT 0
+#define RENDER_KEY_MESH_SHIFT (RENDER_KEY_DEPTH_SHIFT + RENDER_KEY_DEPTH_BITS)
+#define RENDER_KEY_MATERIAL_SHIFT (RENDER_KEY_MESH_SHIFT + RENDER_KEY_MESH_BITS)
+#define RENDER_KEY_SHADER_SHIFT (RENDER_KEY_MATERIAL_SHIFT + RENDER_KEY_MATERIAL_BITS)
+#define RENDER_KEY_PASS_SHIFT (RENDER_KEY_SHADER_SHIFT + RENDER_KEY_SHADER_BITS)
+
+namespace
+{
+	unsigned long long Field(unsigned int value, unsigned int bits, unsigned int shift)
+	{
+		unsigned int largest = (1u << bits) - 1;
+		return (unsigned long long)(value < largest ? value : largest) << shift;
+	}
+
+	unsigned int Unfield(unsigned long long key, unsigned int bits, unsigned int shift)
+	{
+		return (unsigned int)(key >> shift) & ((1u << bits) - 1);
+	}
+}
+
+RenderQueue::RenderQueue()
+{
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Clear()
+{
+	entries.clear();
+}
+
+void RenderQueue::Add(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth, unsigned int item)
+{
+	// Depth is quantized; anything past the ends is clamped onto them
+	float largest = (float)((1u << RENDER_KEY_DEPTH_BITS) - 1);
+	float scaled = depth * largest;
+	unsigned int quantized = scaled > 0 ? (unsigned int)(scaled < largest ? scaled : largest) : 0;
+
+	Entry entry;
+	entry.key =
+		Field(pass, RENDER_KEY_PASS_BITS, RENDER_KEY_PASS_SHIFT) |
+		Field(shader, RENDER_KEY_SHADER_BITS, RENDER_KEY_SHADER_SHIFT) |
+		Field(material, RENDER_KEY_MATERIAL_BITS, RENDER_KEY_MATERIAL_SHIFT) |
+		Field(mesh, RENDER_KEY_MESH_BITS, RENDER_KEY_MESH_SHIFT) |
+		Field(quantized, RENDER_KEY_DEPTH_BITS, RENDER_KEY_DEPTH_SHIFT);
+	entry.item = item;
+	entries.push_back(entry);
+}
+
+void RenderQueue::Sort()
+{
+	unsigned int count = (unsigned int)entries.size();
+	if (count < 2) return;
+
+	// Every byte's histogram in one read
+	static const int bytes = 8;
+	unsigned int counts[bytes][256];
+	memset(counts, 0, sizeof(counts));
+	for (unsigned int i = 0; i < count; i++)
+	{
+		unsigned long long key = entries[i].key;
+		for (int b = 0; b < bytes; b++)
+		{
+			counts[b][(key >> (b * 8)) & 0xFF]++;
+		}
+	}
+
+	scratch.resize(count);
+	Entry* from = &entries[0];
+	Entry* to = &scratch[0];
+	for (int b = 0; b < bytes; b++)
+	{
+		// Every key has the same byte here, so this pass wouldn't move anything
+		unsigned int first = (unsigned int)((entries[0].key >> (b * 8)) & 0xFF);
+		if (counts[b][first] == count) continue;
+
+		unsigned int offsets[256];
+		unsigned int offset = 0;
+		for (int d = 0; d < 256; d++)
+		{
+			offsets[d] = offset;
+			offset += counts[b][d];
+		}
+
+		// Stable, so lower bytes keep their order within each digit
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int digit = (unsigned int)((from[i].key >> (b * 8)) & 0xFF);
+			to[offsets[digit]++] = from[i];
+		}
+
+		Entry* swap = from;
+		from = to;
+		to = swap;
+	}
+
+	if (from != &entries[0]) entries.swap(scratch);
+}
+
+unsigned int RenderQueue::GetPass(unsigned long long key)
+{
+	return Unfield(key, RENDER_KEY_PASS_BITS, RENDER_KEY_PASS_SHIFT);
+}
+
+unsigned int RenderQueue::GetShader(unsigned long long key)
+{
+	return Unfield(key, RENDER_KEY_SHADER_BITS, RENDER_KEY_SHADER_SHIFT);
+}
+
+unsigned int RenderQueue::GetMaterial(unsigned long long key)
+{
+	return Unfield(key, RENDER_KEY_MATERIAL_BITS, RENDER_KEY_MATERIAL_SHIFT);
+}
+
+unsigned int RenderQueue::GetMesh(unsigned long long key)
+{
+	return Unfield(key, RENDER_KEY_MESH_BITS, RENDER_KEY_MESH_SHIFT);
+}
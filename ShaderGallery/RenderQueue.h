@@ -0,0 +1,57 @@
+#pragma once
+#include <vector>
+
+// Bits of each sort key field, most significant first.  They add up to 64.
+#define RENDER_KEY_PASS_BITS 4
+#define RENDER_KEY_SHADER_BITS 8
+#define RENDER_KEY_MATERIAL_BITS 16
+#define RENDER_KEY_MESH_BITS 16
+#define RENDER_KEY_DEPTH_BITS 20
+
+// --------------------------------------------------------
+// A frame's draws as 64-bit sort keys, each with the index
+// of whatever it draws.
+//
+// Keys order draws by pass, then shader, material and mesh,
+// so draws that share state end up next to each other and
+// whoever runs the queue can skip binding what's already
+// bound.  The last field is depth, so draws that share all
+// of that go front to back.
+//
+// Sort() is an LSD radix sort, 8 bits at a time, that skips
+// any byte every key has the same value in (usually most of
+// them, since a scene only has a few passes and shaders).
+// No D3D in here, so it can run headless.
+// --------------------------------------------------------
+class RenderQueue
+{
+public:
+	RenderQueue();
+	~RenderQueue();
+
+	void Clear();
+
+	// Ids are clamped to their fields.  Depth is 0 (near) to 1 (far).
+	void Add(unsigned int pass, unsigned int shader, unsigned int material, unsigned int mesh, float depth, unsigned int item);
+	void Sort();
+
+	unsigned int GetCount() { return (unsigned int)entries.size(); }
+	unsigned long long GetKey(unsigned int index) { return entries[index].key; }
+	unsigned int GetItem(unsigned int index) { return entries[index].item; }
+
+	// Taking a key apart again
+	static unsigned int GetPass(unsigned long long key);
+	static unsigned int GetShader(unsigned long long key);
+	static unsigned int GetMaterial(unsigned long long key);
+	static unsigned int GetMesh(unsigned long long key);
+
+private:
+	struct Entry
+	{
+		unsigned long long key;
+		unsigned int item;
+	};
+
+	std::vector<Entry> entries;
+	std::vector<Entry> scratch;
+};
@@ -0,0 +1,552 @@
+#include "Scene.h"
+#include "Particle.h"
+
+#include <fstream>
+#include <stdlib.h>
+#include <string.h>
+#include <unordered_map>
+
+using namespace DirectX;
+
+// Laid out in front of the arrays in a binary scene
+struct SceneBinaryHeader
+{
+	unsigned int magic;
+	unsigned int version;
+	unsigned int stringBytes;
+	unsigned int meshCount;
+	unsigned int materialCount;
+	unsigned int entityCount;
+	unsigned int boundsCount;
+	unsigned int emitterCount;
+	unsigned int colorKeyCount;
+};
+
+// --------------------------------------------------------
+// Splits scene text into whitespace separated tokens, one
+// record per line.  Tokens point straight into the text.
+// --------------------------------------------------------
+struct SceneToken
+{
+	const char* text;
+	unsigned int length;
+
+	bool Is(const char* word) { return strlen(word) == length && memcmp(text, word, length) == 0; }
+	std::string ToString() { return std::string(text, length); }
+};
+
+struct SceneTokenizer
+{
+	const char* cursor;
+	const char* end;
+	unsigned int line;
+
+	// Next token on the current line; false at the end of the line
+	bool Next(SceneToken& token)
+	{
+		while (cursor < end && (*cursor == ' ' || *cursor == '\t' || *cursor == '\r')) cursor++;
+		if (cursor >= end || *cursor == '\n' || *cursor == '#') return false;
+
+		// Quoted tokens can hold spaces
+		if (*cursor == '"')
+		{
+			token.text = ++cursor;
+			while (cursor < end && *cursor != '"' && *cursor != '\n') cursor++;
+			token.length = (unsigned int)(cursor - token.text);
+			if (cursor < end && *cursor == '"') cursor++;
+			return true;
+		}
+
+		token.text = cursor;
+		while (cursor < end && *cursor != ' ' && *cursor != '\t' && *cursor != '\r' && *cursor != '\n') cursor++;
+		token.length = (unsigned int)(cursor - token.text);
+		return true;
+	}
+
+	// Skips whatever is left of the line (comments included)
+	void NextLine()
+	{
+		while (cursor < end && *cursor != '\n') cursor++;
+		if (cursor < end) cursor++;
+		line++;
+	}
+
+	bool ReadFloat(float& value)
+	{
+		SceneToken token;
+		if (!Next(token)) return false;
+
+		// The text is null terminated and tokens end on whitespace, so
+		// strtof stops inside the token
+		char* parsed;
+		value = strtof(token.text, &parsed);
+		return parsed == token.text + token.length;
+	}
+
+	bool ReadUInt(unsigned int& value)
+	{
+		SceneToken token;
+		if (!Next(token)) return false;
+
+		char* parsed;
+		value = (unsigned int)strtoul(token.text, &parsed, 10);
+		return parsed == token.text + token.length;
+	}
+
+	bool ReadFloat3(XMFLOAT3& value)
+	{
+		return ReadFloat(value.x) && ReadFloat(value.y) && ReadFloat(value.z);
+	}
+
+	bool ReadFloat4(XMFLOAT4& value)
+	{
+		return ReadFloat(value.x) && ReadFloat(value.y) && ReadFloat(value.z) && ReadFloat(value.w);
+	}
+};
+
+typedef std::unordered_map<std::string, unsigned int> SceneNameMap;
+
+// Index of a name declared earlier, or SCENE_NONE
+static unsigned int Resolve(SceneNameMap& names, SceneToken& token)
+{
+	auto found = names.find(token.ToString());
+	return found == names.end() ? SCENE_NONE : found->second;
+}
+
+Scene::Scene()
+{
+	Clear();
+}
+
+Scene::~Scene()
+{
+}
+
+void Scene::Clear()
+{
+	strings.clear();
+	meshes.clear();
+	materials.clear();
+	entities.clear();
+	bounds.clear();
+	emitters.clear();
+	colorKeys.clear();
+
+	// Offset 0 is always the empty string (anonymous names)
+	strings.push_back('\0');
+}
+
+void Scene::ClearLayout()
+{
+	entities.clear();
+	bounds.clear();
+	emitters.clear();
+	colorKeys.clear();
+}
+
+unsigned int Scene::AddName(const char* name)
+{
+	return AddString(name, (unsigned int)strlen(name));
+}
+
+unsigned int Scene::AddEntity(const SceneEntity& entity)
+{
+	entities.push_back(entity);
+	return (unsigned int)entities.size() - 1;
+}
+
+void Scene::AddBounds(const SceneBounds& box)
+{
+	bounds.push_back(box);
+}
+
+void Scene::AddEmitter(SceneEmitter emitter, const ParticleColorKey* keys, unsigned int keyCount)
+{
+	emitter.firstColorKey = (unsigned int)colorKeys.size();
+	emitter.colorKeyCount = keyCount;
+	colorKeys.insert(colorKeys.end(), keys, keys + keyCount);
+	emitters.push_back(emitter);
+}
+
+unsigned int Scene::AddString(const char* text, unsigned int length)
+{
+	if (length == 0) return 0;
+
+	unsigned int offset = (unsigned int)strings.size();
+	strings.insert(strings.end(), text, text + length);
+	strings.push_back('\0');
+	return offset;
+}
+
+bool Scene::Fail(unsigned int line, const char* message)
+{
+	error = line > 0 ? "line " + std::to_string(line) + ": " + message : message;
+	Clear();
+	return false;
+}
+
+bool Scene::Load(const char* path)
+{
+	std::ifstream file(path, std::ios::binary);
+	if (!file.is_open()) return Fail(0, "can't open the scene file");
+
+	unsigned int magic = 0;
+	file.read((char*)&magic, sizeof(magic));
+	file.close();
+
+	return magic == SCENE_BINARY_MAGIC ? LoadBinary(path) : LoadText(path);
+}
+
+bool Scene::LoadText(const char* path)
+{
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) return Fail(0, "can't open the scene file");
+
+	// Read it all at once and parse in place
+	unsigned int length = (unsigned int)file.tellg();
+	std::vector<char> text(length + 1);
+	file.seekg(0);
+	file.read(&text[0], length);
+	text[length] = '\0';
+
+	return ParseText(&text[0], length);
+}
+
+bool Scene::ParseText(const char* text, unsigned int length)
+{
+	Clear();
+	error.clear();
+
+	SceneNameMap meshNames;
+	SceneNameMap materialNames;
+	SceneNameMap entityNames;
+
+	SceneTokenizer tokens = { text, text + length, 1 };
+	SceneToken word;
+	SceneToken name;
+
+	while (tokens.cursor < tokens.end)
+	{
+		unsigned int line = tokens.line;
+
+		// Blank or comment line
+		if (!tokens.Next(word))
+		{
+			tokens.NextLine();
+			continue;
+		}
+
+		if (!tokens.Next(name)) return Fail(line, "missing name");
+
+		// Bounds have a type where the others have a name
+		bool anonymous = name.Is("-") || word.Is("bounds");
+		unsigned int nameOffset = anonymous ? 0 : AddString(name.text, name.length);
+
+		if (word.Is("mesh"))
+		{
+			SceneToken path;
+			if (!tokens.Next(path)) return Fail(line, "mesh needs a path");
+
+			if (!anonymous && !meshNames.emplace(name.ToString(), (unsigned int)meshes.size()).second)
+				return Fail(line, "mesh name already used");
+
+			SceneMesh mesh = { nameOffset, AddString(path.text, path.length) };
+			meshes.push_back(mesh);
+		}
+		else if (word.Is("material"))
+		{
+			SceneToken texture, specularMap, normalMap;
+			if (!tokens.Next(texture) || !tokens.Next(specularMap) || !tokens.Next(normalMap))
+				return Fail(line, "material needs a texture, specular map and normal map");
+
+			SceneMaterial material = {};
+			material.name = nameOffset;
+			material.texture = AddString(texture.text, texture.length);
+			material.specularMap = AddString(specularMap.text, specularMap.length);
+			material.normalMap = AddString(normalMap.text, normalMap.length);
+			material.shader = SCENE_SHADER_STANDARD;
+
+			SceneToken flag;
+			while (tokens.Next(flag))
+			{
+				if (flag.Is("particle")) material.shader = SCENE_SHADER_PARTICLE;
+				else if (flag.Is("translucent")) material.translucent = 1;
+				else return Fail(line, "unknown material flag");
+			}
+
+			if (!anonymous && !materialNames.emplace(name.ToString(), (unsigned int)materials.size()).second)
+				return Fail(line, "material name already used");
+			materials.push_back(material);
+		}
+		else if (word.Is("static") || word.Is("exhibit") || word.Is("node"))
+		{
+			SceneEntity entity = {};
+			entity.name = nameOffset;
+			entity.group = word.Is("static") ? SCENE_GROUP_STATIC : word.Is("exhibit") ? SCENE_GROUP_EXHIBIT : SCENE_GROUP_NODE;
+			entity.mesh = SCENE_NONE;
+			entity.material = SCENE_NONE;
+			entity.parent = SCENE_NONE;
+			entity.scale = XMFLOAT3(1, 1, 1);
+
+			if (entity.group != SCENE_GROUP_NODE)
+			{
+				SceneToken mesh, material;
+				if (!tokens.Next(mesh) || !tokens.Next(material))
+					return Fail(line, "entity needs a mesh and a material");
+
+				entity.mesh = Resolve(meshNames, mesh);
+				entity.material = Resolve(materialNames, material);
+				if (entity.mesh == SCENE_NONE) return Fail(line, "unknown mesh");
+				if (entity.material == SCENE_NONE) return Fail(line, "unknown material");
+			}
+
+			SceneToken option;
+			while (tokens.Next(option))
+			{
+				bool read;
+				if (option.Is("position")) read = tokens.ReadFloat3(entity.position);
+				else if (option.Is("rotation")) read = tokens.ReadFloat3(entity.rotation);
+				else if (option.Is("scale")) read = tokens.ReadFloat3(entity.scale);
+				else if (option.Is("spin")) read = tokens.ReadFloat(entity.spin);
+				else if (option.Is("jitter")) read = tokens.ReadFloat(entity.jitter);
+				else if (option.Is("parent"))
+				{
+					SceneToken parent;
+					read = tokens.Next(parent);
+					if (read) entity.parent = Resolve(entityNames, parent);
+					if (read && entity.parent == SCENE_NONE) return Fail(line, "unknown parent");
+				}
+				else return Fail(line, "unknown entity option");
+
+				if (!read) return Fail(line, "bad value for an entity option");
+			}
+
+			if (!anonymous && !entityNames.emplace(name.ToString(), (unsigned int)entities.size()).second)
+				return Fail(line, "entity name already used");
+			entities.push_back(entity);
+		}
+		else if (word.Is("bounds"))
+		{
+			SceneBounds box = {};
+			if (name.Is("world")) box.type = SCENE_BOUNDS_WORLD;
+			else if (name.Is("doorway")) box.type = SCENE_BOUNDS_DOORWAY;
+			else if (name.Is("exhibit")) box.type = SCENE_BOUNDS_EXHIBIT;
+			else return Fail(line, "bounds must be world, doorway or exhibit");
+
+			if (!tokens.ReadFloat3(box.min) || !tokens.ReadFloat3(box.max))
+				return Fail(line, "bounds need a min and a max corner");
+
+			bounds.push_back(box);
+		}
+		else if (word.Is("emitter"))
+		{
+			SceneToken material;
+			if (!tokens.Next(material)) return Fail(line, "emitter needs a material");
+
+			SceneEmitter emitter = {};
+			emitter.name = nameOffset;
+			emitter.material = Resolve(materialNames, material);
+			if (emitter.material == SCENE_NONE) return Fail(line, "unknown material");
+
+			emitter.startColor = XMFLOAT4(1, 1, 1, 1);
+			emitter.endColor = XMFLOAT4(0, 0, 0, 1);
+			emitter.startSize = 1.0f;
+			emitter.endSize = 1.0f;
+			emitter.maxParticles = 1000;
+			emitter.emissionRate = 20.0f;
+			emitter.lifetime = 2.0f;
+			emitter.spreadAngles = PARTICLE_SPREAD_ANGLES;
+			emitter.spreadCalmness = PARTICLE_SPREAD_CALMNESS;
+			emitter.firstColorKey = (unsigned int)colorKeys.size();
+
+			SceneToken option;
+			while (tokens.Next(option))
+			{
+				bool read;
+				if (option.Is("position")) read = tokens.ReadFloat3(emitter.position);
+				else if (option.Is("velocity")) read = tokens.ReadFloat3(emitter.velocity);
+				else if (option.Is("colors")) read = tokens.ReadFloat4(emitter.startColor) && tokens.ReadFloat4(emitter.endColor);
+				else if (option.Is("sizes")) read = tokens.ReadFloat(emitter.startSize) && tokens.ReadFloat(emitter.endSize);
+				else if (option.Is("particles")) read = tokens.ReadUInt(emitter.maxParticles);
+				else if (option.Is("rate")) read = tokens.ReadFloat(emitter.emissionRate);
+				else if (option.Is("lifetime")) read = tokens.ReadFloat(emitter.lifetime);
+				else if (option.Is("spread"))
+				{
+					read = tokens.ReadUInt(emitter.spreadAngles) && tokens.ReadFloat(emitter.spreadCalmness);
+					if (read && (emitter.spreadAngles == 0 || emitter.spreadCalmness <= 0.0f))
+						return Fail(line, "spread needs at least 1 angle and a positive calmness");
+				}
+				else if (option.Is("collide"))
+				{
+					emitter.collide = 1;
+					read = true;
+				}
+				else if (option.Is("key"))
+				{
+					ParticleColorKey key;
+					read = tokens.ReadFloat(key.time) && tokens.ReadFloat4(key.color);
+					if (read && emitter.colorKeyCount > 0 && key.time < colorKeys.back().time)
+						return Fail(line, "color keys must be in time order");
+
+					colorKeys.push_back(key);
+					emitter.colorKeyCount++;
+				}
+				else return Fail(line, "unknown emitter option");
+
+				if (!read) return Fail(line, "bad value for an emitter option");
+			}
+
+			emitters.push_back(emitter);
+		}
+		else return Fail(line, "unknown record");
+
+		// Anything left over on a record with a fixed layout is a mistake
+		if (tokens.Next(word)) return Fail(line, "unexpected text after the record");
+		tokens.NextLine();
+	}
+
+	return true;
+}
+
+bool Scene::LoadBinary(const char* path)
+{
+	error.clear();
+
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file.is_open()) return Fail(0, "can't open the scene file");
+	unsigned long long fileBytes = (unsigned long long)file.tellg();
+	file.seekg(0);
+
+	SceneBinaryHeader header;
+	file.read((char*)&header, sizeof(header));
+	if (!file || header.magic != SCENE_BINARY_MAGIC) return Fail(0, "not a binary scene");
+	if (header.version != SCENE_BINARY_VERSION) return Fail(0, "unsupported binary scene version");
+	if (header.stringBytes == 0) return Fail(0, "binary scene has no string pool");
+
+	// Counts come straight from the file, so make sure it really holds
+	// that much before sizing anything by them (64-bit, so they can't wrap)
+	unsigned long long expected = sizeof(header) +
+		(unsigned long long)header.stringBytes +
+		(unsigned long long)header.meshCount * sizeof(SceneMesh) +
+		(unsigned long long)header.materialCount * sizeof(SceneMaterial) +
+		(unsigned long long)header.entityCount * sizeof(SceneEntity) +
+		(unsigned long long)header.boundsCount * sizeof(SceneBounds) +
+		(unsigned long long)header.emitterCount * sizeof(SceneEmitter) +
+		(unsigned long long)header.colorKeyCount * sizeof(ParticleColorKey);
+	if (expected > fileBytes) return Fail(0, "binary scene is truncated");
+
+	// Each array is read straight into its final home
+	strings.resize(header.stringBytes);
+	meshes.resize(header.meshCount);
+	materials.resize(header.materialCount);
+	entities.resize(header.entityCount);
+	bounds.resize(header.boundsCount);
+	emitters.resize(header.emitterCount);
+	colorKeys.resize(header.colorKeyCount);
+
+	file.read(strings.data(), strings.size());
+	file.read((char*)meshes.data(), meshes.size() * sizeof(SceneMesh));
+	file.read((char*)materials.data(), materials.size() * sizeof(SceneMaterial));
+	file.read((char*)entities.data(), entities.size() * sizeof(SceneEntity));
+	file.read((char*)bounds.data(), bounds.size() * sizeof(SceneBounds));
+	file.read((char*)emitters.data(), emitters.size() * sizeof(SceneEmitter));
+	file.read((char*)colorKeys.data(), colorKeys.size() * sizeof(ParticleColorKey));
+	if (!file) return Fail(0, "binary scene is truncated");
+
+	return Validate();
+}
+
+bool Scene::SaveBinary(const char* path)
+{
+	std::ofstream file(path, std::ios::binary);
+	if (!file.is_open()) return false;
+
+	SceneBinaryHeader header;
+	header.magic = SCENE_BINARY_MAGIC;
+	header.version = SCENE_BINARY_VERSION;
+	header.stringBytes = (unsigned int)strings.size();
+	header.meshCount = (unsigned int)meshes.size();
+	header.materialCount = (unsigned int)materials.size();
+	header.entityCount = (unsigned int)entities.size();
+	header.boundsCount = (unsigned int)bounds.size();
+	header.emitterCount = (unsigned int)emitters.size();
+	header.colorKeyCount = (unsigned int)colorKeys.size();
+
+	file.write((char*)&header, sizeof(header));
+	file.write(strings.data(), strings.size());
+	file.write((char*)meshes.data(), meshes.size() * sizeof(SceneMesh));
+	file.write((char*)materials.data(), materials.size() * sizeof(SceneMaterial));
+	file.write((char*)entities.data(), entities.size() * sizeof(SceneEntity));
+	file.write((char*)bounds.data(), bounds.size() * sizeof(SceneBounds));
+	file.write((char*)emitters.data(), emitters.size() * sizeof(SceneEmitter));
+	file.write((char*)colorKeys.data(), colorKeys.size() * sizeof(ParticleColorKey));
+	return file.good();
+}
+
+bool Scene::Validate()
+{
+	unsigned int stringBytes = (unsigned int)strings.size();
+	if (strings.back() != '\0') return Fail(0, "binary scene string pool isn't terminated");
+
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		if (meshes[i].name >= stringBytes || meshes[i].path >= stringBytes)
+			return Fail(0, "binary scene has a bad mesh");
+	}
+
+	for (size_t i = 0; i < materials.size(); i++)
+	{
+		SceneMaterial& m = materials[i];
+		if (m.name >= stringBytes || m.texture >= stringBytes || m.specularMap >= stringBytes || m.normalMap >= stringBytes ||
+			m.shader > SCENE_SHADER_PARTICLE || m.translucent > 1)
+			return Fail(0, "binary scene has a bad material");
+	}
+
+	for (size_t i = 0; i < entities.size(); i++)
+	{
+		SceneEntity& e = entities[i];
+		bool node = e.group == SCENE_GROUP_NODE;
+		if (e.name >= stringBytes || e.group > SCENE_GROUP_NODE ||
+			(!node && (e.mesh >= meshes.size() || e.material >= materials.size())) ||
+			(e.parent != SCENE_NONE && e.parent >= i))
+			return Fail(0, "binary scene has a bad entity");
+	}
+
+	for (size_t i = 0; i < bounds.size(); i++)
+	{
+		if (bounds[i].type > SCENE_BOUNDS_DOORWAY)
+			return Fail(0, "binary scene has bad bounds");
+	}
+
+	for (size_t i = 0; i < emitters.size(); i++)
+	{
+		SceneEmitter& e = emitters[i];
+		if (e.name >= stringBytes || e.material >= materials.size() ||
+			e.firstColorKey > colorKeys.size() || e.colorKeyCount > colorKeys.size() - e.firstColorKey ||
+			e.spreadAngles == 0 || !(e.spreadCalmness > 0.0f))
+			return Fail(0, "binary scene has a bad emitter");
+	}
+
+	return true;
+}
+
+unsigned int Scene::FindMesh(const char* name)
+{
+	for (size_t i = 0; i < meshes.size(); i++)
+		if (strcmp(GetString(meshes[i].name), name) == 0) return (unsigned int)i;
+	return SCENE_NONE;
+}
+
+unsigned int Scene::FindMaterial(const char* name)
+{
+	for (size_t i = 0; i < materials.size(); i++)
+		if (strcmp(GetString(materials[i].name), name) == 0) return (unsigned int)i;
+	return SCENE_NONE;
+}
+
+unsigned int Scene::FindEntity(const char* name)
+{
+	for (size_t i = 0; i < entities.size(); i++)
+		if (strcmp(GetString(entities[i].name), name) == 0) return (unsigned int)i;
+	return SCENE_NONE;
+}
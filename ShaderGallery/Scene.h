@@ -0,0 +1,187 @@
+#pragma once
+#include <DirectXMath.h>
+#include <string>
+#include <vector>
+
+#include "ParticleCurves.h"
+
+// Reference to nothing (no parent, no mesh, not found)
+#define SCENE_NONE 0xFFFFFFFF
+
+#define SCENE_BINARY_MAGIC 0x4E435347	// "GSCN"
+#define SCENE_BINARY_VERSION 1
+
+// What an entity record becomes
+enum SceneGroup
+{
+	SCENE_GROUP_STATIC,		// Drawn, not rateable (the building, benches)
+	SCENE_GROUP_EXHIBIT,	// Drawn and rateable
+	SCENE_GROUP_NODE		// Bare transform for others to hang off
+};
+
+enum SceneShader
+{
+	SCENE_SHADER_STANDARD,
+	SCENE_SHADER_PARTICLE
+};
+
+enum SceneBoundsType
+{
+	SCENE_BOUNDS_WORLD,		// Walkable area
+	SCENE_BOUNDS_EXHIBIT,
+	SCENE_BOUNDS_DOORWAY	// Walkable, and joins the rooms it touches
+};
+
+// --------------------------------------------------------
+// Records.  Everything is plain data with fixed-size fields
+// so the binary form is just these arrays back to back.
+// Names and paths are offsets into the scene's string pool.
+// --------------------------------------------------------
+struct SceneMesh
+{
+	unsigned int name;
+	unsigned int path;
+};
+
+struct SceneMaterial
+{
+	unsigned int name;
+	unsigned int texture;
+	unsigned int specularMap;
+	unsigned int normalMap;
+	unsigned int shader;		// SceneShader
+	unsigned int translucent;
+};
+
+struct SceneEntity
+{
+	unsigned int name;
+	unsigned int group;			// SceneGroup
+	unsigned int mesh;			// SCENE_NONE for nodes
+	unsigned int material;
+	unsigned int parent;		// Index of an earlier entity record, or SCENE_NONE
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT3 rotation;
+	DirectX::XMFLOAT3 scale;
+	float spin;					// Radians per second around y
+	float jitter;				// Random shake each frame
+};
+
+struct SceneBounds
+{
+	unsigned int type;			// SceneBoundsType
+	DirectX::XMFLOAT3 min;
+	DirectX::XMFLOAT3 max;
+};
+
+struct SceneEmitter
+{
+	unsigned int name;
+	unsigned int material;
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT3 velocity;
+	DirectX::XMFLOAT4 startColor;
+	DirectX::XMFLOAT4 endColor;
+	float startSize;
+	float endSize;
+	unsigned int maxParticles;
+	float emissionRate;
+	float lifetime;
+	unsigned int firstColorKey;	// Optional gradient, in the scene's color keys
+	unsigned int colorKeyCount;
+	unsigned int collide;		// Bounce off the world bounds
+	unsigned int spreadAngles;	// Random x/z spread at spawn (see Emitter::SetSpread)
+	float spreadCalmness;
+};
+
+// --------------------------------------------------------
+// Everything placed in a gallery: meshes, materials,
+// entities, bounds and emitters, each kept in one array and
+// referring to each other by index.
+//
+// The text form is for authoring; one record per line:
+//
+//   mesh <name> <path>
+//   material <name> <texture> <specular> <normal> [particle] [translucent]
+//   static|exhibit <name> <mesh> <material> [options]
+//   node <name> [options]
+//   bounds world|doorway|exhibit <minX> <minY> <minZ> <maxX> <maxY> <maxZ>
+//   emitter <name> <material> [emitter options]
+//
+// Entity options: position x y z, rotation x y z, scale x y z,
+// parent <name>, spin <rate>, jitter <amount>.
+// Emitter options: position x y z, velocity x y z,
+// colors <start rgba> <end rgba>, sizes <start> <end>,
+// particles <max>, rate <per second>, lifetime <seconds>,
+// key <time> <rgba> (repeatable), spread <angles> <calmness>,
+// collide.
+//
+// Names are resolved as they're read, so anything referred
+// to has to come earlier in the file.  '#' starts a comment
+// and "-" is an anonymous name.
+//
+// The binary form is the same arrays, written back to back
+// after a header, and is read straight into place.
+// --------------------------------------------------------
+class Scene
+{
+public:
+	Scene();
+	~Scene();
+
+	// Picks the binary or text reader from the file's first bytes
+	bool Load(const char* path);
+	bool LoadText(const char* path);
+	bool LoadBinary(const char* path);
+	bool SaveBinary(const char* path);
+
+	// Parses text already in memory (must be null terminated)
+	bool ParseText(const char* text, unsigned int length);
+
+	// Building a scene in code (see SceneGenerator).  Records are taken
+	// as they are; parents must come before their children.
+	unsigned int AddName(const char* name);
+	unsigned int AddEntity(const SceneEntity& entity);
+	void AddBounds(const SceneBounds& box);
+	void AddEmitter(SceneEmitter emitter, const ParticleColorKey* keys, unsigned int keyCount);
+
+	// Drops the entities, bounds and emitters but keeps the meshes and materials
+	void ClearLayout();
+
+	// Why the last load failed
+	const std::string& GetError() { return error; }
+
+	const char* GetString(unsigned int offset) { return &strings[offset]; }
+
+	// Linear searches by name; fine for the handful of lookups at startup
+	unsigned int FindMesh(const char* name);
+	unsigned int FindMaterial(const char* name);
+	unsigned int FindEntity(const char* name);
+
+	const std::vector<SceneMesh>& GetMeshes() { return meshes; }
+	const std::vector<SceneMaterial>& GetMaterials() { return materials; }
+	const std::vector<SceneEntity>& GetEntities() { return entities; }
+	const std::vector<SceneBounds>& GetBounds() { return bounds; }
+	const std::vector<SceneEmitter>& GetEmitters() { return emitters; }
+	const ParticleColorKey* GetColorKeys(unsigned int first) { return &colorKeys[first]; }
+
+private:
+	void Clear();
+	unsigned int AddString(const char* text, unsigned int length);
+
+	// Records the error (with its line for text) and empties the scene
+	bool Fail(unsigned int line, const char* message);
+
+	// Checks every index in a freshly read binary scene
+	bool Validate();
+
+	std::vector<char> strings;
+	std::vector<SceneMesh> meshes;
+	std::vector<SceneMaterial> materials;
+	std::vector<SceneEntity> entities;
+	std::vector<SceneBounds> bounds;
+	std::vector<SceneEmitter> emitters;
+	std::vector<ParticleColorKey> colorKeys;
+
+	std::string error;
+};
@@ -0,0 +1,310 @@
+#include "SceneGenerator.h"
+#include "Particle.h"
+
+#include <math.h>
+
+using namespace DirectX;
+
+#define PI 3.14159265f
+
+// Walls of a room, also the bits in doors
+#define WALL_WEST 0
+#define WALL_NORTH 1
+#define WALL_EAST 2
+#define WALL_SOUTH 3
+
+// Walkable floor stops this far short of the walls
+#define WALL_CLEARANCE 0.5f
+
+// Room for one painting along a wall
+#define PAINTING_SPACING 2.5f
+
+SceneGenerator::SceneGenerator(SceneGeneratorSettings settings)
+{
+	this->settings = settings;
+	columns = 1;
+}
+
+SceneGenerator::~SceneGenerator()
+{
+}
+
+bool SceneGenerator::Generate(Scene* scene)
+{
+	error.clear();
+	if (!FindPalette(scene)) return false;
+
+	scene->ClearLayout();
+	random.Seed(settings.seed);
+
+	unsigned int roomCount = settings.roomCount > 0 ? settings.roomCount : 1;
+	columns = (unsigned int)ceilf(sqrtf((float)roomCount));
+	doors.assign(roomCount, 0);
+
+	for (unsigned int room = 0; room < roomCount; room++)
+	{
+		AddRoom(scene, room);
+	}
+
+	// Every room joins the one to its west, and the first column
+	// joins north to south, so everything is reachable from room 0
+	for (unsigned int room = 1; room < roomCount; room++)
+	{
+		unsigned int column = room % columns;
+		if (column > 0) AddDoorway(scene, room, room - 1);
+		else AddDoorway(scene, room, room - columns);
+	}
+
+	// Then some loops, so there's more than one way around
+	for (unsigned int room = columns; room < roomCount; room++)
+	{
+		if (room % columns == 0) continue;
+		if (random.NextFloat() < settings.extraDoorwayChance) AddDoorway(scene, room, room - columns);
+	}
+
+	for (unsigned int room = 0; room < roomCount; room++)
+	{
+		AddPaintings(scene, room, Roll(settings.paintingsPerRoom));
+		AddFloorPieces(scene, room);
+	}
+
+	return true;
+}
+
+XMFLOAT3 SceneGenerator::GetRoomCenter(unsigned int room)
+{
+	float pitch = settings.roomSize + settings.doorwayLength;
+	return XMFLOAT3((room % columns) * pitch, 0, -(float)(room / columns) * pitch);
+}
+
+bool SceneGenerator::FindPalette(Scene* scene)
+{
+	paintingMeshes[0] = scene->FindMesh("painting_small_h");
+	paintingMeshes[1] = scene->FindMesh("painting_large");
+	benchMesh = scene->FindMesh("bench");
+	benchMaterial = scene->FindMaterial("bench");
+	shellMesh = scene->FindMesh("cube_inverted");
+	shellMaterial = scene->FindMaterial("white");
+	particleMaterial = scene->FindMaterial("particle");
+
+	if (paintingMeshes[0] == SCENE_NONE || paintingMeshes[1] == SCENE_NONE ||
+		benchMesh == SCENE_NONE || benchMaterial == SCENE_NONE ||
+		shellMesh == SCENE_NONE || shellMaterial == SCENE_NONE ||
+		particleMaterial == SCENE_NONE)
+	{
+		error = "the scene is missing a mesh or material the generator needs";
+		return false;
+	}
+
+	// Whichever of these the scene has
+	const char* paintings[] = { "painting_0", "painting_1", "painting_2", "painting_3", "painting_4" };
+	const char* sculptures[] = { "sculpture1", "sculpture2", "sculpture3", "big_sculpture" };
+	const char* finishes[] = { "marble", "gold", "volcanic", "cheese" };
+
+	paintingMaterials.clear();
+	sculptureMeshes.clear();
+	sculptureMaterials.clear();
+	for (int i = 0; i < 5; i++)
+	{
+		unsigned int material = scene->FindMaterial(paintings[i]);
+		if (material != SCENE_NONE) paintingMaterials.push_back(material);
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		unsigned int mesh = scene->FindMesh(sculptures[i]);
+		unsigned int material = scene->FindMaterial(finishes[i]);
+		if (mesh != SCENE_NONE) sculptureMeshes.push_back(mesh);
+		if (material != SCENE_NONE) sculptureMaterials.push_back(material);
+	}
+
+	if (paintingMaterials.empty() || sculptureMeshes.empty() || sculptureMaterials.empty())
+	{
+		error = "the scene has no paintings or sculptures to place";
+		return false;
+	}
+	return true;
+}
+
+unsigned int SceneGenerator::Roll(float density)
+{
+	// Always draw, so one density doesn't shift everything after it
+	unsigned int count = (unsigned int)density;
+	if (random.NextFloat() < density - count) count++;
+	return count;
+}
+
+SceneEntity SceneGenerator::MakeEntity(unsigned int group, unsigned int mesh, unsigned int material)
+{
+	SceneEntity entity = {};
+	entity.group = group;
+	entity.mesh = mesh;
+	entity.material = material;
+	entity.parent = SCENE_NONE;
+	entity.scale = XMFLOAT3(1, 1, 1);
+	return entity;
+}
+
+XMFLOAT3 SceneGenerator::RandomFloorPoint(unsigned int room, float margin)
+{
+	XMFLOAT3 center = GetRoomCenter(room);
+	float extent = settings.roomSize / 2 - margin;
+	if (extent < 0) extent = 0;
+
+	float x = random.NextFloat(-extent, extent);
+	float z = random.NextFloat(-extent, extent);
+	return XMFLOAT3(center.x + x, 0, center.z + z);
+}
+
+void SceneGenerator::AddRoom(Scene* scene, unsigned int room)
+{
+	XMFLOAT3 center = GetRoomCenter(room);
+	float half = settings.roomSize / 2;
+	float walkable = half - WALL_CLEARANCE;
+
+	SceneBounds floor = {};
+	floor.type = SCENE_BOUNDS_WORLD;
+	floor.min = XMFLOAT3(center.x - walkable, 0, center.z - walkable);
+	floor.max = XMFLOAT3(center.x + walkable, 0, center.z + walkable);
+	scene->AddBounds(floor);
+
+	if (settings.roomShells)
+	{
+		// The inverted cube spans -1 to 1; put its floor at the gallery's
+		SceneEntity shell = MakeEntity(SCENE_GROUP_STATIC, shellMesh, shellMaterial);
+		shell.position = XMFLOAT3(center.x, 2.0f, center.z);
+		shell.scale = XMFLOAT3(half, 2.5f, half);
+		scene->AddEntity(shell);
+	}
+}
+
+void SceneGenerator::AddDoorway(Scene* scene, unsigned int room, unsigned int neighbor)
+{
+	XMFLOAT3 a = GetRoomCenter(room);
+	XMFLOAT3 b = GetRoomCenter(neighbor);
+	XMFLOAT3 middle((a.x + b.x) / 2, 0, (a.z + b.z) / 2);
+
+	// Long enough to reach into both rooms' walkable floor
+	float length = settings.doorwayLength / 2 + WALL_CLEARANCE * 2;
+	float width = settings.doorwayWidth / 2;
+
+	bool west = a.z == b.z;
+	XMFLOAT3 extent = west ? XMFLOAT3(length, 0, width) : XMFLOAT3(width, 0, length);
+
+	SceneBounds doorway = {};
+	doorway.type = SCENE_BOUNDS_DOORWAY;
+	doorway.min = XMFLOAT3(middle.x - extent.x, 0, middle.z - extent.z);
+	doorway.max = XMFLOAT3(middle.x + extent.x, 0, middle.z + extent.z);
+	scene->AddBounds(doorway);
+
+	// The neighbor is always west of or north of the room
+	doors[room] |= 1 << (west ? WALL_WEST : WALL_NORTH);
+	doors[neighbor] |= 1 << (west ? WALL_EAST : WALL_SOUTH);
+}
+
+void SceneGenerator::AddPaintings(Scene* scene, unsigned int room, unsigned int count)
+{
+	XMFLOAT3 center = GetRoomCenter(room);
+	float half = settings.roomSize / 2;
+	float inset = half - 0.1f;
+
+	// Every free spot along the walls, skipping doors
+	struct Slot { unsigned int wall; float offset; };
+	Slot slots[256];
+	unsigned int slotCount = 0;
+
+	float clearDoor = settings.doorwayWidth / 2 + PAINTING_SPACING / 2;
+	for (unsigned int wall = 0; wall < 4; wall++)
+	{
+		for (float offset = -half + PAINTING_SPACING; offset <= half - PAINTING_SPACING && slotCount < 256; offset += PAINTING_SPACING)
+		{
+			if ((doors[room] >> wall & 1) && fabsf(offset) < clearDoor) continue;
+			Slot slot = { wall, offset };
+			slots[slotCount++] = slot;
+		}
+	}
+
+	if (count > slotCount) count = slotCount;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		// Partial shuffle, so no spot is used twice
+		unsigned int pick = random.NextInt(i, slotCount - 1);
+		Slot slot = slots[pick];
+		slots[pick] = slots[i];
+		slots[i] = slot;
+
+		unsigned int large = random.NextInt(0, 1);
+		unsigned int material = paintingMaterials[random.NextInt(0, (int)paintingMaterials.size() - 1)];
+		SceneEntity painting = MakeEntity(SCENE_GROUP_EXHIBIT, paintingMeshes[large], material);
+
+		// The small painting faces +x unrotated, so hangs on the west wall;
+		// the large one faces -z, the north wall
+		float height = large ? 2.0f : 1.5f;
+		float facing = slot.wall * (PI / 2) - (large ? PI / 2 : 0);
+		switch (slot.wall)
+		{
+		case WALL_WEST: painting.position = XMFLOAT3(center.x - inset, height, center.z + slot.offset); break;
+		case WALL_NORTH: painting.position = XMFLOAT3(center.x + slot.offset, height, center.z + inset); break;
+		case WALL_EAST: painting.position = XMFLOAT3(center.x + inset, height, center.z + slot.offset); break;
+		default: painting.position = XMFLOAT3(center.x + slot.offset, height, center.z - inset); break;
+		}
+		painting.rotation = XMFLOAT3(0, facing, 0);
+		scene->AddEntity(painting);
+	}
+}
+
+void SceneGenerator::AddFloorPieces(Scene* scene, unsigned int room)
+{
+	unsigned int sculptures = Roll(settings.sculpturesPerRoom);
+	for (unsigned int i = 0; i < sculptures; i++)
+	{
+		unsigned int mesh = sculptureMeshes[random.NextInt(0, (int)sculptureMeshes.size() - 1)];
+		unsigned int material = sculptureMaterials[random.NextInt(0, (int)sculptureMaterials.size() - 1)];
+		SceneEntity sculpture = MakeEntity(SCENE_GROUP_EXHIBIT, mesh, material);
+
+		sculpture.position = RandomFloorPoint(room, 2.5f);
+		sculpture.position.y = -0.5f;
+		sculpture.rotation = XMFLOAT3(0, random.NextFloat(0, 2 * PI), 0);
+		scene->AddEntity(sculpture);
+	}
+
+	unsigned int benches = Roll(settings.benchesPerRoom);
+	for (unsigned int i = 0; i < benches; i++)
+	{
+		SceneEntity bench = MakeEntity(SCENE_GROUP_STATIC, benchMesh, benchMaterial);
+		bench.position = RandomFloorPoint(room, 2.0f);
+		bench.position.y = -0.65f;
+		bench.rotation = XMFLOAT3(0, random.NextInt(0, 1) * (PI / 2), 0);
+		bench.scale = XMFLOAT3(0.5f, 0.5f, 0.5f);
+		scene->AddEntity(bench);
+	}
+
+	// The hand-made gallery's fire, run through a gradient so stress
+	// scenes pay for the color curves: white hot, cooling to orange
+	static const ParticleColorKey fireColors[] = {
+		{ 0.0f, XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f) },
+		{ 0.25f, XMFLOAT4(1.0f, 0.85f, 0.4f, 1.0f) },
+		{ 0.6f, XMFLOAT4(0.9f, 0.35f, 0.1f, 1.0f) },
+		{ 1.0f, XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f) }
+	};
+
+	unsigned int fires = Roll(settings.emittersPerRoom);
+	for (unsigned int i = 0; i < fires; i++)
+	{
+		SceneEmitter fire = {};
+		fire.material = particleMaterial;
+		fire.position = RandomFloorPoint(room, 2.0f);
+		fire.position.y = 1.5f;
+		fire.velocity = XMFLOAT3(0.1f, 0.003125f, 0.1f);
+		fire.startColor = XMFLOAT4(1, 1, 1, 1);
+		fire.endColor = XMFLOAT4(0, 0, 0, 1);
+		fire.startSize = 1.25f;
+		fire.endSize = 0.45f;
+		fire.maxParticles = 1000;
+		fire.emissionRate = 20.0f;
+		fire.lifetime = 2.0f;
+		fire.spreadAngles = PARTICLE_SPREAD_ANGLES;
+		fire.spreadCalmness = PARTICLE_SPREAD_CALMNESS;
+		fire.collide = 1;
+		scene->AddEmitter(fire, fireColors, 4);
+	}
+}
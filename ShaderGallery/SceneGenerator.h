@@ -0,0 +1,95 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "Random.h"
+#include "Scene.h"
+
+// --------------------------------------------------------
+// Knobs for a generated gallery.  Densities are averages per
+// room; the fraction is rolled, so 0.25 emitters per room
+// puts one in about every fourth room.
+// --------------------------------------------------------
+struct SceneGeneratorSettings
+{
+	unsigned int roomCount = 4;
+	unsigned int seed = 1;
+
+	float roomSize = 12.0f;			// Rooms are square, on a grid
+	float doorwayLength = 2.5f;		// Gap between neighboring rooms
+	float doorwayWidth = 3.0f;
+	float extraDoorwayChance = 0.5f;	// Doors beyond the ones that keep every room reachable
+
+	float paintingsPerRoom = 6.0f;
+	float sculpturesPerRoom = 2.0f;
+	float benchesPerRoom = 1.0f;
+	float emittersPerRoom = 0.25f;
+
+	// Put walls around each room (an inverted cube), so there's
+	// something to occlude with
+	bool roomShells = true;
+};
+
+// --------------------------------------------------------
+// Lays out a gallery of any size for scaling tests.
+//
+// Rooms sit on a grid around the origin's room, each joined
+// to its west neighbor and the first column joined north to
+// south, so every room can be reached; extra doors are then
+// rolled between the rest.  Rooms and doorways go into the
+// scene as world and doorway bounds, the same way the
+// hand-made gallery describes its floor.  Paintings hang on
+// the walls (never over a door), sculptures, benches and
+// emitters go on the floor.
+//
+// The scene passed in supplies the meshes and materials (the
+// gallery's, found by name) and keeps them; its entities,
+// bounds and emitters are replaced.  Nothing here touches
+// D3D, so it can run headless.  The same settings and seed
+// always give the same gallery.
+// --------------------------------------------------------
+class SceneGenerator
+{
+public:
+	SceneGenerator(SceneGeneratorSettings settings);
+	~SceneGenerator();
+
+	bool Generate(Scene* scene);
+
+	// Why the last Generate() failed (a missing mesh or material)
+	const std::string& GetError() { return error; }
+
+	// Center of a room, in the order they were laid out (room 0 holds the origin)
+	DirectX::XMFLOAT3 GetRoomCenter(unsigned int room);
+
+private:
+	bool FindPalette(Scene* scene);
+	unsigned int Roll(float density);
+
+	void AddRoom(Scene* scene, unsigned int room);
+	void AddDoorway(Scene* scene, unsigned int a, unsigned int b);
+	void AddPaintings(Scene* scene, unsigned int room, unsigned int count);
+	void AddFloorPieces(Scene* scene, unsigned int room);
+
+	SceneEntity MakeEntity(unsigned int group, unsigned int mesh, unsigned int material);
+	DirectX::XMFLOAT3 RandomFloorPoint(unsigned int room, float margin);
+
+	SceneGeneratorSettings settings;
+	Random random;
+	unsigned int columns;
+	std::string error;
+
+	// From the scene being filled
+	unsigned int paintingMeshes[2];			// Small (faces +x unrotated), large (faces -z)
+	std::vector<unsigned int> paintingMaterials;
+	std::vector<unsigned int> sculptureMeshes;
+	std::vector<unsigned int> sculptureMaterials;
+	unsigned int benchMesh;
+	unsigned int benchMaterial;
+	unsigned int shellMesh;
+	unsigned int shellMaterial;
+	unsigned int particleMaterial;
+
+	// Which walls of each room have a door (west, north, east, south bits)
+	std::vector<unsigned char> doors;
+};
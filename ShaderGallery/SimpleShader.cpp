@@ -675,6 +675,11 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		D3D11_SIGNATURE_PARAMETER_DESC paramDesc;
 		refl->GetInputParameterDesc(i, &paramDesc);
 
+		// System values (like SV_VertexID) are generated by the
+		// pipeline, not read from a vertex buffer
+		if (paramDesc.SystemValueType != D3D_NAME_UNDEFINED)
+			continue;
+
 		// Check the semantic name for "_PER_INSTANCE"
 		std::string perInstanceStr = "_PER_INSTANCE";
 		std::string sem = paramDesc.SemanticName;
@@ -732,6 +737,13 @@ bool SimpleVertexShader::CreateShader(ID3DBlob* shaderBlob)
 		inputLayoutDesc.push_back(elementDesc);
 	}
 
+	// Nothing to read from vertex buffers, so no layout is needed
+	if (inputLayoutDesc.size() == 0)
+	{
+		refl->Release();
+		return true;
+	}
+
 	// Try to create Input Layout
 	HRESULT hr = device->CreateInputLayout(
 		&inputLayoutDesc[0], 
@@ -0,0 +1,200 @@
+#include "SpatialHash.h"
+
+#include <float.h>
+
+// Buckets to start with, and how many items a bucket holds on average
+// before the table doubles
+#define SPATIAL_HASH_MIN_BUCKETS 64
+#define SPATIAL_HASH_LOAD 1
+
+using namespace DirectX;
+
+SpatialHash::SpatialHash(float cellSize)
+{
+	this->cellSize = cellSize > 0 ? cellSize : 1.0f;
+	inverseCellSize = 1.0f / this->cellSize;
+	count = 0;
+	heads.assign(SPATIAL_HASH_MIN_BUCKETS, SPATIAL_HASH_NONE);
+}
+
+SpatialHash::~SpatialHash()
+{
+}
+
+unsigned int SpatialHash::BucketOf(int cellX, int cellZ)
+{
+	// Two big odd multipliers spread neighbouring cells over the table
+	unsigned int h = (unsigned int)cellX * 0x9E3779B1u ^ (unsigned int)cellZ * 0x85EBCA77u;
+	h ^= h >> 15;
+	return h & (unsigned int)(heads.size() - 1);
+}
+
+void SpatialHash::Link(unsigned int id)
+{
+	unsigned int bucket = BucketOf(cellX[id], cellZ[id]);
+	next[id] = heads[bucket];
+	heads[bucket] = id;
+}
+
+void SpatialHash::Unlink(unsigned int id)
+{
+	// Chains are about one long, so walking one is cheaper than keeping back links
+	unsigned int* link = &heads[BucketOf(cellX[id], cellZ[id])];
+	while (*link != id)
+	{
+		link = &next[*link];
+	}
+	*link = next[id];
+}
+
+void SpatialHash::Rehash(unsigned int bucketCount)
+{
+	heads.assign(bucketCount, SPATIAL_HASH_NONE);
+	for (unsigned int id = 0; id < present.size(); id++)
+	{
+		if (present[id]) Link(id);
+	}
+}
+
+void SpatialHash::Insert(unsigned int id, XMFLOAT3 position)
+{
+	if (Contains(id))
+	{
+		Move(id, position);
+		return;
+	}
+
+	if (id >= present.size())
+	{
+		x.resize(id + 1, 0);
+		z.resize(id + 1, 0);
+		cellX.resize(id + 1, 0);
+		cellZ.resize(id + 1, 0);
+		next.resize(id + 1, SPATIAL_HASH_NONE);
+		present.resize(id + 1, 0);
+	}
+
+	x[id] = position.x;
+	z[id] = position.z;
+	cellX[id] = CellOf(position.x);
+	cellZ[id] = CellOf(position.z);
+	present[id] = 1;
+	count++;
+
+	if (count > heads.size() * SPATIAL_HASH_LOAD) Rehash((unsigned int)heads.size() * 2);
+	else Link(id);
+}
+
+void SpatialHash::Move(unsigned int id, XMFLOAT3 position)
+{
+	if (!Contains(id))
+	{
+		Insert(id, position);
+		return;
+	}
+
+	x[id] = position.x;
+	z[id] = position.z;
+
+	// Most moves stay in the same cell
+	int newX = CellOf(position.x);
+	int newZ = CellOf(position.z);
+	if (newX == cellX[id] && newZ == cellZ[id]) return;
+
+	Unlink(id);
+	cellX[id] = newX;
+	cellZ[id] = newZ;
+	Link(id);
+}
+
+void SpatialHash::Remove(unsigned int id)
+{
+	if (!Contains(id)) return;
+
+	Unlink(id);
+	present[id] = 0;
+	count--;
+}
+
+void SpatialHash::Clear()
+{
+	x.clear();
+	z.clear();
+	cellX.clear();
+	cellZ.clear();
+	next.clear();
+	present.clear();
+	heads.assign(SPATIAL_HASH_MIN_BUCKETS, SPATIAL_HASH_NONE);
+	count = 0;
+}
+
+template<typename Visitor>
+void SpatialHash::ForEachInRadius(XMFLOAT3 position, float radius, Visitor visit)
+{
+	if (count == 0 || radius <= 0) return;
+	float radiusSquared = radius * radius;
+
+	int minX = CellOf(position.x - radius);
+	int maxX = CellOf(position.x + radius);
+	int minZ = CellOf(position.z - radius);
+	int maxZ = CellOf(position.z + radius);
+
+	// A circle covering more cells than there are items is quicker to
+	// answer by just checking every item
+	double cells = ((double)maxX - minX + 1) * ((double)maxZ - minZ + 1);
+	if (cells > count)
+	{
+		for (unsigned int id = 0; id < present.size(); id++)
+		{
+			if (!present[id]) continue;
+			float dx = x[id] - position.x;
+			float dz = z[id] - position.z;
+			float distanceSquared = dx * dx + dz * dz;
+			if (distanceSquared < radiusSquared) visit(id, distanceSquared);
+		}
+		return;
+	}
+
+	for (int cz = minZ; cz <= maxZ; cz++)
+	{
+		for (int cx = minX; cx <= maxX; cx++)
+		{
+			for (unsigned int id = heads[BucketOf(cx, cz)]; id != SPATIAL_HASH_NONE; id = next[id])
+			{
+				// Other cells can share the bucket; skip them, or they'd be seen twice
+				if (cellX[id] != cx || cellZ[id] != cz) continue;
+
+				float dx = x[id] - position.x;
+				float dz = z[id] - position.z;
+				float distanceSquared = dx * dx + dz * dz;
+				if (distanceSquared < radiusSquared) visit(id, distanceSquared);
+			}
+		}
+	}
+}
+
+unsigned int SpatialHash::QueryRadius(XMFLOAT3 position, float radius, std::vector<unsigned int>& found)
+{
+	size_t before = found.size();
+	ForEachInRadius(position, radius, [&](unsigned int id, float)
+	{
+		found.push_back(id);
+	});
+	return (unsigned int)(found.size() - before);
+}
+
+unsigned int SpatialHash::FindNearest(XMFLOAT3 position, float radius)
+{
+	unsigned int nearest = SPATIAL_HASH_NONE;
+	float nearestSquared = FLT_MAX;
+	ForEachInRadius(position, radius, [&](unsigned int id, float distanceSquared)
+	{
+		// Ties go to the lower id, so the answer doesn't depend on chain order
+		if (distanceSquared < nearestSquared || (distanceSquared == nearestSquared && id < nearest))
+		{
+			nearest = id;
+			nearestSquared = distanceSquared;
+		}
+	});
+	return nearest;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <DirectXMath.h>
+#include <math.h>
+#include <vector>
+
+// What FindNearest() returns when nothing is in range
+#define SPATIAL_HASH_NONE 0xFFFFFFFF
+
+// --------------------------------------------------------
+// Uniform grid over the XZ plane, hashed so it needs no
+// bounds and only costs memory for cells that hold
+// something.
+//
+// Items are addressed by small ids (an exhibit's index, a
+// transform) and each remembers its position and cell, so
+// Move() only relinks it when it crosses into another cell.
+// Each bucket is a singly linked chain through the items;
+// the bucket count doubles as items are added, so chains
+// stay about one long.
+//
+// Radius queries only visit the cells the circle's square
+// covers and compare squared distances.  Pick a cell size
+// about as big as the usual query radius, so that's a 3x3
+// block of cells.
+// --------------------------------------------------------
+class SpatialHash
+{
+public:
+	SpatialHash(float cellSize);
+	~SpatialHash();
+
+	// Ids already in the hash are moved instead
+	void Insert(unsigned int id, DirectX::XMFLOAT3 position);
+	void Move(unsigned int id, DirectX::XMFLOAT3 position);
+	void Remove(unsigned int id);
+	void Clear();
+	bool Contains(unsigned int id) { return id < present.size() && present[id]; }
+
+	// Appends every id closer than radius (on XZ) to found, in no
+	// particular order.  Returns how many that was.
+	unsigned int QueryRadius(DirectX::XMFLOAT3 position, float radius, std::vector<unsigned int>& found);
+
+	// Closest id that's closer than radius, or SPATIAL_HASH_NONE
+	unsigned int FindNearest(DirectX::XMFLOAT3 position, float radius);
+
+	unsigned int GetCount() { return count; }
+	unsigned int GetBucketCount() { return (unsigned int)heads.size(); }
+	float GetCellSize() { return cellSize; }
+
+private:
+	int CellOf(float coordinate) { return (int)floorf(coordinate * inverseCellSize); }
+	unsigned int BucketOf(int cellX, int cellZ);
+	void Link(unsigned int id);
+	void Unlink(unsigned int id);
+	void Rehash(unsigned int bucketCount);
+
+	// Calls visit(id, squared distance) for everything closer than radius
+	template<typename Visitor>
+	void ForEachInRadius(DirectX::XMFLOAT3 position, float radius, Visitor visit);
+
+	float cellSize;
+	float inverseCellSize;
+	unsigned int count;
+
+	// Per id, structure-of-arrays so queries only touch what they test
+	std::vector<float> x;
+	std::vector<float> z;
+	std::vector<int> cellX;
+	std::vector<int> cellZ;
+	std::vector<unsigned int> next;
+	std::vector<unsigned char> present;
+
+	// First id in each bucket; always a power of two long
+	std::vector<unsigned int> heads;
+};
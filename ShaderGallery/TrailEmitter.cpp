@@ -0,0 +1,424 @@
+#include "TrailEmitter.h"
+
+#include <math.h>
+#include <xmmintrin.h>
+
+using namespace DirectX;
+
+TrailEmitter::TrailEmitter(
+	DirectX::XMFLOAT3 position,
+	DirectX::XMFLOAT3 startVelocity,
+	DirectX::XMFLOAT3 velocitySpread,
+	DirectX::XMFLOAT4 startColor,
+	DirectX::XMFLOAT4 endColor,
+	float width,
+	float gravity,
+	unsigned int maxTrailCount,
+	unsigned int pointsPerTrail,
+	float recordInterval,
+	float emissionRate,
+	float lifetime,
+	ID3D11Device* device,
+	SimpleVertexShader* vs,
+	SimplePixelShader* ps,
+	ID3D11ShaderResourceView* texture
+)
+{
+	this->position = position;
+	this->startVelocity = startVelocity;
+	this->velocitySpread = velocitySpread;
+	this->startColor = startColor;
+	this->endColor = endColor;
+	this->width = width;
+	this->gravity = gravity;
+
+	// A ribbon needs at least one segment
+	this->maxTrailCount = maxTrailCount;
+	this->pointsPerTrail = pointsPerTrail < 2 ? 2 : pointsPerTrail;
+	this->recordInterval = recordInterval;
+	secondsPerTrail = 1.0f / emissionRate;
+	this->lifetime = lifetime;
+	timeSinceEmit = 0.0f;
+	tickLength = 0.0f;
+	UpdateBounds();
+
+	trails = new Trail[maxTrailCount];
+	firstAliveIndex = 0;
+	firstDeadIndex = 0;
+	livingTrailCount = 0;
+
+	unsigned int historySize = maxTrailCount * this->pointsPerTrail;
+	historyX = new float[historySize];
+	historyY = new float[historySize];
+	historyZ = new float[historySize];
+
+	// Ribbons taper and fade from head to tail.  The tables are padded
+	// out to a multiple of 4 (with zero width) for the SSE pass.
+	paddedPoints = (this->pointsPerTrail + 3) & ~3u;
+	halfWidths = new float[paddedPoints];
+	fades = new float[paddedPoints];
+	for (unsigned int i = 0; i < paddedPoints; i++)
+	{
+		float t = (float)i / (this->pointsPerTrail - 1);
+		halfWidths[i] = i < this->pointsPerTrail ? width * 0.5f * (1.0f - t) : 0.0f;
+		fades[i] = i < this->pointsPerTrail ? 1.0f - t : 0.0f;
+	}
+
+	stripX = new float[paddedPoints + 2];
+	stripY = new float[paddedPoints + 2];
+	stripZ = new float[paddedPoints + 2];
+	offsetX = new float[paddedPoints];
+	offsetY = new float[paddedPoints];
+	offsetZ = new float[paddedPoints];
+
+	this->texture = texture;
+	this->vs = vs;
+	this->ps = ps;
+
+	// Two vertices per point, rebuilt every frame
+	D3D11_BUFFER_DESC vbDesc = {};
+	vbDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	vbDesc.Usage = D3D11_USAGE_DYNAMIC;
+	vbDesc.ByteWidth = sizeof(TrailVertex) * 2 * historySize;
+	device->CreateBuffer(&vbDesc, 0, &vertexBuffer);
+
+	// Two triangles per segment, every trail slot laid out back to back
+	unsigned int segments = this->pointsPerTrail - 1;
+	unsigned int* indices = new unsigned int[maxTrailCount * segments * 6];
+	unsigned int indexCount = 0;
+	for (unsigned int t = 0; t < maxTrailCount; t++)
+	{
+		for (unsigned int s = 0; s < segments; s++)
+		{
+			unsigned int v = (t * this->pointsPerTrail + s) * 2;
+			indices[indexCount++] = v;
+			indices[indexCount++] = v + 1;
+			indices[indexCount++] = v + 2;
+			indices[indexCount++] = v + 1;
+			indices[indexCount++] = v + 3;
+			indices[indexCount++] = v + 2;
+		}
+	}
+	D3D11_SUBRESOURCE_DATA indexData = {};
+	indexData.pSysMem = indices;
+
+	D3D11_BUFFER_DESC ibDesc = {};
+	ibDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	ibDesc.CPUAccessFlags = 0;
+	ibDesc.Usage = D3D11_USAGE_DEFAULT;
+	ibDesc.ByteWidth = sizeof(unsigned int) * indexCount;
+	device->CreateBuffer(&ibDesc, &indexData, &indexBuffer);
+
+	delete[] indices;
+}
+
+TrailEmitter::~TrailEmitter()
+{
+	delete[] trails;
+	delete[] historyX;
+	delete[] historyY;
+	delete[] historyZ;
+	delete[] halfWidths;
+	delete[] fades;
+	delete[] stripX;
+	delete[] stripY;
+	delete[] stripZ;
+	delete[] offsetX;
+	delete[] offsetY;
+	delete[] offsetZ;
+
+	vertexBuffer->Release();
+	indexBuffer->Release();
+}
+
+void TrailEmitter::Seed(unsigned int seed)
+{
+	random.Seed(seed);
+}
+
+void TrailEmitter::UpdateBounds()
+{
+	// Heads travel at their launch velocity (start plus or minus the spread)
+	// for at most a lifetime, with gravity pulling y down over the flight
+	float xLow = (startVelocity.x - velocitySpread.x) * lifetime;
+	float xHigh = (startVelocity.x + velocitySpread.x) * lifetime;
+	float zLow = (startVelocity.z - velocitySpread.z) * lifetime;
+	float zHigh = (startVelocity.z + velocitySpread.z) * lifetime;
+
+	// Lowest is the slowest launch at the end; highest is the fastest at its apex.
+	// Ticked heads fall a little faster than the curve (by half a tick of
+	// gravity per second), so allow for ticks up to a tenth of a second.
+	float fall = 0.5f * gravity * lifetime * (lifetime + 0.1f);
+	float slowest = startVelocity.y - velocitySpread.y;
+	float fastest = startVelocity.y + velocitySpread.y;
+	float yLow = slowest * lifetime - fall;
+	float yHigh = fastest * lifetime - fall;
+	if (gravity > 0.0f && fastest > 0.0f && fastest < gravity * lifetime)
+		yHigh = fastest * fastest / (2.0f * gravity);
+
+	float lowX = fminf(0.0f, xLow), highX = fmaxf(0.0f, xHigh);
+	float lowY = fminf(0.0f, yLow), highY = fmaxf(0.0f, yHigh);
+	float lowZ = fminf(0.0f, zLow), highZ = fmaxf(0.0f, zHigh);
+
+	// Ribbons stick out half their width either side
+	float pad = width * 0.5f;
+	boundsCenter = XMFLOAT3(
+		position.x + (lowX + highX) * 0.5f,
+		position.y + (lowY + highY) * 0.5f,
+		position.z + (lowZ + highZ) * 0.5f);
+	boundsHalfSize = XMFLOAT3(
+		(highX - lowX) * 0.5f + pad,
+		(highY - lowY) * 0.5f + pad,
+		(highZ - lowZ) * 0.5f + pad);
+}
+
+bool TrailEmitter::InFrustum(const XMFLOAT4* frustumPlanes)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		XMFLOAT4 plane = frustumPlanes[i];
+
+		// Distance from the plane to the box corner furthest along its normal
+		float distance =
+			plane.x * boundsCenter.x + plane.y * boundsCenter.y + plane.z * boundsCenter.z + plane.w
+			+ fabsf(plane.x) * boundsHalfSize.x
+			+ fabsf(plane.y) * boundsHalfSize.y
+			+ fabsf(plane.z) * boundsHalfSize.z;
+
+		if (distance < 0.0f) return false;
+	}
+
+	return true;
+}
+
+void TrailEmitter::Update(float dt)
+{
+	tickLength = dt;
+
+	// Walk the living trails, oldest first.  Deaths advance firstAliveIndex,
+	// so work from a snapshot of where the living range started.
+	unsigned int first = firstAliveIndex;
+	unsigned int count = livingTrailCount;
+	for (unsigned int i = 0; i < count; i++)
+	{
+		UpdateTrail(dt, (first + i) % maxTrailCount);
+	}
+
+	// Fast emitters can start several trails a frame
+	timeSinceEmit += dt;
+	while (timeSinceEmit >= secondsPerTrail)
+	{
+		SpawnTrail();
+		timeSinceEmit -= secondsPerTrail;
+	}
+}
+
+void TrailEmitter::UpdateTrail(float dt, unsigned int index)
+{
+	Trail* trail = &trails[index];
+
+	// Every trail shares a lifetime, so they always die oldest first
+	trail->age += dt;
+	if (trail->age >= lifetime)
+	{
+		firstAliveIndex = (firstAliveIndex + 1) % maxTrailCount;
+		livingTrailCount--;
+		return;
+	}
+
+	// Trails move in units per second (not per frame like particles)
+	trail->velocity.y -= gravity * dt;
+	trail->position.x += trail->velocity.x * dt;
+	trail->position.y += trail->velocity.y * dt;
+	trail->position.z += trail->velocity.z * dt;
+
+	trail->timeSinceRecord += dt;
+	if (trail->timeSinceRecord >= recordInterval)
+	{
+		RecordPoint(index);
+		trail->timeSinceRecord -= recordInterval;
+	}
+}
+
+void TrailEmitter::RecordPoint(unsigned int index)
+{
+	Trail* trail = &trails[index];
+	unsigned int slot = index * pointsPerTrail + trail->historyHead;
+
+	historyX[slot] = trail->position.x;
+	historyY[slot] = trail->position.y;
+	historyZ[slot] = trail->position.z;
+
+	trail->historyHead = (trail->historyHead + 1) % pointsPerTrail;
+	if (trail->historyCount < pointsPerTrail) trail->historyCount++;
+}
+
+void TrailEmitter::SpawnTrail()
+{
+	// Out of room; skip this one
+	if (livingTrailCount == maxTrailCount)
+	{
+		return;
+	}
+
+	unsigned int index = firstDeadIndex;
+	Trail* trail = &trails[index];
+
+	trail->position = position;
+	trail->velocity.x = startVelocity.x + velocitySpread.x * random.NextFloat(-1.0f, 1.0f);
+	trail->velocity.y = startVelocity.y + velocitySpread.y * random.NextFloat(-1.0f, 1.0f);
+	trail->velocity.z = startVelocity.z + velocitySpread.z * random.NextFloat(-1.0f, 1.0f);
+	trail->age = 0.0f;
+	trail->timeSinceRecord = 0.0f;
+	trail->historyHead = 0;
+	trail->historyCount = 0;
+	RecordPoint(index);
+
+	firstDeadIndex = (firstDeadIndex + 1) % maxTrailCount;
+	livingTrailCount++;
+}
+
+void TrailEmitter::BuildStrip(unsigned int index, DirectX::XMFLOAT3 cameraPosition, float headOffset, TrailVertex* vertices)
+{
+	Trail* trail = &trails[index];
+	unsigned int base = index * pointsPerTrail;
+
+	// Point 0 is the head itself (where it is at the moment being drawn),
+	// then the history newest first.  A short history repeats its oldest
+	// point, which makes zero-width segments.
+	stripX[1] = trail->position.x + trail->velocity.x * headOffset;
+	stripY[1] = trail->position.y + trail->velocity.y * headOffset;
+	stripZ[1] = trail->position.z + trail->velocity.z * headOffset;
+	for (unsigned int i = 1; i < paddedPoints; i++)
+	{
+		unsigned int back = i - 1 < trail->historyCount ? i - 1 : trail->historyCount - 1;
+		unsigned int slot = base + (trail->historyHead + pointsPerTrail - 1 - back) % pointsPerTrail;
+
+		stripX[i + 1] = historyX[slot];
+		stripY[i + 1] = historyY[slot];
+		stripZ[i + 1] = historyZ[slot];
+	}
+
+	// The head usually sits right on its newest record, so lead it along
+	// its velocity instead; the tail end repeats, making it one-sided
+	stripX[0] = stripX[1] + trail->velocity.x * recordInterval;
+	stripY[0] = stripY[1] + trail->velocity.y * recordInterval;
+	stripZ[0] = stripZ[1] + trail->velocity.z * recordInterval;
+	stripX[paddedPoints + 1] = stripX[paddedPoints];
+	stripY[paddedPoints + 1] = stripY[paddedPoints];
+	stripZ[paddedPoints + 1] = stripZ[paddedPoints];
+
+	// Side vector for 4 points at a time: normalize(tangent x toCamera) * halfWidth
+	const __m128 camX = _mm_set1_ps(cameraPosition.x);
+	const __m128 camY = _mm_set1_ps(cameraPosition.y);
+	const __m128 camZ = _mm_set1_ps(cameraPosition.z);
+	const __m128 tiny = _mm_set1_ps(1e-12f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 threeHalves = _mm_set1_ps(1.5f);
+
+	for (unsigned int i = 0; i < paddedPoints; i += 4)
+	{
+		__m128 tx = _mm_sub_ps(_mm_loadu_ps(stripX + i + 2), _mm_loadu_ps(stripX + i));
+		__m128 ty = _mm_sub_ps(_mm_loadu_ps(stripY + i + 2), _mm_loadu_ps(stripY + i));
+		__m128 tz = _mm_sub_ps(_mm_loadu_ps(stripZ + i + 2), _mm_loadu_ps(stripZ + i));
+
+		__m128 cx = _mm_sub_ps(camX, _mm_loadu_ps(stripX + i + 1));
+		__m128 cy = _mm_sub_ps(camY, _mm_loadu_ps(stripY + i + 1));
+		__m128 cz = _mm_sub_ps(camZ, _mm_loadu_ps(stripZ + i + 1));
+
+		__m128 sx = _mm_sub_ps(_mm_mul_ps(ty, cz), _mm_mul_ps(tz, cy));
+		__m128 sy = _mm_sub_ps(_mm_mul_ps(tz, cx), _mm_mul_ps(tx, cz));
+		__m128 sz = _mm_sub_ps(_mm_mul_ps(tx, cy), _mm_mul_ps(ty, cx));
+
+		// Reciprocal square root plus one Newton step; a zero side stays zero
+		__m128 lengthSq = _mm_max_ps(
+			_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, sx), _mm_mul_ps(sy, sy)), _mm_mul_ps(sz, sz)),
+			tiny);
+		__m128 inv = _mm_rsqrt_ps(lengthSq);
+		inv = _mm_mul_ps(inv, _mm_sub_ps(threeHalves, _mm_mul_ps(_mm_mul_ps(half, lengthSq), _mm_mul_ps(inv, inv))));
+
+		__m128 scale = _mm_mul_ps(inv, _mm_loadu_ps(halfWidths + i));
+		_mm_storeu_ps(offsetX + i, _mm_mul_ps(sx, scale));
+		_mm_storeu_ps(offsetY + i, _mm_mul_ps(sy, scale));
+		_mm_storeu_ps(offsetZ + i, _mm_mul_ps(sz, scale));
+	}
+
+	// Trail color over its life, faded toward the tail
+	float agePercent = trail->age / lifetime;
+	XMFLOAT4 color;
+	XMStoreFloat4(&color, XMVectorLerp(XMLoadFloat4(&startColor), XMLoadFloat4(&endColor), agePercent));
+
+	for (unsigned int i = 0; i < pointsPerTrail; i++)
+	{
+		float x = stripX[i + 1];
+		float y = stripY[i + 1];
+		float z = stripZ[i + 1];
+
+		// Vertices may be mapped write-only memory, so never read them back
+		XMFLOAT4 faded = XMFLOAT4(color.x, color.y, color.z, color.w * fades[i]);
+
+		// Sample down the middle of the sprite so the ribbon gets its soft edges
+		TrailVertex* v = &vertices[i * 2];
+		v[0].position = XMFLOAT3(x + offsetX[i], y + offsetY[i], z + offsetZ[i]);
+		v[0].uv = XMFLOAT2(0.5f, 0.0f);
+		v[0].color = faded;
+
+		v[1].position = XMFLOAT3(x - offsetX[i], y - offsetY[i], z - offsetZ[i]);
+		v[1].uv = XMFLOAT2(0.5f, 1.0f);
+		v[1].color = faded;
+	}
+}
+
+void TrailEmitter::BuildRibbons(TrailVertex* vertices, XMFLOAT3 cameraPosition, float alpha)
+{
+	// Heads are drawn back from the last tick, toward where they were a tick before
+	float headOffset = (alpha - 1.0f) * tickLength;
+
+	for (unsigned int i = 0; i < livingTrailCount; i++)
+	{
+		unsigned int index = (firstAliveIndex + i) % maxTrailCount;
+		BuildStrip(index, cameraPosition, headOffset, &vertices[index * pointsPerTrail * 2]);
+	}
+}
+
+void TrailEmitter::Draw(ID3D11DeviceContext* context, Camera* camera, float alpha)
+{
+	if (livingTrailCount == 0) return;
+
+	// Build every living ribbon right into the buffer
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	context->Map(vertexBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+	BuildRibbons((TrailVertex*)mapped.pData, camera->GetPosition(), alpha);
+	context->Unmap(vertexBuffer, 0);
+
+	// Set up buffers
+	UINT stride = sizeof(TrailVertex);
+	UINT offset = 0;
+	context->IASetVertexBuffers(0, 1, &vertexBuffer, &stride, &offset);
+	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+
+	vs->SetMatrix4x4("view", camera->GetView());
+	vs->SetMatrix4x4("projection", camera->GetProjection());
+	vs->SetShader();
+	vs->CopyAllBufferData();
+
+	ps->SetShaderResourceView("particle", texture);
+	ps->SetShader();
+	ps->CopyAllBufferData();
+
+	// Draw the correct parts of the ring
+	unsigned int indicesPerTrail = (pointsPerTrail - 1) * 6;
+	if (firstAliveIndex < firstDeadIndex)
+	{
+		context->DrawIndexed(livingTrailCount * indicesPerTrail, firstAliveIndex * indicesPerTrail, 0);
+	}
+	else
+	{
+		// Draw first half (0 -> dead)
+		context->DrawIndexed(firstDeadIndex * indicesPerTrail, 0, 0);
+
+		// Draw second half (alive -> max)
+		context->DrawIndexed((maxTrailCount - firstAliveIndex) * indicesPerTrail, firstAliveIndex * indicesPerTrail, 0);
+	}
+}
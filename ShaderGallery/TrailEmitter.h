@@ -0,0 +1,151 @@
+#pragma once
+#include <d3d11.h>
+#include <DirectXMath.h>
+
+#include "Camera.h"
+#include "SimpleShader.h"
+#include "Random.h"
+
+// --------------------------------------------------------
+// One corner of a ribbon strip
+// --------------------------------------------------------
+struct TrailVertex
+{
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT2 uv;
+	DirectX::XMFLOAT4 color;
+};
+
+// --------------------------------------------------------
+// Live state of one trail's head
+// --------------------------------------------------------
+struct Trail
+{
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT3 velocity;
+	float age;
+	float timeSinceRecord;
+	unsigned int historyHead;	// Where the next point will be recorded
+	unsigned int historyCount;
+};
+
+// --------------------------------------------------------
+// Emits trails (sparks, light painting) that leave a ribbon
+// behind them.
+//
+// Every trail records its recent positions into its own
+// fixed-size ring buffer, stored as separate x/y/z arrays.
+// Trails share a lifetime, so like the original particle
+// emitter they live in one ring of slots between
+// firstAliveIndex and firstDeadIndex and die oldest first.
+//
+// Each frame the ribbons of an emitter in view are rebuilt
+// camera-facing, four points at a time in SSE, and written
+// straight into the mapped dynamic vertex buffer.
+// --------------------------------------------------------
+class TrailEmitter
+{
+public:
+	TrailEmitter(
+		DirectX::XMFLOAT3 position,
+		DirectX::XMFLOAT3 startVelocity,
+		DirectX::XMFLOAT3 velocitySpread,
+		DirectX::XMFLOAT4 startColor,
+		DirectX::XMFLOAT4 endColor,
+		float width,
+		float gravity,
+		unsigned int maxTrailCount,
+		unsigned int pointsPerTrail,
+		float recordInterval,
+		float emissionRate,
+		float lifetime,
+		ID3D11Device* device,
+		SimpleVertexShader* vs,
+		SimplePixelShader* ps,
+		ID3D11ShaderResourceView* texture
+	);
+	~TrailEmitter();
+
+	void Update(float dt);
+
+	// Alpha is how far between the last two ticks to draw the heads
+	void Draw(ID3D11DeviceContext* context, Camera* camera, float alpha = 1.0f);
+
+	// Writes every living ribbon (2 vertices per point, each trail at its
+	// slot's offset) into vertices, which holds GetVertexCount() of them
+	void BuildRibbons(TrailVertex* vertices, DirectX::XMFLOAT3 cameraPosition, float alpha = 1.0f);
+	unsigned int GetVertexCount() { return maxTrailCount * pointsPerTrail * 2; }
+
+	// Box around wherever the trails can get to in their lifetime
+	bool InFrustum(const DirectX::XMFLOAT4* frustumPlanes);
+	DirectX::XMFLOAT3 GetBoundsCenter() { return boundsCenter; }
+	DirectX::XMFLOAT3 GetBoundsHalfSize() { return boundsHalfSize; }
+
+	// Reseeds this emitter's random stream so runs can be reproduced
+	void Seed(unsigned int seed);
+
+	unsigned int GetLivingTrailCount() { return livingTrailCount; }
+
+private:
+	void SpawnTrail();
+	void UpdateTrail(float dt, unsigned int index);
+	void RecordPoint(unsigned int index);
+	void UpdateBounds();
+
+	// Writes one trail's strip (2 vertices per point), with the head moved
+	// headOffset seconds along its velocity
+	void BuildStrip(unsigned int index, DirectX::XMFLOAT3 cameraPosition, float headOffset, TrailVertex* vertices);
+
+	DirectX::XMFLOAT3 position;
+	DirectX::XMFLOAT3 startVelocity;
+	DirectX::XMFLOAT3 velocitySpread;
+	DirectX::XMFLOAT4 startColor;
+	DirectX::XMFLOAT4 endColor;
+	float width;
+	float gravity;
+
+	unsigned int maxTrailCount;
+	unsigned int pointsPerTrail;
+	float recordInterval;
+	float secondsPerTrail;
+	float lifetime;
+	float timeSinceEmit;
+	float tickLength;
+
+	DirectX::XMFLOAT3 boundsCenter;
+	DirectX::XMFLOAT3 boundsHalfSize;
+
+	Random random;
+
+	// Trail ring
+	Trail* trails;
+	unsigned int firstAliveIndex;
+	unsigned int firstDeadIndex;
+	unsigned int livingTrailCount;
+
+	// Position history, pointsPerTrail entries per trail slot
+	float* historyX;
+	float* historyY;
+	float* historyZ;
+
+	// Per point along a ribbon (newest first): half width and fade
+	float* halfWidths;
+	float* fades;
+
+	// Scratch for building one strip; points unrolled newest first,
+	// with a copy of each end point on either side for the tangents
+	unsigned int paddedPoints;
+	float* stripX;
+	float* stripY;
+	float* stripZ;
+	float* offsetX;
+	float* offsetY;
+	float* offsetZ;
+
+	// Rendering vars
+	ID3D11Buffer* vertexBuffer;
+	ID3D11Buffer* indexBuffer;
+	ID3D11ShaderResourceView* texture;
+	SimpleVertexShader* vs;
+	SimplePixelShader* ps;
+};
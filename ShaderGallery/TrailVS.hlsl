@@ -0,0 +1,35 @@
+
+cbuffer externalData : register(b0)
+{
+	matrix view;
+	matrix projection;
+};
+
+struct VertexShaderInput
+{
+	float3 position		: POSITION;
+	float2 uv			: UV;
+	float4 color		: COLOR;
+};
+
+// Matches ParticlePS, which trails share
+struct VertexToPixel
+{
+	float4 position		: SV_POSITION;
+	float2 uv           : UV;
+	float4 color		: COLOR;
+};
+
+// Ribbon vertices are already camera-facing in world space
+VertexToPixel main(VertexShaderInput input)
+{
+	VertexToPixel output;
+
+	matrix viewProj = mul(view, projection);
+	output.position = mul(float4(input.position, 1.0f), viewProj);
+
+	output.uv = input.uv;
+	output.color = input.color;
+
+	return output;
+}
@@ -0,0 +1,401 @@
+#include "TransformSystem.h"
+
+#include <algorithm>
+
+using namespace DirectX;
+
+TransformSystem::TransformSystem(unsigned int capacity)
+{
+	this->capacity = 0;
+	count = 0;
+	anyDirty = false;
+	anyChanged = false;
+	hierarchyChanged = false;
+	depthCount = 0;
+	Grow(capacity);
+}
+
+TransformSystem::~TransformSystem()
+{
+}
+
+void TransformSystem::Grow(unsigned int capacity)
+{
+	capacity = (capacity + 63) & ~63u;
+	if (capacity <= this->capacity) return;
+	this->capacity = capacity;
+
+	positionX.resize(capacity, 0.0f);
+	positionY.resize(capacity, 0.0f);
+	positionZ.resize(capacity, 0.0f);
+	rotationX.resize(capacity, 0.0f);
+	rotationY.resize(capacity, 0.0f);
+	rotationZ.resize(capacity, 0.0f);
+	scaleX.resize(capacity, 1.0f);
+	scaleY.resize(capacity, 1.0f);
+	scaleZ.resize(capacity, 1.0f);
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+	locals.resize(capacity, identity);
+	worlds.resize(capacity, identity);
+	dirtyBits.resize(capacity / 64, 0);
+
+	live.resize(capacity, 0);
+	parents.resize(capacity, TRANSFORM_NO_PARENT);
+	orderPosition.resize(capacity, 0);
+	changed.resize(capacity, 0);
+}
+
+unsigned int TransformSystem::Create()
+{
+	unsigned int index;
+	if (!freeSlots.empty())
+	{
+		index = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	else
+	{
+		if (count == capacity) Grow(capacity * 2);
+		index = count++;
+	}
+
+	positionX[index] = 0.0f;
+	positionY[index] = 0.0f;
+	positionZ[index] = 0.0f;
+	rotationX[index] = 0.0f;
+	rotationY[index] = 0.0f;
+	rotationZ[index] = 0.0f;
+	scaleX[index] = 1.0f;
+	scaleY[index] = 1.0f;
+	scaleZ[index] = 1.0f;
+	MarkDirty(index);
+
+	live[index] = 1;
+	parents[index] = TRANSFORM_NO_PARENT;
+	hierarchyChanged = true;
+
+	return index;
+}
+
+void TransformSystem::Release(unsigned int index)
+{
+	// Orphan the children; they keep their local transforms
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (parents[i] == index) parents[i] = TRANSFORM_NO_PARENT;
+	}
+
+	live[index] = 0;
+	parents[index] = TRANSFORM_NO_PARENT;
+	hierarchyChanged = true;
+	freeSlots.push_back(index);
+}
+
+bool TransformSystem::SetParent(unsigned int index, unsigned int parent)
+{
+	// Can't hang something under itself or its own descendants
+	for (unsigned int p = parent; p != TRANSFORM_NO_PARENT; p = parents[p])
+	{
+		if (p == index) return false;
+	}
+
+	parents[index] = parent;
+	hierarchyChanged = true;
+	return true;
+}
+
+void TransformSystem::SetPosition(unsigned int index, XMFLOAT3 position)
+{
+	positionX[index] = position.x;
+	positionY[index] = position.y;
+	positionZ[index] = position.z;
+	MarkDirty(index);
+}
+
+void TransformSystem::SetRotation(unsigned int index, XMFLOAT3 rotation)
+{
+	rotationX[index] = rotation.x;
+	rotationY[index] = rotation.y;
+	rotationZ[index] = rotation.z;
+	MarkDirty(index);
+}
+
+void TransformSystem::SetScale(unsigned int index, XMFLOAT3 scale)
+{
+	scaleX[index] = scale.x;
+	scaleY[index] = scale.y;
+	scaleZ[index] = scale.z;
+	MarkDirty(index);
+}
+
+XMFLOAT3 TransformSystem::GetPosition(unsigned int index)
+{
+	return XMFLOAT3(positionX[index], positionY[index], positionZ[index]);
+}
+
+XMFLOAT3 TransformSystem::GetRotation(unsigned int index)
+{
+	return XMFLOAT3(rotationX[index], rotationY[index], rotationZ[index]);
+}
+
+XMFLOAT3 TransformSystem::GetScale(unsigned int index)
+{
+	return XMFLOAT3(scaleX[index], scaleY[index], scaleZ[index]);
+}
+
+XMFLOAT3 TransformSystem::GetWorldPosition(unsigned int index)
+{
+	XMFLOAT4X4 world = GetWorldMatrix(index);
+	return XMFLOAT3(world._14, world._24, world._34);
+}
+
+XMFLOAT4X4 TransformSystem::GetWorldMatrix(unsigned int index)
+{
+	if (!anyDirty && !hierarchyChanged) return worlds[index];
+
+	// Changed since the last batch; don't make the caller wait for the next
+	// one.  Nothing is cached, so the batch still sees everything as dirty.
+	XMMATRIX world = XMMatrixIdentity();
+	for (unsigned int i = index; i != TRANSFORM_NO_PARENT; i = parents[i])
+	{
+		XMFLOAT4X4 local = BuildLocal(i);
+		world = XMMatrixMultiply(XMLoadFloat4x4(&local), world);
+	}
+
+	XMFLOAT4X4 result;
+	XMStoreFloat4x4(&result, world);
+	return result;
+}
+
+void TransformSystem::UpdateWorldMatrices()
+{
+	// The last batch's changes are only reported until this one
+	for (unsigned int i = 0; i < touched.size(); i++)
+	{
+		changed[touched[i]] = 0;
+	}
+	touched.clear();
+	anyChanged = false;
+
+	if (!anyDirty && !hierarchyChanged) return;
+
+	if (hierarchyChanged) BuildOrder();
+
+	// Skip clean words outright; a group is rebuilt if any of its 4 is dirty
+	dirtyRoots.clear();
+	for (unsigned int word = 0; word < dirtyBits.size(); word++)
+	{
+		unsigned long long bits = dirtyBits[word];
+		if (bits == 0) continue;
+
+		for (unsigned int group = 0; group < 64; group += 4)
+		{
+			if ((bits >> group) & 0xF)
+				BuildGroup(word * 64 + group);
+		}
+
+		// Only the ones that were actually dirty drag their children along
+		for (unsigned int bit = 0; bit < 64; bit++)
+		{
+			unsigned int index = word * 64 + bit;
+			if (((bits >> bit) & 1) && live[index]) dirtyRoots.push_back(orderPosition[index]);
+		}
+
+		dirtyBits[word] = 0;
+	}
+
+	// A new parent moves everything under it, so redo the lot
+	if (hierarchyChanged)
+	{
+		Propagate(0, (unsigned int)order.size());
+	}
+	else
+	{
+		// In order, a dirty transform's range either holds the next one's
+		// or ends before it starts; only the outermost ranges are walked
+		std::sort(dirtyRoots.begin(), dirtyRoots.end());
+		unsigned int walked = 0;
+		for (unsigned int i = 0; i < dirtyRoots.size(); i++)
+		{
+			unsigned int first = dirtyRoots[i];
+			if (first < walked) continue;
+
+			walked = subtreeEnd[first];
+			Propagate(first, walked);
+		}
+	}
+
+	anyChanged = !touched.empty();
+	anyDirty = false;
+	hierarchyChanged = false;
+}
+
+void TransformSystem::Propagate(unsigned int first, unsigned int last)
+{
+	for (unsigned int k = first; k < last; k++)
+	{
+		unsigned int i = order[k];
+		unsigned int parent = parents[i];
+
+		if (parent == TRANSFORM_NO_PARENT)
+		{
+			worlds[i] = locals[i];
+		}
+		else
+		{
+			// Stored transposed, so the parent goes on the left
+			XMMATRIX world = XMMatrixMultiply(XMLoadFloat4x4(&worlds[parent]), XMLoadFloat4x4(&locals[i]));
+			XMStoreFloat4x4(&worlds[i], world);
+		}
+
+		changed[i] = 1;
+		touched.push_back(i);
+	}
+}
+
+void TransformSystem::BuildOrder()
+{
+	// Group the children by parent with a counting sort; ties stay in index order
+	childStart.assign(count + 1, 0);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (live[i] && parents[i] != TRANSFORM_NO_PARENT) childStart[parents[i] + 1]++;
+	}
+	for (unsigned int i = 1; i <= count; i++)
+	{
+		childStart[i] += childStart[i - 1];
+	}
+
+	children.resize(childStart[count]);
+	std::vector<unsigned int> cursor(childStart.begin(), childStart.end() - 1);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (live[i] && parents[i] != TRANSFORM_NO_PARENT) children[cursor[parents[i]]++] = i;
+	}
+
+	// Depth first from each root.  A node's range closes once the walk
+	// comes back out of it, marked by pushing it again with the top bit set.
+	const unsigned int leaving = 0x80000000;
+	order.clear();
+	subtreeEnd.resize(count);
+	depthCount = 0;
+	for (unsigned int root = 0; root < count; root++)
+	{
+		if (!live[root] || parents[root] != TRANSFORM_NO_PARENT) continue;
+
+		stack.push_back(root);
+		unsigned int depth = 0;
+		while (!stack.empty())
+		{
+			unsigned int node = stack.back();
+			stack.pop_back();
+
+			if (node & leaving)
+			{
+				subtreeEnd[orderPosition[node & ~leaving]] = (unsigned int)order.size();
+				depth--;
+				continue;
+			}
+
+			orderPosition[node] = (unsigned int)order.size();
+			order.push_back(node);
+			depth++;
+			if (depth > depthCount) depthCount = depth;
+
+			// Reversed, so the first child comes off the stack first
+			stack.push_back(node | leaving);
+			for (unsigned int c = childStart[node + 1]; c > childStart[node]; c--)
+			{
+				stack.push_back(children[c - 1]);
+			}
+		}
+	}
+}
+
+void TransformSystem::BuildGroup(unsigned int first)
+{
+	// Each lane is a different entity
+	XMVECTOR sinX, cosX, sinY, cosY, sinZ, cosZ;
+	XMVectorSinCos(&sinX, &cosX, XMLoadFloat4((XMFLOAT4*)&rotationX[first]));
+	XMVectorSinCos(&sinY, &cosY, XMLoadFloat4((XMFLOAT4*)&rotationY[first]));
+	XMVectorSinCos(&sinZ, &cosZ, XMLoadFloat4((XMFLOAT4*)&rotationZ[first]));
+
+	// RotX * RotY * RotZ, written out
+	XMVECTOR sinXsinY = XMVectorMultiply(sinX, sinY);
+	XMVECTOR cosXsinY = XMVectorMultiply(cosX, sinY);
+
+	XMVECTOR r00 = XMVectorMultiply(cosY, cosZ);
+	XMVECTOR r01 = XMVectorMultiply(cosY, sinZ);
+	XMVECTOR r02 = XMVectorNegate(sinY);
+	XMVECTOR r10 = XMVectorSubtract(XMVectorMultiply(sinXsinY, cosZ), XMVectorMultiply(cosX, sinZ));
+	XMVECTOR r11 = XMVectorAdd(XMVectorMultiply(sinXsinY, sinZ), XMVectorMultiply(cosX, cosZ));
+	XMVECTOR r12 = XMVectorMultiply(sinX, cosY);
+	XMVECTOR r20 = XMVectorAdd(XMVectorMultiply(cosXsinY, cosZ), XMVectorMultiply(sinX, sinZ));
+	XMVECTOR r21 = XMVectorSubtract(XMVectorMultiply(cosXsinY, sinZ), XMVectorMultiply(sinX, cosZ));
+	XMVECTOR r22 = XMVectorMultiply(cosX, cosY);
+
+	// Scale comes first, so it scales the rotation's rows
+	XMVECTOR sx = XMLoadFloat4((XMFLOAT4*)&scaleX[first]);
+	XMVECTOR sy = XMLoadFloat4((XMFLOAT4*)&scaleY[first]);
+	XMVECTOR sz = XMLoadFloat4((XMFLOAT4*)&scaleZ[first]);
+
+	// The stored matrix is transposed, so its row j is column j of
+	// S * R * T.  Transposing the lanes hands each entity its own row.
+	XMMATRIX rows0 = XMMatrixTranspose(XMMATRIX(
+		XMVectorMultiply(sx, r00), XMVectorMultiply(sy, r10), XMVectorMultiply(sz, r20),
+		XMLoadFloat4((XMFLOAT4*)&positionX[first])));
+	XMMATRIX rows1 = XMMatrixTranspose(XMMATRIX(
+		XMVectorMultiply(sx, r01), XMVectorMultiply(sy, r11), XMVectorMultiply(sz, r21),
+		XMLoadFloat4((XMFLOAT4*)&positionY[first])));
+	XMMATRIX rows2 = XMMatrixTranspose(XMMATRIX(
+		XMVectorMultiply(sx, r02), XMVectorMultiply(sy, r12), XMVectorMultiply(sz, r22),
+		XMLoadFloat4((XMFLOAT4*)&positionZ[first])));
+	XMVECTOR row3 = XMVectorSet(0.0f, 0.0f, 0.0f, 1.0f);
+
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		XMFLOAT4X4* local = &locals[first + i];
+		XMStoreFloat4((XMFLOAT4*)local->m[0], rows0.r[i]);
+		XMStoreFloat4((XMFLOAT4*)local->m[1], rows1.r[i]);
+		XMStoreFloat4((XMFLOAT4*)local->m[2], rows2.r[i]);
+		XMStoreFloat4((XMFLOAT4*)local->m[3], row3);
+	}
+}
+
+XMFLOAT4X4 TransformSystem::BuildLocal(unsigned int index)
+{
+	float sinX, cosX, sinY, cosY, sinZ, cosZ;
+	XMScalarSinCos(&sinX, &cosX, rotationX[index]);
+	XMScalarSinCos(&sinY, &cosY, rotationY[index]);
+	XMScalarSinCos(&sinZ, &cosZ, rotationZ[index]);
+
+	float sx = scaleX[index];
+	float sy = scaleY[index];
+	float sz = scaleZ[index];
+
+	// Same closed form as BuildGroup, one entity at a time
+	XMFLOAT4X4 local;
+	local._11 = sx * cosY * cosZ;
+	local._12 = sy * (sinX * sinY * cosZ - cosX * sinZ);
+	local._13 = sz * (cosX * sinY * cosZ + sinX * sinZ);
+	local._14 = positionX[index];
+
+	local._21 = sx * cosY * sinZ;
+	local._22 = sy * (sinX * sinY * sinZ + cosX * cosZ);
+	local._23 = sz * (cosX * sinY * sinZ - sinX * cosZ);
+	local._24 = positionY[index];
+
+	local._31 = sx * -sinY;
+	local._32 = sy * sinX * cosY;
+	local._33 = sz * cosX * cosY;
+	local._34 = positionZ[index];
+
+	local._41 = 0.0f;
+	local._42 = 0.0f;
+	local._43 = 0.0f;
+	local._44 = 1.0f;
+
+	return local;
+}
@@ -0,0 +1,127 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+
+// Parent index of a transform that hangs off the world
+#define TRANSFORM_NO_PARENT 0xFFFFFFFF
+
+// --------------------------------------------------------
+// Position, rotation (Euler) and scale for every entity,
+// kept in structure-of-arrays form and addressed by index.
+//
+// Setters only flip a bit in a dirty bitset.  Once a frame
+// UpdateWorldMatrices() rebuilds every dirty local matrix
+// in one pass, four entities at a time with each SIMD lane
+// holding a different entity, using the closed form of
+// Scale * RotX * RotY * RotZ * Translation.
+//
+// Transforms can have a parent.  Every transform is kept in
+// a flattened depth-first order, so parents are always ahead
+// of their children and each subtree is one contiguous range.
+// A batch only walks the ranges under dirty transforms.
+// --------------------------------------------------------
+class TransformSystem
+{
+public:
+	TransformSystem(unsigned int capacity = 256);
+	~TransformSystem();
+
+	// Hands out a slot holding the identity transform
+	unsigned int Create();
+
+	// Children of a released transform are left hanging off the world
+	void Release(unsigned int index);
+
+	// Position, rotation and scale are relative to the parent from then on.
+	// Returns false (and changes nothing) if it would make a cycle.
+	bool SetParent(unsigned int index, unsigned int parent);
+	unsigned int GetParent(unsigned int index) { return parents[index]; }
+
+	void SetPosition(unsigned int index, DirectX::XMFLOAT3 position);
+	void SetRotation(unsigned int index, DirectX::XMFLOAT3 rotation);
+	void SetScale(unsigned int index, DirectX::XMFLOAT3 scale);
+
+	// Local (relative to the parent)
+	DirectX::XMFLOAT3 GetPosition(unsigned int index);
+	DirectX::XMFLOAT3 GetRotation(unsigned int index);
+	DirectX::XMFLOAT3 GetScale(unsigned int index);
+
+	DirectX::XMFLOAT3 GetWorldPosition(unsigned int index);
+
+	// Transposed for the shaders.  Between a change and the next batch
+	// it's composed up the parent chain on the spot.
+	DirectX::XMFLOAT4X4 GetWorldMatrix(unsigned int index);
+
+	// Rebuilds every dirty local matrix, then propagates down the hierarchy
+	void UpdateWorldMatrices();
+
+	// Did the last UpdateWorldMatrices() move this one (or anything at all)?
+	// Lets things cached off world matrices (like bounds) refresh only what moved.
+	bool WorldChanged(unsigned int index) { return changed[index] != 0; }
+	bool AnyWorldChanged() { return anyChanged; }
+
+	unsigned int GetCount() { return count - (unsigned int)freeSlots.size(); }
+	unsigned int GetDepthCount() { return depthCount; }
+
+	// How many world matrices the last UpdateWorldMatrices() recomputed
+	unsigned int GetChangedCount() { return (unsigned int)touched.size(); }
+
+private:
+	void Grow(unsigned int capacity);
+	void MarkDirty(unsigned int index) { dirtyBits[index / 64] |= 1ull << (index % 64); anyDirty = true; }
+	bool IsDirty(unsigned int index) { return (dirtyBits[index / 64] >> (index % 64)) & 1; }
+
+	// Rebuilds the 4 local matrices starting at first (a multiple of 4)
+	void BuildGroup(unsigned int first);
+	DirectX::XMFLOAT4X4 BuildLocal(unsigned int index);
+
+	// Re-flattens the live transforms after the hierarchy changes
+	void BuildOrder();
+
+	// Recomputes the world matrices of order[first, last), which holds
+	// whole subtrees, so every parent is outside it or ahead in it
+	void Propagate(unsigned int first, unsigned int last);
+
+	unsigned int capacity;		// Always a multiple of 64, so groups never run off the end
+	unsigned int count;			// Slots ever handed out
+	std::vector<unsigned int> freeSlots;
+	std::vector<unsigned char> live;
+
+	std::vector<float> positionX;
+	std::vector<float> positionY;
+	std::vector<float> positionZ;
+	std::vector<float> rotationX;
+	std::vector<float> rotationY;
+	std::vector<float> rotationZ;
+	std::vector<float> scaleX;
+	std::vector<float> scaleY;
+	std::vector<float> scaleZ;
+
+	std::vector<DirectX::XMFLOAT4X4> locals;
+	std::vector<DirectX::XMFLOAT4X4> worlds;
+	std::vector<unsigned long long> dirtyBits;
+	bool anyDirty;
+
+	// Hierarchy, flattened depth first.  The subtree under order[k]
+	// is order[k, subtreeEnd[k]).
+	std::vector<unsigned int> parents;
+	std::vector<unsigned int> order;
+	std::vector<unsigned int> orderPosition;		// Per transform, where it is in order
+	std::vector<unsigned int> subtreeEnd;
+	unsigned int depthCount;
+	bool hierarchyChanged;
+
+	// Scratch for BuildOrder: children of each transform, grouped by parent
+	std::vector<unsigned int> childStart;
+	std::vector<unsigned int> children;
+	std::vector<unsigned int> stack;
+
+	// Where in order this batch's dirty transforms are
+	std::vector<unsigned int> dirtyRoots;
+
+	// Last batch: did the world matrix change?  The ones that did are
+	// listed in touched, so the next batch clears only those.
+	std::vector<unsigned char> changed;
+	std::vector<unsigned int> touched;
+	bool anyChanged;
+};
@@ -5,15 +5,21 @@
 // - All non-pipeline variables that get their values from 
 //    our C++ code must be defined inside a Constant Buffer
 // - The name of the cbuffer itself is unimportant
-cbuffer externalData : register(b0)
+// - Split by how often they change, so a draw that only
+//    moves the object only uploads its world matrix
+cbuffer perFrame : register(b0)
 {
-	matrix world;
 	matrix view;
 	matrix projection;
 	matrix lightView;
 	matrix lightProj;
 };
 
+cbuffer perObject : register(b1)
+{
+	matrix world;
+};
+
 // Struct representing a single vertex worth of data
 // - This should match the vertex definition in our C++ code
 // - By "match", I mean the size, order and number of members
@@ -0,0 +1,6 @@
+#include "Harness.h"
+
+int main(int argc, char** argv)
+{
+	return RunHarness(HARNESS_BENCHMARK, argc, argv);
+}
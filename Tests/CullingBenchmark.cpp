@@ -0,0 +1,97 @@
+#include "Harness.h"
+#include "Camera.h"
+#include "CullingSystem.h"
+#include "TransformSystem.h"
+
+#include <math.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// The check every entity used to need: its world sphere against each plane
+	unsigned int CullScalar(const XMFLOAT4 planes[6], CullingSystem* culling, std::vector<unsigned char>& visible)
+	{
+		unsigned int visibleCount = 0;
+		unsigned int slots = culling->GetSlotCount();
+		visible.resize(slots);
+		for (unsigned int i = 0; i < slots; i++)
+		{
+			if (!culling->HasBounds(i))
+			{
+				visible[i] = 1;
+				continue;
+			}
+
+			XMFLOAT3 center = culling->GetWorldCenter(i);
+			float radius = culling->GetWorldRadius(i);
+			bool inside = true;
+			for (int p = 0; p < 6 && inside; p++)
+			{
+				inside = planes[p].x * center.x + planes[p].y * center.y + planes[p].z * center.z + planes[p].w >= -radius;
+			}
+
+			visible[i] = inside;
+			visibleCount += inside;
+		}
+		return visibleCount;
+	}
+}
+
+// Unit cubes on a square grid around the camera: one frame's cull
+// with a plain per-entity sphere loop, and with the culling system
+// (its 8-wide pass below TREE_CULL_THRESHOLD bounded transforms, its
+// BVH above).  Then the cost of refreshing world bounds when a tenth
+// of the entities move.
+BENCHMARK_CASE(FrustumCull)
+{
+	unsigned int sizes[4] = { 1024, 4000, run.Size(16384, 8192), run.Size(100000, 16384) };
+	unsigned int runs = run.Size(32, 4);
+
+	printf("  %8s %8s %10s %10s %10s %10s\n", "entities", "visible", "scalar us", "system us", "speedup", "move us");
+	for (unsigned int s = 0; s < 4; s++)
+	{
+		unsigned int side = (unsigned int)ceilf(sqrtf((float)sizes[s]));
+		TransformSystem transforms(sizes[s]);
+		CullingSystem culling(&transforms);
+		culling.SetThreadCount(1);
+
+		std::vector<unsigned int> slots;
+		for (unsigned int i = 0; i < sizes[s]; i++)
+		{
+			unsigned int slot = transforms.Create();
+			transforms.SetPosition(slot, XMFLOAT3((float)(i % side) * 2.0f - side, 0.5f, (float)(i / side) * 2.0f - side));
+			culling.SetLocalBounds(slot, XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(0.5f, 0.5f, 0.5f), 0.87f);
+			slots.push_back(slot);
+		}
+		transforms.UpdateWorldMatrices();
+		culling.UpdateWorldBounds();
+
+		Camera camera(0.0f, 1.5f, 0.0f);
+		camera.UpdateProjectionMatrix(16.0f / 9.0f);
+		camera.UpdateViewMatrix();
+		XMFLOAT4 planes[6];
+		camera.GetFrustumPlanes(planes);
+
+		std::vector<unsigned char> visible;
+		unsigned int scalarCount = 0, systemCount = 0;
+		double scalar = MeasureMicroseconds(runs, [&]() { scalarCount = CullScalar(planes, &culling, visible); });
+		double system = MeasureMicroseconds(runs, [&]() { systemCount = culling.Cull(planes, visible); });
+
+		// The system also tests boxes, so it can only cull more
+		CHECK(systemCount <= scalarCount);
+
+		float offset = 0.0f;
+		double move = MeasureMicroseconds(runs, [&]()
+		{
+			offset += 0.01f;
+			for (unsigned int i = 0; i < sizes[s]; i += 10)
+				transforms.SetPosition(slots[i], XMFLOAT3((float)(i % side) * 2.0f - side, 0.5f + offset, (float)(i / side) * 2.0f - side));
+			transforms.UpdateWorldMatrices();
+			culling.UpdateWorldBounds();
+		});
+
+		printf("  %8u %8u %10.1f %10.1f %9.1fx %10.1f\n", sizes[s], systemCount, scalar, system, scalar / system, move);
+	}
+}
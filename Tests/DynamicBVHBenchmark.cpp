@@ -0,0 +1,99 @@
+#include "Harness.h"
+#include "Camera.h"
+#include "DynamicBVH.h"
+#include "Random.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+// Small boxes scattered over a square, with a share of them moving
+// steadily every frame (each with its own velocity) and the rest
+// still.  Per frame, at each share: moving them (and rebalancing on
+// a budget), a frustum query from the middle, a hundred sphere queries
+// and a hundred ray casts, plus how loose the tree ended up.
+BENCHMARK_CASE(BVHMotion)
+{
+	unsigned int itemCount = run.Size(100000, 10000);
+	unsigned int frames = run.Size(60, 8);
+	unsigned int probes = 100;
+	float side = 500.0f;
+	float ratios[5] = { 0.0f, 0.01f, 0.1f, 0.5f, 1.0f };
+
+	printf("  %7s %8s %10s %10s %10s %10s %8s\n",
+		"moving", "items", "update us", "frustum us", "sphere us", "ray us", "area");
+	for (unsigned int r = 0; r < 5; r++)
+	{
+		Random random(7);
+		std::vector<XMFLOAT3> positions(itemCount);
+		std::vector<XMFLOAT3> velocities(itemCount);
+		DynamicBVH tree;
+		for (unsigned int i = 0; i < itemCount; i++)
+		{
+			positions[i] = XMFLOAT3(random.NextFloat(-side, side), random.NextFloat(0, 10), random.NextFloat(-side, side));
+			velocities[i] = XMFLOAT3(random.NextFloat(-0.2f, 0.2f), 0, random.NextFloat(-0.2f, 0.2f));
+			tree.Insert(i,
+				XMFLOAT3(positions[i].x - 0.5f, positions[i].y - 0.5f, positions[i].z - 0.5f),
+				XMFLOAT3(positions[i].x + 0.5f, positions[i].y + 0.5f, positions[i].z + 0.5f));
+		}
+
+		// Every stride-th item moves
+		unsigned int stride = ratios[r] > 0 ? (unsigned int)(1.0f / ratios[r] + 0.5f) : 0;
+
+		Camera camera(0, 5, 0);
+		camera.UpdateProjectionMatrix(16.0f / 9.0f);
+
+		double update = 0, frustum = 0, sphere = 0, ray = 0;
+		std::vector<unsigned int> inside, crossing, found;
+		for (unsigned int f = 0; f < frames; f++)
+		{
+			update += MeasureMicroseconds(1, [&]()
+			{
+				for (unsigned int i = 0; stride > 0 && i < itemCount; i += stride)
+				{
+					XMFLOAT3& p = positions[i];
+					p.x += velocities[i].x;
+					p.z += velocities[i].z;
+					tree.Move(i, XMFLOAT3(p.x - 0.5f, p.y - 0.5f, p.z - 0.5f), XMFLOAT3(p.x + 0.5f, p.y + 0.5f, p.z + 0.5f));
+				}
+				tree.Rebalance(256);
+			});
+
+			camera.RotateBy(0, XM_2PI / frames);
+			camera.UpdateViewMatrix();
+			XMFLOAT4 planes[6];
+			camera.GetFrustumPlanes(planes);
+			frustum += MeasureMicroseconds(1, [&]()
+			{
+				inside.clear();
+				crossing.clear();
+				tree.QueryFrustum(planes, inside, crossing);
+			});
+
+			sphere += MeasureMicroseconds(1, [&]()
+			{
+				found.clear();
+				for (unsigned int q = 0; q < probes; q++)
+				{
+					tree.QuerySphere(positions[(q * 7919 + f) % itemCount], 5.0f, found);
+				}
+			}) / probes;
+
+			ray += MeasureMicroseconds(1, [&]()
+			{
+				for (unsigned int q = 0; q < probes; q++)
+				{
+					float distance;
+					XMFLOAT3 origin(random.NextFloat(-side, side), 5, random.NextFloat(-side, side));
+					XMFLOAT3 direction(random.NextFloat(-1, 1), 0, random.NextFloat(-1, 1));
+					tree.RayCast(origin, direction, 100.0f, &distance);
+				}
+			}) / probes;
+		}
+
+		printf("  %6.0f%% %8u %10.1f %10.1f %10.2f %10.2f %8.1f\n",
+			ratios[r] * 100, itemCount, update / frames, frustum / frames,
+			sphere / frames, ray / frames, tree.GetAreaRatio());
+		CHECK(tree.GetItemCount() == itemCount);
+	}
+}
@@ -0,0 +1,137 @@
+#include "Harness.h"
+#include "Emitter.h"
+#include "FluidSimulation.h"
+
+#include <math.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Where the emitter drew its i-th living particle in the pool's staging
+	XMFLOAT3 DrawnAt(ParticlePool& pool, Emitter* emitter, unsigned int i)
+	{
+		unsigned int index = (unsigned int)(emitter->GetParticle(i) - pool.GetParticle(0));
+		return pool.GetVertices(index)[0].position;
+	}
+
+	bool Same(XMFLOAT3 a, XMFLOAT3 b)
+	{
+		return fabsf(a.x - b.x) < 1e-5f && fabsf(a.y - b.y) < 1e-5f && fabsf(a.z - b.z) < 1e-5f;
+	}
+}
+
+// Drawn at alpha 1 a particle is where the last tick left it, at alpha 0
+// where it was before that tick, and halfway in between at a half; that
+// holds through gravity's curve and off the walls it bounces from.
+TEST_CASE(EmitterDrawsBetweenTicks)
+{
+	ID3D11Device device;
+	ParticlePool pool(&device, 4096, PARTICLE_OVERFLOW_DROP);
+	Camera camera(0, 1, -5);
+
+	BoundingBox room(XMFLOAT3(-1.0f, 0.0f, -1.0f), XMFLOAT3(1.0f, 2.0f, 1.0f));
+	std::vector<BoundingBox*> rooms(1, &room);
+
+	Emitter* emitter = new Emitter(
+		XMFLOAT3(0.0f, 0.5f, 0.0f),
+		XMFLOAT3(0.0f, 0.05f, 0.0f),
+		XMFLOAT4(1, 1, 1, 1), XMFLOAT4(1, 1, 1, 0),
+		0.1f, 0.1f,
+		1000, 60.0f, 3.0f,
+		&pool, nullptr, nullptr, nullptr);
+	emitter->SetSpread(91, 20.0f);
+	emitter->SetGravity(0.004f);
+	emitter->SetCollision(PARTICLE_COLLISION_BOUNCE, rooms, 0.8f);
+
+	for (unsigned int t = 0; t < 120; t++) emitter->Update(1.0f / 60.0f);
+	CHECK(emitter->GetParticleCount() > 100);
+
+	float alphas[3] = { 0.0f, 0.5f, 1.0f };
+	for (int a = 0; a < 3; a++)
+	{
+		emitter->CopyParticlesToPool(&camera, alphas[a]);
+		for (unsigned int i = 0; i < emitter->GetParticleCount(); i++)
+		{
+			Particle* p = emitter->GetParticle(i);
+			XMFLOAT3 expected(
+				p->previousPosition.x + (p->position.x - p->previousPosition.x) * alphas[a],
+				p->previousPosition.y + (p->position.y - p->previousPosition.y) * alphas[a],
+				p->previousPosition.z + (p->position.z - p->previousPosition.z) * alphas[a]);
+			CHECK(Same(DrawnAt(pool, emitter, i), expected));
+		}
+	}
+
+	// Nobody bounced through the floor on the way between ticks
+	emitter->CopyParticlesToPool(&camera, 0.0f);
+	for (unsigned int i = 0; i < emitter->GetParticleCount(); i++)
+	{
+		CHECK(DrawnAt(pool, emitter, i).y >= -1e-4f);
+	}
+
+	delete emitter;
+}
+
+// Particles born during the last tick are drawn between the emitter and
+// where they are now, never behind the emitter along their velocity.
+TEST_CASE(EmitterDrawsNewbornsFromTheEmitter)
+{
+	ID3D11Device device;
+	ParticlePool pool(&device, 4096, PARTICLE_OVERFLOW_DROP);
+	Camera camera(0, 1, -5);
+
+	// Many spawns per tick, straight up
+	Emitter* emitter = new Emitter(
+		XMFLOAT3(0.0f, 0.5f, 0.0f),
+		XMFLOAT3(0.0f, 0.05f, 0.0f),
+		XMFLOAT4(1, 1, 1, 1), XMFLOAT4(1, 1, 1, 0),
+		0.1f, 0.1f,
+		1000, 600.0f, 1.0f,
+		&pool, nullptr, nullptr, nullptr);
+	emitter->SetSpread(1, 1.0f);
+
+	for (unsigned int t = 0; t < 3; t++) emitter->Update(1.0f / 60.0f);
+
+	unsigned int newborns = 0;
+	emitter->CopyParticlesToPool(&camera, 0.0f);
+	for (unsigned int i = 0; i < emitter->GetParticleCount(); i++)
+	{
+		XMFLOAT3 drawn = DrawnAt(pool, emitter, i);
+		CHECK(drawn.y >= 0.5f - 1e-5f);
+		if (emitter->GetParticle(i)->age < 1.0f / 60.0f)
+		{
+			CHECK(Same(drawn, XMFLOAT3(0.0f, 0.5f, 0.0f)));
+			newborns++;
+		}
+	}
+	CHECK(newborns >= 9);
+
+	delete emitter;
+}
+
+// The fluid re-sorts its particles every substep; the previous positions
+// have to follow them, so each is still a substep or five from its own.
+TEST_CASE(FluidKeepsPreviousPositionsThroughTheSort)
+{
+	FluidSettings settings;
+	FluidSimulation simulation(4000, settings);
+	for (int t = 0; t < 30; t++) simulation.Update(1.0f / 60.0f);
+
+	const float* x = simulation.GetPositionsX();
+	const float* y = simulation.GetPositionsY();
+	const float* z = simulation.GetPositionsZ();
+	const float* px = simulation.GetPreviousPositionsX();
+	const float* py = simulation.GetPreviousPositionsY();
+	const float* pz = simulation.GetPreviousPositionsZ();
+
+	// Nothing moves much faster than the jet in a sixtieth of a second
+	float furthest = 0.0f;
+	for (unsigned int i = 0; i < simulation.GetParticleCount(); i++)
+	{
+		float dx = x[i] - px[i], dy = y[i] - py[i], dz = z[i] - pz[i];
+		float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+		if (distance > furthest) furthest = distance;
+	}
+	CHECK(furthest < settings.jetSpeed * 2.0f / 60.0f);
+}
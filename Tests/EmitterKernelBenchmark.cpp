@@ -0,0 +1,105 @@
+#include "Harness.h"
+#include "EmitterPolicies.h"
+#include "ParticleCurves.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// What the emitter picks at compile time: one loop per combination
+	template<typename Color, typename Size, typename Motion>
+	void SpecializedUpdate(Particle* particles, unsigned int count, float dt, float steps, float gravity, ParticleCurves* curves)
+	{
+		const bool usesCurves = Color::UsesCurve || Size::UsesCurve || Motion::UsesCurve;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Particle* particle = &particles[i];
+			particle->age += dt;
+
+			unsigned int index = usesCurves ? curves->GetIndex(particle->age) : 0;
+			Motion::Move(particle, steps, gravity, curves, index);
+			Color::Apply(particle, curves, index);
+			Size::Apply(particle, curves, index);
+		}
+	}
+
+	// The generic loop: the same work, with every feature decided per particle
+	void GenericUpdate(Particle* particles, unsigned int count, float dt, float steps, float gravity, ParticleCurves* curves,
+		bool colorCurve, bool sizeCurve, bool speedCurve)
+	{
+		for (unsigned int i = 0; i < count; i++)
+		{
+			Particle* particle = &particles[i];
+			particle->age += dt;
+
+			unsigned int index = curves->GetIndex(particle->age);
+			if (gravity != 0.0f) GravityMotion::Move(particle, steps, gravity, curves, index);
+			else if (speedCurve) SpeedCurveMotion::Move(particle, steps, gravity, curves, index);
+			else LinearMotion::Move(particle, steps, gravity, curves, index);
+
+			if (colorCurve) particle->color = curves->GetColor(index);
+			if (sizeCurve) particle->size = curves->GetSize(index);
+		}
+	}
+
+	void ResetParticles(std::vector<Particle>& particles)
+	{
+		for (size_t i = 0; i < particles.size(); i++)
+		{
+			Particle& p = particles[i];
+			p.position = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			p.velocity = XMFLOAT3(0.001f, 0.02f, -0.001f);
+			p.color = XMFLOAT4(1, 1, 1, 1);
+			p.size = 0.1f;
+			p.age = 2.0f * i / particles.size();
+			p.killed = false;
+		}
+	}
+}
+
+// Nanoseconds per particle for the update loop, specialized per feature
+// combination against one generic loop that branches on each feature
+BENCHMARK_CASE(EmitterKernels)
+{
+	unsigned int count = run.Size(100000, 10000);
+	const float dt = 1.0f / 60.0f;
+
+	ParticleCurves plain(2.0f);
+	ParticleCurves shaped(2.0f);
+	ParticleColorKey colors[3] = {
+		{ 0.0f, XMFLOAT4(1.0f, 0.9f, 0.5f, 1.0f) },
+		{ 0.5f, XMFLOAT4(0.9f, 0.3f, 0.0f, 0.7f) },
+		{ 1.0f, XMFLOAT4(0.2f, 0.2f, 0.2f, 0.0f) } };
+	ParticleCurveKey sizes[2] = { { 0.0f, 0.1f }, { 1.0f, 0.4f } };
+	shaped.SetColorGradient(colors, 3);
+	shaped.SetSizeCurve(sizes, 2);
+
+	std::vector<Particle> particles(count);
+
+	printf("  %9s %-26s %12s %12s\n", "particles", "features", "generic ns", "special ns");
+	for (int combination = 0; combination < 3; combination++)
+	{
+		ParticleCurves* curves = combination == 0 ? &plain : &shaped;
+		float gravity = combination == 2 ? 0.001f : 0.0f;
+		bool curved = combination > 0;
+
+		ResetParticles(particles);
+		double generic = MeasureMicroseconds(15, [&]()
+		{
+			GenericUpdate(particles.data(), count, dt, 1.0f, gravity, curves, curved, curved, false);
+		});
+
+		ResetParticles(particles);
+		double special = MeasureMicroseconds(15, [&]()
+		{
+			if (combination == 0) SpecializedUpdate<ConstantColor, ConstantSize, LinearMotion>(particles.data(), count, dt, 1.0f, gravity, curves);
+			else if (combination == 1) SpecializedUpdate<CurveColor, CurveSize, LinearMotion>(particles.data(), count, dt, 1.0f, gravity, curves);
+			else SpecializedUpdate<CurveColor, CurveSize, GravityMotion>(particles.data(), count, dt, 1.0f, gravity, curves);
+		});
+
+		const char* names[] = { "constant, linear", "color+size curves, linear", "color+size curves, gravity" };
+		printf("  %9u %-26s %12.2f %12.2f\n", count, names[combination], generic * 1000.0 / count, special * 1000.0 / count);
+	}
+}
@@ -0,0 +1,82 @@
+#include "Harness.h"
+#include "Camera.h"
+#include "Emitter.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+// Hundreds of fire emitters on a grid through the rooms, with the camera
+// standing at one end and slowly turning.  Frame cost (simulate and copy
+// to the pool) with every emitter at full rate, against picking a level
+// of detail per emitter each frame and skipping the asleep ones.
+BENCHMARK_CASE(EmitterLOD)
+{
+	unsigned int side = run.Size(20, 8);
+	unsigned int frames = run.Size(600, 120);
+	unsigned int emitterCount = side * side;
+
+	printf("  %8s %6s %10s %8s %8s %8s %8s\n", "emitters", "mode", "frame us", "full", "half", "quarter", "asleep");
+	for (unsigned int mode = 0; mode < 2; mode++)
+	{
+		ID3D11Device device;
+		ParticlePool pool(&device, emitterCount * 256, PARTICLE_OVERFLOW_DROP);
+
+		std::vector<Emitter*> emitters;
+		for (unsigned int i = 0; i < emitterCount; i++)
+		{
+			Emitter* emitter = new Emitter(
+				XMFLOAT3((float)(i % side) * 3.0f - side * 1.5f, 0.5f, (float)(i / side) * 3.0f + 2.0f),
+				XMFLOAT3(0.0f, 0.02f, 0.0f),
+				XMFLOAT4(1.0f, 0.6f, 0.1f, 1.0f),
+				XMFLOAT4(0.3f, 0.0f, 0.0f, 0.0f),
+				0.2f, 0.05f,
+				256, 60.0f, 2.0f,
+				&pool, nullptr, nullptr, nullptr);
+			emitter->Seed(i + 1);
+			emitters.push_back(emitter);
+		}
+
+		Camera camera(0.0f, 1.5f, 0.0f);
+		camera.UpdateProjectionMatrix(16.0f / 9.0f);
+
+		unsigned int counts[4] = {};
+		double total = 0.0;
+		for (unsigned int f = 0; f < frames; f++)
+		{
+			// A full turn every 20 seconds, so emitters keep falling asleep and waking
+			camera.RotateBy(0.0f, XM_2PI / (20.0f * 60.0f));
+			camera.UpdateViewMatrix();
+
+			XMFLOAT4 planes[6];
+			camera.GetFrustumPlanes(planes);
+
+			total += MeasureMicroseconds(1, [&]()
+			{
+				for (unsigned int i = 0; i < emitterCount; i++)
+				{
+					Emitter* emitter = emitters[i];
+					if (mode == 1)
+					{
+						emitter->UpdateLOD(planes, camera.GetPosition());
+						emitter->Update(1.0f / 60.0f);
+						if (emitter->IsVisible()) emitter->CopyParticlesToPool(&camera);
+					}
+					else
+					{
+						emitter->Update(1.0f / 60.0f);
+						emitter->CopyParticlesToPool(&camera);
+					}
+				}
+			});
+
+			for (unsigned int i = 0; i < emitterCount; i++) counts[emitters[i]->GetLOD()]++;
+		}
+
+		printf("  %8u %6s %10.1f %8.1f %8.1f %8.1f %8.1f\n",
+			emitterCount, mode == 0 ? "full" : "lod", total / frames,
+			(double)counts[0] / frames, (double)counts[1] / frames, (double)counts[2] / frames, (double)counts[3] / frames);
+
+		for (unsigned int i = 0; i < emitterCount; i++) delete emitters[i];
+	}
+}
@@ -0,0 +1,122 @@
+#include "Harness.h"
+#include "Clock.h"
+#include "FixedTimestep.h"
+
+#include <math.h>
+#include <vector>
+
+namespace
+{
+	// A ball thrown up, stepped with Euler the way the game steps things
+	struct Ball
+	{
+		double height;
+		double velocity;
+
+		void Step(float dt)
+		{
+			velocity -= 9.8 * dt;
+			height += velocity * dt;
+		}
+	};
+
+	// DXCore::Run without the window: each frame reads the clock, banks
+	// the time since the last frame and runs the ticks it covers.
+	// frameTimes is cycled through.  Returns the most ticks any frame ran.
+	unsigned int RunFrames(ManualClock& clock, FixedTimestep& timestep, const std::vector<double>& frameTimes, unsigned int frames, Ball& ball)
+	{
+		unsigned int mostTicks = 0;
+		double previous = clock.GetSeconds();
+		for (unsigned int f = 0; f < frames; f++)
+		{
+			clock.Advance(frameTimes[f % frameTimes.size()]);
+			double now = clock.GetSeconds();
+			timestep.Advance(now - previous);
+			previous = now;
+
+			unsigned int ticks = 0;
+			while (timestep.Tick())
+			{
+				ball.Step(timestep.GetTickLength());
+				ticks++;
+			}
+			if (ticks > mostTicks) mostTicks = ticks;
+		}
+		return mostTicks;
+	}
+}
+
+// Frames exactly a tick long run exactly one tick each, never zero
+// then two, however many go by.
+TEST_CASE(FixedTimestepTicksOncePerTickFrame)
+{
+	ManualClock clock;
+	FixedTimestep timestep(60, 8);
+	Ball ball = { 0, 5 };
+	std::vector<double> frameTimes(1, 1.0 / 60.0);
+
+	CHECK(RunFrames(clock, timestep, frameTimes, 6000, ball) == 1);
+	CHECK(timestep.GetTickCount() == 6000);
+	CHECK(timestep.GetAlpha() < 0.01f);
+	CHECK(timestep.GetDroppedTime() == 0.0);
+}
+
+// The same ten seconds, drawn at 30Hz, 144Hz, or at uneven rates,
+// runs the same ticks and lands the simulation in the same place.
+TEST_CASE(FixedTimestepIgnoresFrameRate)
+{
+	std::vector<std::vector<double> > rates;
+	rates.push_back(std::vector<double>(1, 1.0 / 30.0));
+	rates.push_back(std::vector<double>(1, 1.0 / 144.0));
+	double uneven[5] = { 0.004, 0.031, 0.017, 0.0005, 0.047 };
+	rates.push_back(std::vector<double>(uneven, uneven + 5));
+
+	std::vector<double> heights;
+	for (size_t r = 0; r < rates.size(); r++)
+	{
+		// Frames to cover just about ten seconds
+		double cycle = 0;
+		for (size_t i = 0; i < rates[r].size(); i++) cycle += rates[r][i];
+		unsigned int frames = (unsigned int)(10.0 / cycle * rates[r].size());
+
+		ManualClock clock(1000.0);
+		FixedTimestep timestep(60, 8);
+		Ball ball = { 0, 5 };
+		RunFrames(clock, timestep, rates[r], frames, ball);
+
+		// Then run out to exactly tick 600
+		std::vector<double> small(1, 0.001);
+		while (timestep.GetTickCount() < 600) RunFrames(clock, timestep, small, 1, ball);
+		CHECK(timestep.GetTickCount() == 600);
+		CHECK(timestep.GetDroppedTime() == 0.0);
+		heights.push_back(ball.height);
+	}
+
+	CHECK(heights[1] == heights[0]);
+	CHECK(heights[2] == heights[0]);
+}
+
+// A long hitch runs at most the max substeps and drops the rest, and
+// part of a tick left over is the alpha frames draw at.
+TEST_CASE(FixedTimestepCapsSubstepsAndInterpolates)
+{
+	ManualClock clock;
+	FixedTimestep timestep(60, 8);
+	Ball ball = { 0, 5 };
+
+	std::vector<double> hitch(1, 1.0);
+	CHECK(RunFrames(clock, timestep, hitch, 1, ball) == 8);
+	CHECK(timestep.GetTickCount() == 8);
+	CHECK(fabs(timestep.GetDroppedTime() - (1.0 - 8.0 / 60.0)) < 1e-9);
+
+	// Half a tick more: nothing runs, and the frame is halfway along
+	std::vector<double> half(1, 0.5 / 60.0);
+	CHECK(RunFrames(clock, timestep, half, 1, ball) == 0);
+	CHECK(fabsf(timestep.GetAlpha() - 0.5f) < 1e-4f);
+
+	// The bank keeps its seconds when the tick rate changes
+	timestep.SetTickRate(120);
+	CHECK(fabsf(timestep.GetAlpha() - 1.0f) < 1e-4f);
+	CHECK(timestep.Tick());
+	CHECK(!timestep.Tick());
+}
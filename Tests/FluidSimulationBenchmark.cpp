@@ -0,0 +1,77 @@
+#include "Harness.h"
+#include "FluidSimulation.h"
+#include "Parallel.h"
+
+#include <math.h>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	// The gallery's basin, with the smoothing radius shrunk so more
+	// particles still fill it to the same depth (the default is tuned
+	// for 50K) and every particle keeps about as many neighbors
+	FluidSettings ScaledSettings(unsigned int particleCount)
+	{
+		FluidSettings settings;
+		settings.smoothingRadius *= cbrtf(50000.0f / particleCount);
+		return settings;
+	}
+}
+
+// What a parallel loop pays just to start its workers and wait for
+// them: a thread spawned and joined per call, against the pool.
+// The fluid runs seven of these a substep.
+BENCHMARK_CASE(ParallelDispatch)
+{
+	unsigned int calls = run.Size(2000, 200);
+	unsigned int workers = 4;
+	std::vector<unsigned int> hits(workers, 0);
+
+	double spawned = MeasureMicroseconds(1, [&]()
+	{
+		for (unsigned int c = 0; c < calls; c++)
+		{
+			std::vector<std::thread> threads;
+			for (unsigned int t = 1; t < workers; t++) threads.push_back(std::thread([&](unsigned int w) { hits[w]++; }, t));
+			hits[0]++;
+			for (unsigned int t = 0; t < threads.size(); t++) threads[t].join();
+		}
+	});
+
+	double pooled = MeasureMicroseconds(1, [&]()
+	{
+		for (unsigned int c = 0; c < calls; c++)
+		{
+			RunParallel(workers, [&](unsigned int w) { hits[w]++; });
+		}
+	});
+
+	printf("  %8s %8s %12s\n", "workers", "mode", "us per call");
+	printf("  %8u %8s %12.2f\n", workers, "spawn", spawned / calls);
+	printf("  %8u %8s %12.2f\n", workers, "pool", pooled / calls);
+	CHECK(hits[workers - 1] == calls * 2);
+}
+
+// Substeps per second of the headless fluid, filled and settled,
+// on one thread and on four.
+BENCHMARK_CASE(FluidSteps)
+{
+	unsigned int sizes[2] = { run.Size(50000, 5000), run.Size(250000, 20000) };
+	unsigned int steps = run.Size(20, 3);
+
+	printf("  %9s %8s %10s %10s\n", "particles", "threads", "step ms", "steps/s");
+	for (unsigned int s = 0; s < 2; s++)
+	{
+		FluidSimulation fluid(sizes[s], ScaledSettings(sizes[s]));
+		for (unsigned int i = 0; i < steps; i++) fluid.Step();
+
+		unsigned int threadCounts[2] = { 1, 4 };
+		for (unsigned int t = 0; t < 2; t++)
+		{
+			fluid.SetThreadCount(threadCounts[t]);
+			double time = MeasureMicroseconds(steps, [&]() { fluid.Step(); });
+			printf("  %9u %8u %10.2f %10.1f\n", sizes[s], threadCounts[t], time / 1000.0, 1000000.0 / time);
+		}
+	}
+}
@@ -0,0 +1,253 @@
+#include "Harness.h"
+#include "GPUParticleReference.h"
+#include "Random.h"
+
+#include <algorithm>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+using namespace DirectX;
+
+#define GPU_GOLDEN_FILE GOLDEN_DIR "/GPUParticleReference.txt"
+
+// How far a float may drift from the golden value: a few units in the
+// last place, or a hair either side of zero where ulps get tiny
+#define GPU_GOLDEN_ULPS 4
+#define GPU_GOLDEN_EPSILON 1e-6f
+
+namespace
+{
+	// The emitter the golden run uses: enough spawns per frame that
+	// the dead list runs dry, so exhaustion is covered too
+	GPUParticleParams MakeParams(unsigned int step, unsigned int spawnBase, unsigned int key)
+	{
+		int angles = 91;
+		float calmness = 20.0f;
+
+		GPUParticleParams params = {};
+		params.emitterPosition = XMFLOAT3(1.0f, 2.0f, 3.0f);
+		params.startVelocity = XMFLOAT3(0.0f, 0.05f, 0.0f);
+		params.startColor = XMFLOAT4(1.0f, 0.6f, 0.1f, 1.0f);
+		params.endColor = XMFLOAT4(0.2f, 0.0f, 0.0f, 0.0f);
+		params.startSize = 0.3f;
+		params.endSize = 0.05f;
+		params.lifetime = 2.0f;
+		params.invLifetime = 1.0f / params.lifetime;
+		params.spread = (angles / 2) / (calmness * angles);
+		params.dt = 1.0f / 60.0f;
+		params.emitCount = 3 + step % 4;
+		params.spawnBase = spawnBase;
+		params.randomKey = key;
+		params.maxParticles = 256;
+		return params;
+	}
+
+	// Every living particle, ordered by spawn id (the GPU's own order isn't defined)
+	void Describe(GPUParticleReference& reference, unsigned int step, std::string& out)
+	{
+		const std::vector<GPUParticle>& particles = reference.GetParticles();
+		std::vector<unsigned int> drawList = reference.GetDrawList();
+		std::sort(drawList.begin(), drawList.end(), [&](unsigned int a, unsigned int b)
+		{
+			return particles[a].spawnId < particles[b].spawnId;
+		});
+
+		char line[512];
+		snprintf(line, sizeof(line), "step %u drawn %u dead %u\n", step, (unsigned int)drawList.size(), reference.GetDeadCount());
+		out += line;
+
+		for (size_t i = 0; i < drawList.size(); i++)
+		{
+			const GPUParticle& p = particles[drawList[i]];
+			snprintf(line, sizeof(line), "%u %a %a %a %a %a %a %a %a %a %a %a %a %a %a %a\n",
+				p.spawnId,
+				p.position.x, p.position.y, p.position.z,
+				p.previousPosition.x, p.previousPosition.y, p.previousPosition.z, p.age,
+				p.velocity.x, p.velocity.y, p.velocity.z, p.size,
+				p.color.x, p.color.y, p.color.z, p.color.w);
+			out += line;
+		}
+	}
+
+	std::string RunGoldenScenario()
+	{
+		Random random(7);
+		GPUParticleReference reference(256);
+		reference.DeadListInit();
+
+		std::string out;
+		unsigned int spawnBase = 0;
+		for (unsigned int step = 1; step <= 240; step++)
+		{
+			GPUParticleParams params = MakeParams(step, spawnBase, random.GetKey());
+			reference.Step(params);
+			spawnBase += params.emitCount;
+
+			if (step == 1 || step == 30 || step == 120 || step == 240)
+				Describe(reference, step, out);
+		}
+		return out;
+	}
+
+	bool ReadFile(const char* path, std::string& out)
+	{
+		FILE* file = fopen(path, "rb");
+		if (!file) return false;
+
+		char buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) out.append(buffer, read);
+		fclose(file);
+		return true;
+	}
+
+	// The kernels GPUParticleReference mirrors, by FNV-1a of their text
+	// (carriage returns dropped, so checkouts on any platform agree).
+	// Written into the golden file's header and checked against it.
+	std::string DescribeKernels()
+	{
+		const char* kernels[4] = { "ParticleDeadListInitCS.hlsl", "ParticleEmitCS.hlsl", "ParticleUpdateCS.hlsl", "ParticleGPUCommon.hlsli" };
+
+		std::string out;
+		for (int k = 0; k < 4; k++)
+		{
+			std::string text;
+			ReadFile((std::string(SHADER_DIR "/") + kernels[k]).c_str(), text);
+
+			unsigned long long hash = 14695981039346656037ull;
+			for (size_t c = 0; c < text.size(); c++)
+			{
+				if (text[c] != '\r') hash = (hash ^ (unsigned char)text[c]) * 1099511628211ull;
+			}
+
+			char line[128];
+			snprintf(line, sizeof(line), "# kernel %s %016llx\n", kernels[k], text.empty() ? 0ull : hash);
+			out += line;
+		}
+		return out;
+	}
+
+	// Splits off the header's comment lines, and the body into lines
+	void SplitGolden(const std::string& text, std::string& kernels, std::vector<std::string>& lines)
+	{
+		size_t start = 0;
+		while (start < text.size())
+		{
+			size_t end = text.find('\n', start);
+			if (end == std::string::npos) end = text.size();
+			std::string line = text.substr(start, end - start);
+			if (!line.empty() && line[line.size() - 1] == '\r') line.erase(line.size() - 1);
+
+			if (line.compare(0, 9, "# kernel ") == 0) kernels += line + "\n";
+			else if (!line.empty() && line[0] != '#') lines.push_back(line);
+			start = end + 1;
+		}
+	}
+
+	// Floats as integers that count ulps, with -0 and +0 next to each other
+	long long OrderedBits(float f)
+	{
+		int bits;
+		memcpy(&bits, &f, sizeof(bits));
+		return bits < 0 ? -(long long)(bits & 0x7FFFFFFF) : (long long)bits;
+	}
+
+	// Particle lines compare their spawn ids exactly and the floats after
+	// them within tolerance; step lines compare exactly
+	bool LinesMatch(const std::string& output, const std::string& golden)
+	{
+		if (output.compare(0, 5, "step ") == 0 || golden.compare(0, 5, "step ") == 0) return output == golden;
+
+		const char* a = output.c_str();
+		const char* b = golden.c_str();
+		char* aEnd;
+		char* bEnd;
+		if (strtoul(a, &aEnd, 10) != strtoul(b, &bEnd, 10)) return false;
+
+		while (*aEnd != 0 || *bEnd != 0)
+		{
+			a = aEnd;
+			b = bEnd;
+			float x = strtof(a, &aEnd);
+			float y = strtof(b, &bEnd);
+			if (aEnd == a || bEnd == b) return false;
+
+			long long ulps = OrderedBits(x) - OrderedBits(y);
+			if (ulps < 0) ulps = -ulps;
+			if (ulps > GPU_GOLDEN_ULPS && fabsf(x - y) > GPU_GOLDEN_EPSILON) return false;
+		}
+		return true;
+	}
+}
+
+// The reference's hash has to be the emitter's: same key, same counter, same bits
+TEST_CASE(GPUReferenceRandomMatchesEmitter)
+{
+	Random random(7);
+	GPUParticleReference reference(1);
+	GPUParticleParams params = MakeParams(0, 1000, random.GetKey());
+	params.emitCount = 1;
+	params.maxParticles = 1;
+
+	reference.DeadListInit();
+	reference.Emit(params);
+
+	const GPUParticle& p = reference.GetParticles()[0];
+	CHECK(p.spawnId == 1000);
+	CHECK(p.velocity.x == (Random::ToFloat(random.At(2000)) * 2.0f - 1.0f) * params.spread);
+	CHECK(p.velocity.z == (Random::ToFloat(random.At(2001)) * 2.0f - 1.0f) * params.spread);
+}
+
+// 240 frames of spawning, aging and dying, compared against the committed
+// output within GPU_GOLDEN_ULPS.  The file's header records the kernels it
+// was written from; when one changes, this fails until the golden file is
+// regenerated with --update-golden and the new output reviewed with it.
+TEST_CASE(GPUReferenceMatchesGolden)
+{
+	std::string output = RunGoldenScenario();
+	std::string kernels = DescribeKernels();
+
+	if (IsUpdatingGolden())
+	{
+		FILE* file = fopen(GPU_GOLDEN_FILE, "wb");
+		CHECK(file != nullptr);
+		if (file)
+		{
+			fputs("# GPUParticleReference over the 240 steps of GPUReferenceMatchesGolden\n", file);
+			fputs("# (Tests/GPUParticleReferenceTests.cpp), written by GalleryTests --update-golden.\n", file);
+			fputs("# Living particles at steps 1, 30, 120 and 240, by spawn id: position, previous\n", file);
+			fputs("# position, age, velocity, size and color as hex floats.  Written from these kernels:\n", file);
+			fwrite(kernels.data(), 1, kernels.size(), file);
+			fwrite(output.data(), 1, output.size(), file);
+			fclose(file);
+		}
+		return;
+	}
+
+	std::string golden;
+	CHECK(ReadFile(GPU_GOLDEN_FILE, golden));
+	if (golden.empty()) return;
+
+	std::string goldenKernels, outputKernels;
+	std::vector<std::string> goldenLines, outputLines;
+	SplitGolden(golden, goldenKernels, goldenLines);
+	SplitGolden(output, outputKernels, outputLines);
+
+	if (goldenKernels != kernels) printf("  kernels changed since the golden file was written; review and rerun with --update-golden\n");
+	CHECK(goldenKernels == kernels);
+
+	// Point at the first line that differs
+	CHECK(outputLines.size() == goldenLines.size());
+	for (size_t i = 0; i < outputLines.size() && i < goldenLines.size(); i++)
+	{
+		if (LinesMatch(outputLines[i], goldenLines[i])) continue;
+
+		printf("  first difference at: %s\n  golden:              %s\n", outputLines[i].c_str(), goldenLines[i].c_str());
+		CHECK(LinesMatch(outputLines[i], goldenLines[i]));
+		break;
+	}
+}
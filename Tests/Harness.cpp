@@ -0,0 +1,102 @@
+#include "Harness.h"
+
+#include <string.h>
+
+namespace
+{
+	HarnessCase* firstCase = 0;
+	HarnessCase* lastCase = 0;
+	unsigned int failures = 0;
+	bool updatingGolden = false;
+
+	void AddCase(const char* name, HarnessKind kind, HarnessTestFunc test, HarnessBenchmarkFunc benchmark)
+	{
+		// Kept in registration order, so runs are repeatable
+		HarnessCase* c = new HarnessCase();
+		c->name = name;
+		c->kind = kind;
+		c->test = test;
+		c->benchmark = benchmark;
+		c->next = 0;
+
+		if (lastCase) lastCase->next = c;
+		else firstCase = c;
+		lastCase = c;
+	}
+
+	bool IsSelected(const char* name, int argc, char** argv)
+	{
+		bool any = false;
+		for (int i = 1; i < argc; i++)
+		{
+			if (argv[i][0] == '-') continue;
+			any = true;
+			if (strcmp(argv[i], name) == 0) return true;
+		}
+		return !any;
+	}
+}
+
+HarnessRegistrar::HarnessRegistrar(const char* name, HarnessTestFunc test)
+{
+	AddCase(name, HARNESS_TEST, test, 0);
+}
+
+HarnessRegistrar::HarnessRegistrar(const char* name, HarnessBenchmarkFunc benchmark)
+{
+	AddCase(name, HARNESS_BENCHMARK, 0, benchmark);
+}
+
+void HarnessFail(const char* file, int line, const char* expression)
+{
+	printf("  %s(%d): CHECK(%s) failed\n", file, line, expression);
+	failures++;
+}
+
+bool IsUpdatingGolden()
+{
+	return updatingGolden;
+}
+
+int RunHarness(HarnessKind kind, int argc, char** argv)
+{
+	bool quick = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--quick") == 0) quick = true;
+		if (strcmp(argv[i], "--update-golden") == 0) updatingGolden = true;
+	}
+
+	unsigned int ran = 0;
+	unsigned int failed = 0;
+	for (HarnessCase* c = firstCase; c; c = c->next)
+	{
+		if (c->kind != kind || !IsSelected(c->name, argc, argv)) continue;
+
+		printf("%s\n", c->name);
+		fflush(stdout);
+
+		unsigned int before = failures;
+		if (kind == HARNESS_TEST)
+		{
+			c->test();
+		}
+		else
+		{
+			BenchmarkRun run(quick);
+			c->benchmark(run);
+		}
+
+		ran++;
+		if (failures != before) failed++;
+	}
+
+	if (ran == 0)
+	{
+		printf("no matching cases\n");
+		return 1;
+	}
+
+	printf("%u run, %u failed\n", ran, failed);
+	return failed == 0 ? 0 : 1;
+}
@@ -0,0 +1,104 @@
+#pragma once
+#include <chrono>
+#include <stdio.h>
+
+// --------------------------------------------------------
+// A very small test and benchmark runner for the parts of
+// the gallery that build without Direct3D.
+//
+// Cases register themselves from wherever they're defined:
+//
+//     TEST_CASE(SorterOrdersByDepth) { CHECK(...); }
+//     BENCHMARK_CASE(SortParticles) { ... run.IsQuick() ... }
+//
+// GalleryTests runs every test case (or the ones named on
+// the command line) and fails if any CHECK did.  Gallery-
+// Benchmarks does the same for benchmarks and prints their
+// reports; --quick shrinks them to a smoke run.
+// --------------------------------------------------------
+enum HarnessKind
+{
+	HARNESS_TEST,
+	HARNESS_BENCHMARK
+};
+
+class BenchmarkRun
+{
+public:
+	BenchmarkRun(bool quick) { this->quick = quick; }
+
+	// Smoke runs (under ctest) use the small size
+	bool IsQuick() { return quick; }
+	unsigned int Size(unsigned int full, unsigned int small) { return quick ? small : full; }
+
+private:
+	bool quick;
+};
+
+typedef void (*HarnessTestFunc)();
+typedef void (*HarnessBenchmarkFunc)(BenchmarkRun& run);
+
+struct HarnessCase
+{
+	const char* name;
+	HarnessKind kind;
+	HarnessTestFunc test;
+	HarnessBenchmarkFunc benchmark;
+	HarnessCase* next;
+};
+
+// Adds a case to the list at static initialization
+struct HarnessRegistrar
+{
+	HarnessRegistrar(const char* name, HarnessTestFunc test);
+	HarnessRegistrar(const char* name, HarnessBenchmarkFunc benchmark);
+};
+
+// Records a failed CHECK (the runner reports them all)
+void HarnessFail(const char* file, int line, const char* expression);
+
+// Golden output files live in Tests/Golden (GOLDEN_DIR).  Tests compare
+// against them, unless --update-golden was given, when they rewrite them.
+bool IsUpdatingGolden();
+
+// Runs the registered cases of one kind; returns the process exit code
+int RunHarness(HarnessKind kind, int argc, char** argv);
+
+#define TEST_CASE(name) \
+	static void name(); \
+	static HarnessRegistrar name##Registrar(#name, &name); \
+	static void name()
+
+#define BENCHMARK_CASE(name) \
+	static void name(BenchmarkRun& run); \
+	static HarnessRegistrar name##Registrar(#name, &name); \
+	static void name(BenchmarkRun& run)
+
+#define CHECK(expression) \
+	do { if (!(expression)) HarnessFail(__FILE__, __LINE__, #expression); } while (0)
+
+// Median wall time of func() in microseconds, over the given runs
+template<typename Func>
+double MeasureMicroseconds(unsigned int runs, Func func)
+{
+	double times[64];
+	if (runs > 64) runs = 64;
+	if (runs == 0) runs = 1;
+
+	for (unsigned int r = 0; r < runs; r++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		func();
+		times[r] = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Insertion sort; there are only a handful
+	for (unsigned int i = 1; i < runs; i++)
+	{
+		double t = times[i];
+		unsigned int j = i;
+		for (; j > 0 && times[j - 1] > t; j--) times[j] = times[j - 1];
+		times[j] = t;
+	}
+	return times[runs / 2];
+}
@@ -0,0 +1,10 @@
+#include "SimpleShader.h"
+
+// --------------------------------------------------------
+// The SimpleShader calls the headless sources make on
+// their draw paths, as no-ops.  Nothing headless loads a
+// shader, so these only have to link.
+// --------------------------------------------------------
+void ISimpleShader::SetShader() {}
+void ISimpleShader::CopyAllBufferData() {}
+bool ISimpleShader::SetMatrix4x4(std::string, const DirectX::XMFLOAT4X4) { return false; }
@@ -0,0 +1,14 @@
+#pragma once
+
+// --------------------------------------------------------
+// Stand-in for Windows.h: no keys are ever held down.
+// --------------------------------------------------------
+#ifndef NOMINMAX
+#define min(a, b) (((a) < (b)) ? (a) : (b))
+#define max(a, b) (((a) > (b)) ? (a) : (b))
+#endif
+
+#define VK_SHIFT 0x10
+#define VK_CONTROL 0x11
+
+inline short GetAsyncKeyState(int) { return 0; }
@@ -0,0 +1,147 @@
+#pragma once
+#include <stddef.h>
+
+// --------------------------------------------------------
+// Stand-in for the parts of d3d11.h the headless sources
+// touch.  Buffers are created without memory behind them,
+// Map hands out one shared scratch block (so anything
+// written there is throwaway, as with WRITE_DISCARD), and
+// draws do nothing.  Enough for the CPU side of a system
+// to run and be measured; nothing here renders.
+// --------------------------------------------------------
+typedef unsigned int UINT;
+typedef long HRESULT;
+typedef int BOOL;
+
+#define S_OK ((HRESULT)0)
+#define SUCCEEDED(hr) (((HRESULT)(hr)) >= 0)
+#define FAILED(hr) (((HRESULT)(hr)) < 0)
+
+enum D3D11_USAGE
+{
+	D3D11_USAGE_DEFAULT = 0,
+	D3D11_USAGE_IMMUTABLE = 1,
+	D3D11_USAGE_DYNAMIC = 2,
+	D3D11_USAGE_STAGING = 3
+};
+
+enum D3D11_BIND_FLAG
+{
+	D3D11_BIND_VERTEX_BUFFER = 0x1,
+	D3D11_BIND_INDEX_BUFFER = 0x2,
+	D3D11_BIND_CONSTANT_BUFFER = 0x4,
+	D3D11_BIND_SHADER_RESOURCE = 0x8,
+	D3D11_BIND_STREAM_OUTPUT = 0x10,
+	D3D11_BIND_UNORDERED_ACCESS = 0x80
+};
+
+enum D3D11_CPU_ACCESS_FLAG
+{
+	D3D11_CPU_ACCESS_WRITE = 0x10000,
+	D3D11_CPU_ACCESS_READ = 0x20000
+};
+
+enum D3D11_RESOURCE_MISC_FLAG
+{
+	D3D11_RESOURCE_MISC_DRAWINDIRECT_ARGS = 0x10,
+	D3D11_RESOURCE_MISC_BUFFER_STRUCTURED = 0x40
+};
+
+enum D3D11_MAP
+{
+	D3D11_MAP_READ = 1,
+	D3D11_MAP_WRITE = 2,
+	D3D11_MAP_READ_WRITE = 3,
+	D3D11_MAP_WRITE_DISCARD = 4,
+	D3D11_MAP_WRITE_NO_OVERWRITE = 5
+};
+
+enum DXGI_FORMAT
+{
+	DXGI_FORMAT_UNKNOWN = 0,
+	DXGI_FORMAT_R32G32B32A32_FLOAT = 2,
+	DXGI_FORMAT_R32G32B32_FLOAT = 6,
+	DXGI_FORMAT_R32G32_FLOAT = 16,
+	DXGI_FORMAT_R32_UINT = 42
+};
+
+struct D3D11_BUFFER_DESC
+{
+	UINT ByteWidth;
+	UINT Usage;
+	UINT BindFlags;
+	UINT CPUAccessFlags;
+	UINT MiscFlags;
+	UINT StructureByteStride;
+};
+
+struct D3D11_SUBRESOURCE_DATA
+{
+	const void* pSysMem;
+	UINT SysMemPitch;
+	UINT SysMemSlicePitch;
+};
+
+struct D3D11_MAPPED_SUBRESOURCE
+{
+	void* pData;
+	UINT RowPitch;
+	UINT DepthPitch;
+};
+
+struct IUnknown
+{
+	unsigned long AddRef() { return 1; }
+	unsigned long Release() { return 0; }
+};
+
+struct ID3D11Resource : IUnknown {};
+struct ID3D11Buffer : ID3D11Resource {};
+struct ID3D11View : IUnknown {};
+struct ID3D11ShaderResourceView : ID3D11View {};
+struct ID3D11UnorderedAccessView : ID3D11View {};
+struct ID3D11SamplerState : IUnknown {};
+struct ID3D11InputLayout : IUnknown {};
+struct ID3D11VertexShader : IUnknown {};
+struct ID3D11PixelShader : IUnknown {};
+struct ID3D11DomainShader : IUnknown {};
+struct ID3D11HullShader : IUnknown {};
+struct ID3D11GeometryShader : IUnknown {};
+struct ID3D11ComputeShader : IUnknown {};
+
+struct ID3D11Device : IUnknown
+{
+	HRESULT CreateBuffer(const D3D11_BUFFER_DESC*, const D3D11_SUBRESOURCE_DATA*, ID3D11Buffer** buffer)
+	{
+		static ID3D11Buffer shared;
+		*buffer = &shared;
+		return S_OK;
+	}
+};
+
+struct ID3D11DeviceContext : IUnknown
+{
+	// Large enough for the biggest dynamic buffer the tests map
+	static const size_t ScratchSize = 64 << 20;
+
+	ID3D11DeviceContext() { scratch = new char[ScratchSize]; }
+	~ID3D11DeviceContext() { delete[] scratch; }
+
+	HRESULT Map(ID3D11Resource*, UINT, D3D11_MAP, UINT, D3D11_MAPPED_SUBRESOURCE* mapped)
+	{
+		mapped->pData = scratch;
+		mapped->RowPitch = 0;
+		mapped->DepthPitch = 0;
+		return S_OK;
+	}
+	void Unmap(ID3D11Resource*, UINT) {}
+
+	void IASetVertexBuffers(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) {}
+	void IASetIndexBuffer(ID3D11Buffer*, DXGI_FORMAT, UINT) {}
+	void Draw(UINT, UINT) {}
+	void DrawIndexed(UINT, UINT, int) {}
+	void DrawIndexedInstanced(UINT, UINT, UINT, int, UINT) {}
+
+private:
+	char* scratch;
+};
@@ -0,0 +1,14 @@
+#pragma once
+#include <d3d11.h>
+
+// --------------------------------------------------------
+// Stand-in for d3dcompiler.h: just the types SimpleShader.h
+// declares with.  Shaders never load headlessly.
+// --------------------------------------------------------
+typedef const wchar_t* LPCWSTR;
+
+struct ID3DBlob : IUnknown
+{
+	void* GetBufferPointer() { return nullptr; }
+	size_t GetBufferSize() { return 0; }
+};
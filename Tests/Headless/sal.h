@@ -0,0 +1,34 @@
+#pragma once
+
+// --------------------------------------------------------
+// Stand-in for sal.h, the source annotations DirectXMath
+// marks its parameters with.  Outside of MSVC's analyzer
+// they mean nothing, so every one expands to nothing.
+// --------------------------------------------------------
+#define _In_
+#define _In_opt_
+#define _In_z_
+#define _In_reads_(size)
+#define _In_reads_opt_(size)
+#define _In_reads_bytes_(size)
+#define _In_range_(low, high)
+#define _Out_
+#define _Out_opt_
+#define _Out_writes_(size)
+#define _Out_writes_opt_(size)
+#define _Out_writes_bytes_(size)
+#define _Out_writes_all_(size)
+#define _Inout_
+#define _Inout_opt_
+#define _Inout_updates_(size)
+#define _Inout_updates_bytes_(size)
+#define _Outptr_
+#define _Outptr_opt_
+#define _Ret_maybenull_
+#define _Check_return_
+#define _Success_(expression)
+#define _Use_decl_annotations_
+#define _Analysis_assume_(expression)
+#define _Printf_format_string_
+#define _Pre_
+#define _Post_
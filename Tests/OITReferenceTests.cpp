@@ -0,0 +1,117 @@
+#include "Harness.h"
+#include "OITReference.h"
+
+#include <math.h>
+
+using namespace DirectX;
+
+namespace
+{
+	bool Near(XMFLOAT3 a, XMFLOAT3 b, float epsilon)
+	{
+		return fabsf(a.x - b.x) <= epsilon && fabsf(a.y - b.y) <= epsilon && fabsf(a.z - b.z) <= epsilon;
+	}
+
+	// Sorted back-to-front "over" blending, what OIT approximates
+	XMFLOAT3 Over(XMFLOAT4 color, XMFLOAT3 background)
+	{
+		return XMFLOAT3(
+			color.x * color.w + background.x * (1.0f - color.w),
+			color.y * color.w + background.y * (1.0f - color.w),
+			color.z * color.w + background.z * (1.0f - color.w));
+	}
+}
+
+TEST_CASE(OITUntouchedPixelKeepsBackground)
+{
+	XMFLOAT3 background(0.2f, 0.4f, 0.6f);
+	XMFLOAT3 result = OITReference::Composite(OITReference::Clear(), background);
+	CHECK(result.x == background.x && result.y == background.y && result.z == background.z);
+}
+
+TEST_CASE(OITSingleSurfaceMatchesOver)
+{
+	// With one surface the weight cancels out, at any depth
+	XMFLOAT3 background(0.1f, 0.2f, 0.3f);
+	XMFLOAT4 glass(0.9f, 0.5f, 0.1f, 0.35f);
+	float depths[] = { 0.1f, 2.0f, 30.0f, 500.0f };
+	for (int i = 0; i < 4; i++)
+	{
+		OITPixel pixel = OITReference::Clear();
+		OITReference::Accumulate(pixel, glass, depths[i]);
+		CHECK(fabsf(pixel.revealage - 0.65f) < 1e-6f);
+		CHECK(Near(OITReference::Composite(pixel, background), Over(glass, background), 1e-5f));
+	}
+}
+
+TEST_CASE(OITIsOrderIndependent)
+{
+	XMFLOAT3 background(0.0f, 0.0f, 0.0f);
+	XMFLOAT4 red(1.0f, 0.0f, 0.0f, 0.5f);
+	XMFLOAT4 blue(0.0f, 0.0f, 1.0f, 0.25f);
+
+	OITPixel redFirst = OITReference::Clear();
+	OITReference::Accumulate(redFirst, red, 3.0f);
+	OITReference::Accumulate(redFirst, blue, 8.0f);
+
+	OITPixel blueFirst = OITReference::Clear();
+	OITReference::Accumulate(blueFirst, blue, 8.0f);
+	OITReference::Accumulate(blueFirst, red, 3.0f);
+
+	CHECK(Near(OITReference::Composite(redFirst, background), OITReference::Composite(blueFirst, background), 1e-6f));
+
+	// Revealage is the product of what each lets through
+	CHECK(fabsf(redFirst.revealage - 0.5f * 0.75f) < 1e-6f);
+}
+
+TEST_CASE(OITSameColorLayersMatchOver)
+{
+	// Equal colors average to that color, so only coverage matters
+	XMFLOAT3 background(0.5f, 0.5f, 0.5f);
+	XMFLOAT4 smoke(0.2f, 0.2f, 0.25f, 0.3f);
+
+	OITPixel pixel = OITReference::Clear();
+	XMFLOAT3 sorted = background;
+	for (int i = 0; i < 5; i++)
+	{
+		OITReference::Accumulate(pixel, smoke, 1.0f + i * 7.0f);
+		sorted = Over(smoke, sorted);
+	}
+	CHECK(Near(OITReference::Composite(pixel, background), sorted, 1e-5f));
+}
+
+TEST_CASE(OITNearerSurfaceDominates)
+{
+	XMFLOAT3 background(0.0f, 0.0f, 0.0f);
+	XMFLOAT4 red(1.0f, 0.0f, 0.0f, 0.5f);
+	XMFLOAT4 blue(0.0f, 0.0f, 1.0f, 0.5f);
+
+	// Red in front: the result leans red, as sorted blending would
+	OITPixel pixel = OITReference::Clear();
+	OITReference::Accumulate(pixel, blue, 60.0f);
+	OITReference::Accumulate(pixel, red, 1.0f);
+	XMFLOAT3 result = OITReference::Composite(pixel, background);
+	XMFLOAT3 sorted = Over(red, Over(blue, background));
+
+	CHECK(result.x > result.z);
+	CHECK(sorted.x > sorted.z);
+
+	// Total coverage is exact, only the split between layers is approximate
+	CHECK(fabsf((result.x + result.z) - (sorted.x + sorted.z)) < 1e-5f);
+}
+
+TEST_CASE(OITWeightFallsOffAndClamps)
+{
+	float previous = OITReference::Weight(0.01f, 1.0f);
+	CHECK(previous == 3e3f);
+	for (float depth = 0.5f; depth < 1000.0f; depth *= 2.0f)
+	{
+		float weight = OITReference::Weight(depth, 1.0f);
+		CHECK(weight <= previous);
+		previous = weight;
+	}
+	CHECK(OITReference::Weight(1e5f, 1.0f) == 1e-2f);
+
+	// Alpha scales it
+	CHECK(OITReference::Weight(10.0f, 0.5f) == 0.5f * OITReference::Weight(10.0f, 1.0f));
+}
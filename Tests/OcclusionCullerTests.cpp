@@ -0,0 +1,118 @@
+#include "Harness.h"
+#include "Camera.h"
+#include "CullingSystem.h"
+#include "OcclusionCuller.h"
+#include "TransformSystem.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// A quad in the z = 0 plane spanning -1 to 1, facing -z (toward a
+	// camera in front of it) unless flipped.  Front faces are clockwise.
+	std::vector<XMFLOAT3> Wall(bool flipped)
+	{
+		XMFLOAT3 corners[4] = {
+			XMFLOAT3(-1, -1, 0), XMFLOAT3(-1, 1, 0), XMFLOAT3(1, 1, 0), XMFLOAT3(1, -1, 0) };
+		int order[6] = { 0, 1, 2, 0, 2, 3 };
+
+		std::vector<XMFLOAT3> positions;
+		for (int i = 0; i < 6; i++)
+		{
+			positions.push_back(corners[order[flipped ? 5 - i : i]]);
+		}
+		return positions;
+	}
+
+	// Camera at the origin looking down +z, a wall 4 wide at z = 5 (so
+	// its edges are on screen), and a unit box (its own transform)
+	// wherever the test puts it
+	struct WallScene
+	{
+		TransformSystem transforms;
+		CullingSystem culling;
+		OcclusionCuller occlusion;
+		Camera camera;
+		std::vector<XMFLOAT3> wall;
+		unsigned int wallTransform;
+		unsigned int box;
+
+		WallScene(bool flipped)
+			: culling(&transforms), occlusion(&transforms, &culling), camera(0, 0, 0)
+		{
+			wall = Wall(flipped);
+			wallTransform = transforms.Create();
+			transforms.SetPosition(wallTransform, XMFLOAT3(0, 0, 5));
+			transforms.SetScale(wallTransform, XMFLOAT3(2, 2, 1));
+			culling.SetLocalBounds(wallTransform, XMFLOAT3(-1, -1, 0), XMFLOAT3(1, 1, 0), 1.42f);
+			occlusion.AddOccluder(wallTransform, &wall[0], 2);
+
+			box = transforms.Create();
+			culling.SetLocalBounds(box, XMFLOAT3(-0.5f, -0.5f, -0.5f), XMFLOAT3(0.5f, 0.5f, 0.5f), 0.87f);
+
+			camera.UpdateProjectionMatrix(16.0f / 9.0f);
+			camera.UpdateViewMatrix();
+		}
+
+		// Moves the box, renders the wall and returns whether the box was culled
+		bool BoxOccluded(XMFLOAT3 position)
+		{
+			transforms.SetPosition(box, position);
+			transforms.UpdateWorldMatrices();
+			culling.UpdateWorldBounds();
+
+			std::vector<unsigned char> visible(culling.GetSlotCount(), 1);
+			occlusion.Render(camera.GetView(), camera.GetProjection(), visible);
+			occlusion.Cull(visible);
+			return visible[box] == 0;
+		}
+	};
+}
+
+TEST_CASE(OcclusionWallHidesWhatsBehindIt)
+{
+	WallScene scene(false);
+	CHECK(scene.BoxOccluded(XMFLOAT3(0, 0, 10)));
+	CHECK(scene.BoxOccluded(XMFLOAT3(2, -2, 30)));
+	CHECK(scene.occlusion.GetRasterizedTriangleCount() == 2);
+
+	// The wall itself isn't hidden by itself
+	std::vector<unsigned char> visible(scene.culling.GetSlotCount(), 1);
+	scene.occlusion.Cull(visible);
+	CHECK(visible[scene.wallTransform] == 1);
+}
+
+TEST_CASE(OcclusionKeepsWhatsInFrontOrAround)
+{
+	WallScene scene(false);
+
+	// In front of the wall, poking out past its edge, and straddling the camera
+	CHECK(!scene.BoxOccluded(XMFLOAT3(0, 0, 3)));
+	CHECK(!scene.BoxOccluded(XMFLOAT3(4, 0, 10)));
+	CHECK(!scene.BoxOccluded(XMFLOAT3(0, 0, 0)));
+}
+
+TEST_CASE(OcclusionSkipsBackFacingWalls)
+{
+	// Seen from behind (like a room's shell from outside) a wall hides nothing
+	WallScene scene(true);
+	CHECK(!scene.BoxOccluded(XMFLOAT3(0, 0, 10)));
+	CHECK(scene.occlusion.GetRasterizedTriangleCount() == 0);
+}
+
+TEST_CASE(OcclusionSkipsOccludersOutOfView)
+{
+	// Occluders the frustum cull dropped aren't rasterized
+	WallScene scene(false);
+	scene.transforms.SetPosition(scene.box, XMFLOAT3(0, 0, 10));
+	scene.transforms.UpdateWorldMatrices();
+	scene.culling.UpdateWorldBounds();
+
+	std::vector<unsigned char> visible(scene.culling.GetSlotCount(), 1);
+	visible[scene.wallTransform] = 0;
+	scene.occlusion.Render(scene.camera.GetView(), scene.camera.GetProjection(), visible);
+	CHECK(scene.occlusion.Cull(visible) == 0);
+	CHECK(visible[scene.box] == 1);
+}
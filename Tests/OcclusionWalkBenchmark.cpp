@@ -0,0 +1,183 @@
+#include "Harness.h"
+#include "Camera.h"
+#include "CullingSystem.h"
+#include "OcclusionCuller.h"
+#include "SceneGenerator.h"
+#include "TransformSystem.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Just the names the generator looks for; geometry comes from MeshBox
+	const char* paletteText =
+		"mesh painting_small_h painting_small_h.obj\n"
+		"mesh painting_large painting_large.obj\n"
+		"mesh bench bench.obj\n"
+		"mesh cube_inverted cube_inverted.obj\n"
+		"mesh sculpture1 sculpture1.obj\n"
+		"material white white.png spec.png normal.png\n"
+		"material bench wood.png spec.png normal.png\n"
+		"material particle fire.png spec.png normal.png particle\n"
+		"material painting_0 painting_0.png spec.png normal.png\n"
+		"material marble marble.png spec.png normal.png\n";
+
+	// Rough local boxes of the gallery's meshes, in the palette's order
+	void MeshBox(unsigned int mesh, XMFLOAT3* min, XMFLOAT3* max)
+	{
+		switch (mesh)
+		{
+		case 0: *min = XMFLOAT3(-0.05f, -0.5f, -0.75f); *max = XMFLOAT3(0.05f, 0.5f, 0.75f); break;
+		case 1: *min = XMFLOAT3(-1.0f, -0.75f, -0.05f); *max = XMFLOAT3(1.0f, 0.75f, 0.05f); break;
+		case 2: *min = XMFLOAT3(-1.0f, 0.0f, -0.3f); *max = XMFLOAT3(1.0f, 0.5f, 0.3f); break;
+		case 3: *min = XMFLOAT3(-1.0f, -1.0f, -1.0f); *max = XMFLOAT3(1.0f, 1.0f, 1.0f); break;
+		default: *min = XMFLOAT3(-0.5f, 0.0f, -0.5f); *max = XMFLOAT3(0.5f, 2.0f, 0.5f); break;
+		}
+	}
+
+	// The inverted cube, faces pointing in (front faces are the ones whose
+	// cross(b - a, c - a) points at the viewer)
+	std::vector<XMFLOAT3> InvertedCube()
+	{
+		std::vector<XMFLOAT3> positions;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			for (int side = -1; side <= 1; side += 2)
+			{
+				// Four corners of the face, going around it
+				XMFLOAT3 corners[4];
+				for (int c = 0; c < 4; c++)
+				{
+					float u = (c == 1 || c == 2) ? 1.0f : -1.0f;
+					float v = (c >= 2) ? 1.0f : -1.0f;
+					float p[3];
+					p[axis] = (float)side;
+					p[(axis + 1) % 3] = u;
+					p[(axis + 2) % 3] = v;
+					corners[c] = XMFLOAT3(p[0], p[1], p[2]);
+				}
+
+				XMFLOAT3 triangles[6] = { corners[0], corners[1], corners[2], corners[0], corners[2], corners[3] };
+				XMVECTOR a = XMLoadFloat3(&triangles[0]);
+				XMVECTOR normal = XMVector3Cross(
+					XMVectorSubtract(XMLoadFloat3(&triangles[1]), a),
+					XMVectorSubtract(XMLoadFloat3(&triangles[2]), a));
+
+				// Should face the middle, against the side it's on
+				bool flip = XMVectorGetByIndex(normal, axis) * side > 0;
+				for (int i = 0; i < 6; i++)
+				{
+					positions.push_back(triangles[flip ? 5 - i : i]);
+				}
+			}
+		}
+		return positions;
+	}
+}
+
+// A camera walking a generated gallery: along the first row of rooms
+// to room 0, then down the first column, looking side to side as it
+// goes.  Every frame is frustum culled and then occlusion culled
+// against the room shells.  Reported per frame: the share of all
+// draws the frustum removed, the share of the rest the occluders
+// removed, what was left, and what the occlusion pass cost.
+BENCHMARK_CASE(OcclusionWalk)
+{
+	unsigned int roomCounts[2] = { run.Size(16, 4), run.Size(64, 16) };
+	unsigned int framesPerRoom = run.Size(120, 30);
+	std::vector<XMFLOAT3> shell = InvertedCube();
+
+	printf("  %5s %6s %7s %8s %10s %10s %8s %12s\n",
+		"rooms", "draws", "frames", "in view", "frustum %", "occluded %", "drawn %", "occlusion us");
+	for (unsigned int r = 0; r < 2; r++)
+	{
+		Scene scene;
+		CHECK(scene.ParseText(paletteText, (unsigned int)strlen(paletteText)));
+
+		SceneGeneratorSettings settings;
+		settings.roomCount = roomCounts[r];
+		SceneGenerator generator(settings);
+		CHECK(generator.Generate(&scene));
+
+		TransformSystem transforms;
+		CullingSystem culling(&transforms);
+		OcclusionCuller occlusion(&transforms, &culling);
+		culling.SetThreadCount(1);
+		occlusion.SetThreadCount(1);
+
+		const std::vector<SceneEntity>& entities = scene.GetEntities();
+		for (size_t i = 0; i < entities.size(); i++)
+		{
+			const SceneEntity& e = entities[i];
+			unsigned int transform = transforms.Create();
+			transforms.SetPosition(transform, e.position);
+			transforms.SetRotation(transform, e.rotation);
+			transforms.SetScale(transform, e.scale);
+			if (e.mesh == SCENE_NONE) continue;
+
+			XMFLOAT3 min, max;
+			MeshBox(e.mesh, &min, &max);
+			float radius = sqrtf(fmaxf(min.x * min.x, max.x * max.x) + fmaxf(min.y * min.y, max.y * max.y) + fmaxf(min.z * min.z, max.z * max.z));
+			culling.SetLocalBounds(transform, min, max, radius);
+			if (e.mesh == 3) occlusion.AddOccluder(transform, &shell[0], (unsigned int)shell.size() / 3);
+		}
+		transforms.UpdateWorldMatrices();
+		culling.UpdateWorldBounds();
+
+		// The first row, east to west, then the first column north to south
+		unsigned int columns = (unsigned int)ceilf(sqrtf((float)roomCounts[r]));
+		std::vector<unsigned int> path;
+		for (unsigned int room = columns; room-- > 0;) path.push_back(room);
+		for (unsigned int room = columns; room < roomCounts[r]; room += columns) path.push_back(room);
+
+		Camera camera(0, 0, 0);
+		camera.UpdateProjectionMatrix(16.0f / 9.0f);
+		float yaw = 0.0f;
+
+		unsigned int frames = 0;
+		double inView = 0, occluded = 0, occlusionTime = 0;
+		std::vector<unsigned char> visible;
+		for (size_t leg = 0; leg + 1 < path.size(); leg++)
+		{
+			XMFLOAT3 from = generator.GetRoomCenter(path[leg]);
+			XMFLOAT3 to = generator.GetRoomCenter(path[leg + 1]);
+			float heading = atan2f(to.x - from.x, to.z - from.z);
+
+			for (unsigned int f = 0; f < framesPerRoom; f++)
+			{
+				float t = (float)f / framesPerRoom;
+				camera.SetPosition(XMFLOAT3(from.x + (to.x - from.x) * t, 1.6f, from.z + (to.z - from.z) * t));
+
+				// Sweep 60 degrees either side of the way it's walking
+				float target = heading + sinf(t * XM_2PI) * XM_PI / 3;
+				camera.RotateBy(0, target - yaw);
+				yaw = target;
+				camera.UpdateViewMatrix();
+
+				XMFLOAT4 planes[6];
+				camera.GetFrustumPlanes(planes);
+				inView += culling.Cull(planes, visible);
+
+				occlusionTime += MeasureMicroseconds(1, [&]()
+				{
+					occlusion.Render(camera.GetView(), camera.GetProjection(), visible);
+					occluded += occlusion.Cull(visible);
+				});
+				frames++;
+			}
+		}
+
+		double draws = culling.GetBoundedCount();
+		double perFrame = frames > 0 ? 1.0 / frames : 0.0;
+		printf("  %5u %6u %7u %8.1f %10.1f %10.1f %8.1f %12.1f\n",
+			roomCounts[r], (unsigned int)draws, frames, inView * perFrame,
+			100.0 * (1.0 - inView * perFrame / draws),
+			100.0 * occluded / inView,
+			100.0 * (inView - occluded) * perFrame / draws,
+			occlusionTime * perFrame);
+	}
+}
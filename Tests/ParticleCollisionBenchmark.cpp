@@ -0,0 +1,54 @@
+#include "Harness.h"
+#include "Emitter.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+// Update throughput of one big emitter falling onto the floor of a
+// small room, with collision off and with each response.  Six rooms
+// are given, and prefiltering leaves the collider just the one to test.
+BENCHMARK_CASE(ParticleCollision)
+{
+	unsigned int count = run.Size(100000, 10000);
+	const float dt = 1.0f / 60.0f;
+
+	std::vector<BoundingBox> boxes;
+	for (int i = 0; i < 6; i++)
+	{
+		float x = i * 10.0f;
+		boxes.push_back(BoundingBox(XMFLOAT3(x - 3.0f, 0.0f, -3.0f), XMFLOAT3(x + 3.0f, 5.0f, 3.0f)));
+	}
+	std::vector<BoundingBox*> rooms;
+	for (size_t i = 0; i < boxes.size(); i++) rooms.push_back(&boxes[i]);
+
+	const char* names[] = { "off", "bounce", "stick", "kill" };
+	printf("  %9s %8s %10s %14s\n", "particles", "response", "update us", "M particles/s");
+	for (int mode = 0; mode < 4; mode++)
+	{
+		ID3D11Device device;
+		ParticlePool pool(&device, count + PARTICLE_BLOCK_SIZE, PARTICLE_OVERFLOW_DROP);
+		Emitter* emitter = new Emitter(
+			XMFLOAT3(0.0f, 2.0f, 0.0f),
+			XMFLOAT3(0.0f, 0.05f, 0.0f),
+			XMFLOAT4(1, 1, 1, 1),
+			XMFLOAT4(1, 1, 1, 0),
+			0.1f, 0.1f,
+			count, count / 3.0f, 3.0f,
+			&pool, nullptr, nullptr, nullptr);
+		emitter->SetSpread(91, 10.0f);
+		emitter->SetGravity(0.002f);
+		emitter->Seed(1);
+
+		if (mode > 0) emitter->SetCollision((ParticleCollisionResponse)(mode - 1), rooms, 0.0f);
+
+		// Fill up first, so plenty are already on the floor or at the walls
+		for (unsigned int f = 0; f < 200; f++) emitter->Update(dt);
+
+		unsigned int living = emitter->GetParticleCount();
+		double us = MeasureMicroseconds(15, [&]() { emitter->Update(dt); });
+		printf("  %9u %8s %10.0f %14.1f\n", living, names[mode], us, living / us);
+
+		delete emitter;
+	}
+}
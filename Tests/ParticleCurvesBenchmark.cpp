@@ -0,0 +1,98 @@
+#include "Harness.h"
+#include "Emitter.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// The update before curves: a divide per particle, then a lerp for
+	// color and size between the start and end values
+	void LerpUpdate(std::vector<Particle>& particles, float dt, float lifetime,
+		XMFLOAT4 startColor, XMFLOAT4 endColor, float startSize, float endSize)
+	{
+		for (size_t i = 0; i < particles.size(); i++)
+		{
+			Particle* particle = &particles[i];
+			particle->age += dt;
+			particle->position.x += particle->velocity.x;
+			particle->position.y += particle->velocity.y;
+			particle->position.z += particle->velocity.z;
+
+			float agePercent = particle->age / lifetime;
+			particle->size = (startSize * (1.0f - agePercent)) + (endSize * agePercent);
+			XMStoreFloat4(&particle->color, XMVectorLerp(XMLoadFloat4(&startColor), XMLoadFloat4(&endColor), agePercent));
+		}
+	}
+
+	Emitter* MakeEmitter(ParticlePool* pool, unsigned int count)
+	{
+		// Enough emission that count particles are alive at once
+		return new Emitter(
+			XMFLOAT3(0.0f, 0.0f, 0.0f),
+			XMFLOAT3(0.0f, 0.01f, 0.0f),
+			XMFLOAT4(1.0f, 0.6f, 0.1f, 1.0f),
+			XMFLOAT4(0.3f, 0.0f, 0.0f, 0.0f),
+			0.2f, 0.05f,
+			count, count / 2.0f, 2.0f,
+			pool, nullptr, nullptr, nullptr);
+	}
+}
+
+// Nanoseconds per particle for one update of a full emitter: the old
+// divide-and-lerp, the same two-key ramp from the baked tables, and a
+// five-key gradient with a size curve and a speed curve on top
+BENCHMARK_CASE(ParticleCurves)
+{
+	unsigned int count = run.Size(100000, 10000);
+	const float dt = 1.0f / 60.0f;
+
+	printf("  %9s %14s %14s %14s\n", "particles", "lerp ns", "2-key LUT ns", "5-key+curves ns");
+
+	std::vector<Particle> particles(count);
+	for (unsigned int i = 0; i < count; i++)
+	{
+		particles[i].position = XMFLOAT3(0, 0, 0);
+		particles[i].velocity = XMFLOAT3(0.001f, 0.01f, 0.0f);
+		particles[i].age = 2.0f * i / count;
+	}
+	double lerp = MeasureMicroseconds(15, [&]()
+	{
+		LerpUpdate(particles, dt, 1e9f, XMFLOAT4(1.0f, 0.6f, 0.1f, 1.0f), XMFLOAT4(0.3f, 0.0f, 0.0f, 0.0f), 0.2f, 0.05f);
+	});
+
+	double perParticle[2];
+	for (unsigned int pass = 0; pass < 2; pass++)
+	{
+		ID3D11Device device;
+		ParticlePool pool(&device, count + PARTICLE_BLOCK_SIZE, PARTICLE_OVERFLOW_DROP);
+		Emitter* emitter = MakeEmitter(&pool, count);
+
+		if (pass == 1)
+		{
+			ParticleColorKey colors[5] = {
+				{ 0.0f, XMFLOAT4(1.0f, 1.0f, 0.8f, 1.0f) },
+				{ 0.1f, XMFLOAT4(1.0f, 0.7f, 0.2f, 1.0f) },
+				{ 0.4f, XMFLOAT4(0.9f, 0.3f, 0.0f, 0.8f) },
+				{ 0.7f, XMFLOAT4(0.3f, 0.3f, 0.3f, 0.4f) },
+				{ 1.0f, XMFLOAT4(0.2f, 0.2f, 0.2f, 0.0f) } };
+			ParticleCurveKey sizes[3] = { { 0.0f, 0.1f }, { 0.3f, 0.4f }, { 1.0f, 0.05f } };
+			ParticleCurveKey speeds[2] = { { 0.0f, 1.0f }, { 1.0f, 0.2f } };
+			emitter->SetColorGradient(colors, 5);
+			emitter->SetSizeCurve(sizes, 3);
+			emitter->SetSpeedCurve(speeds, 2);
+		}
+
+		// Fill up to a steady state first
+		for (unsigned int f = 0; f < 150; f++) emitter->Update(dt);
+
+		unsigned int living = emitter->GetParticleCount();
+		double us = MeasureMicroseconds(15, [&]() { emitter->Update(dt); });
+		perParticle[pass] = us * 1000.0 / living;
+
+		delete emitter;
+	}
+
+	printf("  %9u %14.2f %14.2f %14.2f\n", count, lerp * 1000.0 / count, perParticle[0], perParticle[1]);
+}
@@ -0,0 +1,68 @@
+#include "Harness.h"
+#include "Emitter.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+// 500 live emitters of mixed sizes sharing one pool, run for ten seconds
+// of 60Hz ticks.  Reports the pool's real peak against what sizing every
+// emitter for its own maximum would take, and the tick cost, with a pool
+// big enough for everyone and with one half that size that has to steal.
+BENCHMARK_CASE(PoolPeakUsage)
+{
+	unsigned int emitterCount = run.Size(500, 50);
+	unsigned int ticks = run.Size(600, 120);
+
+	printf("  %8s %6s %8s %12s %12s %12s %10s\n", "emitters", "policy", "budget", "peak KB", "pool KB", "per-max KB", "tick us");
+	for (unsigned int pass = 0; pass < 2; pass++)
+	{
+		// Caps of 100 to 1000 particles; only the fast, long-lived ones get near theirs
+		unsigned int worstCase = 0;
+		for (unsigned int i = 0; i < emitterCount; i++) worstCase += 100 + (i * 7919) % 901;
+
+		unsigned int budget = pass == 0 ? worstCase : worstCase / 2;
+		ParticleOverflowPolicy policy = pass == 0 ? PARTICLE_OVERFLOW_DROP : PARTICLE_OVERFLOW_STEAL;
+
+		ID3D11Device device;
+		ParticlePool pool(&device, budget, policy);
+		pool.SetViewPosition(XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+		std::vector<Emitter*> emitters;
+		for (unsigned int i = 0; i < emitterCount; i++)
+		{
+			float rate = 5.0f + (i * 104729) % 200;
+			float lifetime = 0.5f + (i % 17) * 0.25f;
+			Emitter* emitter = new Emitter(
+				XMFLOAT3((float)(i % 25) * 4.0f, 1.0f, (float)(i / 25) * 4.0f),
+				XMFLOAT3(0.0f, 0.02f, 0.0f),
+				XMFLOAT4(1, 1, 1, 1),
+				XMFLOAT4(1, 1, 1, 0),
+				0.2f, 0.1f,
+				100 + (i * 7919) % 901, rate, lifetime,
+				&pool, nullptr, nullptr, nullptr);
+			emitter->Seed(i);
+			emitters.push_back(emitter);
+		}
+
+		double total = 0.0;
+		for (unsigned int t = 0; t < ticks; t++)
+		{
+			total += MeasureMicroseconds(1, [&]()
+			{
+				for (unsigned int i = 0; i < emitters.size(); i++) emitters[i]->Update(1.0f / 60.0f);
+			});
+		}
+
+		// Same bytes per particle as the pool itself spends
+		size_t perParticle = pool.GetMemoryUsage() / ((size_t)pool.GetBlockCount() * PARTICLE_BLOCK_SIZE);
+		size_t peak = (size_t)pool.GetPeakLeasedBlockCount() * PARTICLE_BLOCK_SIZE * perParticle;
+
+		printf("  %8u %6s %8u %12.0f %12.0f %12.0f %10.1f\n",
+			emitterCount, pass == 0 ? "drop" : "steal", budget,
+			peak / 1024.0, pool.GetMemoryUsage() / 1024.0, (double)worstCase * perParticle / 1024.0,
+			total / ticks);
+
+		for (unsigned int i = 0; i < emitters.size(); i++) delete emitters[i];
+	}
+}
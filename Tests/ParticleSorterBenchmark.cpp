@@ -0,0 +1,132 @@
+#include "Harness.h"
+#include "Emitter.h"
+#include "Parallel.h"
+#include "ParticleSorter.h"
+
+#include <algorithm>
+#include <float.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	unsigned int NextRandom(unsigned int& state)
+	{
+		state = state * 1664525u + 1013904223u;
+		return state >> 8;
+	}
+}
+
+// Sort time at 100K and 1M particles: a fresh order (full radix sort),
+// a frame where everything drifted a little (carried-over order), and
+// one where a few particles jumped across the whole depth range
+BENCHMARK_CASE(SortParticles)
+{
+	unsigned int sizes[] = { run.Size(100000, 10000), run.Size(1000000, 50000) };
+	unsigned int threads = GetHardwareThreadCount();
+
+	printf("  %9s %7s %12s %12s %12s %12s\n", "particles", "threads", "fresh us", "drift us", "jumps us", "std::sort us");
+	for (unsigned int s = 0; s < 2; s++)
+	{
+		unsigned int count = sizes[s];
+		std::vector<unsigned int> living(count);
+		std::vector<float> depths(count);
+		unsigned int state = 12345;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			living[i] = i;
+			depths[i] = (NextRandom(state) % 100000) * 0.001f;
+		}
+
+		// One thread, then every hardware thread
+		for (unsigned int pass = 0; pass < (threads > 1 ? 2u : 1u); pass++)
+		{
+			unsigned int t = pass == 0 ? 1 : threads;
+			ParticleSorter sorter(count);
+			sorter.SetThreadCount(t);
+
+			double fresh = MeasureMicroseconds(5, [&]()
+			{
+				// New indices every run, so nothing carries over
+				for (unsigned int i = 0; i < count; i++) living[i] += count;
+				sorter.Sort(living.data(), depths.data(), count);
+			});
+
+			// Camera creeping forward: depths shift a hair, with a little noise
+			std::vector<float> drifted(depths);
+			double drift = MeasureMicroseconds(5, [&]()
+			{
+				for (unsigned int i = 0; i < count; i++)
+					drifted[i] += 0.0001f + (NextRandom(state) % 3) * 0.00001f;
+				sorter.Sort(living.data(), drifted.data(), count);
+			});
+
+			// One particle in a thousand jumps to the other end of the range (and back)
+			std::vector<float> jumped(drifted);
+			double jumps = MeasureMicroseconds(5, [&]()
+			{
+				for (unsigned int i = 0; i < count; i += 1000)
+					jumped[i] = 200.0f - jumped[i];
+				sorter.Sort(living.data(), jumped.data(), count);
+			});
+
+			std::vector<float> copy(depths);
+			double reference = MeasureMicroseconds(5, [&]()
+			{
+				copy = depths;
+				std::sort(copy.begin(), copy.end());
+			});
+
+			printf("  %9u %7u %12.0f %12.0f %12.0f %12.0f\n", count, t, fresh, drift, jumps, reference);
+		}
+	}
+}
+
+// A whole alpha-blended emitter, the way the game draws one: the time
+// to fill its slots in the pool in spawn order, then sorted back-to-front
+// (depth pass, sort and copy), with the camera behind the spray
+BENCHMARK_CASE(SortedEmitterCopy)
+{
+	unsigned int sizes[] = { run.Size(10000, 2000), run.Size(100000, 10000) };
+
+	printf("  %9s %12s %12s\n", "particles", "unsorted us", "sorted us");
+	for (unsigned int s = 0; s < 2; s++)
+	{
+		unsigned int count = sizes[s];
+		ID3D11Device device;
+		ParticlePool pool(&device, count, PARTICLE_OVERFLOW_DROP);
+		Camera camera(0, 0, -5);
+
+		// Spawns enough in a second to fill itself, spread out in depth
+		Emitter* emitter = new Emitter(
+			XMFLOAT3(0.0f, 0.0f, 0.0f),
+			XMFLOAT3(0.0f, 0.01f, 0.05f),
+			XMFLOAT4(0.35f, 0.35f, 0.35f, 0.6f), XMFLOAT4(0.2f, 0.2f, 0.2f, 0.0f),
+			0.6f, 1.8f,
+			count, (float)count, 4.0f,
+			&pool, nullptr, nullptr, nullptr);
+		emitter->SetSpread(91, 2.0f);
+		for (unsigned int t = 0; t < 60; t++) emitter->Update(1.0f / 60.0f);
+
+		double unsorted = MeasureMicroseconds(5, [&]() { emitter->CopyParticlesToPool(&camera); });
+
+		emitter->SetDepthSorted(true);
+		double sorted = MeasureMicroseconds(5, [&]() { emitter->CopyParticlesToPool(&camera); });
+
+		// The view is the identity, so back-to-front is by falling z
+		bool ordered = true;
+		float previous = FLT_MAX;
+		for (unsigned int i = 0; i < emitter->GetParticleCount(); i++)
+		{
+			unsigned int slot = (unsigned int)(emitter->GetParticle(i) - pool.GetParticle(0));
+			float z = pool.GetVertices(slot)[0].position.z;
+			ordered = ordered && z <= previous + 0.01f;
+			previous = z;
+		}
+		CHECK(ordered);
+
+		printf("  %9u %12.0f %12.0f\n", emitter->GetParticleCount(), unsorted, sorted);
+		delete emitter;
+	}
+}
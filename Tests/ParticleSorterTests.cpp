@@ -0,0 +1,121 @@
+#include "Harness.h"
+#include "ParticleSorter.h"
+
+#include <algorithm>
+#include <float.h>
+#include <vector>
+
+namespace
+{
+	// Depths 0 to count - 1, shuffled
+	void MakeParticles(unsigned int count, unsigned int seed, std::vector<unsigned int>& living, std::vector<float>& depths)
+	{
+		living.resize(count);
+		depths.resize(count);
+		for (unsigned int i = 0; i < count; i++)
+		{
+			living[i] = i * 3 + 1;		// Spread out, like indices in the shared pool
+			depths[i] = (float)i;
+		}
+
+		// Fixed shuffle
+		unsigned int state = seed;
+		for (unsigned int i = count - 1; i > 0; i--)
+		{
+			state = state * 1664525u + 1013904223u;
+			std::swap(depths[i], depths[(state >> 8) % (i + 1)]);
+		}
+	}
+
+	bool IsBackToFront(ParticleSorter& sorter, const std::vector<unsigned int>& living, const std::vector<float>& depths)
+	{
+		std::vector<float> depthOf(*std::max_element(living.begin(), living.end()) + 1, -FLT_MAX);
+		for (size_t i = 0; i < living.size(); i++) depthOf[living[i]] = depths[i];
+
+		// Depths are quantized to 16 bits over their range, so
+		// neighbours within a step of each other can go either way
+		float nearest = *std::min_element(depths.begin(), depths.end());
+		float farthest = *std::max_element(depths.begin(), depths.end());
+		float step = (farthest - nearest) / 65535.0f;
+
+		if (sorter.GetCount() != living.size()) return false;
+		const unsigned int* order = sorter.GetOrder();
+		for (unsigned int i = 0; i < sorter.GetCount(); i++)
+		{
+			if (order[i] >= depthOf.size() || depthOf[order[i]] == -FLT_MAX) return false;
+			if (i > 0 && depthOf[order[i]] > depthOf[order[i - 1]] + step) return false;
+		}
+		return true;
+	}
+}
+
+TEST_CASE(SorterOrdersBackToFront)
+{
+	unsigned int counts[] = { 2, 100, 20000, 70000 };
+	for (unsigned int c = 0; c < 4; c++)
+	{
+		std::vector<unsigned int> living;
+		std::vector<float> depths;
+		MakeParticles(counts[c], c + 1, living, depths);
+
+		ParticleSorter sorter(16);
+		sorter.SetThreadCount(4);
+		sorter.Sort(living.data(), depths.data(), counts[c]);
+		CHECK(IsBackToFront(sorter, living, depths));
+	}
+}
+
+TEST_CASE(SorterFixesUpSmallChanges)
+{
+	std::vector<unsigned int> living;
+	std::vector<float> depths;
+	MakeParticles(10000, 7, living, depths);
+
+	ParticleSorter sorter(10000 * 3 + 1);
+	sorter.Sort(living.data(), depths.data(), 10000);
+
+	// A few neighbours trade places, one dies and one is born
+	for (unsigned int i = 0; i < 40; i++)
+	{
+		unsigned int a = (i * 2477) % 10000;
+		for (unsigned int b = 0; b < 10000; b++)
+		{
+			if (depths[b] == depths[a] + 1.0f)
+			{
+				std::swap(depths[a], depths[b]);
+				break;
+			}
+		}
+	}
+	living.pop_back();
+	depths.pop_back();
+	living.push_back(10000 * 3 + 5);
+	depths.push_back(10000.0f);
+
+	sorter.Sort(living.data(), depths.data(), (unsigned int)living.size());
+	CHECK(IsBackToFront(sorter, living, depths));
+
+	// Nothing changed at all
+	sorter.Sort(living.data(), depths.data(), (unsigned int)living.size());
+	CHECK(IsBackToFront(sorter, living, depths));
+}
+
+TEST_CASE(SorterSurvivesLongMoves)
+{
+	// Few keys out of place, but each has to cross the whole array:
+	// the insertion sort has to give up and leave a whole order behind
+	std::vector<unsigned int> living;
+	std::vector<float> depths;
+	MakeParticles(50000, 3, living, depths);
+
+	ParticleSorter sorter(16);
+	sorter.Sort(living.data(), depths.data(), 50000);
+
+	for (unsigned int i = 0; i < 50000; i += 1000)
+	{
+		depths[i] = depths[i] < 25000.0f ? depths[i] + 50000.0f : depths[i] - 50000.0f;
+	}
+
+	sorter.Sort(living.data(), depths.data(), 50000);
+	CHECK(IsBackToFront(sorter, living, depths));
+}
@@ -0,0 +1,94 @@
+#include "Harness.h"
+#include "Pool.h"
+#include "Random.h"
+
+#include <vector>
+
+namespace
+{
+	// About the size of an entity: a cached world matrix and some state
+	struct Thing
+	{
+		float world[16];
+		float position[3];
+		float rotation[3];
+		float scale[3];
+		unsigned int transform;
+		unsigned int material;
+		unsigned int mesh;
+
+		Thing(unsigned int transform)
+		{
+			for (int i = 0; i < 16; i++) world[i] = (float)(i % 5 == 0);
+			for (int i = 0; i < 3; i++) position[i] = rotation[i] = scale[i] = 0;
+			this->transform = transform;
+			material = mesh = 0;
+		}
+	};
+}
+
+// Things made and destroyed every frame, a twentieth of them at a time,
+// while everything alive is read once a frame through what refers to
+// it: pool handles against pointers from new.  Reports the churn and
+// the pass over everything, per frame.
+BENCHMARK_CASE(PoolChurn)
+{
+	unsigned int sizes[2] = { run.Size(10000, 1000), run.Size(100000, 5000) };
+	unsigned int frames = run.Size(200, 20);
+
+	printf("  %7s %8s %10s %10s\n", "things", "storage", "churn us", "read us");
+	for (unsigned int s = 0; s < 2; s++)
+	{
+		unsigned int count = sizes[s];
+		unsigned int churn = count / 20;
+
+		for (unsigned int mode = 0; mode < 2; mode++)
+		{
+			Random random(s + 1);
+			Pool<Thing> pool;
+			std::vector<unsigned int> handles;
+			std::vector<Thing*> pointers;
+			for (unsigned int i = 0; i < count; i++)
+			{
+				if (mode == 0) handles.push_back(pool.Create(i));
+				else pointers.push_back(new Thing(i));
+			}
+
+			double churnTime = 0, readTime = 0;
+			unsigned int sum = 0;
+			for (unsigned int f = 0; f < frames; f++)
+			{
+				churnTime += MeasureMicroseconds(1, [&]()
+				{
+					for (unsigned int c = 0; c < churn; c++)
+					{
+						unsigned int i = random.NextInt(0, count - 1);
+						if (mode == 0)
+						{
+							pool.Destroy(handles[i]);
+							handles[i] = pool.Create(i);
+						}
+						else
+						{
+							delete pointers[i];
+							pointers[i] = new Thing(i);
+						}
+					}
+				});
+
+				readTime += MeasureMicroseconds(1, [&]()
+				{
+					for (unsigned int i = 0; i < count; i++)
+					{
+						const Thing* thing = mode == 0 ? pool.Get(handles[i]) : pointers[i];
+						sum += thing->transform + (unsigned int)thing->world[0];
+					}
+				});
+			}
+
+			printf("  %7u %8s %10.1f %10.1f\n", count, mode == 0 ? "pool" : "new", churnTime / frames, readTime / frames);
+			CHECK(sum == frames * (count * (count - 1) / 2 + count));
+			for (unsigned int i = 0; i < pointers.size(); i++) delete pointers[i];
+		}
+	}
+}
@@ -0,0 +1,70 @@
+#include "Harness.h"
+#include "Pool.h"
+
+#include <vector>
+
+namespace
+{
+	// Counts how many are alive, to catch double and missed destroys
+	struct Counted
+	{
+		static int living;
+		int value;
+
+		Counted(int value) { this->value = value; living++; }
+		~Counted() { living--; }
+	};
+	int Counted::living = 0;
+}
+
+// One object made and destroyed over and over (the worst case for
+// generations wrapping) never brings an old handle back to life.
+TEST_CASE(PoolStaleHandlesStayStale)
+{
+	Pool<Counted> pool;
+	unsigned int first = pool.Create(0);
+	pool.Destroy(first);
+
+	bool stale = true;
+	for (int i = 1; i < 100000; i++)
+	{
+		unsigned int handle = pool.Create(i);
+		stale = stale && !pool.IsValid(first) && pool.Get(first) == 0;
+		pool.Destroy(handle);
+	}
+	CHECK(stale);
+	CHECK(pool.GetCount() == 0);
+	CHECK(Counted::living == 0);
+}
+
+// Handles find what they were made for through churn, and everything
+// is destroyed exactly once.
+TEST_CASE(PoolHandlesSurviveChurn)
+{
+	{
+		Pool<Counted> pool;
+		std::vector<unsigned int> handles;
+		for (int i = 0; i < 1000; i++) handles.push_back(pool.Create(i));
+
+		// Every other one goes, and as many again come back
+		for (int i = 0; i < 1000; i += 2) pool.Destroy(handles[i]);
+		for (int i = 0; i < 1000; i += 2)
+		{
+			CHECK(!pool.IsValid(handles[i]));
+			handles[i] = pool.Create(i);
+		}
+
+		bool found = true;
+		for (int i = 0; i < 1000; i++) found = found && pool.Get(handles[i]) && pool.Get(handles[i])->value == i;
+		CHECK(found);
+		CHECK(pool.GetCount() == 1000);
+		CHECK(Counted::living == 1000);
+
+		// Destroying twice, or a null handle, does nothing
+		pool.Destroy(handles[1]);
+		pool.Destroy(handles[1]);
+		pool.Destroy(POOL_NULL_HANDLE);
+		CHECK(Counted::living == 999);
+	}
+	CHECK(Counted::living == 0);
+}
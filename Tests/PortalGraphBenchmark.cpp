@@ -0,0 +1,124 @@
+#include "Harness.h"
+#include "Camera.h"
+#include "CullingSystem.h"
+#include "PortalGraph.h"
+#include "SceneGenerator.h"
+#include "TransformSystem.h"
+
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Just the names the generator looks for; every mesh gets the same box
+	const char* paletteText =
+		"mesh painting_small_h painting_small_h.obj\n"
+		"mesh painting_large painting_large.obj\n"
+		"mesh bench bench.obj\n"
+		"mesh cube_inverted cube_inverted.obj\n"
+		"mesh sculpture1 sculpture1.obj\n"
+		"material white white.png spec.png normal.png\n"
+		"material bench wood.png spec.png normal.png\n"
+		"material particle fire.png spec.png normal.png particle\n"
+		"material painting_0 painting_0.png spec.png normal.png\n"
+		"material marble marble.png spec.png normal.png\n";
+}
+
+// A generated gallery with the camera walking down its first column of
+// rooms.  Per frame: the flood out from the camera's room, the cull of
+// everything filed under rooms, and refiling what moved when a tenth
+// of the bounded transforms shuffle about.  Build is timed once.
+BENCHMARK_CASE(PortalFlood)
+{
+	unsigned int roomCounts[3] = { run.Size(16, 4), run.Size(64, 16), run.Size(256, 16) };
+	unsigned int frames = run.Size(240, 30);
+
+	printf("  %5s %6s %8s %8s %10s %8s %10s\n",
+		"rooms", "draws", "build us", "seen", "flood us", "cull us", "refile us");
+	for (unsigned int r = 0; r < 3; r++)
+	{
+		Scene scene;
+		CHECK(scene.ParseText(paletteText, (unsigned int)strlen(paletteText)));
+
+		SceneGeneratorSettings settings;
+		settings.roomCount = roomCounts[r];
+		SceneGenerator generator(settings);
+		CHECK(generator.Generate(&scene));
+
+		TransformSystem transforms;
+		CullingSystem culling(&transforms);
+		PortalGraph portals(&culling);
+		culling.SetThreadCount(1);
+
+		std::vector<unsigned int> bounded;
+		const std::vector<SceneEntity>& entities = scene.GetEntities();
+		for (size_t i = 0; i < entities.size(); i++)
+		{
+			const SceneEntity& e = entities[i];
+			unsigned int transform = transforms.Create();
+			transforms.SetPosition(transform, e.position);
+			transforms.SetRotation(transform, e.rotation);
+			transforms.SetScale(transform, e.scale);
+			if (e.mesh == SCENE_NONE) continue;
+
+			culling.SetLocalBounds(transform, XMFLOAT3(-0.5f, 0, -0.5f), XMFLOAT3(0.5f, 1, 0.5f), 1.23f);
+			bounded.push_back(transform);
+		}
+
+		const std::vector<SceneBounds>& bounds = scene.GetBounds();
+		for (size_t i = 0; i < bounds.size(); i++)
+		{
+			if (bounds[i].type == SCENE_BOUNDS_EXHIBIT) continue;
+			if (bounds[i].type == SCENE_BOUNDS_DOORWAY) portals.AddDoorway(bounds[i].min, bounds[i].max);
+			else portals.AddRoom(bounds[i].min, bounds[i].max);
+		}
+		transforms.UpdateWorldMatrices();
+		culling.UpdateWorldBounds();
+		double build = MeasureMicroseconds(1, [&]() { portals.Build(); });
+
+		// Down the first column, turning slowly side to side
+		unsigned int columns = (unsigned int)ceilf(sqrtf((float)roomCounts[r]));
+		XMFLOAT3 from = generator.GetRoomCenter(0);
+		XMFLOAT3 to = generator.GetRoomCenter((roomCounts[r] - 1) / columns * columns);
+		Camera camera(from.x, 1.6f, from.z);
+		camera.UpdateProjectionMatrix(16.0f / 9.0f);
+
+		double seen = 0, flood = 0, cull = 0, refile = 0;
+		std::vector<unsigned char> visible;
+		for (unsigned int f = 0; f < frames; f++)
+		{
+			float t = (float)f / frames;
+			camera.SetPosition(XMFLOAT3(from.x + (to.x - from.x) * t, 1.6f, from.z + (to.z - from.z) * t));
+			camera.RotateBy(0, cosf(t * XM_2PI * 4) * 0.02f);
+			camera.UpdateViewMatrix();
+
+			// A different tenth each frame nudges over
+			for (size_t i = f % 10; i < bounded.size(); i += 10)
+			{
+				XMFLOAT3 p = transforms.GetPosition(bounded[i]);
+				transforms.SetPosition(bounded[i], XMFLOAT3(p.x + ((f / 10) % 2 ? 0.1f : -0.1f), p.y, p.z));
+			}
+			transforms.UpdateWorldMatrices();
+			culling.UpdateWorldBounds();
+			refile += MeasureMicroseconds(1, [&]() { portals.UpdateMembers(); });
+
+			flood += MeasureMicroseconds(1, [&]()
+			{
+				portals.FindVisibleRooms(camera.GetPosition(), camera.GetView(), camera.GetProjection());
+			});
+			seen += portals.GetVisibleRoomCount();
+
+			XMFLOAT4 planes[6];
+			camera.GetFrustumPlanes(planes);
+			culling.Cull(planes, visible);
+			cull += MeasureMicroseconds(1, [&]() { portals.Cull(visible); });
+		}
+
+		printf("  %5u %6u %8.1f %8.1f %10.2f %8.2f %10.2f\n",
+			roomCounts[r], culling.GetBoundedCount(), build,
+			seen / frames, flood / frames, cull / frames, refile / frames);
+	}
+}
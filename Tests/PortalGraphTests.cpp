@@ -0,0 +1,99 @@
+#include "Harness.h"
+#include "Camera.h"
+#include "CullingSystem.h"
+#include "PortalGraph.h"
+#include "TransformSystem.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Two rooms with no doorway between them: the camera's, around the
+	// origin, and a closed one straight ahead of it (past z = 20).
+	// The camera looks down +z, so both are in its frustum.
+	struct ClosedRoomScene
+	{
+		TransformSystem transforms;
+		CullingSystem culling;
+		PortalGraph portals;
+		Camera camera;
+		std::vector<unsigned char> visible;
+
+		ClosedRoomScene()
+			: culling(&transforms), portals(&culling), camera(0, 1.6f, -4)
+		{
+			portals.AddRoom(XMFLOAT3(-5, 0, -5), XMFLOAT3(5, 0, 5));
+			portals.AddRoom(XMFLOAT3(-5, 0, 20), XMFLOAT3(5, 0, 30));
+			camera.UpdateProjectionMatrix(16.0f / 9.0f);
+			camera.UpdateViewMatrix();
+		}
+
+		unsigned int AddBox(XMFLOAT3 position)
+		{
+			unsigned int box = transforms.Create();
+			transforms.SetPosition(box, position);
+			culling.SetLocalBounds(box, XMFLOAT3(-0.5f, 0, -0.5f), XMFLOAT3(0.5f, 1, 0.5f), 1.23f);
+			return box;
+		}
+
+		// Runs a frame the way the game does and returns whether the box
+		// was hidden behind the walls
+		bool Hidden(unsigned int box)
+		{
+			transforms.UpdateWorldMatrices();
+			culling.UpdateWorldBounds();
+			portals.UpdateMembers();
+
+			portals.FindVisibleRooms(camera.GetPosition(), camera.GetView(), camera.GetProjection());
+			visible.assign(culling.GetSlotCount(), 1);
+			portals.Cull(visible);
+			return !visible[box];
+		}
+	};
+}
+
+// Something walking from the camera's room into the closed one is
+// hidden once it's there, and seen again when it walks back.
+TEST_CASE(PortalRefilesMovedMembers)
+{
+	ClosedRoomScene scene;
+	unsigned int box = scene.AddBox(XMFLOAT3(0, 0, 2));
+	scene.transforms.UpdateWorldMatrices();
+	scene.culling.UpdateWorldBounds();
+	scene.portals.Build();
+	CHECK(!scene.Hidden(box));
+
+	scene.transforms.SetPosition(box, XMFLOAT3(0, 0, 25));
+	CHECK(scene.Hidden(box));
+
+	scene.transforms.SetPosition(box, XMFLOAT3(0, 0, 2));
+	CHECK(!scene.Hidden(box));
+}
+
+// Things given bounds after the graph was built are filed too, and a
+// slot whose bounds were cleared and then reused is filed by its new
+// owner, not its old one.
+TEST_CASE(PortalFilesNewAndReusedSlots)
+{
+	ClosedRoomScene scene;
+	unsigned int first = scene.AddBox(XMFLOAT3(0, 0, 2));
+	scene.transforms.UpdateWorldMatrices();
+	scene.culling.UpdateWorldBounds();
+	scene.portals.Build();
+
+	unsigned int late = scene.AddBox(XMFLOAT3(0, 0, 25));
+	CHECK(scene.Hidden(late));
+	CHECK(!scene.Hidden(first));
+
+	// The closed room's box goes away; its slot isn't filed anywhere now
+	scene.culling.ClearBounds(late);
+	scene.transforms.Release(late);
+	CHECK(!scene.Hidden(late));
+
+	// And a box in the camera's room takes the slot over
+	unsigned int reused = scene.AddBox(XMFLOAT3(1, 0, 1));
+	CHECK(reused == late);
+	CHECK(!scene.Hidden(reused));
+}
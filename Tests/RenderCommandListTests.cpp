@@ -0,0 +1,156 @@
+#include "Harness.h"
+#include "NullRenderBackend.h"
+#include "Parallel.h"
+#include "RenderCommandList.h"
+
+#include <vector>
+
+namespace
+{
+	// Stand-ins for shaders, views and buffers; the backend only
+	// ever sees their addresses
+	struct FakeFrame
+	{
+		int shaders[2];
+		int textures[8];
+		int meshes[4];
+		int sampler;
+
+		// Per draw, sorted the way the queue sorts them
+		std::vector<unsigned int> shaderOf;
+		std::vector<unsigned int> materialOf;
+		std::vector<unsigned int> meshOf;
+		std::vector<float> worlds;
+
+		FakeFrame(unsigned int drawCount)
+		{
+			for (unsigned int i = 0; i < drawCount; i++)
+			{
+				shaderOf.push_back(i * 2 / drawCount);
+				materialOf.push_back(i * 8 / drawCount);
+				meshOf.push_back((i / 7) % 4);
+				for (int m = 0; m < 16; m++) worlds.push_back((float)(i * 16 + m));
+			}
+		}
+
+		// Like Game::RecordOpaque: binds only what differs from the draw
+		// before it in the slice (so the first binds everything), then
+		// sends that draw's world matrix and draws it
+		void Record(unsigned int begin, unsigned int end, RenderCommandList* list)
+		{
+			list->Clear();
+			const int* boundShader = 0;
+			int boundMaterial = -1;
+			const int* boundMesh = 0;
+			for (unsigned int i = begin; i < end; i++)
+			{
+				const int* shader = &shaders[shaderOf[i]];
+				if (shader != boundShader)
+				{
+					float view[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+					list->SetConstant(shader, "view", view, sizeof(view));
+					list->SetShader(shader);
+					boundShader = shader;
+				}
+				if ((int)materialOf[i] != boundMaterial)
+				{
+					list->SetSampler(shader, "basicSampler", &sampler);
+					list->SetTexture(shader, "diffuseTexture", &textures[materialOf[i]]);
+					boundMaterial = materialOf[i];
+				}
+				if (&meshes[meshOf[i]] != boundMesh)
+				{
+					list->SetGeometry(&meshes[meshOf[i]], &meshes[meshOf[i]] + 1, 32);
+					boundMesh = &meshes[meshOf[i]];
+				}
+
+				list->SetConstant(shader, "world", &worlds[i * 16], sizeof(float) * 16);
+				list->UploadConstants(shader, "perObject");
+				list->Draw(36 + meshOf[i], 0, 0);
+			}
+		}
+	};
+
+	// Plays the lists back in order and returns the hash of all of it
+	unsigned long long Replay(std::vector<RenderCommandList*>& lists, NullRenderBackend& backend)
+	{
+		backend.Reset();
+		for (size_t i = 0; i < lists.size(); i++) lists[i]->Execute(&backend);
+		return backend.GetHash();
+	}
+}
+
+// A list played back makes the same calls, with the same constant data,
+// as making them on the backend directly, even once the data it was
+// given has been overwritten.
+TEST_CASE(CommandListReplaysWhatWasRecorded)
+{
+	int shader = 0, view = 0, sampler = 0, vertices = 0, indices = 0;
+	float world[4] = { 1, 2, 3, 4 };
+
+	NullRenderBackend direct;
+	direct.SetShader(&shader);
+	direct.SetConstant(&shader, "world", world, sizeof(world));
+	direct.UploadConstants(&shader, 0);
+	direct.SetTexture(&shader, "diffuseTexture", &view);
+	direct.SetSampler(&shader, "basicSampler", &sampler);
+	direct.SetGeometry(&vertices, &indices, 32);
+	direct.Draw(36, 4, 2);
+
+	RenderCommandList list;
+	list.SetShader(&shader);
+	list.SetConstant(&shader, "world", world, sizeof(world));
+	list.UploadConstants(&shader, 0);
+	list.SetTexture(&shader, "diffuseTexture", &view);
+	list.SetSampler(&shader, "basicSampler", &sampler);
+	list.SetGeometry(&vertices, &indices, 32);
+	list.Draw(36, 4, 2);
+	world[0] = 99;
+
+	NullRenderBackend replayed;
+	list.Execute(&replayed);
+	CHECK(replayed.GetHash() == direct.GetHash());
+	CHECK(replayed.GetCommandCount() == direct.GetCommandCount());
+	CHECK(replayed.GetDrawCount() == 1);
+	CHECK(replayed.GetInstanceCount() == 4);
+}
+
+// A frame split into slices and recorded on four threads plays back
+// exactly like the same slices recorded one after another on one.
+TEST_CASE(CommandListsRecordTheSameInParallel)
+{
+	unsigned int drawCount = 5000;
+	unsigned int workers = 4;
+	FakeFrame frame(drawCount);
+
+	std::vector<unsigned int> sliceStarts(workers + 1);
+	for (unsigned int w = 0; w <= workers; w++) sliceStarts[w] = drawCount * w / workers;
+
+	std::vector<RenderCommandList*> lists;
+	for (unsigned int w = 0; w < workers; w++) lists.push_back(new RenderCommandList());
+
+	NullRenderBackend backend;
+	for (unsigned int w = 0; w < workers; w++) frame.Record(sliceStarts[w], sliceStarts[w + 1], lists[w]);
+	unsigned long long serial = Replay(lists, backend);
+	unsigned int serialCommands = backend.GetCommandCount();
+	CHECK(backend.GetDrawCount() == drawCount);
+
+	// Several times, so a race has a chance to show
+	for (int attempt = 0; attempt < 8; attempt++)
+	{
+		RunParallel(workers, [&](unsigned int w)
+		{
+			frame.Record(sliceStarts[w], sliceStarts[w + 1], lists[w]);
+		});
+		CHECK(Replay(lists, backend) == serial);
+		CHECK(backend.GetCommandCount() == serialCommands);
+	}
+
+	// And one list for the whole frame binds less, so it hashes differently
+	std::vector<RenderCommandList*> whole(1, lists[0]);
+	frame.Record(0, drawCount, whole[0]);
+	CHECK(Replay(whole, backend) != serial);
+	CHECK(backend.GetDrawCount() == drawCount);
+
+	for (unsigned int w = 0; w < workers; w++) delete lists[w];
+}
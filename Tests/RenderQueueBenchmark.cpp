@@ -0,0 +1,180 @@
+#include "Harness.h"
+#include "RenderQueue.h"
+#include "SceneGenerator.h"
+
+#include <algorithm>
+#include <math.h>
+#include <string.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Just the names the generator looks for
+	const char* paletteText =
+		"mesh painting_small_h painting_small_h.obj\n"
+		"mesh painting_large painting_large.obj\n"
+		"mesh bench bench.obj\n"
+		"mesh cube_inverted cube_inverted.obj\n"
+		"mesh sculpture1 sculpture1.obj\n"
+		"material white white.png spec.png normal.png\n"
+		"material bench wood.png spec.png normal.png\n"
+		"material particle fire.png spec.png normal.png particle\n"
+		"material painting_0 painting_0.png spec.png normal.png\n"
+		"material painting_1 painting_1.png spec.png normal.png\n"
+		"material painting_2 painting_2.png spec.png normal.png\n"
+		"material marble marble.png spec.png normal.png\n";
+
+	// The game's opaque draws: what each one's key is made of
+	struct Draw
+	{
+		unsigned int pass;
+		unsigned int shader;
+		unsigned int material;
+		unsigned int mesh;
+		XMFLOAT3 position;
+	};
+
+	// Binds Game::RecordOpaque makes going down the queue in order
+	// (without instancing): vertex shader, pixel shader and pass,
+	// material, mesh
+	unsigned int CountBinds(RenderQueue& queue, const std::vector<Draw>& draws)
+	{
+		unsigned int binds = 0;
+		const Draw* previous = 0;
+		for (unsigned int i = 0; i < queue.GetCount(); i++)
+		{
+			const Draw& draw = draws[queue.GetItem(i)];
+			if (!previous || draw.shader != previous->shader) binds += 2;
+			else if (draw.pass != previous->pass) binds++;
+			if (!previous || draw.material != previous->material) binds++;
+			if (!previous || draw.mesh != previous->mesh) binds++;
+			previous = &draw;
+		}
+		return binds;
+	}
+}
+
+// Every opaque draw of a generated gallery, keyed from a camera in
+// its first room: the time to fill the queue and radix sort it (next
+// to std::sort on the same keys), and the binds per frame drawing
+// them one by one takes against going down the sorted queue.
+BENCHMARK_CASE(RenderQueueSort)
+{
+	unsigned int roomCounts[4] = { run.Size(16, 4), run.Size(64, 16), run.Size(256, 16), run.Size(1024, 16) };
+	unsigned int runs = run.Size(50, 5);
+
+	printf("  %5s %6s %9s %9s %10s %10s %8s\n",
+		"rooms", "draws", "fill us", "sort us", "std::sort", "binds", "sorted");
+	for (unsigned int r = 0; r < 4; r++)
+	{
+		Scene scene;
+		CHECK(scene.ParseText(paletteText, (unsigned int)strlen(paletteText)));
+
+		SceneGeneratorSettings settings;
+		settings.roomCount = roomCounts[r];
+		SceneGenerator generator(settings);
+		CHECK(generator.Generate(&scene));
+
+		// Positions are only local, but that's enough to spread the depths
+		std::vector<Draw> draws;
+		const std::vector<SceneEntity>& entities = scene.GetEntities();
+		const std::vector<SceneMaterial>& materials = scene.GetMaterials();
+		for (size_t i = 0; i < entities.size(); i++)
+		{
+			const SceneEntity& e = entities[i];
+			if (e.mesh == SCENE_NONE || materials[e.material].translucent) continue;
+
+			Draw draw = { e.group == SCENE_GROUP_EXHIBIT ? 1u : 0u, materials[e.material].shader, e.material, e.mesh, e.position };
+			draws.push_back(draw);
+		}
+
+		XMFLOAT3 camera = generator.GetRoomCenter(0);
+		RenderQueue queue;
+		double fill = MeasureMicroseconds(runs, [&]()
+		{
+			queue.Clear();
+			for (unsigned int i = 0; i < draws.size(); i++)
+			{
+				float dx = draws[i].position.x - camera.x;
+				float dz = draws[i].position.z - camera.z;
+				queue.Add(draws[i].pass, draws[i].shader, draws[i].material, draws[i].mesh, sqrtf(dx * dx + dz * dz) / 100.0f, i);
+			}
+		});
+		std::vector<unsigned long long> unsorted(queue.GetCount());
+		for (unsigned int i = 0; i < unsorted.size(); i++) unsorted[i] = queue.GetKey(i);
+
+		// LSD radix sort makes the same passes whatever order the keys are in,
+		// so sorting the sorted queue again costs the same
+		double sort = MeasureMicroseconds(runs, [&]() { queue.Sort(); });
+
+		std::vector<unsigned long long> keys;
+		double stdSort = MeasureMicroseconds(runs, [&]()
+		{
+			keys = unsorted;
+			std::sort(keys.begin(), keys.end());
+		});
+
+		bool ordered = true;
+		for (unsigned int i = 1; i < queue.GetCount(); i++) ordered = ordered && queue.GetKey(i - 1) <= queue.GetKey(i);
+		CHECK(ordered);
+
+		printf("  %5u %6u %9.1f %9.1f %10.1f %10u %8u\n",
+			roomCounts[r], (unsigned int)draws.size(), fill, sort, stdSort,
+			(unsigned int)draws.size() * 4, CountBinds(queue, draws));
+	}
+}
+
+// The same sorted queues, counting the draw calls once runs of draws
+// that share a pass, material and mesh on the standard shader go as one
+// instanced call (Game::ContinuesRun), and the time to find the runs.
+BENCHMARK_CASE(InstancedDraws)
+{
+	unsigned int roomCounts[4] = { run.Size(16, 4), run.Size(64, 16), run.Size(256, 16), run.Size(1024, 16) };
+	unsigned int runs = run.Size(50, 5);
+
+	printf("  %5s %6s %10s %10s %8s\n", "rooms", "draws", "instanced", "reduction", "runs us");
+	for (unsigned int r = 0; r < 4; r++)
+	{
+		Scene scene;
+		CHECK(scene.ParseText(paletteText, (unsigned int)strlen(paletteText)));
+
+		SceneGeneratorSettings settings;
+		settings.roomCount = roomCounts[r];
+		SceneGenerator generator(settings);
+		CHECK(generator.Generate(&scene));
+
+		std::vector<Draw> draws;
+		const std::vector<SceneEntity>& entities = scene.GetEntities();
+		const std::vector<SceneMaterial>& materials = scene.GetMaterials();
+		RenderQueue queue;
+		for (size_t i = 0; i < entities.size(); i++)
+		{
+			const SceneEntity& e = entities[i];
+			if (e.mesh == SCENE_NONE || materials[e.material].translucent) continue;
+
+			Draw draw = { e.group == SCENE_GROUP_EXHIBIT ? 1u : 0u, materials[e.material].shader, e.material, e.mesh, e.position };
+			queue.Add(draw.pass, draw.shader, draw.material, draw.mesh, 0.5f, (unsigned int)draws.size());
+			draws.push_back(draw);
+		}
+		queue.Sort();
+
+		unsigned int calls = 0;
+		double time = MeasureMicroseconds(runs, [&]()
+		{
+			calls = 0;
+			for (unsigned int i = 0; i < queue.GetCount(); i++)
+			{
+				const Draw& draw = draws[queue.GetItem(i)];
+				const Draw* previous = i > 0 ? &draws[queue.GetItem(i - 1)] : 0;
+				bool continues = previous && draw.shader == SCENE_SHADER_STANDARD &&
+					draw.pass == previous->pass && draw.material == previous->material && draw.mesh == previous->mesh;
+				calls += !continues;
+			}
+		});
+
+		printf("  %5u %6u %10u %9.1fx %8.1f\n",
+			roomCounts[r], (unsigned int)draws.size(), calls, (double)draws.size() / calls, time);
+	}
+}
@@ -0,0 +1,143 @@
+#include "Harness.h"
+#include "SceneGenerator.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Just the names the generator looks for
+	const char* paletteText =
+		"mesh painting_small_h painting_small_h.obj\n"
+		"mesh painting_large painting_large.obj\n"
+		"mesh bench bench.obj\n"
+		"mesh cube_inverted cube_inverted.obj\n"
+		"mesh sculpture1 sculpture1.obj\n"
+		"material white white.png spec.png normal.png\n"
+		"material bench wood.png spec.png normal.png\n"
+		"material particle fire.png spec.png normal.png particle\n"
+		"material painting_0 painting_0.png spec.png normal.png\n"
+		"material marble marble.png spec.png normal.png\n";
+
+	std::vector<char> ReadFile(const char* path)
+	{
+		std::vector<char> bytes;
+		FILE* file = fopen(path, "rb");
+		if (!file) return bytes;
+		char buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) bytes.insert(bytes.end(), buffer, buffer + read);
+		fclose(file);
+		return bytes;
+	}
+
+	// A generated gallery, saved and read back as bytes
+	std::vector<char> GeneratedBytes(SceneGeneratorSettings settings, const char* path)
+	{
+		Scene scene;
+		CHECK(scene.ParseText(paletteText, (unsigned int)strlen(paletteText)));
+
+		SceneGenerator generator(settings);
+		CHECK(generator.Generate(&scene));
+		CHECK(scene.SaveBinary(path));
+
+		std::vector<char> bytes = ReadFile(path);
+		remove(path);
+		return bytes;
+	}
+
+	// Walkable boxes touch when they overlap or share an edge on the floor
+	bool Touch(const SceneBounds& a, const SceneBounds& b)
+	{
+		return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.z <= b.max.z && b.min.z <= a.max.z;
+	}
+
+	bool Contains(const SceneBounds& box, XMFLOAT3 point)
+	{
+		return point.x >= box.min.x && point.x <= box.max.x && point.z >= box.min.z && point.z <= box.max.z;
+	}
+}
+
+// The same settings and seed give the same gallery byte for byte, a
+// different seed gives another, and what's generated loads back.
+TEST_CASE(SceneGeneratorIsReproducible)
+{
+	const char* path = "SceneGeneratorIsReproducible.gscn";
+	SceneGeneratorSettings settings;
+	settings.roomCount = 40;
+	settings.emittersPerRoom = 1.0f;
+
+	std::vector<char> first = GeneratedBytes(settings, path);
+	std::vector<char> second = GeneratedBytes(settings, path);
+	CHECK(!first.empty());
+	CHECK(first == second);
+
+	settings.seed = 2;
+	CHECK(GeneratedBytes(settings, path) != first);
+
+	// The binary reader range-checks every record, emitters included
+	Scene scene;
+	CHECK(scene.ParseText(paletteText, (unsigned int)strlen(paletteText)));
+	SceneGenerator generator(settings);
+	CHECK(generator.Generate(&scene));
+	CHECK(scene.SaveBinary(path));
+
+	Scene loaded;
+	CHECK(loaded.Load(path));
+	CHECK(loaded.GetEntities().size() == scene.GetEntities().size());
+	CHECK(loaded.GetEmitters().size() >= 40);
+	remove(path);
+}
+
+// Every room can be walked to from room 0 through the floor and
+// doorway bounds, at any gallery size.
+TEST_CASE(SceneGeneratorReachesEveryRoom)
+{
+	unsigned int roomCounts[3] = { 1, 7, 150 };
+	for (int r = 0; r < 3; r++)
+	{
+		Scene scene;
+		CHECK(scene.ParseText(paletteText, (unsigned int)strlen(paletteText)));
+
+		SceneGeneratorSettings settings;
+		settings.roomCount = roomCounts[r];
+		settings.extraDoorwayChance = 0.0f;
+		SceneGenerator generator(settings);
+		CHECK(generator.Generate(&scene));
+
+		std::vector<SceneBounds> walkable;
+		const std::vector<SceneBounds>& bounds = scene.GetBounds();
+		for (size_t i = 0; i < bounds.size(); i++)
+		{
+			if (bounds[i].type != SCENE_BOUNDS_EXHIBIT) walkable.push_back(bounds[i]);
+		}
+
+		// Flood out from whatever room 0 stands in
+		std::vector<bool> reached(walkable.size(), false);
+		std::vector<size_t> open;
+		for (size_t i = 0; i < walkable.size(); i++)
+		{
+			if (Contains(walkable[i], generator.GetRoomCenter(0))) { reached[i] = true; open.push_back(i); }
+		}
+		CHECK(!open.empty());
+		while (!open.empty())
+		{
+			size_t box = open.back();
+			open.pop_back();
+			for (size_t i = 0; i < walkable.size(); i++)
+			{
+				if (!reached[i] && Touch(walkable[box], walkable[i])) { reached[i] = true; open.push_back(i); }
+			}
+		}
+
+		for (unsigned int room = 0; room < roomCounts[r]; room++)
+		{
+			bool found = false;
+			for (size_t i = 0; i < walkable.size() && !found; i++) found = reached[i] && Contains(walkable[i], generator.GetRoomCenter(room));
+			CHECK(found);
+		}
+	}
+}
@@ -0,0 +1,57 @@
+#include "Harness.h"
+#include "Scene.h"
+
+#include <stdio.h>
+#include <string>
+
+// A gallery of 10K and 100K entities, saved as text and as binary:
+// the time to load each form from disk.
+BENCHMARK_CASE(SceneLoad)
+{
+	unsigned int sizes[2] = { run.Size(10000, 1000), run.Size(100000, 10000) };
+	unsigned int runs = run.Size(8, 2);
+	const char* textPath = "SceneLoad.txt";
+	const char* binaryPath = "SceneLoad.gscn";
+
+	printf("  %8s %10s %10s %10s %8s\n", "entities", "text KB", "text ms", "binary ms", "speedup");
+	for (unsigned int s = 0; s < 2; s++)
+	{
+		// A node per room, then exhibits and benches hung off them
+		std::string text =
+			"mesh cube cube.obj\n"
+			"mesh bench bench.obj\n"
+			"material white white.png spec.png normal.png\n"
+			"material wood wood.png spec.png normal.png\n";
+		char line[256];
+		for (unsigned int i = 0; i < sizes[s]; i++)
+		{
+			if (i % 100 == 0)
+				snprintf(line, sizeof(line), "node room%u position %u 0 %u\n", i / 100, (i / 100) % 32 * 14, (i / 100) / 32 * 14);
+			else if (i % 10 == 0)
+				snprintf(line, sizeof(line), "static - bench wood parent room%u position %.2f 0 %.2f rotation 0 1.57 0\n", i / 100, (i % 7) * 1.5f, (i % 5) * 1.5f);
+			else
+				snprintf(line, sizeof(line), "exhibit piece%u cube white parent room%u position %.2f 1 %.2f scale 0.5 0.5 0.5 spin 0.5\n", i, i / 100, (i % 7) * 1.5f, (i % 5) * 1.5f);
+			text += line;
+		}
+
+		FILE* file = fopen(textPath, "wb");
+		fwrite(text.data(), 1, text.size(), file);
+		fclose(file);
+
+		Scene scene;
+		CHECK(scene.ParseText(text.c_str(), (unsigned int)text.size()));
+		CHECK(scene.SaveBinary(binaryPath));
+
+		Scene loaded;
+		double textTime = MeasureMicroseconds(runs, [&]() { loaded.LoadText(textPath); });
+		CHECK(loaded.GetEntities().size() == sizes[s]);
+		double binaryTime = MeasureMicroseconds(runs, [&]() { loaded.LoadBinary(binaryPath); });
+		CHECK(loaded.GetEntities().size() == sizes[s]);
+
+		printf("  %8u %10u %10.2f %10.2f %7.1fx\n",
+			sizes[s], (unsigned int)(text.size() / 1024), textTime / 1000.0, binaryTime / 1000.0, textTime / binaryTime);
+	}
+
+	remove(textPath);
+	remove(binaryPath);
+}
@@ -0,0 +1,119 @@
+#include "Harness.h"
+#include "Scene.h"
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+	const char* sceneText =
+		"mesh cube cube.obj\n"
+		"material white white.png spec.png normal.png\n"
+		"material glass glass.png spec.png normal.png translucent\n"
+		"node center position 0 1 0\n"
+		"exhibit box cube white parent center position 1 0 0\n"
+		"static pane cube glass scale 2 2 0.1\n";
+
+	std::vector<char> ReadFile(const char* path)
+	{
+		std::vector<char> bytes;
+		FILE* file = fopen(path, "rb");
+		if (!file) return bytes;
+		char buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) bytes.insert(bytes.end(), buffer, buffer + read);
+		fclose(file);
+		return bytes;
+	}
+
+	void WriteFile(const char* path, const std::vector<char>& bytes)
+	{
+		FILE* file = fopen(path, "wb");
+		fwrite(bytes.data(), 1, bytes.size(), file);
+		fclose(file);
+	}
+
+	// The saved test scene's bytes, for tampering with
+	std::vector<char> SavedScene(const char* path)
+	{
+		Scene scene;
+		scene.ParseText(sceneText, (unsigned int)strlen(sceneText));
+		scene.SaveBinary(path);
+		return ReadFile(path);
+	}
+
+	// Where a header field sits (see SceneBinaryHeader): magic, version,
+	// string bytes, then the record counts in file order
+	unsigned int* HeaderField(std::vector<char>& bytes, unsigned int field)
+	{
+		return (unsigned int*)&bytes[field * sizeof(unsigned int)];
+	}
+
+	const unsigned int headerFields = 9;
+}
+
+TEST_CASE(SceneBinaryRoundTrips)
+{
+	const char* path = "SceneBinaryRoundTrips.gscn";
+	SavedScene(path);
+
+	Scene loaded;
+	CHECK(loaded.Load(path));
+	CHECK(loaded.GetEntities().size() == 3);
+	CHECK(loaded.GetMaterials().size() == 2);
+	CHECK(loaded.GetMaterials()[1].translucent == 1);
+	CHECK(loaded.FindEntity("box") == 1);
+	CHECK(loaded.GetEntities()[1].parent == 0);
+	CHECK(loaded.GetEntities()[0].position.y == 1.0f);
+	remove(path);
+}
+
+TEST_CASE(SceneRejectsCountsBiggerThanTheFile)
+{
+	// Huge counts have to fail on the file size, before anything is sized by them
+	const char* path = "SceneRejectsCountsBiggerThanTheFile.gscn";
+	std::vector<char> saved = SavedScene(path);
+
+	for (unsigned int field = 2; field < headerFields; field++)
+	{
+		std::vector<char> bytes = saved;
+		*HeaderField(bytes, field) = 0x7FFFFFFF;
+		WriteFile(path, bytes);
+
+		Scene scene;
+		CHECK(!scene.LoadBinary(path));
+		CHECK(scene.GetError().find("truncated") != std::string::npos);
+		CHECK(scene.GetEntities().empty());
+	}
+
+	// One record short
+	std::vector<char> bytes = saved;
+	bytes.resize(bytes.size() - 1);
+	WriteFile(path, bytes);
+	Scene scene;
+	CHECK(!scene.LoadBinary(path));
+	remove(path);
+}
+
+TEST_CASE(SceneRejectsBadMaterialFlags)
+{
+	const char* path = "SceneRejectsBadMaterialFlags.gscn";
+	std::vector<char> saved = SavedScene(path);
+	unsigned int materials = headerFields * sizeof(unsigned int) + *HeaderField(saved, 2) + *HeaderField(saved, 3) * sizeof(SceneMesh);
+
+	// Shader past the last one, then translucent that isn't 0 or 1
+	unsigned int offsets[2] = { offsetof(SceneMaterial, shader), offsetof(SceneMaterial, translucent) };
+	for (unsigned int i = 0; i < 2; i++)
+	{
+		std::vector<char> bytes = saved;
+		*(unsigned int*)&bytes[materials + offsets[i]] = 7;
+		WriteFile(path, bytes);
+
+		Scene scene;
+		CHECK(!scene.LoadBinary(path));
+		CHECK(scene.GetError().find("material") != std::string::npos);
+	}
+	remove(path);
+}
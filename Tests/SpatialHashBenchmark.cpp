@@ -0,0 +1,100 @@
+#include "Harness.h"
+#include "Random.h"
+#include "SpatialHash.h"
+
+#include <math.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// What DoExhibits used to do every frame: every exhibit's distance,
+	// with pow and sqrt, keeping the closest one in range
+	unsigned int NearestScan(const std::vector<XMFLOAT3>& exhibits, XMFLOAT3 position, float radius)
+	{
+		unsigned int nearest = SPATIAL_HASH_NONE;
+		float nearestDistance = radius;
+		for (unsigned int i = 0; i < exhibits.size(); i++)
+		{
+			float distance = (float)sqrt(pow(exhibits[i].x - position.x, 2) + pow(exhibits[i].z - position.z, 2));
+			if (distance < nearestDistance)
+			{
+				nearest = i;
+				nearestDistance = distance;
+			}
+		}
+		return nearest;
+	}
+}
+
+// Finding the exhibit the camera is at among 10K and 1M scattered
+// about one per rating cell: the old scan of all of them against the
+// hash's nearest and radius queries.  Then what it costs to move a
+// hundredth of them a little each frame.
+BENCHMARK_CASE(ExhibitLookup)
+{
+	unsigned int sizes[2] = { run.Size(10000, 1000), run.Size(1000000, 20000) };
+	unsigned int queries = run.Size(1000, 100);
+	float radius = 2.5f;
+
+	printf("  %8s %10s %10s %10s %10s %10s\n",
+		"exhibits", "scan us", "nearest us", "radius us", "found", "move us");
+	for (unsigned int s = 0; s < 2; s++)
+	{
+		Random random(s + 1);
+		float side = sqrtf((float)sizes[s]) * radius;
+		std::vector<XMFLOAT3> exhibits(sizes[s]);
+		SpatialHash grid(radius);
+		for (unsigned int i = 0; i < sizes[s]; i++)
+		{
+			exhibits[i] = XMFLOAT3(random.NextFloat(0, side), 0, random.NextFloat(0, side));
+			grid.Insert(i, exhibits[i]);
+		}
+
+		std::vector<XMFLOAT3> cameras(queries);
+		for (unsigned int q = 0; q < queries; q++)
+		{
+			cameras[q] = XMFLOAT3(random.NextFloat(0, side), 1.6f, random.NextFloat(0, side));
+		}
+
+		// The scan is slow at 1M, so it gets fewer cameras
+		unsigned int scanQueries = sizes[s] > 100000 ? queries / 20 : queries;
+		std::vector<unsigned int> scanned(scanQueries);
+		double scan = MeasureMicroseconds(1, [&]()
+		{
+			for (unsigned int q = 0; q < scanQueries; q++) scanned[q] = NearestScan(exhibits, cameras[q], radius);
+		}) / scanQueries;
+
+		std::vector<unsigned int> hashed(queries);
+		double nearest = MeasureMicroseconds(1, [&]()
+		{
+			for (unsigned int q = 0; q < queries; q++) hashed[q] = grid.FindNearest(cameras[q], radius);
+		}) / queries;
+
+		unsigned int mismatches = 0;
+		for (unsigned int q = 0; q < scanQueries; q++) mismatches += scanned[q] != hashed[q];
+
+		std::vector<unsigned int> found;
+		double radiusQuery = MeasureMicroseconds(1, [&]()
+		{
+			found.clear();
+			for (unsigned int q = 0; q < queries; q++) grid.QueryRadius(cameras[q], radius, found);
+		}) / queries;
+
+		unsigned int moving = sizes[s] / 100;
+		double move = MeasureMicroseconds(1, [&]()
+		{
+			for (unsigned int i = 0; i < moving; i++)
+			{
+				unsigned int id = i * 100;
+				exhibits[id].x += 0.3f;
+				grid.Move(id, exhibits[id]);
+			}
+		});
+
+		printf("  %8u %10.2f %10.3f %10.3f %10.2f %10.1f\n",
+			sizes[s], scan, nearest, radiusQuery, (double)found.size() / queries, move);
+		CHECK(mismatches == 0);
+	}
+}
@@ -0,0 +1,87 @@
+#include "Harness.h"
+#include "Camera.h"
+#include "TrailEmitter.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Sparks thrown up and out, emitting just fast enough to keep every slot alive
+	TrailEmitter* MakeSparks(ID3D11Device* device, XMFLOAT3 position, unsigned int trailCount, unsigned int points)
+	{
+		TrailEmitter* trails = new TrailEmitter(
+			position,
+			XMFLOAT3(0.0f, 3.0f, 0.0f),
+			XMFLOAT3(1.5f, 1.0f, 1.5f),
+			XMFLOAT4(1.0f, 0.8f, 0.3f, 1.0f),
+			XMFLOAT4(1.0f, 0.2f, 0.0f, 0.0f),
+			0.05f, 4.0f,
+			trailCount, points, 1.0f / 60.0f,
+			trailCount / 2.0f, 2.0f,
+			device, nullptr, nullptr, nullptr);
+
+		// Run past one lifetime so the ring is full
+		for (unsigned int t = 0; t < 150; t++) trails->Update(1.0f / 60.0f);
+		return trails;
+	}
+}
+
+// One emitter with 10K trails of 32 points: the per-frame cost of
+// ticking the heads and of rebuilding every camera-facing ribbon.
+// Then the same trails split over emitters all around the camera,
+// rebuilding all of them against only those in the view frustum.
+BENCHMARK_CASE(TrailRibbons)
+{
+	unsigned int trailCount = run.Size(10000, 1000);
+	unsigned int points = 32;
+	unsigned int runs = run.Size(32, 4);
+	ID3D11Device device;
+
+	Camera camera(0.0f, 1.5f, -8.0f);
+	camera.UpdateProjectionMatrix(16.0f / 9.0f);
+	camera.UpdateViewMatrix();
+
+	TrailEmitter* sparks = MakeSparks(&device, XMFLOAT3(0.0f, 0.0f, 0.0f), trailCount, points);
+	std::vector<TrailVertex> vertices(sparks->GetVertexCount());
+
+	double update = MeasureMicroseconds(runs, [&]() { sparks->Update(1.0f / 60.0f); });
+	double build = MeasureMicroseconds(runs, [&]() { sparks->BuildRibbons(&vertices[0], camera.GetPosition(), 0.5f); });
+
+	printf("  %8s %6s %10s %10s %10s\n", "trails", "points", "update us", "build us", "Mverts/s");
+	printf("  %8u %6u %10.1f %10.1f %10.1f\n",
+		trailCount, points, update, build, sparks->GetVertexCount() / build);
+	delete sparks;
+
+	// Eight emitters in a ring around the camera; three are in view
+	unsigned int emitterCount = 8;
+	std::vector<TrailEmitter*> ring;
+	for (unsigned int i = 0; i < emitterCount; i++)
+	{
+		float angle = XM_2PI * i / emitterCount;
+		ring.push_back(MakeSparks(&device, XMFLOAT3(sinf(angle) * 10.0f, 0.0f, cosf(angle) * 10.0f - 8.0f), trailCount / emitterCount, points));
+	}
+
+	XMFLOAT4 planes[6];
+	camera.GetFrustumPlanes(planes);
+
+	printf("  %8s %6s %10s %10s\n", "emitters", "mode", "drawn", "build us");
+	for (unsigned int mode = 0; mode < 2; mode++)
+	{
+		unsigned int drawn = 0;
+		double time = MeasureMicroseconds(runs, [&]()
+		{
+			drawn = 0;
+			for (unsigned int i = 0; i < emitterCount; i++)
+			{
+				if (mode == 1 && !ring[i]->InFrustum(planes)) continue;
+				ring[i]->BuildRibbons(&vertices[0], camera.GetPosition(), 0.5f);
+				drawn++;
+			}
+		});
+		printf("  %8u %6s %10u %10.1f\n", emitterCount, mode == 0 ? "all" : "culled", drawn, time);
+	}
+
+	for (unsigned int i = 0; i < emitterCount; i++) delete ring[i];
+}
@@ -0,0 +1,111 @@
+#include "Harness.h"
+#include "TransformSystem.h"
+
+#include <math.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// What every entity used to store and rebuild for itself
+	struct OldTransform
+	{
+		XMFLOAT3 position;
+		XMFLOAT3 rotation;
+		XMFLOAT3 scale;
+		XMFLOAT4X4 world;
+		bool dirty;
+	};
+
+	void OldUpdateWorldMatrix(OldTransform* transform)
+	{
+		if (!transform->dirty) return;
+
+		XMMATRIX rotation = XMMatrixMultiply(
+			XMMatrixMultiply(XMMatrixRotationX(transform->rotation.x), XMMatrixRotationY(transform->rotation.y)),
+			XMMatrixRotationZ(transform->rotation.z));
+		XMMATRIX w = XMMatrixMultiply(
+			XMMatrixMultiply(XMMatrixScaling(transform->scale.x, transform->scale.y, transform->scale.z), rotation),
+			XMMatrixTranslation(transform->position.x, transform->position.y, transform->position.z));
+
+		XMStoreFloat4x4(&transform->world, XMMatrixTranspose(w));
+		transform->dirty = false;
+	}
+
+	// Frame f's pose for entity i; everything spins and bobs every frame
+	void Pose(unsigned int i, unsigned int f, XMFLOAT3* position, XMFLOAT3* rotation, XMFLOAT3* scale)
+	{
+		float t = f * 0.016f + i * 0.001f;
+		*position = XMFLOAT3((float)(i % 316), sinf(t), (float)(i / 316));
+		*rotation = XMFLOAT3(t * 0.5f, t, t * 0.25f);
+		*scale = XMFLOAT3(1.0f, 1.0f + 0.1f * (i % 3), 1.0f);
+	}
+}
+
+// 100K dynamic entities, every one moving every frame: the old heap
+// allocated entities (reached through a vector of pointers, each
+// rebuilding its own matrix from three rotations and two multiplies)
+// against the SoA transform system's batched update.
+BENCHMARK_CASE(TransformUpdate)
+{
+	unsigned int entityCount = run.Size(100000, 10000);
+	unsigned int frames = run.Size(16, 4);
+
+	std::vector<OldTransform*> entities;
+	for (unsigned int i = 0; i < entityCount; i++)
+	{
+		OldTransform* transform = new OldTransform();
+		transform->dirty = true;
+		entities.push_back(transform);
+	}
+
+	TransformSystem transforms(entityCount);
+	std::vector<unsigned int> slots;
+	for (unsigned int i = 0; i < entityCount; i++) slots.push_back(transforms.Create());
+
+	// Poses are set outside the timing; only the matrix rebuilds are timed
+	double oldTime = 0.0;
+	double batchTime = 0.0;
+	for (unsigned int frame = 1; frame <= frames; frame++)
+	{
+		for (unsigned int i = 0; i < entityCount; i++)
+		{
+			OldTransform* transform = entities[i];
+			Pose(i, frame, &transform->position, &transform->rotation, &transform->scale);
+			transform->dirty = true;
+
+			transforms.SetPosition(slots[i], transform->position);
+			transforms.SetRotation(slots[i], transform->rotation);
+			transforms.SetScale(slots[i], transform->scale);
+		}
+
+		oldTime += MeasureMicroseconds(1, [&]()
+		{
+			for (unsigned int i = 0; i < entityCount; i++) OldUpdateWorldMatrix(entities[i]);
+		});
+		batchTime += MeasureMicroseconds(1, [&]() { transforms.UpdateWorldMatrices(); });
+	}
+	oldTime /= frames;
+	batchTime /= frames;
+
+	// Same matrices either way
+	float worst = 0.0f;
+	for (unsigned int i = 0; i < entityCount; i += 97)
+	{
+		XMFLOAT4X4 batched = transforms.GetWorldMatrix(slots[i]);
+		for (unsigned int e = 0; e < 16; e++)
+		{
+			float difference = fabsf((&batched._11)[e] - (&entities[i]->world._11)[e]);
+			if (difference > worst) worst = difference;
+		}
+	}
+
+	printf("  %8s %8s %10s %10s\n", "entities", "mode", "frame us", "ns each");
+	printf("  %8u %8s %10.1f %10.2f\n", entityCount, "entity", oldTime, oldTime * 1000.0 / entityCount);
+	printf("  %8u %8s %10.1f %10.2f\n", entityCount, "batched", batchTime, batchTime * 1000.0 / entityCount);
+	printf("  largest matrix difference %g\n", worst);
+	CHECK(worst < 1e-3f);
+
+	for (unsigned int i = 0; i < entityCount; i++) delete entities[i];
+}
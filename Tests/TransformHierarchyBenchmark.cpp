@@ -0,0 +1,101 @@
+#include "Harness.h"
+#include "TransformSystem.h"
+
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Shapes of hierarchy, all with about the same number of transforms
+	enum Shape
+	{
+		SHAPE_DEEP,		// Chains 64 long
+		SHAPE_WIDE,		// One root with everything else under it
+		SHAPE_TREE		// Every node has 8 children
+	};
+
+	const char* shapeNames[] = { "deep", "wide", "tree" };
+
+	// Creates the hierarchy and returns the roots
+	std::vector<unsigned int> Build(TransformSystem* transforms, Shape shape, unsigned int count)
+	{
+		std::vector<unsigned int> roots;
+		std::vector<unsigned int> nodes;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			unsigned int node = transforms->Create();
+			transforms->SetPosition(node, XMFLOAT3(0.0f, 1.0f, 0.0f));
+			transforms->SetRotation(node, XMFLOAT3(0.0f, 0.01f, 0.0f));
+
+			unsigned int parent = TRANSFORM_NO_PARENT;
+			if (shape == SHAPE_DEEP && i % 64 != 0) parent = nodes[i - 1];
+			if (shape == SHAPE_WIDE && i != 0) parent = nodes[0];
+			if (shape == SHAPE_TREE && i != 0) parent = nodes[(i - 1) / 8];
+
+			if (parent == TRANSFORM_NO_PARENT) roots.push_back(node);
+			else transforms->SetParent(node, parent);
+			nodes.push_back(node);
+		}
+
+		transforms->UpdateWorldMatrices();
+		return roots;
+	}
+}
+
+// Deep, wide and bushy hierarchies of 100K transforms.  Frame cost of
+// propagating when every root moves (so everything is dirty), when
+// only about 1% of the transforms move, and when nothing does, with
+// how many world matrices the 1% case recomputed.
+BENCHMARK_CASE(TransformHierarchy)
+{
+	unsigned int count = run.Size(100032, 10048);
+	unsigned int frames = run.Size(16, 4);
+
+	printf("  %5s %7s %6s %10s %10s %10s %8s\n", "shape", "roots", "levels", "all us", "some us", "still us", "changed");
+	for (unsigned int shape = 0; shape < 3; shape++)
+	{
+		TransformSystem transforms(count);
+		std::vector<unsigned int> roots = Build(&transforms, (Shape)shape, count);
+
+		// What moves in the "some" case, about 1% of the transforms: every
+		// 100th chain, every 100th child of the wide root, or one of the
+		// tree's 64 grandchildren (a 1/64 subtree)
+		std::vector<unsigned int> some;
+		if (shape == SHAPE_DEEP)
+		{
+			for (unsigned int i = 0; i < roots.size(); i += 100) some.push_back(roots[i]);
+		}
+		else if (shape == SHAPE_WIDE)
+		{
+			for (unsigned int i = 1; i < count; i += 100) some.push_back(i);
+		}
+		else
+		{
+			some.push_back(9);
+		}
+
+		float angle = 0.0f;
+		double times[3];
+		unsigned int changed = 0;
+		for (unsigned int mode = 0; mode < 3; mode++)
+		{
+			std::vector<unsigned int>& moving = mode == 0 ? roots : some;
+			times[mode] = MeasureMicroseconds(frames, [&]()
+			{
+				angle += 0.01f;
+				if (mode < 2)
+				{
+					for (unsigned int i = 0; i < moving.size(); i++)
+						transforms.SetRotation(moving[i], XMFLOAT3(0.0f, angle, 0.0f));
+				}
+				transforms.UpdateWorldMatrices();
+			});
+			if (mode == 1) changed = transforms.GetChangedCount();
+		}
+
+		printf("  %5s %7u %6u %10.1f %10.1f %10.1f %8u\n",
+			shapeNames[shape], (unsigned int)roots.size(), transforms.GetDepthCount(),
+			times[0], times[1], times[2], changed);
+	}
+}
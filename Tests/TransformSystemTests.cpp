@@ -0,0 +1,133 @@
+#include "Harness.h"
+#include "Random.h"
+#include "TransformSystem.h"
+
+#include <math.h>
+#include <vector>
+
+using namespace DirectX;
+
+namespace
+{
+	// Scale * RotX * RotY * RotZ * Translation, composed up the parent
+	// chain one matrix at a time, then transposed like the system stores it
+	XMFLOAT4X4 ComposeChain(TransformSystem& transforms, unsigned int index)
+	{
+		XMMATRIX world = XMMatrixIdentity();
+		for (unsigned int i = index; i != TRANSFORM_NO_PARENT; i = transforms.GetParent(i))
+		{
+			XMFLOAT3 p = transforms.GetPosition(i);
+			XMFLOAT3 r = transforms.GetRotation(i);
+			XMFLOAT3 s = transforms.GetScale(i);
+			XMMATRIX local =
+				XMMatrixScaling(s.x, s.y, s.z) *
+				XMMatrixRotationX(r.x) * XMMatrixRotationY(r.y) * XMMatrixRotationZ(r.z) *
+				XMMatrixTranslation(p.x, p.y, p.z);
+			world = world * local;
+		}
+
+		XMFLOAT4X4 result;
+		XMStoreFloat4x4(&result, XMMatrixTranspose(world));
+		return result;
+	}
+
+	// Largest difference between every live world matrix and its chain
+	float LargestDifference(TransformSystem& transforms, const std::vector<unsigned int>& nodes)
+	{
+		float largest = 0.0f;
+		for (unsigned int n = 0; n < nodes.size(); n++)
+		{
+			XMFLOAT4X4 expected = ComposeChain(transforms, nodes[n]);
+			XMFLOAT4X4 actual = transforms.GetWorldMatrix(nodes[n]);
+			for (int r = 0; r < 4; r++)
+				for (int c = 0; c < 4; c++)
+				{
+					float difference = fabsf(expected.m[r][c] - actual.m[r][c]);
+					if (difference > largest) largest = difference;
+				}
+		}
+		return largest;
+	}
+
+	void Pose(TransformSystem& transforms, Random& random, unsigned int index)
+	{
+		transforms.SetPosition(index, XMFLOAT3(random.NextFloat(-1, 1), random.NextFloat(-1, 1), random.NextFloat(-1, 1)));
+		transforms.SetRotation(index, XMFLOAT3(random.NextFloat(-3, 3), random.NextFloat(-3, 3), random.NextFloat(-3, 3)));
+		transforms.SetScale(index, XMFLOAT3(random.NextFloat(0.8f, 1.2f), random.NextFloat(0.8f, 1.2f), random.NextFloat(0.8f, 1.2f)));
+	}
+
+	bool IsUnder(TransformSystem& transforms, unsigned int index, unsigned int ancestor)
+	{
+		for (unsigned int i = index; i != TRANSFORM_NO_PARENT; i = transforms.GetParent(i))
+		{
+			if (i == ancestor) return true;
+		}
+		return false;
+	}
+}
+
+// A forest with parents at any index, against composing each chain by
+// hand: after building it, after moving a few transforms, and after
+// reparenting and releasing some.  Each partial batch reports exactly
+// the moved transforms and everything under them as changed.
+TEST_CASE(TransformsMatchTheirParentChains)
+{
+	Random random(11);
+	TransformSystem transforms(16);
+	std::vector<unsigned int> nodes;
+	for (unsigned int i = 0; i < 500; i++)
+	{
+		nodes.push_back(transforms.Create());
+		Pose(transforms, random, nodes.back());
+	}
+
+	// Refused when it would make a cycle, which leaves a forest
+	for (unsigned int i = 0; i < nodes.size(); i++)
+	{
+		if (random.NextFloat() < 0.8f) transforms.SetParent(nodes[i], nodes[(unsigned int)(random.NextFloat() * nodes.size())]);
+	}
+	CHECK(!transforms.SetParent(nodes[0], nodes[0]));
+
+	transforms.UpdateWorldMatrices();
+	CHECK(transforms.GetDepthCount() > 3);
+	CHECK(transforms.GetChangedCount() == nodes.size());
+	CHECK(LargestDifference(transforms, nodes) < 1e-4f);
+
+	for (int frame = 0; frame < 20; frame++)
+	{
+		std::vector<unsigned int> moved;
+		for (int m = 0; m < 3; m++)
+		{
+			moved.push_back(nodes[(unsigned int)(random.NextFloat() * nodes.size())]);
+			Pose(transforms, random, moved.back());
+		}
+		transforms.UpdateWorldMatrices();
+		CHECK(LargestDifference(transforms, nodes) < 1e-4f);
+
+		unsigned int expected = 0;
+		for (unsigned int n = 0; n < nodes.size(); n++)
+		{
+			bool under = false;
+			for (unsigned int m = 0; m < moved.size(); m++) under = under || IsUnder(transforms, nodes[n], moved[m]);
+			CHECK(transforms.WorldChanged(nodes[n]) == under);
+			expected += under;
+		}
+		CHECK(transforms.GetChangedCount() == expected);
+	}
+
+	// Nothing moved: nothing changed
+	transforms.UpdateWorldMatrices();
+	CHECK(!transforms.AnyWorldChanged());
+	CHECK(!transforms.WorldChanged(nodes[0]));
+
+	// Orphaned children keep their local transforms, now off the world
+	std::vector<unsigned int> kept;
+	for (unsigned int i = 0; i < nodes.size(); i++)
+	{
+		if (i % 7 == 0) transforms.Release(nodes[i]);
+		else kept.push_back(nodes[i]);
+	}
+	transforms.SetParent(kept[1], TRANSFORM_NO_PARENT);
+	transforms.UpdateWorldMatrices();
+	CHECK(LargestDifference(transforms, kept) < 1e-4f);
+}